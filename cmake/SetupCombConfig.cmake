@@ -34,6 +34,23 @@ if (ENABLE_CUDA)
   endif()
 endif()
 
+# MPI 4 partitioned communication
+if (ENABLE_MPI)
+  include(CheckCXXSymbolExists)
+  set(CMAKE_REQUIRED_INCLUDES ${MPI_C_INCLUDE_DIRS} ${MPI_C_INCLUDE_PATH} ${MPI_CXX_INCLUDE_DIRS} ${MPI_CXX_INCLUDE_PATH})
+  set(CMAKE_REQUIRED_LIBRARIES ${MPI_C_LIBRARIES} ${MPI_CXX_LIBRARIES})
+  check_cxx_symbol_exists(MPI_Psend_init mpi.h COMB_ENABLE_MPI_PARTITIONED)
+  unset(CMAKE_REQUIRED_LIBRARIES)
+  unset(CMAKE_REQUIRED_INCLUDES)
+endif()
+
+if (NOT (COMB_INDEX_BITS STREQUAL "32" OR COMB_INDEX_BITS STREQUAL "64"))
+  message(FATAL_ERROR "COMB_INDEX_BITS must be 32 or 64")
+endif()
+if (NOT (COMB_LOCAL_INDEX_BITS STREQUAL "16" OR COMB_LOCAL_INDEX_BITS STREQUAL "32" OR COMB_LOCAL_INDEX_BITS STREQUAL "64"))
+  message(FATAL_ERROR "COMB_LOCAL_INDEX_BITS must be 16, 32 or 64")
+endif()
+
 set(COMB_CXX_COMPILER ${CMAKE_CXX_COMPILER})
 set(COMB_CUDA_COMPILER ${CMAKE_CUDA_COMPILER})
 
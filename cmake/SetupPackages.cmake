@@ -22,6 +22,11 @@ if (ENABLE_MPI)
 endif()
 
 
+# the progress thread uses std::thread
+set(THREADS_PREFER_PTHREAD_FLAG ON)
+find_package(Threads REQUIRED)
+
+
 if (ENABLE_OPENMP)
   if(OPENMP_FOUND)
     message(STATUS "OpenMP Enabled")
@@ -18,6 +18,8 @@
 
 #include "config.hpp"
 
+#include <vector>
+
 #include "memory.hpp"
 #include "exec_utils.hpp"
 #include "MeshInfo.hpp"
@@ -76,11 +78,11 @@ struct Box3d
 
   void print(const char* name) const
   {
-    fgprintf(FileGroup::proc, "Box3d %32s local (%i %i %i)-(%i %i %i) info (%i %i %i)-(%i %i %i) global (%i %i %i)-(%i %i %i)\n",
+    fgprintf(FileGroup::proc, "Box3d %32s local (%li %li %li)-(%li %li %li) info (%li %li %li)-(%li %li %li) global (%li %li %li)-(%li %li %li)\n",
                      name,
-                     min[0], min[1], min[2], min[0]+sizes[0], min[1]+sizes[1], min[2]+sizes[2],
-                     info.min[0], info.min[1], info.min[2], info.max[0], info.max[1], info.max[2],
-                     info.global_min[0], info.global_min[1], info.global_min[2], info.global_max[0], info.global_max[1], info.global_max[2] );
+                     (long)min[0], (long)min[1], (long)min[2], (long)(min[0]+sizes[0]), (long)(min[1]+sizes[1]), (long)(min[2]+sizes[2]),
+                     (long)info.min[0], (long)info.min[1], (long)info.min[2], (long)info.max[0], (long)info.max[1], (long)info.max[2],
+                     (long)info.global_min[0], (long)info.global_min[1], (long)info.global_min[2], (long)info.global_max[0], (long)info.global_max[1], (long)info.global_max[2] );
   }
 
   void correct_periodicity()
@@ -90,6 +92,17 @@ struct Box3d
     info.correct_periodicity();
   }
 
+  // get the part of this box in [lo, hi) along dim, relative to min[dim]
+  Box3d slab(IdxT dim, IdxT lo, IdxT hi) const
+  {
+    assert(0 <= lo && lo <= hi && hi <= sizes[dim]);
+    IdxT smin[3] { min[0], min[1], min[2] };
+    IdxT smax[3] { min[0] + sizes[0], min[1] + sizes[1], min[2] + sizes[2] };
+    smin[dim] = min[dim] + lo;
+    smax[dim] = min[dim] + hi;
+    return Box3d{ info, smin, smax };
+  }
+
   // get the intersection between two boxes from the same GlobalMeshInfo
   // returns a box with indices in the local index space of this->info
   Box3d intersect(Box3d const& other) const
@@ -253,7 +266,10 @@ struct Box3d
 #ifdef COMB_ENABLE_MPI
   MPI_Datatype get_type_subarray() const
   {
-    MPI_Datatype mpi_type = detail::MPI::Type_create_subarray(3, info.len, sizes, min, MPI_ORDER_FORTRAN, MPI_DOUBLE);
+    int mpi_len[3]   {static_cast<int>(info.len[0]), static_cast<int>(info.len[1]), static_cast<int>(info.len[2])};
+    int mpi_sizes[3] {static_cast<int>(sizes[0]),    static_cast<int>(sizes[1]),    static_cast<int>(sizes[2])};
+    int mpi_min[3]   {static_cast<int>(min[0]),      static_cast<int>(min[1]),      static_cast<int>(min[2])};
+    MPI_Datatype mpi_type = detail::MPI::Type_create_subarray(3, mpi_len, mpi_sizes, mpi_min, MPI_ORDER_FORTRAN, MPI_DOUBLE);
     detail::MPI::Type_commit(&mpi_type);
     return mpi_type;
   }
@@ -278,6 +294,37 @@ struct Box3d
     //}
     con.synchronize();
   }
+
+  // describe this box as rows of contiguous zones instead of a list of indices
+  detail::box_rows get_rows() const
+  {
+    IdxT jstride = info.len[0];
+    IdxT kstride = info.len[0]*info.len[1];
+    return detail::box_rows{ min[0] + min[1]*jstride + min[2]*kstride
+                           , sizes[0]
+                           , sizes[1]
+                           , sizes[1]*sizes[2]
+                           , jstride
+                           , kstride };
+  }
+  // append the rows of this box to a list of spans of contiguous indices,
+  // merging rows that are contiguous in both the mesh and the buffer
+  void append_spans(std::vector<detail::index_span>& spans, IdxT offset) const
+  {
+    detail::box_rows rows = get_rows();
+    if (rows.ilen <= 0) return;
+    for (IdxT r = 0; r < rows.nrows; ++r) {
+      IdxT start = rows.row(r);
+      if (!spans.empty() && spans.back().offset + spans.back().len == offset
+                         && spans.back().start  + spans.back().len == start) {
+        spans.back().len += rows.ilen;
+      } else {
+        spans.push_back(detail::index_span{offset, start, rows.ilen});
+      }
+      offset += rows.ilen;
+    }
+  }
+
 };
 
 struct Box3dTemplate
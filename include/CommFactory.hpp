@@ -22,6 +22,7 @@
 #include <cstdlib>
 #include <cassert>
 #include <type_traits>
+#include <algorithm>
 #include <list>
 #include <vector>
 #include <map>
@@ -424,6 +425,55 @@ private:
     COMB::ignore_unused(comm);
     using message_item_type = detail::MessageItem<exec_policy>;
 
+    if (comb_allow_structured_packing()) {
+
+      // structured items describe each box directly, no indices needed
+      for (Box3d const& msg_box : data_item.boxes) {
+
+        IdxT size = msg_box.size();
+        IdxT nbytes = msg_group.zone_nbytes()*size; // data nbytes
+
+        msg_group.add_message_item(
+            partner_rank,
+            message_item_type{size, nbytes, msg_box.get_rows(), mesh_aloc});
+      }
+      return;
+    }
+
+    if (comb_allow_span_packing()) {
+
+      // compress the boxes into spans of contiguous indices, remembering
+      // where the spans of each box begin, buffer offsets restart for each
+      // box unless the boxes are combined into one item
+      std::vector<detail::index_span> spans;
+      std::vector<IdxT> box_span_begins;
+      IdxT combined_size = 0;
+      for (Box3d const& msg_box : data_item.boxes) {
+        box_span_begins.emplace_back(spans.size());
+        msg_box.append_spans(spans, combineable ? combined_size : 0);
+        combined_size += msg_box.size();
+      }
+      box_span_begins.emplace_back(spans.size());
+
+      // short spans are cheaper to pack with an index list
+      if (combined_size >= min_avg_span_len * static_cast<IdxT>(spans.size())) {
+        if (combineable) {
+          add_span_item(con, msg_group, partner_rank, combined_size,
+                        spans.data(), spans.size());
+        } else {
+          IdxT box_idx = 0;
+          for (Box3d const& msg_box : data_item.boxes) {
+            IdxT begin = box_span_begins[box_idx];
+            IdxT end   = box_span_begins[box_idx+1];
+            add_span_item(con, msg_group, partner_rank, msg_box.size(),
+                          spans.data() + begin, end - begin);
+            box_idx += 1;
+          }
+        }
+        return;
+      }
+    }
+
     IdxT combined_size = 0;
     IdxT combined_nbytes = 0;
     LidxT* combined_indices = nullptr;
@@ -431,7 +481,7 @@ private:
 
     if (combineable) {
       combined_size = data_item.total_size();
-      combined_nbytes = sizeof(DataT)*combined_size; // data nbytes
+      combined_nbytes = msg_group.zone_nbytes()*combined_size; // data nbytes
       combined_indices = (LidxT*)mesh_aloc.allocate(sizeof(LidxT)*combined_size);
     }
 
@@ -441,7 +491,7 @@ private:
 
         // fill item data
         IdxT size = msg_box.size();
-        IdxT nbytes = sizeof(DataT)*size; // data nbytes
+        IdxT nbytes = msg_group.zone_nbytes()*size; // data nbytes
         LidxT* indices = (LidxT*)mesh_aloc.allocate(sizeof(LidxT)*size);
         msg_box.set_indices(con, indices);
 
@@ -464,6 +514,32 @@ private:
     }
   }
 
+  // minimum average span length for span items to be used over index lists
+  static constexpr IdxT min_avg_span_len = 4;
+
+  template < typename exec_policy, typename msg_group_type >
+  void add_span_item(
+      ExecContext<exec_policy>& con,
+      msg_group_type& msg_group,
+      int partner_rank,
+      IdxT size,
+      detail::index_span const* spans,
+      IdxT num_spans) const
+  {
+    using message_item_type = detail::MessageItem<exec_policy>;
+
+    // spans are written on the host so use the utility allocator
+    IdxT nbytes = msg_group.zone_nbytes()*size; // data nbytes
+    detail::index_span* span_list = (detail::index_span*)con.util_aloc.allocate(sizeof(detail::index_span)*num_spans);
+    for (IdxT s = 0; s < num_spans; ++s) {
+      span_list[s] = spans[s];
+    }
+
+    msg_group.add_message_item(
+        partner_rank,
+        message_item_type{size, nbytes, span_list, num_spans, con.util_aloc});
+  }
+
 #ifdef COMB_ENABLE_MPI
   template < typename comm_type, typename msg_group_type >
   void populate_msg_info(
@@ -484,9 +560,12 @@ private:
 
       // fill item data
       IdxT size = msg_box.size();
+      // the subarray type is for DataT, packed once per variable
+      assert(comb_variables_are_DataT());
       MPI_Datatype mpi_type = msg_box.get_type_subarray();
       detail::MPI::Type_commit(&mpi_type);
-      IdxT nbytes = detail::MPI::Pack_size(1, mpi_type, comm.con_comm.comm);
+      IdxT nbytes = detail::MPI::Pack_size(1, mpi_type, comm.con_comm.comm) *
+                    static_cast<IdxT>(msg_group.m_variables.size());
 
       msg_group.add_message_item(
           partner_rank,
@@ -495,6 +574,45 @@ private:
   }
 #endif
 
+  // number of chunk messages to split a message of nbytes into
+  template < typename comm_type >
+  IdxT num_message_chunks(comm_type& comm, IdxT nbytes) const
+  {
+    CommInfo const& info = comm.comminfo;
+    if (!comm_type::policy_comm::chunk_messages ||
+        info.pipeline_chunks <= 1 || nbytes <= info.pipeline_threshold) {
+      return 1;
+    }
+    // chunk tags must stay below the smallest MPI_TAG_UB mpi allows
+    IdxT max_chunks = std::max(IdxT(1), IdxT(32768) / info.size);
+    return std::min(info.pipeline_chunks, max_chunks);
+  }
+
+  // split the boxes of a message into num_chunks lists, each box is cut
+  // into slabs along its slowest dimension with at least num_chunks zones,
+  // partners' boxes have the same shape so they are cut the same way,
+  // empty chunks are dropped
+  static std::vector<message_info_data_type> chunk_data_items(message_info_data_type const& data_item, IdxT num_chunks)
+  {
+    std::vector<message_info_data_type> chunks(num_chunks);
+    for (Box3d const& msg_box : data_item.boxes) {
+      IdxT dim = 2;
+      while (dim > 0 && msg_box.sizes[dim] < num_chunks) --dim;
+      IdxT len = msg_box.sizes[dim];
+      for (IdxT c = 0; c < num_chunks; ++c) {
+        IdxT lo = len * c / num_chunks;
+        IdxT hi = len * (c+1) / num_chunks;
+        if (lo < hi) {
+          chunks[c].add_box(msg_box.slab(dim, lo, hi));
+        }
+      }
+    }
+    chunks.erase(std::remove_if(chunks.begin(), chunks.end(),
+                                [](message_info_data_type const& chunk) { return chunk.num_boxes() == 0; }),
+                 chunks.end());
+    return chunks;
+  }
+
   struct msg_extra_info
   {
     IdxT size = 0;
@@ -563,12 +681,12 @@ private:
       // add variables for this MeshInfo
       for (MeshData const* msg_data : msg_data_list) {
         DataT *data = msg_data->data();
-        msg_list.message_group_many.add_variable(data);
-        msg_list.message_group_few.add_variable(data);
+        msg_list.message_group_many.add_variable(data, msg_data->type);
+        msg_list.message_group_few.add_variable(data, msg_data->type);
       }
 
       // get allocator for mesh for use with indices
-      COMB::Allocator& mesh_aloc = msg_data_list.front()->aloc;
+      COMB::Allocator& mesh_aloc = msg_data_list.front()->aloc.local_allocator();
 
       // add message and each box per message to the comm
       auto lambda = [&](message_info_type& msginfo) {
@@ -579,12 +697,28 @@ private:
         bool have_many   = extras.have_many;
 
         // add a new message to the message group
-        if (have_many) {
-          msg_list.message_group_many.add_message(con_many, msginfo.partner_rank, msginfo.msg_tag);
-          populate_msg_info(comm, con_many, msg_list.message_group_many, msginfo.partner_rank, combineable, msginfo.data_items, mesh_aloc);
+        auto add_message = [&](int msg_tag, message_info_data_type const& data_items) {
+          if (have_many) {
+            msg_list.message_group_many.add_message(con_many, msginfo.partner_rank, msg_tag);
+            populate_msg_info(comm, con_many, msg_list.message_group_many, msginfo.partner_rank, combineable, data_items, mesh_aloc);
+          } else {
+            msg_list.message_group_few.add_message(con_few, msginfo.partner_rank, msg_tag);
+            populate_msg_info(comm, con_few, msg_list.message_group_few, msginfo.partner_rank, combineable, data_items, mesh_aloc);
+          }
+        };
+
+        IdxT nbytes = msg_list.message_group_many.zone_nbytes() * msginfo.data_items.total_size();
+        IdxT num_chunks = num_message_chunks(comm, nbytes);
+        if (num_chunks <= 1) {
+          add_message(msginfo.msg_tag, msginfo.data_items);
         } else {
-          msg_list.message_group_few.add_message(con_few, msginfo.partner_rank, msginfo.msg_tag);
-          populate_msg_info(comm, con_few, msg_list.message_group_few, msginfo.partner_rank, combineable, msginfo.data_items, mesh_aloc);
+          // chunks go in order so each chunk can be sent as soon as it is
+          // packed and unpacked as soon as it arrives, chunk c is tagged
+          // msg_tag + c*size so the tags of different partners don't overlap
+          std::vector<message_info_data_type> chunks = chunk_data_items(msginfo.data_items, num_chunks);
+          for (IdxT c = 0; c < static_cast<IdxT>(chunks.size()); ++c) {
+            add_message(msginfo.msg_tag + static_cast<int>(c * comm.comminfo.size), chunks[c]);
+          }
         }
       };
 
@@ -615,13 +749,14 @@ private:
 
   void print_msg_info(const char* name,
                       size_t nvars,
+                      size_t zone_nbytes,
                       int partner_rank,
                       int msg_tag,
                       message_info_data_type const& data_item,
                       bool print_packing_sizes, bool print_message_sizes) const
   {
     size_t combined_size = data_item.total_size()*nvars;
-    size_t combined_nbytes = sizeof(DataT)*combined_size;
+    size_t combined_nbytes = zone_nbytes*data_item.total_size();
 
     const char* prefix = "";
 
@@ -639,10 +774,10 @@ private:
       for (Box3d const& msg_box : data_item.boxes) {
 
         // fill item data
-        IdxT size = msg_box.size();
-        IdxT nbytes = sizeof(DataT)*size;
+        size_t size = msg_box.size();
+        size_t nbytes = zone_nbytes*size;
 
-        fgprintf(FileGroup::proc, "%*s %4zu var%s %9zu items/var %9zu bytes/var\n",
+        fgprintf(FileGroup::proc, "%*s %4zu var%s %9zu items/var %9zu bytes\n",
             prefix_size, prefix, nvars, (nvars == 1) ? "" : "s", size, nbytes);
       }
     }
@@ -667,11 +802,16 @@ private:
       // skip this MeshInfo if it isn't used
       if (msg_data_list.size() == 0) continue;
 
+      size_t zone_nbytes = 0;
+      for (MeshData const* msg_data : msg_data_list) {
+        zone_nbytes += detail::data_type_size(msg_data->type);
+      }
+
       // add message and each box per message to the comm
       auto lambda = [&](message_info_type const& msginfo) {
 
         // add a new message to the message group
-        print_msg_info(name, msg_data_list.size(), msginfo.partner_rank, msginfo.msg_tag, msginfo.data_items, print_packing_sizes, print_message_sizes);
+        print_msg_info(name, msg_data_list.size(), zone_nbytes, msginfo.partner_rank, msginfo.msg_tag, msginfo.data_items, print_packing_sizes, print_message_sizes);
       };
 
       // order messages (myrank-end), [begin-myrank)
@@ -25,11 +25,14 @@ struct MeshData
 {
   COMB::Allocator& aloc;
   MeshInfo const& info;
+  detail::data_type type;
   DataT* ptr;
 
-  MeshData(MeshInfo const& meshinfo, COMB::Allocator& aloc_)
+  MeshData(MeshInfo const& meshinfo, COMB::Allocator& aloc_,
+           detail::data_type type_ = detail::data_type::float64)
     : aloc(aloc_)
     , info(meshinfo)
+    , type(type_)
     , ptr(nullptr)
   {
 
@@ -38,7 +41,7 @@ struct MeshData
   void allocate()
   {
     if (ptr == nullptr) {
-      ptr = (DataT*)aloc.allocate(info.totallen*sizeof(DataT));
+      ptr = (DataT*)aloc.allocate(info.totallen*detail::data_type_size(type));
     }
   }
 
@@ -49,11 +52,17 @@ struct MeshData
            ptr == other.ptr;
   }
 
+  // the data of variables whose type is not DataT must be cast to their type
   DataT* data() const
   {
     return ptr;
   }
 
+  detail::any_data_ptr any_data() const
+  {
+    return detail::any_data_ptr{ptr, type};
+  }
+
   void deallocate()
   {
     if (ptr != nullptr) {
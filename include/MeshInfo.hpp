@@ -279,7 +279,7 @@ struct MeshInfo {
   IdxT global_offset[3];
   IdxT global_own_min[3];
   IdxT global_own_max[3];
-  IdxT global_coords[3];
+  int global_coords[3];
 
   MeshInfo(GlobalMeshInfo const& global_,
            const IdxT global_min_[], const IdxT global_max_[],
@@ -18,6 +18,7 @@
 
 #include "config.hpp"
 
+#include <algorithm>
 #include <type_traits>
 #include <list>
 #include <utility>
@@ -48,11 +49,15 @@ struct MessageBase
 struct MessageItemBase
 {
   IdxT size;
+  // bytes of all the variables of this item in a message
   IdxT nbytes;
+  // pack and unpack bypassing the cache, set when the message is large
+  bool nontemporal;
 
   MessageItemBase(IdxT _size, IdxT _nbytes)
     : size(_size)
     , nbytes(_nbytes)
+    , nontemporal(false)
   { }
 
   MessageItemBase(MessageItemBase const&) = delete;
@@ -61,6 +66,7 @@ struct MessageItemBase
   MessageItemBase(MessageItemBase && o)
     : size(detail::exchange(o.size, 0))
     , nbytes(detail::exchange(o.nbytes, 0))
+    , nontemporal(detail::exchange(o.nontemporal, false))
   { }
   MessageItemBase& operator=(MessageItemBase &&) = delete;
 };
@@ -68,12 +74,38 @@ struct MessageItemBase
 template < typename exec_policy >
 struct MessageItem : MessageItemBase
 {
+  // items use either a list of indices, a list of contiguous spans of
+  // indices, or describe a box by its rows in the mesh
   LidxT* indices;
+  index_span* spans;
+  IdxT num_spans;
+  box_rows box;
   COMB::Allocator& m_aloc;
 
   MessageItem(IdxT _size, IdxT _nbytes, LidxT* _indices, COMB::Allocator& _aloc)
     : MessageItemBase(_size, _nbytes)
     , indices(_indices)
+    , spans(nullptr)
+    , num_spans(0)
+    , box{0, 0, 0, 0, 0, 0}
+    , m_aloc(_aloc)
+  { }
+
+  MessageItem(IdxT _size, IdxT _nbytes, index_span* _spans, IdxT _num_spans, COMB::Allocator& _aloc)
+    : MessageItemBase(_size, _nbytes)
+    , indices(nullptr)
+    , spans(_spans)
+    , num_spans(_num_spans)
+    , box{0, 0, 0, 0, 0, 0}
+    , m_aloc(_aloc)
+  { }
+
+  MessageItem(IdxT _size, IdxT _nbytes, box_rows const& _box, COMB::Allocator& _aloc)
+    : MessageItemBase(_size, _nbytes)
+    , indices(nullptr)
+    , spans(nullptr)
+    , num_spans(0)
+    , box(_box)
     , m_aloc(_aloc)
   { }
 
@@ -83,6 +115,9 @@ struct MessageItem : MessageItemBase
   MessageItem(MessageItem && o)
     : MessageItemBase(std::move(o))
     , indices(detail::exchange(o.indices, nullptr))
+    , spans(detail::exchange(o.spans, nullptr))
+    , num_spans(detail::exchange(o.num_spans, 0))
+    , box(o.box)
     , m_aloc(o.m_aloc)
   { }
   MessageItem& operator=(MessageItem &&) = delete;
@@ -92,6 +127,126 @@ struct MessageItem : MessageItemBase
     if (indices) {
       m_aloc.deallocate(indices); indices = nullptr;
     }
+    if (spans) {
+      m_aloc.deallocate(spans); spans = nullptr;
+    }
+  }
+
+  bool structured() const
+  {
+    return indices == nullptr && spans == nullptr;
+  }
+
+  // only items packed from a list of indices use the gather and scatter
+  // kernels, which have streaming variants
+  bool indexed() const
+  {
+    return indices != nullptr;
+  }
+
+  // number of iterations in a loop over this item
+  IdxT loop_len() const
+  {
+    return indices ? size : spans ? num_spans : box.nrows;
+  }
+
+  // length of the shortest contiguous row copied by this item,
+  // 0 for index lists
+  IdxT min_row_len() const
+  {
+    if (indices) {
+      return 0;
+    } else if (spans) {
+      IdxT len = spans[0].len;
+      for (IdxT s = 1; s < num_spans; ++s) {
+        len = std::min(len, spans[s].len);
+      }
+      return len;
+    } else {
+      return box.ilen;
+    }
+  }
+
+  template < typename context_type, typename T >
+  void pack(context_type& con, T const* src, T* buf) const
+  {
+    if (indices) {
+      pack_indexed(con, src, buf, use_simd<context_type, T>{});
+    } else if (spans) {
+      con.for_all(num_spans, make_pack_spans(src, buf, spans));
+    } else {
+      con.for_all(box.nrows, make_pack_box_rows(src, buf, box));
+    }
+  }
+
+  template < typename context_type, typename T >
+  void unpack(context_type& con, T const* buf, T* dst) const
+  {
+    if (indices) {
+      unpack_indexed(con, buf, dst, use_simd<context_type, T>{});
+    } else if (spans) {
+      con.for_all(num_spans, make_unpack_spans(buf, dst, spans));
+    } else {
+      con.for_all(box.nrows, make_unpack_box_rows(buf, dst, box));
+    }
+  }
+
+  // pack all variables of each zone next to each other in buf
+  template < typename context_type >
+  void pack_zones(context_type& con, DataT const* const* srcs, IdxT num_vars, DataT* buf) const
+  {
+    detail::pack_zones<DataT> kernel{srcs, num_vars, buf};
+    if (indices) {
+      con.for_all(size, zone_list_loop<detail::pack_zones<DataT>>{kernel, indices});
+    } else if (spans) {
+      con.for_all(num_spans, zone_span_loop<detail::pack_zones<DataT>>{kernel, spans});
+    } else {
+      con.for_all(box.nrows, zone_box_loop<detail::pack_zones<DataT>>{kernel, box});
+    }
+  }
+
+  template < typename context_type >
+  void unpack_zones(context_type& con, DataT const* buf, DataT* const* dsts, IdxT num_vars) const
+  {
+    detail::unpack_zones<DataT> kernel{dsts, num_vars, buf};
+    if (indices) {
+      con.for_all(size, zone_list_loop<detail::unpack_zones<DataT>>{kernel, indices});
+    } else if (spans) {
+      con.for_all(num_spans, zone_span_loop<detail::unpack_zones<DataT>>{kernel, spans});
+    } else {
+      con.for_all(box.nrows, zone_box_loop<detail::unpack_zones<DataT>>{kernel, box});
+    }
+  }
+
+private:
+  // cpu contexts use the simd gather and scatter kernels for DataT
+  template < typename context_type, typename T >
+  using use_simd = std::integral_constant<bool,
+      std::is_base_of<CPUContext, context_type>::value &&
+      std::is_same<T, DataT>::value>;
+
+  template < typename context_type >
+  void pack_indexed(context_type& con, DataT const* src, DataT* buf, std::true_type) const
+  {
+    con.for_all(gather_chunks::num_chunks(size), gather_chunks{src, indices, buf, size, nontemporal});
+  }
+
+  template < typename context_type, typename T >
+  void pack_indexed(context_type& con, T const* src, T* buf, std::false_type) const
+  {
+    con.for_all(size, make_copy_idxr_idxr(src, detail::indexer_list_i{indices}, buf, detail::indexer_i{}));
+  }
+
+  template < typename context_type >
+  void unpack_indexed(context_type& con, DataT const* buf, DataT* dst, std::true_type) const
+  {
+    con.for_all(scatter_chunks::num_chunks(size), scatter_chunks{buf, indices, dst, size, nontemporal});
+  }
+
+  template < typename context_type, typename T >
+  void unpack_indexed(context_type& con, T const* buf, T* dst, std::false_type) const
+  {
+    con.for_all(size, make_copy_idxr_idxr(buf, detail::indexer_i{}, dst, detail::indexer_list_i{indices}));
   }
 };
 
@@ -119,6 +274,18 @@ struct MessageItem<mpi_type_pol> : MessageItemBase
   { }
   MessageItem& operator=(MessageItem &&) = delete;
 
+  // packed by mpi, there are no rows
+  IdxT min_row_len() const
+  {
+    return 0;
+  }
+
+  // packed by mpi, there are no indices
+  bool indexed() const
+  {
+    return false;
+  }
+
   ~MessageItem()
   {
     if (mpi_type != MPI_DATATYPE_NULL) {
@@ -191,6 +358,15 @@ struct MessageInterface
     }
     return msg_nbytes;
   }
+
+  // true if any item of this message is packed with streaming stores
+  bool nontemporal() const
+  {
+    for (const MessageItemBase* item : message_items) {
+      if (item->nontemporal) return true;
+    }
+    return false;
+  }
 };
 
 template < MessageBase::Kind kind, typename comm_policy, typename exec_policy >
@@ -222,15 +398,25 @@ struct MessageGroupInterface
   std::vector<component_type> m_components;
   std::vector<group_type> m_groups;
 
+  // variables whose type is not DataT are cast to their type when packed
   std::vector<DataT*> m_variables;
+  std::vector<data_type> m_variable_types;
+  // copy of m_variables in backend accessible memory
+  DataT** m_variable_ptrs = nullptr;
 
-  std::vector<int> m_item_partner_ranks;
+  // message idx of each item
+  std::vector<IdxT> m_item_message_idxs;
   std::vector<message_item_type> m_items;
 
   fuser_type m_fuser;
 
   COMB::Allocator& m_aloc;
 
+  // with persistent buffers the buffer of each message is a piece of one
+  // slab allocated after finalize instead of an allocation per cycle
+  char* m_buffer_slab = nullptr;
+  std::vector<IdxT> m_buffer_offsets;
+
 
   MessageGroupInterface(COMB::Allocator& aloc_)
     : m_aloc(aloc_)
@@ -247,15 +433,30 @@ struct MessageGroupInterface
     m_groups.emplace_back( m_contexts.back().create_group() );
   }
 
-  void add_variable(DataT *data)
+  void add_variable(DataT *data, data_type type = data_type::float64)
   {
     m_variables.emplace_back(data);
+    m_variable_types.emplace_back(type);
   }
 
+  // bytes of all the variables of one zone
+  IdxT zone_nbytes() const
+  {
+    IdxT nbytes = 0;
+    for (data_type type : m_variable_types) {
+      nbytes += data_type_size(type);
+    }
+    return nbytes;
+  }
+
+  // items belong to the last message added, a partner may have several
+  // messages when large messages are split into chunks
   void add_message_item(int partner_rank, message_item_type&& item)
   {
+    COMB::ignore_unused(partner_rank);
+    assert(!messages.empty() && messages.back().partner_rank == partner_rank);
     // emplace_back invalidates iterators
-    m_item_partner_ranks.emplace_back(partner_rank);
+    m_item_message_idxs.emplace_back(messages.back().idx);
     m_items.emplace_back(std::move(item));
   }
 
@@ -264,25 +465,163 @@ struct MessageGroupInterface
     // add items to messages
     IdxT numItems = m_items.size();
     for (IdxT i = 0; i < numItems; ++i) {
-
-      int partner_rank = m_item_partner_ranks[i];
-      message_item_type& item = m_items[i];
-
-      bool found = false;
+      messages[m_item_message_idxs[i]].add_item(m_items[i]);
+    }
+    m_item_message_idxs.clear();
+
+    // only the unfused cpu gather and scatter kernels have streaming
+    // variants, they copy variables one at a time and only DataT ones
+    if (std::is_base_of<CPUContext, context_type>::value &&
+        !comb_allow_pack_loop_fusion() &&
+        comb_message_layout() == message_layout::variable_major &&
+        std::all_of(m_variable_types.begin(), m_variable_types.end(),
+                    [](data_type type) { return type == data_type::float64; })) {
       for (message_type& msg : messages) {
-        if (msg.partner_rank == partner_rank) {
-          msg.add_item(item);
-          found = true;
-          break;
+        if (comb_use_nontemporal(msg.nbytes())) {
+          for (MessageItemBase* msg_item : msg.message_items) {
+            message_item_type* item = static_cast<message_item_type*>(msg_item);
+            item->nontemporal = item->indexed();
+          }
         }
       }
-      assert(found);
     }
-    m_item_partner_ranks.clear();
+
+    if (!m_contexts.empty() && !m_variables.empty()) {
+      IdxT num_vars = m_variables.size();
+      m_variable_ptrs = (DataT**)m_contexts.front().util_aloc.allocate(num_vars*sizeof(DataT*));
+      for (IdxT v = 0; v < num_vars; ++v) {
+        m_variable_ptrs[v] = m_variables[v];
+      }
+    }
+  }
+
+  // pick the specialized fused kernels for the number of variables and
+  // the shortest row in the items, rows are ghost width long in x faces
+  void select_fused_kernel()
+  {
+    IdxT width = 0;
+    for (message_item_type const& item : m_items) {
+      IdxT len = item.min_row_len();
+      if (len > 0 && (width == 0 || len < width)) {
+        width = len;
+      }
+    }
+    // rows of other lengths take the generic row copy in every kernel,
+    // so use the narrowest kernel when no row length has its own
+    if (width < 1 || width > 4) width = 1;
+    m_fuser.select_kernel(m_variables.size(), width);
+  }
+
+  // allocate one slab for the buffers of all messages, message buffers
+  // start on cache line boundaries
+  void allocate_buffer_slab()
+  {
+    assert(m_buffer_slab == nullptr);
+    constexpr IdxT align = 64;
+    IdxT slab_nbytes = 0;
+    m_buffer_offsets.resize(messages.size()+1, 0);
+    for (message_type const& msg : messages) {
+      m_buffer_offsets[msg.idx] = slab_nbytes;
+      slab_nbytes += (msg.nbytes() + align - 1) / align * align;
+    }
+    m_buffer_offsets[messages.size()] = slab_nbytes;
+    if (slab_nbytes > 0) {
+      m_buffer_slab = static_cast<char*>(m_aloc.allocate(slab_nbytes));
+      LOGPRINTF("%p allocate_buffer_slab slab %p nbytes %d\n", this, m_buffer_slab, (int)slab_nbytes);
+    }
+  }
+
+  void deallocate_buffer_slab()
+  {
+    if (m_buffer_slab != nullptr) {
+      m_aloc.deallocate(m_buffer_slab);
+      m_buffer_slab = nullptr;
+    }
+    m_buffer_offsets.clear();
+  }
+
+  // buffer of nbytes for msg, from the slab if there is one
+  void* allocate_buffer(message_type const& msg, IdxT nbytes)
+  {
+    if (m_buffer_slab != nullptr) {
+      assert(m_buffer_offsets[msg.idx] + nbytes <= m_buffer_offsets[msg.idx+1]);
+      return m_buffer_slab + m_buffer_offsets[msg.idx];
+    }
+    return m_aloc.allocate(nbytes);
+  }
+
+  void deallocate_buffer(void* buf)
+  {
+    if (m_buffer_slab == nullptr) {
+      m_aloc.deallocate(buf);
+    }
+  }
+
+  // policies that keep buffers and requests for the lifetime of the
+  // comm make them here, others allocate per cycle
+  void setup_persistent(context_type&, communicator_type&)
+  {
+  }
+
+  void teardown_persistent(communicator_type&)
+  {
+  }
+
+  // policies that can unpack parts of messages before the messages
+  // complete do so here, the rest unpack when the requests complete
+  void unpack_arrived(context_type&, communicator_type&, message_type**, IdxT)
+  {
+  }
+
+  // pack all variables of an item into buf in the current message layout,
+  // returns the end of the packed data
+  char* pack_item(context_type& con, message_item_type const& item, char* buf) const
+  {
+    if (comb_message_layout() == message_layout::zone_major) {
+      assert(comb_variables_are_DataT());
+      item.pack_zones(con, m_variable_ptrs, m_variables.size(), (DataT*)buf);
+      buf += item.nbytes;
+    } else {
+      IdxT num_vars = m_variables.size();
+      for (IdxT v = 0; v < num_vars; ++v) {
+        void const* src = m_variables[v];
+        visit_data_type(m_variable_types[v], [&](auto type) {
+          using T = decltype(type);
+          item.pack(con, static_cast<T const*>(src), reinterpret_cast<T*>(buf));
+          buf += item.size * sizeof(T);
+        });
+      }
+    }
+    return buf;
+  }
+
+  // unpack all variables of an item from buf in the current message layout,
+  // returns the end of the unpacked data
+  char const* unpack_item(context_type& con, message_item_type const& item, char const* buf) const
+  {
+    if (comb_message_layout() == message_layout::zone_major) {
+      assert(comb_variables_are_DataT());
+      item.unpack_zones(con, (DataT const*)buf, m_variable_ptrs, m_variables.size());
+      buf += item.nbytes;
+    } else {
+      IdxT num_vars = m_variables.size();
+      for (IdxT v = 0; v < num_vars; ++v) {
+        void* dst = m_variables[v];
+        visit_data_type(m_variable_types[v], [&](auto type) {
+          using T = decltype(type);
+          item.unpack(con, reinterpret_cast<T const*>(buf), static_cast<T*>(dst));
+          buf += item.size * sizeof(T);
+        });
+      }
+    }
+    return buf;
   }
 
   ~MessageGroupInterface()
   {
+    if (m_variable_ptrs != nullptr) {
+      m_contexts.front().util_aloc.deallocate(m_variable_ptrs); m_variable_ptrs = nullptr;
+    }
     IdxT numMessages = messages.size();
     for(IdxT i = 0; i < numMessages; i++) {
       m_contexts[i].destroyEvent(m_events[i]);
@@ -76,18 +76,36 @@ namespace detail {
      }
   };
 
+  // first touch of a var with the same 3d loop and schedule the stencil
+  // uses, so each page is placed by its numa policy near the thread that
+  // computes on it
+  struct set_n1_3d {
+     ::detail::any_data_ptr data;
+     IdxT jstride, kstride;
+     set_n1_3d(::detail::any_data_ptr data_, IdxT jstride_, IdxT kstride_)
+       : data(data_), jstride(jstride_), kstride(kstride_)
+     {}
+     COMB_HOST COMB_DEVICE
+     void operator()(IdxT k, IdxT j, IdxT i) const {
+       IdxT zone = i + j * jstride + k * kstride;
+       // LOGPRINTF("init-var %p[%i] = %f\n", data, zone, -1.0);
+       data[zone] = -1.0;
+     }
+  };
+
+  template < typename T >
   struct set_1 {
      IdxT ilen, ijlen;
-     DataT* data;
+     T* data;
      IdxT imin, jmin, kmin;
-     set_1(IdxT ilen_, IdxT ijlen_, DataT* data_, IdxT imin_, IdxT jmin_, IdxT kmin_)
+     set_1(IdxT ilen_, IdxT ijlen_, T* data_, IdxT imin_, IdxT jmin_, IdxT kmin_)
        : ilen(ilen_), ijlen(ijlen_), data(data_)
        , imin(imin_), jmin(jmin_), kmin(kmin_)
      {}
      COMB_HOST COMB_DEVICE
      void operator()(IdxT k, IdxT j, IdxT i) const {
        IdxT zone = (i+imin) + (j+jmin) * ilen + (k+kmin) * ijlen;
-       DataT next = 1.0;
+       T next = 1;
        // LOGPRINTF("%p[%i] = %f\n", data, zone, next);
        data[zone] = next;
      }
@@ -123,11 +141,61 @@ namespace detail {
      }
   };
 
+  // average of the 7 or 27 zone neighborhood of data stored in result,
+  // dims with no ghost zones have a stride of 0 so they are not differenced,
+  // in 27 point mode their loop runs once so fewer points are averaged
+  template < typename T >
+  struct stencil {
+     IdxT ilen, ijlen;
+     T const* data;
+     T* result;
+     IdxT imin, jmin, kmin;
+     IdxT istride, jstride, kstride;
+     IdxT npoints;
+     // points summed for each zone
+     IdxT divisor;
+     stencil(IdxT ilen_, IdxT ijlen_, T const* data_, T* result_, IdxT imin_, IdxT jmin_, IdxT kmin_,
+             IdxT istride_, IdxT jstride_, IdxT kstride_, IdxT npoints_)
+       : ilen(ilen_), ijlen(ijlen_), data(data_), result(result_)
+       , imin(imin_), jmin(jmin_), kmin(kmin_)
+       , istride(istride_), jstride(jstride_), kstride(kstride_)
+       , npoints(npoints_)
+       , divisor((npoints_ == 27) ? (istride_ > 0 ? 3 : 1) * (jstride_ > 0 ? 3 : 1) * (kstride_ > 0 ? 3 : 1)
+                                  : npoints_)
+     {}
+     COMB_HOST COMB_DEVICE
+     void operator()(IdxT k, IdxT j, IdxT i) const {
+       IdxT zone = (i+imin) + (j+jmin) * ilen + (k+kmin) * ijlen;
+       DataT sum = 0.0;
+       if (npoints == 27) {
+         for (IdxT kk = -kstride; kk <= kstride; kk += (kstride > 0 ? kstride : 1)) {
+           for (IdxT jj = -jstride; jj <= jstride; jj += (jstride > 0 ? jstride : 1)) {
+             for (IdxT ii = -istride; ii <= istride; ii += (istride > 0 ? istride : 1)) {
+               sum += data[zone + ii + jj + kk];
+             }
+           }
+         }
+       } else {
+         sum = data[zone]
+             + data[zone - istride] + data[zone + istride]
+             + data[zone - jstride] + data[zone + jstride]
+             + data[zone - kstride] + data[zone + kstride];
+       }
+       result[zone] = static_cast<T>(sum / divisor);
+     }
+  };
+
 
 } // namespace detail
 
 extern void print_timer(CommInfo& comminfo, Timer& tm, const char* prefix = "");
 
+extern void print_progress(CommInfo& comminfo, ProgressThread& progress);
+
+extern void print_overlap(CommInfo& comminfo, Timer& tm_overlap, Timer& tm_sequential);
+
+extern void print_buffer_slab(CommInfo& comminfo, Timer& tm_slab, Timer& tm_per_cycle);
+
 extern void print_message_info(CommInfo& comminfo, MeshInfo& info,
                                COMB::Allocator& aloc_unused,
                                IdxT num_vars,
@@ -143,6 +211,9 @@ extern void test_copy(CommInfo& comminfo,
                       COMB::Allocators& alloc,
                       Timer& tm, IdxT num_vars, IdxT len, IdxT nrepeats);
 
+extern void test_mempool(CommInfo& comminfo, MeshInfo& info,
+                         Timer& tm, IdxT num_vars, IdxT nrepeats);
+
 extern void test_cycles_mock(CommInfo& comminfo, MeshInfo& info,
                              COMB::Executors& exec,
                              COMB::Allocators& alloc,
@@ -153,6 +224,38 @@ extern void test_cycles_mpi(CommInfo& comminfo, MeshInfo& info,
                             COMB::Executors& exec,
                             COMB::Allocators& alloc,
                             IdxT num_vars, IdxT ncycles, Timer& tm, Timer& tm_total);
+
+extern void test_cycles_mpi_persistent(CommInfo& comminfo, MeshInfo& info,
+                                       COMB::Executors& exec,
+                                       COMB::Allocators& alloc,
+                                       IdxT num_vars, IdxT ncycles, Timer& tm, Timer& tm_total);
+
+extern void test_cycles_mpi_neighbor(CommInfo& comminfo, MeshInfo& info,
+                                     COMB::Executors& exec,
+                                     COMB::Allocators& alloc,
+                                     IdxT num_vars, IdxT ncycles, Timer& tm, Timer& tm_total);
+
+extern void test_cycles_mpi_rma(CommInfo& comminfo, MeshInfo& info,
+                                COMB::Executors& exec,
+                                COMB::Allocators& alloc,
+                                IdxT num_vars, IdxT ncycles, Timer& tm, Timer& tm_total);
+
+extern void test_cycles_mpi_shm(CommInfo& comminfo, MeshInfo& info,
+                                COMB::Executors& exec,
+                                COMB::Allocators& alloc,
+                                IdxT num_vars, IdxT ncycles, Timer& tm, Timer& tm_total);
+
+extern void test_cycles_mpi_threads(CommInfo& comminfo, MeshInfo& info,
+                                    COMB::Executors& exec,
+                                    COMB::Allocators& alloc,
+                                    IdxT num_vars, IdxT ncycles, Timer& tm, Timer& tm_total);
+#endif
+
+#ifdef COMB_ENABLE_MPI_PARTITIONED
+extern void test_cycles_mpi_partitioned(CommInfo& comminfo, MeshInfo& info,
+                                        COMB::Executors& exec,
+                                        COMB::Allocators& alloc,
+                                        IdxT num_vars, IdxT ncycles, Timer& tm, Timer& tm_total);
 #endif
 
 #ifdef COMB_ENABLE_GDSYNC
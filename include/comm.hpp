@@ -20,6 +20,8 @@
 
 #include <cstdlib>
 #include <cassert>
+#include <algorithm>
+#include <chrono>
 #include <type_traits>
 #include <list>
 #include <vector>
@@ -36,8 +38,18 @@
 #include "exec.hpp"
 
 #include "MessageBase.hpp"
+#include "comm_progress.hpp"
 
 
+// seconds spent packing or unpacking the messages that use streaming stores
+// and the messages that use cached stores, sub-timers of post-send and
+// wait-recv
+struct PackTimes
+{
+  double streamed = 0.0;
+  double cached = 0.0;
+};
+
 struct CartRank
 {
   int rank;
@@ -155,6 +167,38 @@ struct CommInfo
 
   IdxT cutoff;
 
+  // messages over pipeline_threshold bytes are split into pipeline_chunks
+  // messages that are packed, sent, and unpacked separately
+  IdxT pipeline_chunks;
+  IdxT pipeline_threshold;
+
+  // work done by the optional progress thread between posting and waiting
+  enum struct progress : IdxT
+  { off
+  , poll
+  , unpack };
+
+  static const char* progress_str(progress p)
+  {
+    const char* str = "unknown";
+    switch (p) {
+      case progress::off:    str = "off";    break;
+      case progress::poll:   str = "poll";   break;
+      case progress::unpack: str = "unpack"; break;
+    }
+    return str;
+  }
+
+  progress progress_thread;
+
+  // points in the stencil run on the interior between posting and waiting
+  // and on the boundary after waiting, 0 to not run it
+  IdxT overlap_stencil;
+
+  // trial cycles in the first round of tuning the methods and cutoff of
+  // each test, 0 to use the given methods and cutoff
+  IdxT autotune_cycles;
+
   enum struct method : IdxT
   { waitany
   , testany
@@ -182,15 +226,40 @@ struct CommInfo
   method wait_send_method;
   method wait_recv_method;
 
+  // mpi thread support provided by Init_thread
+  int thread_level;
+
+  static const char* thread_level_str(int level)
+  {
+    const char* str = "unknown";
+#ifdef COMB_ENABLE_MPI
+    switch (level) {
+      case MPI_THREAD_SINGLE:     str = "single";     break;
+      case MPI_THREAD_FUNNELED:   str = "funneled";   break;
+      case MPI_THREAD_SERIALIZED: str = "serialized"; break;
+      case MPI_THREAD_MULTIPLE:   str = "multiple";   break;
+    }
+#else
+    COMB::ignore_unused(level);
+#endif
+    return str;
+  }
+
   CommInfo()
     : rank(-1)
     , size(0)
     , cart()
     , cutoff(200)
+    , pipeline_chunks(1)
+    , pipeline_threshold(256*1024)
+    , progress_thread(progress::off)
+    , overlap_stencil(0)
+    , autotune_cycles(0)
     , post_send_method(method::waitall)
     , post_recv_method(method::waitall)
     , wait_send_method(method::waitall)
     , wait_recv_method(method::waitall)
+    , thread_level(-1)
   {
 #ifdef COMB_ENABLE_MPI
     rank = detail::MPI::Comm_rank(MPI_COMM_WORLD);
@@ -212,6 +281,45 @@ struct CommInfo
 #endif
   }
 
+  // logical or of val over all ranks
+  bool any(bool val)
+  {
+#ifdef COMB_ENABLE_MPI
+    int in = val ? 1 : 0;
+    int out = in;
+    detail::MPI::Allreduce(&in, &out, 1, MPI_INT, MPI_LOR,
+                           (cart.comm != MPI_COMM_NULL) ? cart.comm : MPI_COMM_WORLD);
+    return out != 0;
+#else
+    return val;
+#endif
+  }
+
+  // minimum of val over all ranks
+  int min(int val)
+  {
+#ifdef COMB_ENABLE_MPI
+    int out = val;
+    detail::MPI::Allreduce(&val, &out, 1, MPI_INT, MPI_MIN,
+                           (cart.comm != MPI_COMM_NULL) ? cart.comm : MPI_COMM_WORLD);
+    return out;
+#else
+    return val;
+#endif
+  }
+
+  // elementwise maximum of vals over all ranks
+  void max(double* vals, int count)
+  {
+#ifdef COMB_ENABLE_MPI
+    std::vector<double> in(vals, vals+count);
+    detail::MPI::Allreduce(in.data(), vals, count, MPI_DOUBLE, MPI_MAX,
+                           (cart.comm != MPI_COMM_NULL) ? cart.comm : MPI_COMM_WORLD);
+#else
+    COMB::ignore_unused(vals, count);
+#endif
+  }
+
   void set_name(const char* name)
   {
 #ifdef COMB_ENABLE_MPI
@@ -307,6 +415,14 @@ struct Comm
 
   recv_message_vars_s m_recvs;
 
+  PackTimes m_pack_times;
+  PackTimes m_unpack_times;
+
+  bool m_buffer_slab = false;
+
+  // optional helper thread armed between postSend and waitRecv
+  ProgressThread* m_progress = nullptr;
+
 
   Comm(CommContext<policy_comm>& con_comm_, CommInfo& comminfo_,
        COMB::Allocator& mesh_aloc_, COMB::Allocator& many_aloc_, COMB::Allocator& few_aloc_)
@@ -347,6 +463,25 @@ struct Comm
     con_comm.connect_ranks(send_ranks, recv_ranks);
 
     con_comm.setup_mempool(many_aloc, few_aloc);
+
+    m_sends.message_group_many.select_fused_kernel();
+    m_sends.message_group_few.select_fused_kernel();
+    m_recvs.message_group_many.select_fused_kernel();
+    m_recvs.message_group_few.select_fused_kernel();
+
+    if (policy_comm::slab_buffers && comb_allow_persistent_buffers()) {
+      m_sends.message_group_many.allocate_buffer_slab();
+      m_sends.message_group_few.allocate_buffer_slab();
+      m_recvs.message_group_many.allocate_buffer_slab();
+      m_recvs.message_group_few.allocate_buffer_slab();
+      m_buffer_slab = true;
+    }
+
+    m_sends.message_group_many.setup_persistent(con_many, con_comm);
+    m_sends.message_group_few.setup_persistent(con_few, con_comm);
+    m_recvs.message_group_many.setup_persistent(con_many, con_comm);
+    m_recvs.message_group_few.setup_persistent(con_few, con_comm);
+
     LOGPRINTF("%p Comm::finish_populating end\n", this);
   }
 
@@ -354,6 +489,16 @@ struct Comm
   {
     LOGPRINTF("%p Comm::~Comm begin\n", this);
 
+    m_sends.message_group_many.teardown_persistent(con_comm);
+    m_sends.message_group_few.teardown_persistent(con_comm);
+    m_recvs.message_group_many.teardown_persistent(con_comm);
+    m_recvs.message_group_few.teardown_persistent(con_comm);
+
+    m_sends.message_group_many.deallocate_buffer_slab();
+    m_sends.message_group_few.deallocate_buffer_slab();
+    m_recvs.message_group_many.deallocate_buffer_slab();
+    m_recvs.message_group_few.deallocate_buffer_slab();
+
     con_comm.teardown_mempool();
 
     std::vector<int> send_ranks;
@@ -379,6 +524,39 @@ struct Comm
     return policy_comm::mock;
   }
 
+  // whether message buffers are carved out of slabs, the same on every rank
+  bool buffer_slab() const
+  {
+    return m_buffer_slab;
+  }
+
+  // free the slabs, buffers are allocated each cycle from then on
+  void release_buffer_slab()
+  {
+    m_sends.message_group_many.deallocate_buffer_slab();
+    m_sends.message_group_few.deallocate_buffer_slab();
+    m_recvs.message_group_many.deallocate_buffer_slab();
+    m_recvs.message_group_few.deallocate_buffer_slab();
+    m_buffer_slab = false;
+  }
+
+  // time spent packing in the last postSend
+  PackTimes const& pack_times() const
+  {
+    return m_pack_times;
+  }
+
+  // time spent unpacking in the last waitRecv
+  PackTimes const& unpack_times() const
+  {
+    return m_unpack_times;
+  }
+
+  void set_progress_thread(ProgressThread* progress)
+  {
+    m_progress = progress;
+  }
+
   void barrier()
   {
     LOGPRINTF("%p Comm::barrier begin\n", this);
@@ -472,10 +650,64 @@ struct Comm
 
 
 
+  // call op on the messages that use streaming stores and then on the
+  // others, adding the time of each to times, the order of msgs is kept
+  template < typename message_type, typename op_type >
+  static void time_nontemporal(message_type** msgs, IdxT len, PackTimes& times, op_type&& op)
+  {
+    using clock = std::chrono::high_resolution_clock;
+    if (len <= 0) return;
+    if (std::none_of(msgs, msgs+len, [](message_type* msg) { return msg->nontemporal(); })) {
+      auto t0 = clock::now();
+      op(msgs, len);
+      times.cached += std::chrono::duration<double>(clock::now() - t0).count();
+    } else {
+      std::vector<message_type*> parts(msgs, msgs+len);
+      auto cached = std::stable_partition(parts.begin(), parts.end(),
+          [](message_type* msg) { return msg->nontemporal(); });
+      IdxT num_streamed = cached - parts.begin();
+      auto t0 = clock::now();
+      op(parts.data(), num_streamed);
+      auto t1 = clock::now();
+      if (num_streamed < len) {
+        op(parts.data() + num_streamed, len - num_streamed);
+      }
+      auto t2 = clock::now();
+      times.streamed += std::chrono::duration<double>(t1 - t0).count();
+      times.cached += std::chrono::duration<double>(t2 - t1).count();
+    }
+  }
+
+  template < typename message_group_type, typename context_type >
+  void pack(message_group_type& group, context_type& con, send_message_type** msgs, IdxT len, detail::Async async)
+  {
+    time_nontemporal(msgs, len, m_pack_times, [&](send_message_type** part, IdxT part_len) {
+      group.pack(con, con_comm, part, part_len, async);
+    });
+  }
+
+  template < typename message_group_type, typename context_type >
+  void unpack(message_group_type& group, context_type& con, recv_message_type** msgs, IdxT len, detail::Async async)
+  {
+    time_nontemporal(msgs, len, m_unpack_times, [&](recv_message_type** part, IdxT part_len) {
+      group.unpack(con, con_comm, part, part_len, async);
+    });
+  }
+
+  template < typename message_group_type, typename context_type >
+  void unpack_arrived(message_group_type& group, context_type& con, recv_message_type** msgs, IdxT len)
+  {
+    time_nontemporal(msgs, len, m_unpack_times, [&](recv_message_type** part, IdxT part_len) {
+      group.unpack_arrived(con, con_comm, part, part_len);
+    });
+  }
+
   void postSend(ExecContext<policy_many>& con_many, ExecContext<policy_few>& con_few)
   {
     LOGPRINTF("%p Comm::postSend begin\n", this);
 
+    m_pack_times = PackTimes{};
+
     IdxT num_many = m_sends.message_group_many.messages.size();
     IdxT num_few = m_sends.message_group_few.messages.size();
 
@@ -498,7 +730,7 @@ struct Comm
         for (IdxT i_many = 0; i_many < num_many; i_many++) {
           messages_many[i_many] = &m_sends.message_group_many.messages[i_many];
           m_sends.message_group_many.allocate(con_many, con_comm, &messages_many[i_many], 1, detail::Async::no);
-          m_sends.message_group_many.pack(con_many, con_comm, &messages_many[i_many], 1, detail::Async::no);
+          pack(m_sends.message_group_many, con_many, &messages_many[i_many], 1, detail::Async::no);
           m_sends.message_group_many.wait_pack_complete(con_many, con_comm, &messages_many[i_many], 1, detail::Async::no);
           m_sends.message_group_many.Isend(con_many, con_comm, &messages_many[i_many], 1, detail::Async::no, &requests_many[i_many]);
         }
@@ -506,7 +738,7 @@ struct Comm
         for (IdxT i_few = 0; i_few < num_few; i_few++) {
           messages_few[i_few] = &m_sends.message_group_few.messages[i_few];
           m_sends.message_group_few.allocate(con_few, con_comm, &messages_few[i_few], 1, detail::Async::no);
-          m_sends.message_group_few.pack(con_few, con_comm, &messages_few[i_few], 1, detail::Async::no);
+          pack(m_sends.message_group_few, con_few, &messages_few[i_few], 1, detail::Async::no);
           m_sends.message_group_few.wait_pack_complete(con_few, con_comm, &messages_few[i_few], 1, detail::Async::no);
           m_sends.message_group_few.Isend(con_few, con_comm, &messages_few[i_few], 1, detail::Async::no, &requests_few[i_few]);
         }
@@ -539,13 +771,13 @@ struct Comm
           // pack and record events
           if (pack_many_send < num_many) {
 
-            m_sends.message_group_many.pack(con_many, con_comm, &messages_many[pack_many_send], 1, detail::Async::yes);
+            pack(m_sends.message_group_many, con_many, &messages_many[pack_many_send], 1, detail::Async::yes);
             ++pack_many_send;
 
           } else
           if (pack_few_send < num_few) {
 
-            m_sends.message_group_few.pack(con_few, con_comm, &messages_few[pack_few_send], 1, detail::Async::yes);
+            pack(m_sends.message_group_few, con_few, &messages_few[pack_few_send], 1, detail::Async::yes);
             ++pack_few_send;
           }
 
@@ -588,7 +820,7 @@ struct Comm
           messages_many[i_many] = &m_sends.message_group_many.messages[i_many];
         }
         m_sends.message_group_many.allocate(con_many, con_comm, &messages_many[0], num_many, detail::Async::no);
-        m_sends.message_group_many.pack(con_many, con_comm, &messages_many[0], num_many, detail::Async::no);
+        pack(m_sends.message_group_many, con_many, &messages_many[0], num_many, detail::Async::no);
         m_sends.message_group_many.wait_pack_complete(con_many, con_comm, &messages_many[0], num_many, detail::Async::no);
         m_sends.message_group_many.Isend(con_many, con_comm, &messages_many[0], num_many, detail::Async::no, &requests_many[0]);
 
@@ -596,7 +828,7 @@ struct Comm
           messages_few[i_few] = &m_sends.message_group_few.messages[i_few];
         }
         m_sends.message_group_few.allocate(con_few, con_comm, &messages_few[0], num_few, detail::Async::no);
-        m_sends.message_group_few.pack(con_few, con_comm, &messages_few[0], num_few, detail::Async::no);
+        pack(m_sends.message_group_few, con_few, &messages_few[0], num_few, detail::Async::no);
         m_sends.message_group_few.wait_pack_complete(con_few, con_comm, &messages_few[0], num_few, detail::Async::no);
         m_sends.message_group_few.Isend(con_few, con_comm, &messages_few[0], num_few, detail::Async::no, &requests_few[0]);
       } break;
@@ -628,13 +860,13 @@ struct Comm
           // pack and record events
           if (pack_many_send < num_many) {
 
-            m_sends.message_group_many.pack(con_many, con_comm, &messages_many[pack_many_send], num_many-pack_many_send, detail::Async::yes);
+            pack(m_sends.message_group_many, con_many, &messages_many[pack_many_send], num_many-pack_many_send, detail::Async::yes);
             pack_many_send = num_many;
 
           } else
           if (pack_few_send < num_few) {
 
-            m_sends.message_group_few.pack(con_few, con_comm, &messages_few[pack_few_send], num_few-pack_few_send, detail::Async::yes);
+            pack(m_sends.message_group_few, con_few, &messages_few[pack_few_send], num_few-pack_few_send, detail::Async::yes);
             pack_few_send = num_few;
           }
 
@@ -683,8 +915,8 @@ struct Comm
         m_sends.message_group_many.allocate(con_many, con_comm, &messages_many[0], num_many, detail::Async::no);
         m_sends.message_group_few.allocate(con_few, con_comm, &messages_few[0], num_few, detail::Async::no);
 
-        m_sends.message_group_many.pack(con_many, con_comm, &messages_many[0], num_many, detail::Async::no);
-        m_sends.message_group_few.pack(con_few, con_comm, &messages_few[0], num_few, detail::Async::no);
+        pack(m_sends.message_group_many, con_many, &messages_many[0], num_many, detail::Async::no);
+        pack(m_sends.message_group_few, con_few, &messages_few[0], num_few, detail::Async::no);
 
         m_sends.message_group_many.wait_pack_complete(con_many, con_comm, &messages_many[0], num_many, detail::Async::no);
         m_sends.message_group_few.wait_pack_complete(con_few, con_comm, &messages_few[0], num_few, detail::Async::no);
@@ -720,13 +952,13 @@ struct Comm
           // pack and record events
           if (pack_many_send < num_many) {
 
-            m_sends.message_group_many.pack(con_many, con_comm, &messages_many[pack_many_send], num_many-pack_many_send, detail::Async::yes);
+            pack(m_sends.message_group_many, con_many, &messages_many[pack_many_send], num_many-pack_many_send, detail::Async::yes);
             pack_many_send = num_many;
 
           }
           if (pack_few_send < num_few) {
 
-            m_sends.message_group_few.pack(con_few, con_comm, &messages_few[pack_few_send], num_few-pack_few_send, detail::Async::yes);
+            pack(m_sends.message_group_few, con_few, &messages_few[pack_few_send], num_few-pack_few_send, detail::Async::yes);
             pack_few_send = num_few;
           }
 
@@ -766,15 +998,66 @@ struct Comm
        assert(0);
       } break;
     }
+
+    if (m_progress != nullptr) {
+      arm_progress(con_many, con_few);
+    }
     LOGPRINTF("%p Comm::postSend end\n", this);
   }
 
+  void arm_progress(ExecContext<policy_many>& con_many, ExecContext<policy_few>& con_few)
+  {
+    if (comminfo.progress_thread == CommInfo::progress::unpack) {
+      // the helper waits for and unpacks the recvs itself, its openmp
+      // parallel regions have one thread so cpu unpacks run sequentially
+      m_progress->arm([this, &con_many, &con_few]() {
+        waitRecv_messages(con_many, con_few);
+        return true;
+      });
+    } else {
+      // the helper polls the requests until they have all completed
+      m_progress->arm([this]() {
+        bool recvs_done = !detail::progress::queryable<recv_request_type>::value ||
+            detail::progress::num_complete(m_recvs.requests.data(), m_recvs.requests.size())
+              == static_cast<IdxT>(m_recvs.requests.size());
+        bool sends_done = !detail::progress::queryable<send_request_type>::value ||
+            detail::progress::num_complete(m_sends.requests.data(), m_sends.requests.size())
+              == static_cast<IdxT>(m_sends.requests.size());
+        return recvs_done && sends_done;
+      });
+    }
+  }
+
 
 
   void waitRecv(ExecContext<policy_many>& con_many, ExecContext<policy_few>& con_few)
+  {
+    if (m_progress != nullptr) {
+      // the helper may be clearing the requests, count the messages
+      IdxT num_recvs = m_recvs.message_group_many.messages.size() +
+                       m_recvs.message_group_few.messages.size();
+      if (comminfo.progress_thread == CommInfo::progress::unpack) {
+        // recvs count as complete if the helper already unpacked them all
+        m_progress->num_recvs += num_recvs;
+        m_progress->num_recvs_complete += m_progress->idle() ? num_recvs : 0;
+        m_progress->finish();
+        return;
+      }
+      m_progress->disarm();
+      if (detail::progress::queryable<recv_request_type>::value) {
+        m_progress->num_recvs += num_recvs;
+        m_progress->num_recvs_complete += detail::progress::num_complete(m_recvs.requests.data(), num_recvs);
+      }
+    }
+    waitRecv_messages(con_many, con_few);
+  }
+
+  void waitRecv_messages(ExecContext<policy_many>& con_many, ExecContext<policy_few>& con_few)
   {
     LOGPRINTF("%p Comm::waitRecv begin\n", this);
 
+    m_unpack_times = PackTimes{};
+
     IdxT num_many = m_recvs.message_group_many.messages.size();
     IdxT num_few = m_recvs.message_group_few.messages.size();
 
@@ -795,6 +1078,9 @@ struct Comm
                                  wait_recv_method == CommInfo::method::waitall)
                                 ? detail::Async::no : detail::Async::yes;
 
+    unpack_arrived(m_recvs.message_group_many, con_many, &messages_many[0], num_many);
+    unpack_arrived(m_recvs.message_group_few, con_few, &messages_few[0], num_few);
+
     switch (wait_recv_method) {
       case CommInfo::method::waitany:
       case CommInfo::method::testany:
@@ -816,9 +1102,9 @@ struct Comm
           assert(requests > (recv_request_type*)0x1);
 
           if (idx < num_many) {
-            m_recvs.message_group_many.unpack(con_many, con_comm, &messages[idx], 1, async);
+            unpack(m_recvs.message_group_many, con_many, &messages[idx], 1, async);
           } else if (idx < num_recvs) {
-            m_recvs.message_group_few.unpack(con_few, con_comm, &messages[idx], 1, async);
+            unpack(m_recvs.message_group_few, con_few, &messages[idx], 1, async);
           }
 
           num_done += 1;
@@ -866,12 +1152,12 @@ struct Comm
           }
 
           if (recvd_num_many < next_recvd_num_many) {
-            m_recvs.message_group_many.unpack(con_many, con_comm, &recvd_messages_many[recvd_num_many], next_recvd_num_many-recvd_num_many, async);
+            unpack(m_recvs.message_group_many, con_many, &recvd_messages_many[recvd_num_many], next_recvd_num_many-recvd_num_many, async);
             recvd_num_many = next_recvd_num_many;
           }
 
           if (recvd_num_few < next_recvd_num_few) {
-            m_recvs.message_group_few.unpack(con_few, con_comm, &recvd_messages_few[recvd_num_few], next_recvd_num_few-recvd_num_few, async);
+            unpack(m_recvs.message_group_few, con_few, &recvd_messages_few[recvd_num_few], next_recvd_num_few-recvd_num_few, async);
             recvd_num_few = next_recvd_num_few;
           }
         }
@@ -891,8 +1177,8 @@ struct Comm
           while (!recv_message_type::test_recv_all(con_comm, num_recvs, &requests[0], &recv_statuses[0]));
         }
 
-        m_recvs.message_group_many.unpack(con_many, con_comm, &messages_many[0], num_many, async);
-        m_recvs.message_group_few.unpack(con_few, con_comm, &messages_few[0], num_few, async);
+        unpack(m_recvs.message_group_many, con_many, &messages_many[0], num_many, async);
+        unpack(m_recvs.message_group_few, con_few, &messages_few[0], num_few, async);
 
         // deallocate at the end to avoid async memory reuse issues
         m_recvs.message_group_many.deallocate(con_many, con_comm, &messages_many[0], num_many, async);
@@ -925,6 +1211,11 @@ struct Comm
   {
     LOGPRINTF("%p Comm::waitSend begin\n", this);
 
+    if (m_progress != nullptr && detail::progress::queryable<send_request_type>::value) {
+      m_progress->num_sends += m_sends.requests.size();
+      m_progress->num_sends_complete += detail::progress::num_complete(m_sends.requests.data(), m_sends.requests.size());
+    }
+
     IdxT num_many = m_sends.message_group_many.messages.size();
     IdxT num_few = m_sends.message_group_few.messages.size();
 
@@ -1057,6 +1348,12 @@ struct CommunicatorsAvailable
 {
   bool mock = false;
   bool mpi = false;
+  bool mpi_persistent = false;
+  bool mpi_neighbor = false;
+  bool mpi_rma = false;
+  bool mpi_shm = false;
+  bool mpi_threads = false;
+  bool mpi_partitioned = false;
   bool gdsync = false;
   bool gpump = false;
   bool mp = false;
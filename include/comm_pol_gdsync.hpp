@@ -320,6 +320,10 @@ struct gdsync_pol {
   static const bool mock = false;
   // compile mpi_type packing/unpacking tests for this comm policy
   static const bool use_mpi_type = false;
+  // messages over the pipeline threshold may be split into chunk messages
+  static const bool chunk_messages = false;
+  // per cycle message buffers may come from one slab allocated per comm
+  static const bool slab_buffers = false;
   static const char* get_name() { return "gdsync"; }
   using send_request_type = detail::gdsync::Request*;
   using recv_request_type = detail::gdsync::Request*;
@@ -910,7 +914,7 @@ struct MessageGroup<MessageBase::Kind::send, gdsync_pol, exec_policy>
       message_type* msg = msgs[i];
       assert(msg->buf == nullptr);
 
-      IdxT nbytes = msg->nbytes() * this->m_variables.size();
+      IdxT nbytes = msg->nbytes();
 
       message_request_type& msg_request = m_msg_requests[msg->idx];
       msg_request.region = con_comm.get_mempool().allocate(con_comm.g, this->m_aloc, nbytes);
@@ -937,15 +941,7 @@ struct MessageGroup<MessageBase::Kind::send, gdsync_pol, exec_policy>
         this->m_contexts[msg_idx].start_component(this->m_groups[len-1], this->m_components[msg_idx]);
         for (const MessageItemBase* msg_item : msg->message_items) {
           const message_item_type* item = static_cast<const message_item_type*>(msg_item);
-          const IdxT nitems = item->size;
-          const IdxT nbytes = item->nbytes;
-          LidxT const* indices = item->indices;
-          for (DataT const* src : this->m_variables) {
-            // LOGPRINTF("%p pack %p = %p[%p] nitems %d\n", this, buf, src, indices, nitems);
-            this->m_contexts[msg_idx].for_all(nitems, make_copy_idxr_idxr(src, detail::indexer_list_i{indices},
-                                               static_cast<DataT*>(static_cast<void*>(buf)), detail::indexer_i{}));
-            buf += nbytes;
-          }
+          buf = this->pack_item(this->m_contexts[msg_idx], *item, buf);
         }
         if (async == detail::Async::no) {
           this->m_contexts[msg_idx].finish_component(this->m_groups[len-1], this->m_components[msg_idx]);
@@ -961,9 +957,9 @@ struct MessageGroup<MessageBase::Kind::send, gdsync_pol, exec_policy>
         assert(buf != nullptr);
         for (const MessageItemBase* msg_item : msg->message_items) {
           const message_item_type* item = static_cast<const message_item_type*>(msg_item);
-          this->m_fuser.enqueue(con, (DataT*)buf, item->indices, item->size);
-          buf += item->nbytes * this->m_variables.size();
-          assert(static_cast<IdxT>(item->size*sizeof(DataT)) == item->nbytes);
+          this->m_fuser.enqueue(con, (DataT*)buf, *item);
+          buf += item->nbytes;
+          assert(static_cast<IdxT>(item->size*sizeof(DataT)*this->m_variables.size()) == item->nbytes);
         }
       }
       this->m_fuser.exec(con);
@@ -976,9 +972,9 @@ struct MessageGroup<MessageBase::Kind::send, gdsync_pol, exec_policy>
         this->m_contexts[msg_idx].start_component(this->m_groups[len-1], this->m_components[msg_idx]);
         for (const MessageItemBase* msg_item : msg->message_items) {
           const message_item_type* item = static_cast<const message_item_type*>(msg_item);
-          this->m_fuser.enqueue(this->m_contexts[msg_idx], (DataT*)buf, item->indices, item->size);
-          buf += item->nbytes * this->m_variables.size();
-          assert(static_cast<IdxT>(item->size*sizeof(DataT)) == item->nbytes);
+          this->m_fuser.enqueue(this->m_contexts[msg_idx], (DataT*)buf, *item);
+          buf += item->nbytes;
+          assert(static_cast<IdxT>(item->size*sizeof(DataT)*this->m_variables.size()) == item->nbytes);
         }
         this->m_fuser.exec(this->m_contexts[msg_idx]);
         this->m_contexts[msg_idx].finish_component_recordEvent(this->m_groups[len-1], this->m_components[msg_idx], this->m_events[msg_idx]);
@@ -1012,7 +1008,7 @@ struct MessageGroup<MessageBase::Kind::send, gdsync_pol, exec_policy>
       assert(buf != nullptr);
       const int partner_rank = msg->partner_rank;
       // const int tag = msg->msg_tag;
-      const IdxT nbytes = msg->nbytes() * this->m_variables.size();
+      const IdxT nbytes = msg->nbytes();
 
       // LOGPRINTF("%p Isend %p nbytes %d to %i tag %i\n", this, buf, nbytes, partner_rank, tag);
       message_request_type& msg_request = m_msg_requests[msg->idx];
@@ -1143,7 +1139,7 @@ struct MessageGroup<MessageBase::Kind::recv, gdsync_pol, exec_policy>
       message_type* msg = msgs[i];
       assert(msg->buf == nullptr);
 
-      IdxT nbytes = msg->nbytes() * this->m_variables.size();
+      IdxT nbytes = msg->nbytes();
 
       message_request_type& msg_request = m_msg_requests[msg->idx];
       msg_request.region = con_comm.get_mempool().allocate(con_comm.g, this->m_aloc, nbytes);
@@ -1166,7 +1162,7 @@ struct MessageGroup<MessageBase::Kind::recv, gdsync_pol, exec_policy>
       assert(buf != nullptr);
       const int partner_rank = msg->partner_rank;
       // const int tag = msg->msg_tag;
-      const IdxT nbytes = msg->nbytes() * this->m_variables.size();
+      const IdxT nbytes = msg->nbytes();
       // LOGPRINTF("%p Irecv %p nbytes %d to %i tag %i\n", this, buf, nbytes, partner_rank, tag);
       message_request_type& msg_request = m_msg_requests[msg->idx];
       detail::gdsync::receive(con_comm.g, partner_rank, msg_request.region.mr, msg_request.region.offset, nbytes);
@@ -1192,15 +1188,7 @@ struct MessageGroup<MessageBase::Kind::recv, gdsync_pol, exec_policy>
         this->m_contexts[msg->idx].start_component(this->m_groups[len-1], this->m_components[msg->idx]);
         for (const MessageItemBase* msg_item : msg->message_items) {
           const message_item_type* item = static_cast<const message_item_type*>(msg_item);
-          const IdxT nitems = item->size;
-          const IdxT nbytes = item->nbytes;
-          LidxT const* indices = item->indices;
-          for (DataT* dst : this->m_variables) {
-            // LOGPRINTF("%p unpack %p[%p] = %p nitems %d\n", this, dst, indices, buf, nitems);
-            this->m_contexts[msg->idx].for_all(nitems, make_copy_idxr_idxr(static_cast<DataT const*>(static_cast<void const*>(buf)), detail::indexer_i{},
-                                               dst, detail::indexer_list_i{indices}));
-            buf += nbytes;
-          }
+          buf = this->unpack_item(this->m_contexts[msg->idx], *item, buf);
         }
         this->m_contexts[msg->idx].finish_component(this->m_groups[len-1], this->m_components[msg->idx]);
       }
@@ -1212,9 +1200,9 @@ struct MessageGroup<MessageBase::Kind::recv, gdsync_pol, exec_policy>
         assert(buf != nullptr);
         for (const MessageItemBase* msg_item : msg->message_items) {
           const message_item_type* item = static_cast<const message_item_type*>(msg_item);
-          this->m_fuser.enqueue(con, (DataT const*)buf, item->indices, item->size);
-          buf += item->nbytes * this->m_variables.size();
-          assert(static_cast<IdxT>(item->size*sizeof(DataT)) == item->nbytes);
+          this->m_fuser.enqueue(con, (DataT const*)buf, *item);
+          buf += item->nbytes;
+          assert(static_cast<IdxT>(item->size*sizeof(DataT)*this->m_variables.size()) == item->nbytes);
         }
       }
       this->m_fuser.exec(con);
@@ -1226,9 +1214,9 @@ struct MessageGroup<MessageBase::Kind::recv, gdsync_pol, exec_policy>
         this->m_contexts[msg->idx].start_component(this->m_groups[len-1], this->m_components[msg->idx]);
         for (const MessageItemBase* msg_item : msg->message_items) {
           const message_item_type* item = static_cast<const message_item_type*>(msg_item);
-          this->m_fuser.enqueue(this->m_contexts[msg->idx], (DataT const*)buf, item->indices, item->size);
-          buf += item->nbytes * this->m_variables.size();
-          assert(static_cast<IdxT>(item->size*sizeof(DataT)) == item->nbytes);
+          this->m_fuser.enqueue(this->m_contexts[msg->idx], (DataT const*)buf, *item);
+          buf += item->nbytes;
+          assert(static_cast<IdxT>(item->size*sizeof(DataT)*this->m_variables.size()) == item->nbytes);
         }
         this->m_fuser.exec(this->m_contexts[msg->idx]);
         this->m_contexts[msg->idx].finish_component(this->m_groups[len-1], this->m_components[msg->idx]);
@@ -26,6 +26,10 @@
 struct mock_pol {
   // static const bool async = false;
   static const bool mock = true;
+  // messages over the pipeline threshold may be split into chunk messages
+  static const bool chunk_messages = true;
+  // per cycle message buffers may come from one slab allocated per comm
+  static const bool slab_buffers = true;
 #ifdef COMB_ENABLE_MPI
   // compile mpi_type packing/unpacking tests for this comm policy
   static const bool use_mpi_type = true;
@@ -372,9 +376,9 @@ struct MessageGroup<MessageBase::Kind::send, mock_pol, exec_policy>
       message_type* msg = msgs[i];
       assert(msg->buf == nullptr);
 
-      IdxT nbytes = msg->nbytes() * this->m_variables.size();
+      IdxT nbytes = msg->nbytes();
 
-      msg->buf = this->m_aloc.allocate(nbytes);
+      msg->buf = this->allocate_buffer(*msg, nbytes);
     }
 
     if (comb_allow_pack_loop_fusion()) {
@@ -396,15 +400,7 @@ struct MessageGroup<MessageBase::Kind::send, mock_pol, exec_policy>
         this->m_contexts[msg_idx].start_component(this->m_groups[len-1], this->m_components[msg_idx]);
         for (const MessageItemBase* msg_item : msg->message_items) {
           const message_item_type* item = static_cast<const message_item_type*>(msg_item);
-          const IdxT nitems = item->size;
-          const IdxT nbytes = item->nbytes;
-          LidxT const* indices = item->indices;
-          for (DataT const* src : this->m_variables) {
-            // LOGPRINTF("%p pack %p = %p[%p] nitems %d\n", this, buf, src, indices, nitems);
-            this->m_contexts[msg_idx].for_all(nitems, make_copy_idxr_idxr(src, detail::indexer_list_i{indices},
-                                               static_cast<DataT*>(static_cast<void*>(buf)), detail::indexer_i{}));
-            buf += nbytes;
-          }
+          buf = this->pack_item(this->m_contexts[msg_idx], *item, buf);
         }
         if (async == detail::Async::no) {
           this->m_contexts[msg_idx].finish_component(this->m_groups[len-1], this->m_components[msg_idx]);
@@ -420,9 +416,9 @@ struct MessageGroup<MessageBase::Kind::send, mock_pol, exec_policy>
         assert(buf != nullptr);
         for (const MessageItemBase* msg_item : msg->message_items) {
           const message_item_type* item = static_cast<const message_item_type*>(msg_item);
-          this->m_fuser.enqueue(con, (DataT*)buf, item->indices, item->size);
-          buf += item->nbytes * this->m_variables.size();
-          assert(static_cast<IdxT>(item->size*sizeof(DataT)) == item->nbytes);
+          this->m_fuser.enqueue(con, (DataT*)buf, *item);
+          buf += item->nbytes;
+          assert(static_cast<IdxT>(item->size*sizeof(DataT)*this->m_variables.size()) == item->nbytes);
         }
       }
       this->m_fuser.exec(con);
@@ -435,9 +431,9 @@ struct MessageGroup<MessageBase::Kind::send, mock_pol, exec_policy>
         this->m_contexts[msg_idx].start_component(this->m_groups[len-1], this->m_components[msg_idx]);
         for (const MessageItemBase* msg_item : msg->message_items) {
           const message_item_type* item = static_cast<const message_item_type*>(msg_item);
-          this->m_fuser.enqueue(this->m_contexts[msg_idx], (DataT*)buf, item->indices, item->size);
-          buf += item->nbytes * this->m_variables.size();
-          assert(static_cast<IdxT>(item->size*sizeof(DataT)) == item->nbytes);
+          this->m_fuser.enqueue(this->m_contexts[msg_idx], (DataT*)buf, *item);
+          buf += item->nbytes;
+          assert(static_cast<IdxT>(item->size*sizeof(DataT)*this->m_variables.size()) == item->nbytes);
         }
         this->m_fuser.exec(this->m_contexts[msg_idx]);
         this->m_contexts[msg_idx].finish_component_recordEvent(this->m_groups[len-1], this->m_components[msg_idx], this->m_events[msg_idx]);
@@ -481,7 +477,7 @@ struct MessageGroup<MessageBase::Kind::send, mock_pol, exec_policy>
       // const int partner_rank = msg->partner_rank;
       // const int tag = msg->msg_tag;
       for (const MessageItemBase* msg_item : msg->message_items) {
-        const IdxT nbytes = msg_item->nbytes * this->m_variables.size();
+        const IdxT nbytes = msg_item->nbytes;
         // LOGPRINTF("%p Isend %p nbytes %d to %i tag %i\n", this, buf, nbytes, partner_rank, tag);
         buf += nbytes;
       }
@@ -504,7 +500,7 @@ struct MessageGroup<MessageBase::Kind::send, mock_pol, exec_policy>
       message_type* msg = msgs[i];
       assert(msg->buf != nullptr);
 
-      this->m_aloc.deallocate(msg->buf);
+      this->deallocate_buffer(msg->buf);
 
       msg->buf = nullptr;
     }
@@ -552,9 +548,9 @@ struct MessageGroup<MessageBase::Kind::recv, mock_pol, exec_policy>
       message_type* msg = msgs[i];
       assert(msg->buf == nullptr);
 
-      IdxT nbytes = msg->nbytes() * this->m_variables.size();
+      IdxT nbytes = msg->nbytes();
 
-      msg->buf = this->m_aloc.allocate(nbytes);
+      msg->buf = this->allocate_buffer(*msg, nbytes);
     }
 
     if (comb_allow_pack_loop_fusion()) {
@@ -572,7 +568,7 @@ struct MessageGroup<MessageBase::Kind::recv, mock_pol, exec_policy>
       assert(buf != nullptr);
       // const int partner_rank = msg->partner_rank;
       // const int tag = msg->msg_tag;
-      // const IdxT nbytes = msg->nbytes() * this->m_variables.size();
+      // const IdxT nbytes = msg->nbytes();
       // LOGPRINTF("%p Irecv %p nbytes %d to %i tag %i\n", this, buf, nbytes, partner_rank, tag);
       requests[i] = -1;
     }
@@ -592,15 +588,7 @@ struct MessageGroup<MessageBase::Kind::recv, mock_pol, exec_policy>
         this->m_contexts[msg_idx].start_component(this->m_groups[len-1], this->m_components[msg_idx]);
         for (const MessageItemBase* msg_item : msg->message_items) {
           const message_item_type* item = static_cast<const message_item_type*>(msg_item);
-          const IdxT nitems = item->size;
-          const IdxT nbytes = item->nbytes;
-          LidxT const* indices = item->indices;
-          for (DataT* dst : this->m_variables) {
-            // LOGPRINTF("%p unpack %p[%p] = %p nitems %d\n", this, dst, indices, buf, nitems);
-            this->m_contexts[msg_idx].for_all(nitems, make_copy_idxr_idxr(static_cast<DataT const*>(static_cast<void const*>(buf)), detail::indexer_i{},
-                                               dst, detail::indexer_list_i{indices}));
-            buf += nbytes;
-          }
+          buf = this->unpack_item(this->m_contexts[msg_idx], *item, buf);
         }
         this->m_contexts[msg_idx].finish_component(this->m_groups[len-1], this->m_components[msg_idx]);
       }
@@ -612,9 +600,9 @@ struct MessageGroup<MessageBase::Kind::recv, mock_pol, exec_policy>
         assert(buf != nullptr);
         for (const MessageItemBase* msg_item : msg->message_items) {
           const message_item_type* item = static_cast<const message_item_type*>(msg_item);
-          this->m_fuser.enqueue(con, (DataT const*)buf, item->indices, item->size);
-          buf += item->nbytes * this->m_variables.size();
-          assert(static_cast<IdxT>(item->size*sizeof(DataT)) == item->nbytes);
+          this->m_fuser.enqueue(con, (DataT const*)buf, *item);
+          buf += item->nbytes;
+          assert(static_cast<IdxT>(item->size*sizeof(DataT)*this->m_variables.size()) == item->nbytes);
         }
       }
       this->m_fuser.exec(con);
@@ -630,7 +618,7 @@ struct MessageGroup<MessageBase::Kind::recv, mock_pol, exec_policy>
       message_type* msg = msgs[i];
       assert(msg->buf != nullptr);
 
-      this->m_aloc.deallocate(msg->buf);
+      this->deallocate_buffer(msg->buf);
 
       msg->buf = nullptr;
     }
@@ -684,9 +672,9 @@ struct MessageGroup<MessageBase::Kind::send, mock_pol, mpi_type_pol>
       if (msg->message_items.size() == 1 && this->m_variables.size() == 1) {
         // no buffer needed
       } else {
-        IdxT nbytes = msg->nbytes() * this->m_variables.size();
+        IdxT nbytes = msg->nbytes();
 
-        msg->buf = this->m_aloc.allocate(nbytes);
+        msg->buf = this->allocate_buffer(*msg, nbytes);
       }
     }
   }
@@ -704,7 +692,7 @@ struct MessageGroup<MessageBase::Kind::send, mock_pol, mpi_type_pol>
         char* buf = static_cast<char*>(msg->buf);
         assert(buf != nullptr);
         int pos = 0;
-        const IdxT nbytes = msg->nbytes() * this->m_variables.size();
+        const IdxT nbytes = msg->nbytes();
         for (MessageItemBase* msg_item : msg->message_items) {
           message_item_type* item = static_cast<message_item_type*>(msg_item);
           const IdxT nitems = 1;
@@ -796,7 +784,7 @@ struct MessageGroup<MessageBase::Kind::send, mock_pol, mpi_type_pol>
         assert(msg->buf == nullptr);
       } else {
         assert(msg->buf != nullptr);
-        this->m_aloc.deallocate(msg->buf);
+        this->deallocate_buffer(msg->buf);
         msg->buf = nullptr;
       }
     }
@@ -843,9 +831,9 @@ struct MessageGroup<MessageBase::Kind::recv, mock_pol, mpi_type_pol>
       if (msg->message_items.size() == 1 && this->m_variables.size() == 1) {
         // no buffer needed
       } else {
-        IdxT nbytes = msg->nbytes() * this->m_variables.size();
+        IdxT nbytes = msg->nbytes();
 
-        msg->buf = this->m_aloc.allocate(nbytes);
+        msg->buf = this->allocate_buffer(*msg, nbytes);
       }
     }
   }
@@ -869,7 +857,7 @@ struct MessageGroup<MessageBase::Kind::recv, mock_pol, mpi_type_pol>
       } else {
         char* buf = static_cast<char*>(msg->buf);
         assert(buf != nullptr);
-        // const IdxT nbytes = msg->nbytes() * this->m_variables.size();
+        // const IdxT nbytes = msg->nbytes();
         // LOGPRINTF("%p Irecv %p maxnbytes %i to %i tag %i\n", this, buf, nbytes, partner_rank, tag);
         requests[i] = -1;
       }
@@ -889,7 +877,7 @@ struct MessageGroup<MessageBase::Kind::recv, mock_pol, mpi_type_pol>
       } else {
         char* buf = static_cast<char*>(msg->buf);
         assert(buf != nullptr);
-        const IdxT nbytes = msg->nbytes() * this->m_variables.size();
+        const IdxT nbytes = msg->nbytes();
         int pos = 0;
         for (MessageItemBase* msg_item : msg->message_items) {
           message_item_type* item = static_cast<message_item_type*>(msg_item);
@@ -920,7 +908,7 @@ struct MessageGroup<MessageBase::Kind::recv, mock_pol, mpi_type_pol>
         assert(msg->buf == nullptr);
       } else {
         assert(msg->buf != nullptr);
-        this->m_aloc.deallocate(msg->buf);
+        this->deallocate_buffer(msg->buf);
         msg->buf = nullptr;
       }
     }
@@ -320,6 +320,10 @@ struct mp_pol {
   static const bool mock = false;
   // compile mpi_type packing/unpacking tests for this comm policy
   static const bool use_mpi_type = false;
+  // messages over the pipeline threshold may be split into chunk messages
+  static const bool chunk_messages = false;
+  // per cycle message buffers may come from one slab allocated per comm
+  static const bool slab_buffers = false;
   static const char* get_name() { return "mp"; }
   using send_request_type = detail::mp::Request*;
   using recv_request_type = detail::mp::Request*;
@@ -910,7 +914,7 @@ struct MessageGroup<MessageBase::Kind::send, mp_pol, exec_policy>
       message_type* msg = msgs[i];
       assert(msg->buf == nullptr);
 
-      IdxT nbytes = msg->nbytes() * this->m_variables.size();
+      IdxT nbytes = msg->nbytes();
 
       message_request_type& msg_request = m_msg_requests[msg->idx];
       msg_request.region = con_comm.get_mempool().allocate(con_comm.g, this->m_aloc, nbytes);
@@ -931,15 +935,7 @@ struct MessageGroup<MessageBase::Kind::send, mp_pol, exec_policy>
       this->m_contexts[msg->idx].start_component(this->m_groups[len-1], this->m_components[msg->idx]);
       for (const MessageItemBase* msg_item : msg->message_items) {
         const message_item_type* item = static_cast<const message_item_type*>(msg_item);
-        const IdxT len = item->size;
-        const IdxT nbytes = item->nbytes;
-        LidxT const* indices = item->indices;
-        for (DataT const* src : this->m_variables) {
-          // LOGPRINTF("%p pack %p = %p[%p] len %d\n", this, buf, src, indices, len);
-          this->m_contexts[msg->idx].for_all(len, make_copy_idxr_idxr(src, detail::indexer_list_i{indices},
-                                             static_cast<DataT*>(static_cast<void*>(buf)), detail::indexer_i{}));
-          buf += nbytes;
-        }
+        buf = this->pack_item(this->m_contexts[msg->idx], *item, buf);
       }
       if (async == detail::Async::no) {
         this->m_contexts[msg->idx].finish_component(this->m_groups[len-1], this->m_components[msg->idx]);
@@ -975,7 +971,7 @@ struct MessageGroup<MessageBase::Kind::send, mp_pol, exec_policy>
       assert(buf != nullptr);
       const int partner_rank = msg->partner_rank;
       // const int tag = msg->msg_tag;
-      const IdxT nbytes = msg->nbytes() * this->m_variables.size();
+      const IdxT nbytes = msg->nbytes();
 
       // LOGPRINTF("%p Isend %p nbytes %d to %i tag %i\n", this, buf, nbytes, partner_rank, tag);
       message_request_type& msg_request = m_msg_requests[msg->idx];
@@ -1101,7 +1097,7 @@ struct MessageGroup<MessageBase::Kind::recv, mp_pol, exec_policy>
       message_type* msg = msgs[i];
       assert(msg->buf == nullptr);
 
-      IdxT nbytes = msg->nbytes() * this->m_variables.size();
+      IdxT nbytes = msg->nbytes();
 
       message_request_type& msg_request = m_msg_requests[msg->idx];
       msg_request.region = con_comm.get_mempool().allocate(con_comm.g, this->m_aloc, nbytes);
@@ -1120,7 +1116,7 @@ struct MessageGroup<MessageBase::Kind::recv, mp_pol, exec_policy>
       assert(buf != nullptr);
       const int partner_rank = msg->partner_rank;
       // const int tag = msg->msg_tag;
-      const IdxT nbytes = msg->nbytes() * this->m_variables.size();
+      const IdxT nbytes = msg->nbytes();
       // LOGPRINTF("%p Irecv %p nbytes %d to %i tag %i\n", this, buf, nbytes, partner_rank, tag);
       message_request_type& msg_request = m_msg_requests[msg->idx];
       detail::mp::receive(con_comm.g, partner_rank, msg_request.region.mr, msg_request.region.offset, nbytes);
@@ -1140,20 +1136,12 @@ struct MessageGroup<MessageBase::Kind::recv, mp_pol, exec_policy>
     con.start_group(this->m_groups[len-1]);
     for (IdxT i = 0; i < len; ++i) {
       const message_type* msg = msgs[i];
-      char* buf = static_cast<char*>(msg->buf);
+      char const* buf = static_cast<char const*>(msg->buf);
       assert(buf != nullptr);
       this->m_contexts[msg->idx].start_component(this->m_groups[len-1], this->m_components[msg->idx]);
       for (const MessageItemBase* msg_item : msg->message_items) {
         const message_item_type* item = static_cast<const message_item_type*>(msg_item);
-        const IdxT len = item->size;
-        const IdxT nbytes = item->nbytes;
-        LidxT const* indices = item->indices;
-        for (DataT* dst : this->m_variables) {
-          // LOGPRINTF("%p unpack %p[%p] = %p len %d\n", this, dst, indices, buf, len);
-          this->m_contexts[msg->idx].for_all(len, make_copy_idxr_idxr(static_cast<DataT*>(static_cast<void*>(buf)), detail::indexer_i{},
-                                             dst, detail::indexer_list_i{indices}));
-          buf += nbytes;
-        }
+        buf = this->unpack_item(this->m_contexts[msg->idx], *item, buf);
       }
       this->m_contexts[msg->idx].finish_component(this->m_groups[len-1], this->m_components[msg->idx]);
     }
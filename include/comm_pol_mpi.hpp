@@ -30,6 +30,10 @@ struct mpi_pol {
   static const bool mock = false;
   // compile mpi_type packing/unpacking tests for this comm policy
   static const bool use_mpi_type = true;
+  // messages over the pipeline threshold may be split into chunk messages
+  static const bool chunk_messages = true;
+  // per cycle message buffers may come from one slab allocated per comm
+  static const bool slab_buffers = true;
   static const char* get_name() { return "mpi"; }
   using send_request_type = MPI_Request;
   using recv_request_type = MPI_Request;
@@ -298,9 +302,9 @@ struct MessageGroup<MessageBase::Kind::send, mpi_pol, exec_policy>
       message_type* msg = msgs[i];
       assert(msg->buf == nullptr);
 
-      IdxT nbytes = msg->nbytes() * this->m_variables.size();
+      IdxT nbytes = msg->nbytes();
 
-      msg->buf = this->m_aloc.allocate(nbytes);
+      msg->buf = this->allocate_buffer(*msg, nbytes);
       LOGPRINTF("%p send allocate msg %p buf %p nbytes %d\n", this, msg, msg->buf, nbytes);
     }
 
@@ -326,14 +330,7 @@ struct MessageGroup<MessageBase::Kind::send, mpi_pol, exec_policy>
         for (const MessageItemBase* msg_item : msg->message_items) {
           const message_item_type* item = static_cast<const message_item_type*>(msg_item);
           LOGPRINTF("%p send pack con %p item %p buf %p = srcs[indices %p] nitems %d\n", this, &this->m_contexts[msg_idx], item, buf, item->indices, item->size);
-          const IdxT nitems = item->size;
-          const IdxT nbytes = item->nbytes;
-          LidxT const* indices = item->indices;
-          for (DataT const* src : this->m_variables) {
-            this->m_contexts[msg_idx].for_all(nitems, make_copy_idxr_idxr(src, detail::indexer_list_i{indices},
-                                               static_cast<DataT*>(static_cast<void*>(buf)), detail::indexer_i{}));
-            buf += nbytes;
-          }
+          buf = this->pack_item(this->m_contexts[msg_idx], *item, buf);
         }
         if (async == detail::Async::no) {
           this->m_contexts[msg_idx].finish_component(this->m_groups[len-1], this->m_components[msg_idx]);
@@ -351,9 +348,9 @@ struct MessageGroup<MessageBase::Kind::send, mpi_pol, exec_policy>
         for (const MessageItemBase* msg_item : msg->message_items) {
           const message_item_type* item = static_cast<const message_item_type*>(msg_item);
           LOGPRINTF("%p send pack con %p item %p buf %p = srcs[indices %p] nitems %d\n", this, &con, item, buf, item->indices, item->size);
-          this->m_fuser.enqueue(con, (DataT*)buf, item->indices, item->size);
-          buf += item->nbytes * this->m_variables.size();
-          assert(static_cast<IdxT>(item->size*sizeof(DataT)) == item->nbytes);
+          this->m_fuser.enqueue(con, (DataT*)buf, *item);
+          buf += item->nbytes;
+          assert(static_cast<IdxT>(item->size*sizeof(DataT)*this->m_variables.size()) == item->nbytes);
         }
       }
       this->m_fuser.exec(con);
@@ -369,9 +366,9 @@ struct MessageGroup<MessageBase::Kind::send, mpi_pol, exec_policy>
         for (const MessageItemBase* msg_item : msg->message_items) {
           const message_item_type* item = static_cast<const message_item_type*>(msg_item);
           LOGPRINTF("%p send pack con %p item %p buf %p = srcs[indices %p] nitems %d\n", this, &this->m_contexts[msg_idx], item, buf, item->indices, item->size);
-          this->m_fuser.enqueue(this->m_contexts[msg_idx], (DataT*)buf, item->indices, item->size);
-          buf += item->nbytes * this->m_variables.size();
-          assert(static_cast<IdxT>(item->size*sizeof(DataT)) == item->nbytes);
+          this->m_fuser.enqueue(this->m_contexts[msg_idx], (DataT*)buf, *item);
+          buf += item->nbytes;
+          assert(static_cast<IdxT>(item->size*sizeof(DataT)*this->m_variables.size()) == item->nbytes);
         }
         this->m_fuser.exec(this->m_contexts[msg_idx]);
         this->m_contexts[msg_idx].finish_component_recordEvent(this->m_groups[len-1], this->m_components[msg_idx], this->m_events[msg_idx]);
@@ -411,12 +408,12 @@ struct MessageGroup<MessageBase::Kind::send, mpi_pol, exec_policy>
     for (IdxT i = 0; i < len; ++i) {
       const message_type* msg = msgs[i];
       LOGPRINTF("%p send Isend msg %p buf %p nbytes %d to %i tag %i\n",
-                this, msg, msg->buf, msg->nbytes() * this->m_variables.size(), msg->partner_rank, msg->msg_tag);
+                this, msg, msg->buf, msg->nbytes(), msg->partner_rank, msg->msg_tag);
       char* buf = static_cast<char*>(msg->buf);
       assert(buf != nullptr);
       const int partner_rank = msg->partner_rank;
       const int tag = msg->msg_tag;
-      const IdxT msg_nbytes = msg->nbytes() * this->m_variables.size();
+      const IdxT msg_nbytes = msg->nbytes();
 
       // char const* print_buf = buf;
       // for (const MessageItemBase* msg_item : msg->message_items) {
@@ -436,8 +433,8 @@ struct MessageGroup<MessageBase::Kind::send, mpi_pol, exec_policy>
       //   }
       // }
 
-      detail::MPI::Isend(buf, msg_nbytes, MPI_BYTE,
-                         partner_rank, tag, con_comm.comm, &requests[i]);
+      detail::MPI::Isend_bytes(buf, msg_nbytes,
+                               partner_rank, tag, con_comm.comm, &requests[i]);
     }
     finish_Isends(con, con_comm);
   }
@@ -458,7 +455,7 @@ struct MessageGroup<MessageBase::Kind::send, mpi_pol, exec_policy>
       LOGPRINTF("%p send deallocate msg %p buf %p\n", this, msg, msg->buf);
       assert(msg->buf != nullptr);
 
-      this->m_aloc.deallocate(msg->buf);
+      this->deallocate_buffer(msg->buf);
 
       msg->buf = nullptr;
     }
@@ -506,11 +503,11 @@ struct MessageGroup<MessageBase::Kind::recv, mpi_pol, exec_policy>
       message_type* msg = msgs[i];
       assert(msg->buf == nullptr);
 
-      IdxT nbytes = msg->nbytes() * this->m_variables.size();
+      IdxT nbytes = msg->nbytes();
 
-      msg->buf = this->m_aloc.allocate(nbytes);
+      msg->buf = this->allocate_buffer(*msg, nbytes);
       LOGPRINTF("%p recv allocate msg %p buf %p nbytes %d\n",
-                                this, msg, msg->buf, msg->nbytes() * this->m_variables.size());
+                                this, msg, msg->buf, msg->nbytes());
     }
 
     if (comb_allow_pack_loop_fusion()) {
@@ -526,14 +523,14 @@ struct MessageGroup<MessageBase::Kind::recv, mpi_pol, exec_policy>
     for (IdxT i = 0; i < len; ++i) {
       const message_type* msg = msgs[i];
       LOGPRINTF("%p recv Irecv msg %p buf %p nbytes %d to %d tag %d\n",
-                                this, msg, msg->buf, msg->nbytes() * this->m_variables.size(), msg->partner_rank, msg->msg_tag);
+                                this, msg, msg->buf, msg->nbytes(), msg->partner_rank, msg->msg_tag);
       char* buf = static_cast<char*>(msg->buf);
       assert(buf != nullptr);
       const int partner_rank = msg->partner_rank;
       const int tag = msg->msg_tag;
-      const IdxT nbytes = msg->nbytes() * this->m_variables.size();
-      detail::MPI::Irecv(buf, nbytes, MPI_BYTE,
-                         partner_rank, tag, con_comm.comm, &requests[i]);
+      const IdxT nbytes = msg->nbytes();
+      detail::MPI::Irecv_bytes(buf, nbytes,
+                               partner_rank, tag, con_comm.comm, &requests[i]);
     }
   }
 
@@ -554,23 +551,7 @@ struct MessageGroup<MessageBase::Kind::recv, mpi_pol, exec_policy>
         for (const MessageItemBase* msg_item : msg->message_items) {
           const message_item_type* item = static_cast<const message_item_type*>(msg_item);
           LOGPRINTF("%p recv unpack con %p item %p dsts[indices %p] = buf %p[i] nitems %d\n", this, &this->m_contexts[msg_idx], item, item->indices, buf, item->size);
-          const IdxT nitems = item->size;
-          const IdxT nbytes = item->nbytes;
-          LidxT const* indices = item->indices;
-          for (DataT* dst : this->m_variables) {
-
-            // if (nitems*sizeof(DataT) == nbytes) {
-            //   LOGPRINTF("  buf %p nitems %d nbytes %d [ ", buf, nitems, nbytes);
-            //   for (IdxT idx = 0; idx < nitems; ++idx) {
-            //     LOGPRINTF("%f ", (double)((DataT const*)buf)[idx]);
-            //   }
-            //   LOGPRINTF("] dst %p[indices %p]\n", dst, indices);
-            // }
-
-            this->m_contexts[msg_idx].for_all(nitems, make_copy_idxr_idxr(static_cast<DataT const*>(static_cast<void const*>(buf)), detail::indexer_i{},
-                                               dst, detail::indexer_list_i{indices}));
-            buf += nbytes;
-          }
+          buf = this->unpack_item(this->m_contexts[msg_idx], *item, buf);
         }
         this->m_contexts[msg_idx].finish_component(this->m_groups[len-1], this->m_components[msg_idx]);
       }
@@ -586,7 +567,6 @@ struct MessageGroup<MessageBase::Kind::recv, mpi_pol, exec_policy>
           LOGPRINTF("%p recv unpack con %p item %p dsts[indices %p] = buf %p[i] nitems %d\n", this, &con, item, item->indices, buf, item->size);
           const IdxT nitems = item->size;
           const IdxT nbytes = item->nbytes;
-          LidxT const* indices = item->indices;
 
           // for (DataT* dst : this->m_variables) {
           //   char const* print_buf = buf;
@@ -600,9 +580,9 @@ struct MessageGroup<MessageBase::Kind::recv, mpi_pol, exec_policy>
           //   print_buf += nbytes;
           // }
 
-          this->m_fuser.enqueue(con, (DataT const*)buf, indices, nitems);
-          buf += nbytes * this->m_variables.size();
-          assert(static_cast<IdxT>(nitems*sizeof(DataT)) == nbytes);
+          this->m_fuser.enqueue(con, (DataT const*)buf, *item);
+          buf += nbytes;
+          assert(static_cast<IdxT>(nitems*sizeof(DataT)*this->m_variables.size()) == nbytes);
         }
       }
       this->m_fuser.exec(con);
@@ -620,7 +600,7 @@ struct MessageGroup<MessageBase::Kind::recv, mpi_pol, exec_policy>
       LOGPRINTF("%p recv deallocate msg %p buf %p\n", this, msg, msg->buf);
       assert(msg->buf != nullptr);
 
-      this->m_aloc.deallocate(msg->buf);
+      this->deallocate_buffer(msg->buf);
 
       msg->buf = nullptr;
     }
@@ -672,9 +652,9 @@ struct MessageGroup<MessageBase::Kind::send, mpi_pol, mpi_type_pol>
       if (msg->message_items.size() == 1 && this->m_variables.size() == 1) {
         // no buffer needed
       } else {
-        IdxT nbytes = msg->nbytes() * this->m_variables.size();
+        IdxT nbytes = msg->nbytes();
 
-        msg->buf = this->m_aloc.allocate(nbytes);
+        msg->buf = this->allocate_buffer(*msg, nbytes);
       }
     }
   }
@@ -692,7 +672,7 @@ struct MessageGroup<MessageBase::Kind::send, mpi_pol, mpi_type_pol>
         char* buf = static_cast<char*>(msg->buf);
         assert(buf != nullptr);
         int pos = 0;
-        const IdxT nbytes = msg->nbytes() * this->m_variables.size();
+        const IdxT nbytes = msg->nbytes();
         for (MessageItemBase* msg_item : msg->message_items) {
           message_item_type* item = static_cast<message_item_type*>(msg_item);
           const IdxT len = 1;
@@ -787,7 +767,7 @@ struct MessageGroup<MessageBase::Kind::send, mpi_pol, mpi_type_pol>
         assert(msg->buf == nullptr);
       } else {
         assert(msg->buf != nullptr);
-        this->m_aloc.deallocate(msg->buf);
+        this->deallocate_buffer(msg->buf);
         msg->buf = nullptr;
       }
     }
@@ -834,9 +814,9 @@ struct MessageGroup<MessageBase::Kind::recv, mpi_pol, mpi_type_pol>
       if (msg->message_items.size() == 1 && this->m_variables.size() == 1) {
         // no buffer needed
       } else {
-        IdxT nbytes = msg->nbytes() * this->m_variables.size();
+        IdxT nbytes = msg->nbytes();
 
-        msg->buf = this->m_aloc.allocate(nbytes);
+        msg->buf = this->allocate_buffer(*msg, nbytes);
       }
     }
   }
@@ -861,7 +841,7 @@ struct MessageGroup<MessageBase::Kind::recv, mpi_pol, mpi_type_pol>
       } else {
         char* buf = static_cast<char*>(msg->buf);
         assert(buf != nullptr);
-        const IdxT nbytes = msg->nbytes() * this->m_variables.size();
+        const IdxT nbytes = msg->nbytes();
         // LOGPRINTF("%p Irecv %p maxnbytes %i to %i tag %i\n", this, dst, nbytes, partner_rank, tag);
         detail::MPI::Irecv(buf, nbytes, MPI_PACKED,
                            partner_rank, tag, con_comm.comm, &requests[i]);
@@ -882,7 +862,7 @@ struct MessageGroup<MessageBase::Kind::recv, mpi_pol, mpi_type_pol>
       } else {
         char* buf = static_cast<char*>(msg->buf);
         assert(buf != nullptr);
-        const IdxT nbytes = msg->nbytes() * this->m_variables.size();
+        const IdxT nbytes = msg->nbytes();
         int pos = 0;
         for (MessageItemBase* msg_item : msg->message_items) {
           message_item_type* item = static_cast<message_item_type*>(msg_item);
@@ -913,7 +893,7 @@ struct MessageGroup<MessageBase::Kind::recv, mpi_pol, mpi_type_pol>
         assert(msg->buf == nullptr);
       } else {
         assert(msg->buf != nullptr);
-        this->m_aloc.deallocate(msg->buf);
+        this->deallocate_buffer(msg->buf);
         msg->buf = nullptr;
       }
     }
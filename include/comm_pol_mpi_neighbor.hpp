@@ -0,0 +1,1035 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2018-2021, Lawrence Livermore National Security, LLC.
+//
+// Produced at the Lawrence Livermore National Laboratory
+//
+// LLNL-CODE-758885
+//
+// All rights reserved.
+//
+// This file is part of Comb.
+//
+// For details, see https://github.com/LLNL/Comb
+// Please also see the LICENSE file for MIT license.
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef _COMM_POL_MPI_NEIGHBOR_HPP
+#define _COMM_POL_MPI_NEIGHBOR_HPP
+
+#include "config.hpp"
+
+#ifdef COMB_ENABLE_MPI
+
+#include <algorithm>
+
+#include "comm_pol_mpi.hpp"
+
+// mpi with a neighborhood collective, all the messages of an exchange are
+// sent and received by one MPI_Ineighbor_alltoallv over contiguous send and
+// recv buffers, or by one MPI_Ineighbor_alltoallw over the mesh with
+// datatypes when packing with mpi_type
+struct mpi_neighbor_pol {
+  // static const bool async = false;
+  static const bool mock = false;
+  // compile mpi_type packing/unpacking tests for this comm policy
+  static const bool use_mpi_type = true;
+  // messages over the pipeline threshold may be split into chunk messages
+  static const bool chunk_messages = false;
+  // per cycle message buffers may come from one slab allocated per comm
+  static const bool slab_buffers = false;
+  static const char* get_name() { return "mpi_neighbor"; }
+  // requests are 1 while the exchange is in flight and 2 once each message
+  // has been reported complete
+  using send_request_type = int;
+  using recv_request_type = int;
+  using send_status_type = int;
+  using recv_status_type = int;
+};
+
+template < >
+struct CommContext<mpi_neighbor_pol> : MPIContext
+{
+  using base = MPIContext;
+
+  using pol = mpi_neighbor_pol;
+
+  using send_request_type = typename pol::send_request_type;
+  using recv_request_type = typename pol::recv_request_type;
+  using send_status_type = typename pol::send_status_type;
+  using recv_status_type = typename pol::recv_status_type;
+
+  // a message to or from a neighbor in the graph communicator, either
+  // bytes in the contiguous buffer or a datatype over the mesh
+  struct neighbor_message
+  {
+    IdxT nbytes = 0;
+    IdxT offset = 0;
+    MPI_Datatype mpi_type = MPI_DATATYPE_NULL;
+  };
+
+  MPI_Comm comm = MPI_COMM_NULL;
+  MPI_Comm graph_comm = MPI_COMM_NULL;
+
+  // neighbors in the order of the graph communicator
+  std::vector<int> m_send_ranks;
+  std::vector<int> m_recv_ranks;
+  std::vector<neighbor_message> m_sends;
+  std::vector<neighbor_message> m_recvs;
+
+  COMB::Allocator* m_aloc = nullptr;
+  char* m_send_buf = nullptr;
+  char* m_recv_buf = nullptr;
+
+  IdxT m_num_sends_posted = 0;
+  MPI_Request m_request = MPI_REQUEST_NULL;
+
+  // arguments of the exchange in flight, they must outlive the request
+  std::vector<int> m_sendcounts;
+  std::vector<int> m_recvcounts;
+  std::vector<int> m_sdispls;
+  std::vector<int> m_rdispls;
+  std::vector<MPI_Aint> m_sdispls_w;
+  std::vector<MPI_Aint> m_rdispls_w;
+  std::vector<MPI_Datatype> m_sendtypes;
+  std::vector<MPI_Datatype> m_recvtypes;
+  std::vector<MPI_Datatype> m_bytes_types;
+
+  CommContext()
+    : base()
+  { }
+
+  CommContext(base const& b)
+    : base(b)
+  { }
+
+  CommContext(CommContext const& a_, MPI_Comm comm_)
+    : base(a_)
+    , comm(comm_)
+  { }
+
+  void ensure_waitable()
+  {
+
+  }
+
+  template < typename context >
+  void waitOn(context& con)
+  {
+    con.ensure_waitable();
+    base::waitOn(con);
+  }
+
+  send_request_type send_request_null() { return 0; }
+  recv_request_type recv_request_null() { return 0; }
+  send_status_type send_status_null() { return 0; }
+  recv_status_type recv_status_null() { return 0; }
+
+  void connect_ranks(std::vector<int> const& send_ranks,
+                     std::vector<int> const& recv_ranks)
+  {
+    m_send_ranks = send_ranks;
+    m_recv_ranks = recv_ranks;
+    m_sends.resize(send_ranks.size());
+    m_recvs.resize(recv_ranks.size());
+    // recvs come from sources and sends go to destinations
+    graph_comm = detail::MPI::Dist_graph_create_adjacent(comm,
+        m_recv_ranks.size(), m_recv_ranks.data(),
+        m_send_ranks.size(), m_send_ranks.data());
+  }
+
+  void disconnect_ranks(std::vector<int> const& send_ranks,
+                        std::vector<int> const& recv_ranks)
+  {
+    COMB::ignore_unused(send_ranks, recv_ranks);
+    if (graph_comm != MPI_COMM_NULL) {
+      detail::MPI::Comm_free(&graph_comm);
+    }
+    m_send_ranks.clear();
+    m_recv_ranks.clear();
+    m_sends.clear();
+    m_recvs.clear();
+  }
+
+
+  // the send and recv buffers of both message groups are made from
+  // many_aloc, so both groups must be able to use that memory
+  void setup_mempool(COMB::Allocator& many_aloc,
+                     COMB::Allocator& few_aloc)
+  {
+    COMB::ignore_unused(few_aloc);
+    m_aloc = &many_aloc;
+  }
+
+  void teardown_mempool()
+  {
+    if (m_send_buf != nullptr) {
+      m_aloc->deallocate(m_send_buf); m_send_buf = nullptr;
+    }
+    if (m_recv_buf != nullptr) {
+      m_aloc->deallocate(m_recv_buf); m_recv_buf = nullptr;
+    }
+    for (neighbor_message& msg : m_sends) {
+      if (msg.mpi_type != MPI_DATATYPE_NULL) {
+        detail::MPI::Type_free(&msg.mpi_type);
+      }
+    }
+    for (neighbor_message& msg : m_recvs) {
+      if (msg.mpi_type != MPI_DATATYPE_NULL) {
+        detail::MPI::Type_free(&msg.mpi_type);
+      }
+    }
+    m_aloc = nullptr;
+  }
+
+  // message groups describe their messages before the first cycle
+  void add_send(int rank, IdxT nbytes, MPI_Datatype mpi_type = MPI_DATATYPE_NULL)
+  {
+    neighbor_message& msg = m_sends[neighbor_index(m_send_ranks, rank)];
+    msg.nbytes = nbytes;
+    msg.mpi_type = mpi_type;
+  }
+
+  void add_recv(int rank, IdxT nbytes, MPI_Datatype mpi_type = MPI_DATATYPE_NULL)
+  {
+    neighbor_message& msg = m_recvs[neighbor_index(m_recv_ranks, rank)];
+    msg.nbytes = nbytes;
+    msg.mpi_type = mpi_type;
+  }
+
+  void* send_buffer(int rank)
+  {
+    if (m_send_buf == nullptr) {
+      m_send_buf = allocate_buffer(m_sends);
+    }
+    return m_send_buf + m_sends[neighbor_index(m_send_ranks, rank)].offset;
+  }
+
+  void* recv_buffer(int rank)
+  {
+    if (m_recv_buf == nullptr) {
+      m_recv_buf = allocate_buffer(m_recvs);
+    }
+    return m_recv_buf + m_recvs[neighbor_index(m_recv_ranks, rank)].offset;
+  }
+
+  // start the exchange once every send has been posted, recvs are posted
+  // before sends so their buffers are ready by then
+  void post_send()
+  {
+    ++m_num_sends_posted;
+    if (m_num_sends_posted == static_cast<IdxT>(m_sends.size())) {
+      m_num_sends_posted = 0;
+      start_exchange();
+    }
+  }
+
+  void wait_exchange()
+  {
+    if (m_request != MPI_REQUEST_NULL) {
+      detail::MPI::Wait(&m_request, MPI_STATUS_IGNORE);
+      finish_exchange();
+    }
+  }
+
+  bool test_exchange()
+  {
+    if (m_request != MPI_REQUEST_NULL) {
+      if (!detail::MPI::Test(&m_request, MPI_STATUS_IGNORE)) return false;
+      finish_exchange();
+    }
+    return true;
+  }
+
+private:
+  static IdxT neighbor_index(std::vector<int> const& ranks, int rank)
+  {
+    auto it = std::find(ranks.begin(), ranks.end(), rank);
+    assert(it != ranks.end());
+    return it - ranks.begin();
+  }
+
+  char* allocate_buffer(std::vector<neighbor_message>& msgs)
+  {
+    IdxT nbytes = 0;
+    for (neighbor_message& msg : msgs) {
+      msg.offset = nbytes;
+      nbytes += msg.nbytes;
+    }
+    return static_cast<char*>(m_aloc->allocate(std::max(nbytes, (IdxT)1)));
+  }
+
+  static bool any_large_count(std::vector<neighbor_message> const& msgs)
+  {
+    for (neighbor_message const& msg : msgs) {
+      if (detail::MPI::is_large_count(msg.offset + msg.nbytes)) return true;
+    }
+    return false;
+  }
+
+  void start_exchange()
+  {
+    m_sendcounts.clear(); m_recvcounts.clear();
+    const bool use_types = (!m_sends.empty() && m_sends.front().mpi_type != MPI_DATATYPE_NULL) ||
+                           (!m_recvs.empty() && m_recvs.front().mpi_type != MPI_DATATYPE_NULL);
+    if (!use_types && !any_large_count(m_sends) && !any_large_count(m_recvs)) {
+      m_sdispls.clear(); m_rdispls.clear();
+      for (neighbor_message const& msg : m_sends) {
+        m_sendcounts.emplace_back(static_cast<int>(msg.nbytes));
+        m_sdispls.emplace_back(static_cast<int>(msg.offset));
+      }
+      for (neighbor_message const& msg : m_recvs) {
+        m_recvcounts.emplace_back(static_cast<int>(msg.nbytes));
+        m_rdispls.emplace_back(static_cast<int>(msg.offset));
+      }
+      detail::MPI::Ineighbor_alltoallv(m_send_buf, m_sendcounts.data(), m_sdispls.data(), MPI_BYTE,
+                                       m_recv_buf, m_recvcounts.data(), m_rdispls.data(), MPI_BYTE,
+                                       graph_comm, &m_request);
+    } else {
+      // datatypes hold absolute addresses, large byte counts use
+      // contiguous types of int sized blocks
+      m_sdispls_w.clear(); m_rdispls_w.clear();
+      m_sendtypes.clear(); m_recvtypes.clear();
+      for (neighbor_message const& msg : m_sends) {
+        add_typed(msg, m_send_buf, m_sendcounts, m_sdispls_w, m_sendtypes);
+      }
+      for (neighbor_message const& msg : m_recvs) {
+        add_typed(msg, m_recv_buf, m_recvcounts, m_rdispls_w, m_recvtypes);
+      }
+      detail::MPI::Ineighbor_alltoallw(MPI_BOTTOM, m_sendcounts.data(), m_sdispls_w.data(), m_sendtypes.data(),
+                                       MPI_BOTTOM, m_recvcounts.data(), m_rdispls_w.data(), m_recvtypes.data(),
+                                       graph_comm, &m_request);
+    }
+  }
+
+  void add_typed(neighbor_message const& msg, char* buf,
+                 std::vector<int>& counts, std::vector<MPI_Aint>& displs,
+                 std::vector<MPI_Datatype>& types)
+  {
+    counts.emplace_back(1);
+    if (msg.mpi_type != MPI_DATATYPE_NULL) {
+      displs.emplace_back(0);
+      types.emplace_back(msg.mpi_type);
+    } else {
+      MPI_Datatype mpi_type = detail::MPI::Type_bytes(msg.nbytes);
+      m_bytes_types.emplace_back(mpi_type);
+      displs.emplace_back(detail::MPI::Get_address(buf + msg.offset));
+      types.emplace_back(mpi_type);
+    }
+  }
+
+  void finish_exchange()
+  {
+    for (MPI_Datatype& mpi_type : m_bytes_types) {
+      detail::MPI::Type_free(&mpi_type);
+    }
+    m_bytes_types.clear();
+  }
+};
+
+
+namespace detail {
+
+template < >
+struct Message<MessageBase::Kind::send, mpi_neighbor_pol>
+  : MessageInterface<MessageBase::Kind::send, mpi_neighbor_pol>
+{
+  using base = MessageInterface<MessageBase::Kind::send, mpi_neighbor_pol>;
+
+  using policy_comm = typename base::policy_comm;
+  using communicator_type = typename base::communicator_type;
+  using request_type      = typename base::request_type;
+  using status_type       = typename base::status_type;
+
+  // use the base class constructor
+  using base::base;
+
+
+  // every message completes with the exchange
+  static int wait_send_any(communicator_type& con_comm,
+                           int count, request_type* requests,
+                           status_type* statuses)
+  {
+    for (int i = 0; i < count; ++i) {
+      if (requests[i] != 2) {
+        assert(requests[i] == 1);
+        con_comm.wait_exchange();
+        requests[i] = 2;
+        statuses[i] = 1;
+        return i;
+      }
+    }
+    return -1;
+  }
+
+  static int test_send_any(communicator_type& con_comm,
+                           int count, request_type* requests,
+                           status_type* statuses)
+  {
+    for (int i = 0; i < count; ++i) {
+      if (requests[i] != 2) {
+        assert(requests[i] == 1);
+        if (!con_comm.test_exchange()) return -1;
+        requests[i] = 2;
+        statuses[i] = 1;
+        return i;
+      }
+    }
+    return -1;
+  }
+
+  static int wait_send_some(communicator_type& con_comm,
+                            int count, request_type* requests,
+                            int* indices, status_type* statuses)
+  {
+    con_comm.wait_exchange();
+    int done = 0;
+    for (int i = 0; i < count; ++i) {
+      if (requests[i] != 2) {
+        assert(requests[i] == 1);
+        requests[i] = 2;
+        statuses[i] = 1;
+        indices[done++] = i;
+      }
+    }
+    return done;
+  }
+
+  static int test_send_some(communicator_type& con_comm,
+                            int count, request_type* requests,
+                            int* indices, status_type* statuses)
+  {
+    if (!con_comm.test_exchange()) return 0;
+    int done = 0;
+    for (int i = 0; i < count; ++i) {
+      if (requests[i] != 2) {
+        assert(requests[i] == 1);
+        requests[i] = 2;
+        statuses[i] = 1;
+        indices[done++] = i;
+      }
+    }
+    return done;
+  }
+
+  static void wait_send_all(communicator_type& con_comm,
+                            int count, request_type* requests,
+                            status_type* statuses)
+  {
+    con_comm.wait_exchange();
+    for (int i = 0; i < count; ++i) {
+      if (requests[i] != 2) {
+        assert(requests[i] == 1);
+        requests[i] = 2;
+        statuses[i] = 1;
+      }
+    }
+  }
+
+  static bool test_send_all(communicator_type& con_comm,
+                            int count, request_type* requests,
+                            status_type* statuses)
+  {
+    if (!con_comm.test_exchange()) return false;
+    for (int i = 0; i < count; ++i) {
+      if (requests[i] != 2) {
+        assert(requests[i] == 1);
+        requests[i] = 2;
+        statuses[i] = 1;
+      }
+    }
+    return true;
+  }
+};
+
+
+template < >
+struct Message<MessageBase::Kind::recv, mpi_neighbor_pol>
+  : MessageInterface<MessageBase::Kind::recv, mpi_neighbor_pol>
+{
+  using base = MessageInterface<MessageBase::Kind::recv, mpi_neighbor_pol>;
+
+  using policy_comm = typename base::policy_comm;
+  using communicator_type = typename base::communicator_type;
+  using request_type      = typename base::request_type;
+  using status_type       = typename base::status_type;
+
+  using send_message_type = Message<MessageBase::Kind::send, mpi_neighbor_pol>;
+
+  // use the base class constructor
+  using base::base;
+
+
+  // sends and recvs complete together
+  static int wait_recv_any(communicator_type& con_comm,
+                           int count, request_type* requests,
+                           status_type* statuses)
+  {
+    return send_message_type::wait_send_any(con_comm, count, requests, statuses);
+  }
+
+  static int test_recv_any(communicator_type& con_comm,
+                           int count, request_type* requests,
+                           status_type* statuses)
+  {
+    return send_message_type::test_send_any(con_comm, count, requests, statuses);
+  }
+
+  static int wait_recv_some(communicator_type& con_comm,
+                            int count, request_type* requests,
+                            int* indices, status_type* statuses)
+  {
+    return send_message_type::wait_send_some(con_comm, count, requests, indices, statuses);
+  }
+
+  static int test_recv_some(communicator_type& con_comm,
+                            int count, request_type* requests,
+                            int* indices, status_type* statuses)
+  {
+    return send_message_type::test_send_some(con_comm, count, requests, indices, statuses);
+  }
+
+  static void wait_recv_all(communicator_type& con_comm,
+                            int count, request_type* requests,
+                            status_type* statuses)
+  {
+    send_message_type::wait_send_all(con_comm, count, requests, statuses);
+  }
+
+  static bool test_recv_all(communicator_type& con_comm,
+                            int count, request_type* requests,
+                            status_type* statuses)
+  {
+    return send_message_type::test_send_all(con_comm, count, requests, statuses);
+  }
+};
+
+
+template < typename exec_policy >
+struct MessageGroup<MessageBase::Kind::send, mpi_neighbor_pol, exec_policy>
+  : detail::MessageGroupInterface<MessageBase::Kind::send, mpi_neighbor_pol, exec_policy>
+{
+  using base = detail::MessageGroupInterface<MessageBase::Kind::send, mpi_neighbor_pol, exec_policy>;
+
+  using policy_comm       = typename base::policy_comm;
+  using communicator_type = typename base::communicator_type;
+  using message_type      = typename base::message_type;
+  using request_type      = typename base::request_type;
+  using status_type       = typename base::status_type;
+
+  using message_item_type = typename base::message_item_type;
+  using context_type      = typename base::context_type;
+  using event_type        = typename base::event_type;
+  using group_type        = typename base::group_type;
+  using component_type    = typename base::component_type;
+
+  // use the base class constructor
+  using base::base;
+
+
+  void finalize()
+  {
+    // call base finalize
+    base::finalize();
+  }
+
+  void setup_persistent(context_type& con, communicator_type& con_comm)
+  {
+    COMB::ignore_unused(con);
+    for (message_type& msg : this->messages) {
+      con_comm.add_send(msg.partner_rank, msg.nbytes());
+    }
+  }
+
+  void allocate(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/)
+  {
+    LOGPRINTF("%p send allocate msgs %p len %d\n", this, msgs, len);
+    if (len <= 0) return;
+    for (IdxT i = 0; i < len; ++i) {
+      message_type* msg = msgs[i];
+      assert(msg->buf == nullptr);
+
+      // messages are slices of the exchange send buffer
+      msg->buf = con_comm.send_buffer(msg->partner_rank);
+      LOGPRINTF("%p send allocate msg %p buf %p nbytes %d\n", this, msg, msg->buf, msg->nbytes());
+    }
+
+    if (comb_allow_pack_loop_fusion()) {
+      this->m_fuser.allocate(con, this->m_variables, this->m_items.size());
+    }
+  }
+
+  void pack(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async async)
+  {
+    COMB::ignore_unused(con_comm);
+    LOGPRINTF("%p send pack con %p msgs %p len %d\n", this, &con, msgs, len);
+    if (len <= 0) return;
+    con.start_group(this->m_groups[len-1]);
+    if (!comb_allow_pack_loop_fusion()) {
+      for (IdxT i = 0; i < len; ++i) {
+        const message_type* msg = msgs[i];
+        LOGPRINTF("%p send pack msg %p buf %p\n", this, msg, msg->buf);
+        const IdxT msg_idx = msg->idx;
+        char* buf = static_cast<char*>(msg->buf);
+        assert(buf != nullptr);
+        this->m_contexts[msg_idx].start_component(this->m_groups[len-1], this->m_components[msg_idx]);
+        for (const MessageItemBase* msg_item : msg->message_items) {
+          const message_item_type* item = static_cast<const message_item_type*>(msg_item);
+          LOGPRINTF("%p send pack con %p item %p buf %p = srcs[indices %p] nitems %d\n", this, &this->m_contexts[msg_idx], item, buf, item->indices, item->size);
+          buf = this->pack_item(this->m_contexts[msg_idx], *item, buf);
+        }
+        if (async == detail::Async::no) {
+          this->m_contexts[msg_idx].finish_component(this->m_groups[len-1], this->m_components[msg_idx]);
+        } else {
+          this->m_contexts[msg_idx].finish_component_recordEvent(this->m_groups[len-1], this->m_components[msg_idx], this->m_events[msg_idx]);
+        }
+      }
+    }
+    else if (async == detail::Async::no) {
+      for (IdxT i = 0; i < len; ++i) {
+        const message_type* msg = msgs[i];
+        LOGPRINTF("%p send pack msg %p buf %p\n", this, msg, msg->buf);
+        char* buf = static_cast<char*>(msg->buf);
+        assert(buf != nullptr);
+        for (const MessageItemBase* msg_item : msg->message_items) {
+          const message_item_type* item = static_cast<const message_item_type*>(msg_item);
+          LOGPRINTF("%p send pack con %p item %p buf %p = srcs[indices %p] nitems %d\n", this, &con, item, buf, item->indices, item->size);
+          this->m_fuser.enqueue(con, (DataT*)buf, *item);
+          buf += item->nbytes;
+          assert(static_cast<IdxT>(item->size*sizeof(DataT)*this->m_variables.size()) == item->nbytes);
+        }
+      }
+      this->m_fuser.exec(con);
+    } else {
+      for (IdxT i = 0; i < len; ++i) {
+        const message_type* msg = msgs[i];
+        LOGPRINTF("%p send pack msg %p buf %p\n", this, msg, msg->buf);
+        const IdxT msg_idx = msg->idx;
+        char* buf = static_cast<char*>(msg->buf);
+        assert(buf != nullptr);
+        this->m_contexts[msg_idx].start_component(this->m_groups[len-1], this->m_components[msg_idx]);
+        for (const MessageItemBase* msg_item : msg->message_items) {
+          const message_item_type* item = static_cast<const message_item_type*>(msg_item);
+          LOGPRINTF("%p send pack con %p item %p buf %p = srcs[indices %p] nitems %d\n", this, &this->m_contexts[msg_idx], item, buf, item->indices, item->size);
+          this->m_fuser.enqueue(this->m_contexts[msg_idx], (DataT*)buf, *item);
+          buf += item->nbytes;
+          assert(static_cast<IdxT>(item->size*sizeof(DataT)*this->m_variables.size()) == item->nbytes);
+        }
+        this->m_fuser.exec(this->m_contexts[msg_idx]);
+        this->m_contexts[msg_idx].finish_component_recordEvent(this->m_groups[len-1], this->m_components[msg_idx], this->m_events[msg_idx]);
+      }
+    }
+    con.finish_group(this->m_groups[len-1]);
+  }
+
+  IdxT wait_pack_complete(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async async)
+  {
+    LOGPRINTF("%p send wait_pack_complete con %p msgs %p len %d\n", this, &con, msgs, len);
+    if (len <= 0) return 0;
+    if (async == detail::Async::no) {
+      con_comm.waitOn(con);
+    } else {
+      for (IdxT i = 0; i < len; ++i) {
+        const message_type* msg = msgs[i];
+        if (!this->m_contexts[msg->idx].queryEvent(this->m_events[msg->idx])) {
+          return i;
+        }
+      }
+    }
+    return len;
+  }
+
+  static void start_Isends(context_type& con, communicator_type& con_comm)
+  {
+    LOGPRINTF("send start_Isends con %p\n", &con);
+    COMB::ignore_unused(con, con_comm);
+  }
+
+  void Isend(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/, request_type* requests)
+  {
+    LOGPRINTF("%p send Isend con %p msgs %p len %d\n", this, &con, msgs, len);
+    if (len <= 0) return;
+    start_Isends(con, con_comm);
+    for (IdxT i = 0; i < len; ++i) {
+      const message_type* msg = msgs[i];
+      LOGPRINTF("%p send Isend msg %p buf %p nbytes %d to %i tag %i\n",
+                this, msg, msg->buf, msg->nbytes(), msg->partner_rank, msg->msg_tag);
+      assert(msg->buf != nullptr);
+      requests[i] = 1;
+      con_comm.post_send();
+    }
+    finish_Isends(con, con_comm);
+  }
+
+  static void finish_Isends(context_type& con, communicator_type& con_comm)
+  {
+    LOGPRINTF("send finish_Isends con %p\n", &con);
+    COMB::ignore_unused(con, con_comm);
+  }
+
+  void deallocate(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/)
+  {
+    COMB::ignore_unused(con, con_comm);
+    LOGPRINTF("%p send deallocate con %p msgs %p len %d\n", this, &con, msgs, len);
+    if (len <= 0) return;
+    for (IdxT i = 0; i < len; ++i) {
+      message_type* msg = msgs[i];
+      LOGPRINTF("%p send deallocate msg %p buf %p\n", this, msg, msg->buf);
+      assert(msg->buf != nullptr);
+
+      // the exchange send buffer is freed with the comm
+      msg->buf = nullptr;
+    }
+
+    if (comb_allow_pack_loop_fusion()) {
+      this->m_fuser.deallocate(con);
+    }
+  }
+};
+
+template < typename exec_policy >
+struct MessageGroup<MessageBase::Kind::recv, mpi_neighbor_pol, exec_policy>
+  : detail::MessageGroupInterface<MessageBase::Kind::recv, mpi_neighbor_pol, exec_policy>
+{
+  using base = detail::MessageGroupInterface<MessageBase::Kind::recv, mpi_neighbor_pol, exec_policy>;
+
+  using policy_comm       = typename base::policy_comm;
+  using communicator_type = typename base::communicator_type;
+  using message_type      = typename base::message_type;
+  using request_type      = typename base::request_type;
+  using status_type       = typename base::status_type;
+
+  using message_item_type = typename base::message_item_type;
+  using context_type      = typename base::context_type;
+  using event_type        = typename base::event_type;
+  using group_type        = typename base::group_type;
+  using component_type    = typename base::component_type;
+
+  // use the base class constructor
+  using base::base;
+
+
+  void finalize()
+  {
+    // call base finalize
+    base::finalize();
+  }
+
+  void setup_persistent(context_type& con, communicator_type& con_comm)
+  {
+    COMB::ignore_unused(con);
+    for (message_type& msg : this->messages) {
+      con_comm.add_recv(msg.partner_rank, msg.nbytes());
+    }
+  }
+
+  void allocate(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/)
+  {
+    LOGPRINTF("%p recv allocate con %p msgs %p len %d\n", this, &con, msgs, len);
+    if (len <= 0) return;
+    for (IdxT i = 0; i < len; ++i) {
+      message_type* msg = msgs[i];
+      assert(msg->buf == nullptr);
+
+      // messages are slices of the exchange recv buffer
+      msg->buf = con_comm.recv_buffer(msg->partner_rank);
+      LOGPRINTF("%p recv allocate msg %p buf %p nbytes %d\n",
+                                this, msg, msg->buf, msg->nbytes());
+    }
+
+    if (comb_allow_pack_loop_fusion()) {
+      this->m_fuser.allocate(con, this->m_variables, this->m_items.size());
+    }
+  }
+
+  void Irecv(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/, request_type* requests)
+  {
+    COMB::ignore_unused(con, con_comm);
+    LOGPRINTF("%p recv Irecv con %p msgs %p len %d\n", this, &con, msgs, len);
+    if (len <= 0) return;
+    for (IdxT i = 0; i < len; ++i) {
+      const message_type* msg = msgs[i];
+      LOGPRINTF("%p recv Irecv msg %p buf %p nbytes %d to %d tag %d\n",
+                                this, msg, msg->buf, msg->nbytes(), msg->partner_rank, msg->msg_tag);
+      assert(msg->buf != nullptr);
+      // received by the exchange started with the last send
+      requests[i] = 1;
+    }
+  }
+
+  void unpack(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/)
+  {
+    COMB::ignore_unused(con_comm);
+    LOGPRINTF("%p recv unpack con %p msgs %p len %d\n", this, &con, msgs, len);
+    if (len <= 0) return;
+    con.start_group(this->m_groups[len-1]);
+    if (!comb_allow_pack_loop_fusion()) {
+      for (IdxT i = 0; i < len; ++i) {
+        const message_type* msg = msgs[i];
+        LOGPRINTF("%p recv unpack msg %p buf %p\n", this, msg, msg->buf);
+        const IdxT msg_idx = msg->idx;
+        char const* buf = static_cast<char const*>(msg->buf);
+        assert(buf != nullptr);
+        this->m_contexts[msg_idx].start_component(this->m_groups[len-1], this->m_components[msg_idx]);
+        for (const MessageItemBase* msg_item : msg->message_items) {
+          const message_item_type* item = static_cast<const message_item_type*>(msg_item);
+          LOGPRINTF("%p recv unpack con %p item %p dsts[indices %p] = buf %p[i] nitems %d\n", this, &this->m_contexts[msg_idx], item, item->indices, buf, item->size);
+          buf = this->unpack_item(this->m_contexts[msg_idx], *item, buf);
+        }
+        this->m_contexts[msg_idx].finish_component(this->m_groups[len-1], this->m_components[msg_idx]);
+      }
+    }
+    else {
+      for (IdxT i = 0; i < len; ++i) {
+        const message_type* msg = msgs[i];
+        LOGPRINTF("%p recv unpack msg %p buf %p\n", this, msg, msg->buf);
+        char const* buf = static_cast<char const*>(msg->buf);
+        assert(buf != nullptr);
+        for (const MessageItemBase* msg_item : msg->message_items) {
+          const message_item_type* item = static_cast<const message_item_type*>(msg_item);
+          LOGPRINTF("%p recv unpack con %p item %p dsts[indices %p] = buf %p[i] nitems %d\n", this, &con, item, item->indices, buf, item->size);
+          const IdxT nitems = item->size;
+          const IdxT nbytes = item->nbytes;
+
+          this->m_fuser.enqueue(con, (DataT const*)buf, *item);
+          buf += nbytes;
+          assert(static_cast<IdxT>(nitems*sizeof(DataT)*this->m_variables.size()) == nbytes);
+        }
+      }
+      this->m_fuser.exec(con);
+    }
+    con.finish_group(this->m_groups[len-1]);
+  }
+
+  void deallocate(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/)
+  {
+    COMB::ignore_unused(con, con_comm);
+    LOGPRINTF("%p recv deallocate con %p msgs %p len %d\n", this, &con, msgs, len);
+    if (len <= 0) return;
+    for (IdxT i = 0; i < len; ++i) {
+      message_type* msg = msgs[i];
+      LOGPRINTF("%p recv deallocate msg %p buf %p\n", this, msg, msg->buf);
+      assert(msg->buf != nullptr);
+
+      // the exchange recv buffer is freed with the comm
+      msg->buf = nullptr;
+    }
+
+    if (comb_allow_pack_loop_fusion()) {
+      this->m_fuser.deallocate(con);
+    }
+  }
+};
+
+
+namespace neighbor {
+
+// datatype of a whole message made of the item datatypes of every variable
+// at their absolute addresses
+template < typename message_type >
+inline MPI_Datatype message_datatype(message_type const& msg, std::vector<DataT*> const& variables)
+{
+  using message_item_type = MessageItem<mpi_type_pol>;
+  std::vector<int> blocklengths;
+  std::vector<MPI_Aint> displacements;
+  std::vector<MPI_Datatype> types;
+  for (const MessageItemBase* msg_item : msg.message_items) {
+    const message_item_type* item = static_cast<const message_item_type*>(msg_item);
+    for (DataT const* var : variables) {
+      blocklengths.emplace_back(1);
+      displacements.emplace_back(detail::MPI::Get_address(var));
+      types.emplace_back(item->mpi_type);
+    }
+  }
+  MPI_Datatype mpi_type = detail::MPI::Type_create_struct(types.size(),
+      blocklengths.data(), displacements.data(), types.data());
+  detail::MPI::Type_commit(&mpi_type);
+  return mpi_type;
+}
+
+} // namespace neighbor
+
+// mpi_type messages are sent straight from the mesh by the exchange
+template < >
+struct MessageGroup<MessageBase::Kind::send, mpi_neighbor_pol, mpi_type_pol>
+  : detail::MessageGroupInterface<MessageBase::Kind::send, mpi_neighbor_pol, mpi_type_pol>
+{
+  using base = detail::MessageGroupInterface<MessageBase::Kind::send, mpi_neighbor_pol, mpi_type_pol>;
+
+  using policy_comm       = typename base::policy_comm;
+  using communicator_type = typename base::communicator_type;
+  using message_type      = typename base::message_type;
+  using request_type      = typename base::request_type;
+  using status_type       = typename base::status_type;
+
+  using message_item_type = typename base::message_item_type;
+  using context_type      = typename base::context_type;
+  using event_type        = typename base::event_type;
+  using group_type        = typename base::group_type;
+  using component_type    = typename base::component_type;
+
+  // use the base class constructor
+  using base::base;
+
+
+  void finalize()
+  {
+    // call base finalize
+    base::finalize();
+  }
+
+  void setup_persistent(context_type& con, communicator_type& con_comm)
+  {
+    COMB::ignore_unused(con);
+    for (message_type& msg : this->messages) {
+      con_comm.add_send(msg.partner_rank, msg.nbytes(), neighbor::message_datatype(msg, this->m_variables));
+    }
+  }
+
+  void allocate(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/)
+  {
+    COMB::ignore_unused(con, con_comm, msgs, len);
+    // no buffers needed
+  }
+
+  void pack(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async async)
+  {
+    COMB::ignore_unused(con_comm);
+    if (len <= 0) return;
+    con.start_group(this->m_groups[len-1]);
+    for (IdxT i = 0; i < len; ++i) {
+      message_type* msg = msgs[i];
+      // packed by the datatype in the exchange
+      this->m_contexts[msg->idx].start_component(this->m_groups[len-1], this->m_components[msg->idx]);
+      if (async == detail::Async::no) {
+        this->m_contexts[msg->idx].finish_component(this->m_groups[len-1], this->m_components[msg->idx]);
+      } else {
+        this->m_contexts[msg->idx].finish_component_recordEvent(this->m_groups[len-1], this->m_components[msg->idx], this->m_events[msg->idx]);
+      }
+    }
+    con.finish_group(this->m_groups[len-1]);
+  }
+
+  IdxT wait_pack_complete(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async async)
+  {
+    if (len <= 0) return 0;
+    if (async == detail::Async::no) {
+      con_comm.waitOn(con);
+    } else {
+      for (IdxT i = 0; i < len; ++i) {
+        const message_type* msg = msgs[i];
+        if (!this->m_contexts[msg->idx].queryEvent(this->m_events[msg->idx])) {
+          return i;
+        }
+      }
+    }
+    return len;
+  }
+
+  static void start_Isends(context_type& con, communicator_type& con_comm)
+  {
+    COMB::ignore_unused(con, con_comm);
+  }
+
+  void Isend(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/, request_type* requests)
+  {
+    COMB::ignore_unused(msgs);
+    if (len <= 0) return;
+    start_Isends(con, con_comm);
+    for (IdxT i = 0; i < len; ++i) {
+      requests[i] = 1;
+      con_comm.post_send();
+    }
+    finish_Isends(con, con_comm);
+  }
+
+  static void finish_Isends(context_type& con, communicator_type& con_comm)
+  {
+    COMB::ignore_unused(con, con_comm);
+  }
+
+  void deallocate(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/)
+  {
+    COMB::ignore_unused(con, con_comm, msgs, len);
+    // buf not allocated
+  }
+};
+
+template < >
+struct MessageGroup<MessageBase::Kind::recv, mpi_neighbor_pol, mpi_type_pol>
+  : detail::MessageGroupInterface<MessageBase::Kind::recv, mpi_neighbor_pol, mpi_type_pol>
+{
+  using base = detail::MessageGroupInterface<MessageBase::Kind::recv, mpi_neighbor_pol, mpi_type_pol>;
+
+  using policy_comm       = typename base::policy_comm;
+  using communicator_type = typename base::communicator_type;
+  using message_type      = typename base::message_type;
+  using request_type      = typename base::request_type;
+  using status_type       = typename base::status_type;
+
+  using message_item_type = typename base::message_item_type;
+  using context_type      = typename base::context_type;
+  using event_type        = typename base::event_type;
+  using group_type        = typename base::group_type;
+  using component_type    = typename base::component_type;
+
+  // use the base class constructor
+  using base::base;
+
+
+  void finalize()
+  {
+    // call base finalize
+    base::finalize();
+  }
+
+  void setup_persistent(context_type& con, communicator_type& con_comm)
+  {
+    COMB::ignore_unused(con);
+    for (message_type& msg : this->messages) {
+      con_comm.add_recv(msg.partner_rank, msg.nbytes(),
+          neighbor::message_datatype(msg, this->m_variables));
+    }
+  }
+
+  void allocate(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/)
+  {
+    COMB::ignore_unused(con, con_comm, msgs, len);
+    // no buffers needed
+  }
+
+  void Irecv(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/, request_type* requests)
+  {
+    COMB::ignore_unused(con, con_comm, msgs);
+    if (len <= 0) return;
+    for (IdxT i = 0; i < len; ++i) {
+      // received by the exchange started with the last send
+      requests[i] = 1;
+    }
+  }
+
+  void unpack(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/)
+  {
+    COMB::ignore_unused(con_comm);
+    if (len <= 0) return;
+    con.start_group(this->m_groups[len-1]);
+    for (IdxT i = 0; i < len; ++i) {
+      message_type* msg = msgs[i];
+      // unpacked by the datatype in the exchange
+      this->m_contexts[msg->idx].start_component(this->m_groups[len-1], this->m_components[msg->idx]);
+      this->m_contexts[msg->idx].finish_component(this->m_groups[len-1], this->m_components[msg->idx]);
+    }
+    con.finish_group(this->m_groups[len-1]);
+  }
+
+  void deallocate(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/)
+  {
+    COMB::ignore_unused(con, con_comm, msgs, len);
+    // buf not allocated
+  }
+};
+
+} // namespace detail
+
+#endif
+
+#endif // _COMM_POL_MPI_NEIGHBOR_HPP
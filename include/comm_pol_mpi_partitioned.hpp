@@ -0,0 +1,749 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2018-2021, Lawrence Livermore National Security, LLC.
+//
+// Produced at the Lawrence Livermore National Laboratory
+//
+// LLNL-CODE-758885
+//
+// All rights reserved.
+//
+// This file is part of Comb.
+//
+// For details, see https://github.com/LLNL/Comb
+// Please also see the LICENSE file for MIT license.
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef _COMM_POL_MPI_PARTITIONED_HPP
+#define _COMM_POL_MPI_PARTITIONED_HPP
+
+#include "config.hpp"
+
+#ifdef COMB_ENABLE_MPI_PARTITIONED
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include "comm_pol_mpi.hpp"
+
+// mpi with partitioned requests, each message is split into one partition
+// per thread of the packing context and each partition is sent as soon as
+// it is packed, partitions that arrived when the wait starts are unpacked
+// before the messages complete
+struct mpi_partitioned_pol {
+  // static const bool async = false;
+  static const bool mock = false;
+  // compile mpi_type packing/unpacking tests for this comm policy
+  static const bool use_mpi_type = false;
+  // messages over the pipeline threshold may be split into chunk messages
+  static const bool chunk_messages = true;
+  // per cycle message buffers may come from one slab allocated per comm
+  static const bool slab_buffers = false;
+  static const char* get_name() { return "mpi_partitioned"; }
+  using send_request_type = MPI_Request;
+  using recv_request_type = MPI_Request;
+  using send_status_type = MPI_Status;
+  using recv_status_type = MPI_Status;
+};
+
+template < >
+struct CommContext<mpi_partitioned_pol> : CommContext<mpi_pol>
+{
+  using base = CommContext<mpi_pol>;
+
+  using pol = mpi_partitioned_pol;
+
+  using send_request_type = typename pol::send_request_type;
+  using recv_request_type = typename pol::recv_request_type;
+  using send_status_type = typename pol::send_status_type;
+  using recv_status_type = typename pol::recv_status_type;
+
+  CommContext()
+    : base()
+  { }
+
+  CommContext(MPIContext const& b)
+    : base(b)
+  { }
+
+  CommContext(CommContext const& a_, MPI_Comm comm_)
+    : base(a_, comm_)
+  { }
+};
+
+
+namespace detail {
+
+namespace partitioned {
+
+// number of partitions in messages packed by an exec policy, one per thread
+template < typename exec_policy >
+struct num_threads
+{
+  static int get() { return 1; }
+};
+
+#ifdef COMB_ENABLE_OPENMP
+template < >
+struct num_threads<omp_pol>
+{
+  static int get() { return omp_get_max_threads(); }
+};
+#endif
+
+// state of a partition in a cycle
+enum : int {
+  empty = 0  // not packed or not arrived
+ ,filled = 1 // packed but not ready or arrived but not unpacked
+ ,done = 2   // marked ready or unpacked
+};
+
+// back off between polls of state other threads update
+inline void pause()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  _mm_pause();
+#else
+  std::this_thread::yield();
+#endif
+}
+
+// run body(thread, num_threads) on num_partitions threads, thread 0 is the
+// calling thread so it may make mpi calls under MPI_THREAD_FUNNELED
+template < typename body_type >
+inline void run(int num_partitions, body_type&& body)
+{
+#ifdef COMB_ENABLE_OPENMP
+  if (num_partitions > 1) {
+#pragma omp parallel num_threads(num_partitions)
+    body(omp_get_thread_num(), omp_get_num_threads());
+    return;
+  }
+#endif
+  body(0, 1);
+}
+
+// bytes of each variable of an item in a partition, padded to keep the
+// variables that follow aligned
+inline IdxT segment_nbytes(IdxT chunk, IdxT type_size)
+{
+  const IdxT align = sizeof(double);
+  return ((chunk * type_size + align - 1) / align) * align;
+}
+
+// zones of an item in each partition
+inline IdxT chunk_size(IdxT size, int num_partitions)
+{
+  return (size + num_partitions - 1) / num_partitions;
+}
+
+// call body(buf_offset, mesh_index, len) for the runs of contiguous zones
+// in [lo, hi) of an item, buf_offset is relative to lo
+template < typename message_item_type, typename body_type >
+inline void for_each_run(message_item_type const& item, IdxT lo, IdxT hi, body_type&& body)
+{
+  if (lo >= hi) return;
+  if (item.indices) {
+    for (IdxT i = lo; i < hi; ++i) {
+      body(i - lo, static_cast<IdxT>(item.indices[i]), 1);
+    }
+  } else if (item.spans) {
+    index_span const* begin = item.spans;
+    index_span const* end = item.spans + item.num_spans;
+    index_span const* span = std::upper_bound(begin, end, lo,
+        [](IdxT i, index_span const& s) { return i < s.offset; });
+    if (span != begin) --span;
+    for (; span != end && span->offset < hi; ++span) {
+      IdxT b = std::max(lo, span->offset);
+      IdxT e = std::min(hi, span->offset + span->len);
+      if (b < e) body(b - lo, span->start + (b - span->offset), e - b);
+    }
+  } else {
+    box_rows const& box = item.box;
+    for (IdxT r = lo / box.ilen; r < box.nrows && r * box.ilen < hi; ++r) {
+      IdxT b = std::max(lo, r * box.ilen);
+      IdxT e = std::min(hi, (r + 1) * box.ilen);
+      body(b - lo, box.row(r) + (b - r * box.ilen), e - b);
+    }
+  }
+}
+
+} // namespace partitioned
+
+
+// partitioned requests are waited on and tested like any other mpi request
+template < >
+struct Message<MessageBase::Kind::send, mpi_partitioned_pol>
+  : MessageInterface<MessageBase::Kind::send, mpi_partitioned_pol>
+{
+  using base = MessageInterface<MessageBase::Kind::send, mpi_partitioned_pol>;
+
+  using policy_comm = typename base::policy_comm;
+  using communicator_type = typename base::communicator_type;
+  using request_type      = typename base::request_type;
+  using status_type       = typename base::status_type;
+
+  using mpi_message_type = Message<MessageBase::Kind::send, mpi_pol>;
+
+  // use the base class constructor
+  using base::base;
+
+
+  static int wait_send_any(communicator_type& con_comm,
+                           int count, request_type* requests,
+                           status_type* statuses)
+  {
+    return mpi_message_type::wait_send_any(con_comm, count, requests, statuses);
+  }
+
+  static int test_send_any(communicator_type& con_comm,
+                           int count, request_type* requests,
+                           status_type* statuses)
+  {
+    return mpi_message_type::test_send_any(con_comm, count, requests, statuses);
+  }
+
+  static int wait_send_some(communicator_type& con_comm,
+                            int count, request_type* requests,
+                            int* indices, status_type* statuses)
+  {
+    return mpi_message_type::wait_send_some(con_comm, count, requests, indices, statuses);
+  }
+
+  static int test_send_some(communicator_type& con_comm,
+                            int count, request_type* requests,
+                            int* indices, status_type* statuses)
+  {
+    return mpi_message_type::test_send_some(con_comm, count, requests, indices, statuses);
+  }
+
+  static void wait_send_all(communicator_type& con_comm,
+                            int count, request_type* requests,
+                            status_type* statuses)
+  {
+    mpi_message_type::wait_send_all(con_comm, count, requests, statuses);
+  }
+
+  static bool test_send_all(communicator_type& con_comm,
+                            int count, request_type* requests,
+                            status_type* statuses)
+  {
+    return mpi_message_type::test_send_all(con_comm, count, requests, statuses);
+  }
+};
+
+
+template < >
+struct Message<MessageBase::Kind::recv, mpi_partitioned_pol>
+  : MessageInterface<MessageBase::Kind::recv, mpi_partitioned_pol>
+{
+  using base = MessageInterface<MessageBase::Kind::recv, mpi_partitioned_pol>;
+
+  using policy_comm = typename base::policy_comm;
+  using communicator_type = typename base::communicator_type;
+  using request_type      = typename base::request_type;
+  using status_type       = typename base::status_type;
+
+  using mpi_message_type = Message<MessageBase::Kind::recv, mpi_pol>;
+
+  // use the base class constructor
+  using base::base;
+
+
+  static int wait_recv_any(communicator_type& con_comm,
+                           int count, request_type* requests,
+                           status_type* statuses)
+  {
+    return mpi_message_type::wait_recv_any(con_comm, count, requests, statuses);
+  }
+
+  static int test_recv_any(communicator_type& con_comm,
+                           int count, request_type* requests,
+                           status_type* statuses)
+  {
+    return mpi_message_type::test_recv_any(con_comm, count, requests, statuses);
+  }
+
+  static int wait_recv_some(communicator_type& con_comm,
+                            int count, request_type* requests,
+                            int* indices, status_type* statuses)
+  {
+    return mpi_message_type::wait_recv_some(con_comm, count, requests, indices, statuses);
+  }
+
+  static int test_recv_some(communicator_type& con_comm,
+                            int count, request_type* requests,
+                            int* indices, status_type* statuses)
+  {
+    return mpi_message_type::test_recv_some(con_comm, count, requests, indices, statuses);
+  }
+
+  static void wait_recv_all(communicator_type& con_comm,
+                            int count, request_type* requests,
+                            status_type* statuses)
+  {
+    mpi_message_type::wait_recv_all(con_comm, count, requests, statuses);
+  }
+
+  static bool test_recv_all(communicator_type& con_comm,
+                            int count, request_type* requests,
+                            status_type* statuses)
+  {
+    return mpi_message_type::test_recv_all(con_comm, count, requests, statuses);
+  }
+};
+
+
+// partitions hold a chunk of the zones of every item of a message, all
+// variables of each item chunk are stored together
+template < MessageBase::Kind kind, typename exec_policy >
+struct PartitionedMessageGroup
+  : detail::MessageGroupInterface<kind, mpi_partitioned_pol, exec_policy>
+{
+  using base = detail::MessageGroupInterface<kind, mpi_partitioned_pol, exec_policy>;
+
+  using communicator_type = typename base::communicator_type;
+  using message_type      = typename base::message_type;
+  using request_type      = typename base::request_type;
+  using message_item_type = typename base::message_item_type;
+  using context_type      = typename base::context_type;
+
+  int m_num_partitions = 1;
+  // partitioned requests and partition sizes indexed by message idx
+  std::vector<request_type> m_partitioned_requests;
+  std::vector<IdxT> m_partition_nbytes;
+  // partition states indexed by message idx * m_num_partitions + partition
+  std::unique_ptr<std::atomic<int>[]> m_partition_states;
+
+  // use the base class constructor
+  using base::base;
+
+
+  void setup_partitions(communicator_type& con_comm)
+  {
+    // ranks must agree on the partitioning as it determines the layout
+    int num_partitions = partitioned::num_threads<exec_policy>::get();
+    detail::MPI::Allreduce(&num_partitions, &m_num_partitions, 1, MPI_INT, MPI_MIN, con_comm.comm);
+    assert(m_num_partitions > 0);
+
+    m_partition_nbytes.resize(this->messages.size(), 0);
+    for (message_type& msg : this->messages) {
+      IdxT nbytes = 0;
+      for (const MessageItemBase* msg_item : msg.message_items) {
+        IdxT chunk = partitioned::chunk_size(msg_item->size, m_num_partitions);
+        for (data_type type : this->m_variable_types) {
+          nbytes += partitioned::segment_nbytes(chunk, data_type_size(type));
+        }
+      }
+      m_partition_nbytes[msg.idx] = nbytes;
+    }
+
+    IdxT num_states = this->messages.size() * m_num_partitions;
+    m_partition_states.reset(new std::atomic<int>[num_states]);
+    for (IdxT i = 0; i < num_states; ++i) {
+      m_partition_states[i].store(partitioned::empty, std::memory_order_relaxed);
+    }
+  }
+
+  void teardown_partitions()
+  {
+    for (IdxT i = 0; i < static_cast<IdxT>(m_partitioned_requests.size()); ++i) {
+      message_type& msg = this->messages[i];
+      detail::MPI::Request_free(&m_partitioned_requests[i]);
+      this->m_aloc.deallocate(msg.buf);
+      msg.buf = nullptr;
+    }
+    m_partitioned_requests.clear();
+    m_partition_nbytes.clear();
+    m_partition_states.reset();
+  }
+
+  std::atomic<int>& partition_state(message_type const& msg, int p)
+  {
+    return m_partition_states[msg.idx * m_num_partitions + p];
+  }
+
+  void reset_partition_states(message_type** msgs, IdxT len)
+  {
+    for (IdxT i = 0; i < len; ++i) {
+      for (int p = 0; p < m_num_partitions; ++p) {
+        partition_state(*msgs[i], p).store(partitioned::empty, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  void pack_partition(message_type const& msg, int p)
+  {
+    char* buf = static_cast<char*>(msg.buf) + p * m_partition_nbytes[msg.idx];
+    for (const MessageItemBase* msg_item : msg.message_items) {
+      const message_item_type& item = *static_cast<const message_item_type*>(msg_item);
+      const IdxT chunk = partitioned::chunk_size(item.size, m_num_partitions);
+      const IdxT lo = std::min(p * chunk, item.size);
+      const IdxT hi = std::min(lo + chunk, item.size);
+      IdxT num_vars = this->m_variables.size();
+      for (IdxT v = 0; v < num_vars; ++v) {
+        void const* src_v = this->m_variables[v];
+        visit_data_type(this->m_variable_types[v], [&](auto type) {
+          using T = decltype(type);
+          T const* src = static_cast<T const*>(src_v);
+          T* dst = reinterpret_cast<T*>(buf);
+          partitioned::for_each_run(item, lo, hi, [&](IdxT b, IdxT m, IdxT n) {
+            for (IdxT i = 0; i < n; ++i) {
+              dst[b + i] = src[m + i];
+            }
+          });
+          buf += partitioned::segment_nbytes(chunk, sizeof(T));
+        });
+      }
+    }
+  }
+
+  void unpack_partition(message_type const& msg, int p)
+  {
+    char const* buf = static_cast<char const*>(msg.buf) + p * m_partition_nbytes[msg.idx];
+    for (const MessageItemBase* msg_item : msg.message_items) {
+      const message_item_type& item = *static_cast<const message_item_type*>(msg_item);
+      const IdxT chunk = partitioned::chunk_size(item.size, m_num_partitions);
+      const IdxT lo = std::min(p * chunk, item.size);
+      const IdxT hi = std::min(lo + chunk, item.size);
+      IdxT num_vars = this->m_variables.size();
+      for (IdxT v = 0; v < num_vars; ++v) {
+        void* dst_v = this->m_variables[v];
+        visit_data_type(this->m_variable_types[v], [&](auto type) {
+          using T = decltype(type);
+          T const* src = reinterpret_cast<T const*>(buf);
+          T* dst = static_cast<T*>(dst_v);
+          partitioned::for_each_run(item, lo, hi, [&](IdxT b, IdxT m, IdxT n) {
+            for (IdxT i = 0; i < n; ++i) {
+              dst[m + i] = src[b + i];
+            }
+          });
+          buf += partitioned::segment_nbytes(chunk, sizeof(T));
+        });
+      }
+    }
+  }
+};
+
+
+template < typename exec_policy >
+struct MessageGroup<MessageBase::Kind::send, mpi_partitioned_pol, exec_policy>
+  : PartitionedMessageGroup<MessageBase::Kind::send, exec_policy>
+{
+  using base = PartitionedMessageGroup<MessageBase::Kind::send, exec_policy>;
+
+  using policy_comm       = typename base::policy_comm;
+  using communicator_type = typename base::communicator_type;
+  using message_type      = typename base::message_type;
+  using request_type      = typename base::request_type;
+  using status_type       = typename base::status_type;
+
+  using message_item_type = typename base::message_item_type;
+  using context_type      = typename base::context_type;
+  using event_type        = typename base::event_type;
+  using group_type        = typename base::group_type;
+  using component_type    = typename base::component_type;
+
+  // use the base class constructor
+  using base::base;
+
+
+  void finalize()
+  {
+    // call base finalize
+    base::finalize();
+  }
+
+  void setup_persistent(context_type& con, communicator_type& con_comm)
+  {
+    COMB::ignore_unused(con);
+    LOGPRINTF("%p send setup_persistent con %p nmsgs %d\n", this, &con, (int)this->messages.size());
+    this->setup_partitions(con_comm);
+    this->m_partitioned_requests.resize(this->messages.size(), con_comm.send_request_null());
+    for (message_type& msg : this->messages) {
+      assert(msg.buf == nullptr);
+
+      IdxT nbytes = this->m_partition_nbytes[msg.idx];
+
+      msg.buf = this->m_aloc.allocate(nbytes * this->m_num_partitions);
+      LOGPRINTF("%p send setup_persistent msg %p buf %p nbytes %d partitions %d to %i tag %i\n",
+                this, &msg, msg.buf, nbytes, this->m_num_partitions, msg.partner_rank, msg.msg_tag);
+      detail::MPI::Psend_init(msg.buf, this->m_num_partitions, nbytes, MPI_BYTE,
+                              msg.partner_rank, msg.msg_tag, con_comm.comm, &this->m_partitioned_requests[msg.idx]);
+    }
+  }
+
+  void teardown_persistent(communicator_type& con_comm)
+  {
+    COMB::ignore_unused(con_comm);
+    LOGPRINTF("%p send teardown_persistent nmsgs %d\n", this, (int)this->m_partitioned_requests.size());
+    this->teardown_partitions();
+  }
+
+
+  void allocate(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/)
+  {
+    COMB::ignore_unused(con, con_comm);
+    LOGPRINTF("%p send allocate msgs %p len %d\n", this, msgs, len);
+    if (len <= 0) return;
+    for (IdxT i = 0; i < len; ++i) {
+      // buffers live as long as the partitioned requests
+      assert(msgs[i]->buf != nullptr);
+    }
+  }
+
+  // each thread packs its partition of every message, thread 0 marks
+  // partitions ready as the other threads finish them
+  void pack(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/)
+  {
+    COMB::ignore_unused(con_comm);
+    LOGPRINTF("%p send pack con %p msgs %p len %d partitions %d\n", this, &con, msgs, len, this->m_num_partitions);
+    if (len <= 0) return;
+
+    // partitions can only be marked ready on started requests
+    std::vector<request_type> requests(len, con_comm.send_request_null());
+    for (IdxT i = 0; i < len; ++i) {
+      requests[i] = this->m_partitioned_requests[msgs[i]->idx];
+    }
+    detail::MPI::Startall(len, &requests[0]);
+    this->reset_partition_states(msgs, len);
+
+    const int num_partitions = this->m_num_partitions;
+    IdxT num_ready = 0;
+    auto mark_ready = [&](IdxT num_msgs) {
+      for (IdxT i = 0; i < num_msgs; ++i) {
+        for (int p = 0; p < num_partitions; ++p) {
+          std::atomic<int>& state = this->partition_state(*msgs[i], p);
+          if (state.load(std::memory_order_acquire) == partitioned::filled) {
+            detail::MPI::Pready(p, requests[i]);
+            state.store(partitioned::done, std::memory_order_relaxed);
+            ++num_ready;
+          }
+        }
+      }
+    };
+
+    partitioned::run(num_partitions, [&](int thread, int num_threads) {
+      for (IdxT i = 0; i < len; ++i) {
+        for (int p = thread; p < num_partitions; p += num_threads) {
+          LOGPRINTF("%p send pack msg %p buf %p partition %d\n", this, msgs[i], msgs[i]->buf, p);
+          this->pack_partition(*msgs[i], p);
+          this->partition_state(*msgs[i], p).store(partitioned::filled, std::memory_order_release);
+        }
+        if (thread == 0) mark_ready(i+1);
+      }
+      if (thread == 0) {
+        while (num_ready < len * num_partitions) {
+          partitioned::pause();
+          mark_ready(len);
+        }
+      }
+    });
+  }
+
+  IdxT wait_pack_complete(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/)
+  {
+    COMB::ignore_unused(con, con_comm, msgs);
+    LOGPRINTF("%p send wait_pack_complete con %p msgs %p len %d\n", this, &con, msgs, len);
+    if (len <= 0) return 0;
+    // every partition was packed and marked ready in pack
+    return len;
+  }
+
+  static void start_Isends(context_type& con, communicator_type& con_comm)
+  {
+    LOGPRINTF("send start_Isends con %p\n", &con);
+    COMB::ignore_unused(con, con_comm);
+  }
+
+  void Isend(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/, request_type* requests)
+  {
+    LOGPRINTF("%p send Isend con %p msgs %p len %d\n", this, &con, msgs, len);
+    if (len <= 0) return;
+    start_Isends(con, con_comm);
+    for (IdxT i = 0; i < len; ++i) {
+      const message_type* msg = msgs[i];
+      LOGPRINTF("%p send Isend msg %p buf %p partitions %d to %i tag %i\n",
+                this, msg, msg->buf, this->m_num_partitions, msg->partner_rank, msg->msg_tag);
+      assert(msg->buf != nullptr);
+      // started in pack
+      requests[i] = this->m_partitioned_requests[msg->idx];
+    }
+    finish_Isends(con, con_comm);
+  }
+
+  static void finish_Isends(context_type& con, communicator_type& con_comm)
+  {
+    LOGPRINTF("send finish_Isends con %p\n", &con);
+    COMB::ignore_unused(con, con_comm);
+  }
+
+  void deallocate(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/)
+  {
+    COMB::ignore_unused(con, con_comm);
+    LOGPRINTF("%p send deallocate con %p msgs %p len %d\n", this, &con, msgs, len);
+    if (len <= 0) return;
+    for (IdxT i = 0; i < len; ++i) {
+      // buffers are freed with the partitioned requests
+      assert(msgs[i]->buf != nullptr);
+    }
+  }
+};
+
+template < typename exec_policy >
+struct MessageGroup<MessageBase::Kind::recv, mpi_partitioned_pol, exec_policy>
+  : PartitionedMessageGroup<MessageBase::Kind::recv, exec_policy>
+{
+  using base = PartitionedMessageGroup<MessageBase::Kind::recv, exec_policy>;
+
+  using policy_comm       = typename base::policy_comm;
+  using communicator_type = typename base::communicator_type;
+  using message_type      = typename base::message_type;
+  using request_type      = typename base::request_type;
+  using status_type       = typename base::status_type;
+
+  using message_item_type = typename base::message_item_type;
+  using context_type      = typename base::context_type;
+  using event_type        = typename base::event_type;
+  using group_type        = typename base::group_type;
+  using component_type    = typename base::component_type;
+
+  // use the base class constructor
+  using base::base;
+
+
+  void finalize()
+  {
+    // call base finalize
+    base::finalize();
+  }
+
+  void setup_persistent(context_type& con, communicator_type& con_comm)
+  {
+    COMB::ignore_unused(con);
+    LOGPRINTF("%p recv setup_persistent con %p nmsgs %d\n", this, &con, (int)this->messages.size());
+    this->setup_partitions(con_comm);
+    this->m_partitioned_requests.resize(this->messages.size(), con_comm.recv_request_null());
+    for (message_type& msg : this->messages) {
+      assert(msg.buf == nullptr);
+
+      IdxT nbytes = this->m_partition_nbytes[msg.idx];
+
+      msg.buf = this->m_aloc.allocate(nbytes * this->m_num_partitions);
+      LOGPRINTF("%p recv setup_persistent msg %p buf %p nbytes %d partitions %d to %d tag %d\n",
+                this, &msg, msg.buf, nbytes, this->m_num_partitions, msg.partner_rank, msg.msg_tag);
+      detail::MPI::Precv_init(msg.buf, this->m_num_partitions, nbytes, MPI_BYTE,
+                              msg.partner_rank, msg.msg_tag, con_comm.comm, &this->m_partitioned_requests[msg.idx]);
+    }
+  }
+
+  void teardown_persistent(communicator_type& con_comm)
+  {
+    COMB::ignore_unused(con_comm);
+    LOGPRINTF("%p recv teardown_persistent nmsgs %d\n", this, (int)this->m_partitioned_requests.size());
+    this->teardown_partitions();
+  }
+
+  void allocate(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/)
+  {
+    COMB::ignore_unused(con, con_comm);
+    LOGPRINTF("%p recv allocate con %p msgs %p len %d\n", this, &con, msgs, len);
+    if (len <= 0) return;
+    for (IdxT i = 0; i < len; ++i) {
+      // buffers live as long as the partitioned requests
+      assert(msgs[i]->buf != nullptr);
+    }
+  }
+
+  void Irecv(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/, request_type* requests)
+  {
+    COMB::ignore_unused(con, con_comm);
+    LOGPRINTF("%p recv Irecv con %p msgs %p len %d\n", this, &con, msgs, len);
+    if (len <= 0) return;
+    for (IdxT i = 0; i < len; ++i) {
+      const message_type* msg = msgs[i];
+      LOGPRINTF("%p recv Irecv msg %p buf %p partitions %d to %d tag %d\n",
+                                this, msg, msg->buf, this->m_num_partitions, msg->partner_rank, msg->msg_tag);
+      assert(msg->buf != nullptr);
+      requests[i] = this->m_partitioned_requests[msg->idx];
+    }
+    detail::MPI::Startall(len, requests);
+    this->reset_partition_states(msgs, len);
+  }
+
+  // poll once for partitions that already arrived and unpack them, each
+  // thread its share of the partitions, the rest are unpacked in unpack
+  // once the wait method completes the message
+  void unpack_arrived(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len)
+  {
+    COMB::ignore_unused(con_comm);
+    LOGPRINTF("%p recv unpack_arrived con %p msgs %p len %d partitions %d\n", this, &con, msgs, len, this->m_num_partitions);
+    if (len <= 0) return;
+
+    // mpi is only called by the calling thread
+    const int num_partitions = this->m_num_partitions;
+    IdxT num_arrived = 0;
+    for (IdxT i = 0; i < len; ++i) {
+      for (int p = 0; p < num_partitions; ++p) {
+        std::atomic<int>& state = this->partition_state(*msgs[i], p);
+        if (state.load(std::memory_order_relaxed) == partitioned::empty &&
+            detail::MPI::Parrived(this->m_partitioned_requests[msgs[i]->idx], p)) {
+          state.store(partitioned::filled, std::memory_order_relaxed);
+          ++num_arrived;
+        }
+      }
+    }
+    if (num_arrived == 0) return;
+
+    partitioned::run(num_partitions, [&](int thread, int num_threads) {
+      for (IdxT i = 0; i < len; ++i) {
+        for (int p = thread; p < num_partitions; p += num_threads) {
+          std::atomic<int>& state = this->partition_state(*msgs[i], p);
+          if (state.load(std::memory_order_relaxed) == partitioned::filled) {
+            this->unpack_partition(*msgs[i], p);
+            state.store(partitioned::done, std::memory_order_relaxed);
+          }
+        }
+      }
+    });
+  }
+
+  // unpack partitions that were not unpacked as they arrived
+  void unpack(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/)
+  {
+    COMB::ignore_unused(con_comm);
+    LOGPRINTF("%p recv unpack con %p msgs %p len %d\n", this, &con, msgs, len);
+    if (len <= 0) return;
+    for (IdxT i = 0; i < len; ++i) {
+      for (int p = 0; p < this->m_num_partitions; ++p) {
+        std::atomic<int>& state = this->partition_state(*msgs[i], p);
+        if (state.load(std::memory_order_relaxed) != partitioned::done) {
+          this->unpack_partition(*msgs[i], p);
+          state.store(partitioned::done, std::memory_order_relaxed);
+        }
+      }
+    }
+  }
+
+  void deallocate(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/)
+  {
+    COMB::ignore_unused(con, con_comm);
+    LOGPRINTF("%p recv deallocate con %p msgs %p len %d\n", this, &con, msgs, len);
+    if (len <= 0) return;
+    for (IdxT i = 0; i < len; ++i) {
+      // buffers are freed with the partitioned requests
+      assert(msgs[i]->buf != nullptr);
+    }
+  }
+};
+
+} // namespace detail
+
+#endif
+
+#endif // _COMM_POL_MPI_PARTITIONED_HPP
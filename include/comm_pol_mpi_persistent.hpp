@@ -0,0 +1,552 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2018-2021, Lawrence Livermore National Security, LLC.
+//
+// Produced at the Lawrence Livermore National Laboratory
+//
+// LLNL-CODE-758885
+//
+// All rights reserved.
+//
+// This file is part of Comb.
+//
+// For details, see https://github.com/LLNL/Comb
+// Please also see the LICENSE file for MIT license.
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef _COMM_POL_MPI_PERSISTENT_HPP
+#define _COMM_POL_MPI_PERSISTENT_HPP
+
+#include "config.hpp"
+
+#ifdef COMB_ENABLE_MPI
+
+#include "comm_pol_mpi.hpp"
+
+// mpi with persistent requests, message buffers and requests are made
+// once in Comm::finish_populating and each cycle only starts the requests
+struct mpi_persistent_pol {
+  // static const bool async = false;
+  static const bool mock = false;
+  // compile mpi_type packing/unpacking tests for this comm policy
+  static const bool use_mpi_type = false;
+  // messages over the pipeline threshold may be split into chunk messages
+  static const bool chunk_messages = true;
+  // per cycle message buffers may come from one slab allocated per comm
+  static const bool slab_buffers = false;
+  static const char* get_name() { return "mpi_persistent"; }
+  using send_request_type = MPI_Request;
+  using recv_request_type = MPI_Request;
+  using send_status_type = MPI_Status;
+  using recv_status_type = MPI_Status;
+};
+
+template < >
+struct CommContext<mpi_persistent_pol> : CommContext<mpi_pol>
+{
+  using base = CommContext<mpi_pol>;
+
+  using pol = mpi_persistent_pol;
+
+  using send_request_type = typename pol::send_request_type;
+  using recv_request_type = typename pol::recv_request_type;
+  using send_status_type = typename pol::send_status_type;
+  using recv_status_type = typename pol::recv_status_type;
+
+  CommContext()
+    : base()
+  { }
+
+  CommContext(MPIContext const& b)
+    : base(b)
+  { }
+
+  CommContext(CommContext const& a_, MPI_Comm comm_)
+    : base(a_, comm_)
+  { }
+};
+
+
+namespace detail {
+
+// persistent requests are waited on and tested like any other mpi request
+template < >
+struct Message<MessageBase::Kind::send, mpi_persistent_pol>
+  : MessageInterface<MessageBase::Kind::send, mpi_persistent_pol>
+{
+  using base = MessageInterface<MessageBase::Kind::send, mpi_persistent_pol>;
+
+  using policy_comm = typename base::policy_comm;
+  using communicator_type = typename base::communicator_type;
+  using request_type      = typename base::request_type;
+  using status_type       = typename base::status_type;
+
+  using mpi_message_type = Message<MessageBase::Kind::send, mpi_pol>;
+
+  // use the base class constructor
+  using base::base;
+
+
+  static int wait_send_any(communicator_type& con_comm,
+                           int count, request_type* requests,
+                           status_type* statuses)
+  {
+    return mpi_message_type::wait_send_any(con_comm, count, requests, statuses);
+  }
+
+  static int test_send_any(communicator_type& con_comm,
+                           int count, request_type* requests,
+                           status_type* statuses)
+  {
+    return mpi_message_type::test_send_any(con_comm, count, requests, statuses);
+  }
+
+  static int wait_send_some(communicator_type& con_comm,
+                            int count, request_type* requests,
+                            int* indices, status_type* statuses)
+  {
+    return mpi_message_type::wait_send_some(con_comm, count, requests, indices, statuses);
+  }
+
+  static int test_send_some(communicator_type& con_comm,
+                            int count, request_type* requests,
+                            int* indices, status_type* statuses)
+  {
+    return mpi_message_type::test_send_some(con_comm, count, requests, indices, statuses);
+  }
+
+  static void wait_send_all(communicator_type& con_comm,
+                            int count, request_type* requests,
+                            status_type* statuses)
+  {
+    mpi_message_type::wait_send_all(con_comm, count, requests, statuses);
+  }
+
+  static bool test_send_all(communicator_type& con_comm,
+                            int count, request_type* requests,
+                            status_type* statuses)
+  {
+    return mpi_message_type::test_send_all(con_comm, count, requests, statuses);
+  }
+};
+
+
+template < >
+struct Message<MessageBase::Kind::recv, mpi_persistent_pol>
+  : MessageInterface<MessageBase::Kind::recv, mpi_persistent_pol>
+{
+  using base = MessageInterface<MessageBase::Kind::recv, mpi_persistent_pol>;
+
+  using policy_comm = typename base::policy_comm;
+  using communicator_type = typename base::communicator_type;
+  using request_type      = typename base::request_type;
+  using status_type       = typename base::status_type;
+
+  using mpi_message_type = Message<MessageBase::Kind::recv, mpi_pol>;
+
+  // use the base class constructor
+  using base::base;
+
+
+  static int wait_recv_any(communicator_type& con_comm,
+                           int count, request_type* requests,
+                           status_type* statuses)
+  {
+    return mpi_message_type::wait_recv_any(con_comm, count, requests, statuses);
+  }
+
+  static int test_recv_any(communicator_type& con_comm,
+                           int count, request_type* requests,
+                           status_type* statuses)
+  {
+    return mpi_message_type::test_recv_any(con_comm, count, requests, statuses);
+  }
+
+  static int wait_recv_some(communicator_type& con_comm,
+                            int count, request_type* requests,
+                            int* indices, status_type* statuses)
+  {
+    return mpi_message_type::wait_recv_some(con_comm, count, requests, indices, statuses);
+  }
+
+  static int test_recv_some(communicator_type& con_comm,
+                            int count, request_type* requests,
+                            int* indices, status_type* statuses)
+  {
+    return mpi_message_type::test_recv_some(con_comm, count, requests, indices, statuses);
+  }
+
+  static void wait_recv_all(communicator_type& con_comm,
+                            int count, request_type* requests,
+                            status_type* statuses)
+  {
+    mpi_message_type::wait_recv_all(con_comm, count, requests, statuses);
+  }
+
+  static bool test_recv_all(communicator_type& con_comm,
+                            int count, request_type* requests,
+                            status_type* statuses)
+  {
+    return mpi_message_type::test_recv_all(con_comm, count, requests, statuses);
+  }
+};
+
+
+template < typename exec_policy >
+struct MessageGroup<MessageBase::Kind::send, mpi_persistent_pol, exec_policy>
+  : detail::MessageGroupInterface<MessageBase::Kind::send, mpi_persistent_pol, exec_policy>
+{
+  using base = detail::MessageGroupInterface<MessageBase::Kind::send, mpi_persistent_pol, exec_policy>;
+
+  using policy_comm       = typename base::policy_comm;
+  using communicator_type = typename base::communicator_type;
+  using message_type      = typename base::message_type;
+  using request_type      = typename base::request_type;
+  using status_type       = typename base::status_type;
+
+  using message_item_type = typename base::message_item_type;
+  using context_type      = typename base::context_type;
+  using event_type        = typename base::event_type;
+  using group_type        = typename base::group_type;
+  using component_type    = typename base::component_type;
+
+  // persistent requests indexed by message idx
+  std::vector<request_type> m_persistent_requests;
+
+  // use the base class constructor
+  using base::base;
+
+
+  void finalize()
+  {
+    // call base finalize
+    base::finalize();
+  }
+
+  void setup_persistent(context_type& con, communicator_type& con_comm)
+  {
+    COMB::ignore_unused(con);
+    LOGPRINTF("%p send setup_persistent con %p nmsgs %d\n", this, &con, (int)this->messages.size());
+    m_persistent_requests.resize(this->messages.size(), con_comm.send_request_null());
+    for (message_type& msg : this->messages) {
+      assert(msg.buf == nullptr);
+
+      IdxT nbytes = msg.nbytes();
+
+      msg.buf = this->m_aloc.allocate(nbytes);
+      LOGPRINTF("%p send setup_persistent msg %p buf %p nbytes %d to %i tag %i\n",
+                this, &msg, msg.buf, nbytes, msg.partner_rank, msg.msg_tag);
+      detail::MPI::Send_init_bytes(msg.buf, nbytes,
+                                   msg.partner_rank, msg.msg_tag, con_comm.comm, &m_persistent_requests[msg.idx]);
+    }
+  }
+
+  void teardown_persistent(communicator_type& con_comm)
+  {
+    COMB::ignore_unused(con_comm);
+    LOGPRINTF("%p send teardown_persistent nmsgs %d\n", this, (int)m_persistent_requests.size());
+    for (IdxT i = 0; i < static_cast<IdxT>(m_persistent_requests.size()); ++i) {
+      message_type& msg = this->messages[i];
+      detail::MPI::Request_free(&m_persistent_requests[i]);
+      this->m_aloc.deallocate(msg.buf);
+      msg.buf = nullptr;
+    }
+    m_persistent_requests.clear();
+  }
+
+
+  void allocate(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/)
+  {
+    COMB::ignore_unused(con, con_comm);
+    LOGPRINTF("%p send allocate msgs %p len %d\n", this, msgs, len);
+    if (len <= 0) return;
+    for (IdxT i = 0; i < len; ++i) {
+      // buffers live as long as the persistent requests
+      assert(msgs[i]->buf != nullptr);
+    }
+
+    if (comb_allow_pack_loop_fusion()) {
+      this->m_fuser.allocate(con, this->m_variables, this->m_items.size());
+    }
+  }
+
+  void pack(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async async)
+  {
+    COMB::ignore_unused(con_comm);
+    LOGPRINTF("%p send pack con %p msgs %p len %d\n", this, &con, msgs, len);
+    if (len <= 0) return;
+    con.start_group(this->m_groups[len-1]);
+    if (!comb_allow_pack_loop_fusion()) {
+      for (IdxT i = 0; i < len; ++i) {
+        const message_type* msg = msgs[i];
+        LOGPRINTF("%p send pack msg %p buf %p\n", this, msg, msg->buf);
+        const IdxT msg_idx = msg->idx;
+        char* buf = static_cast<char*>(msg->buf);
+        assert(buf != nullptr);
+        this->m_contexts[msg_idx].start_component(this->m_groups[len-1], this->m_components[msg_idx]);
+        for (const MessageItemBase* msg_item : msg->message_items) {
+          const message_item_type* item = static_cast<const message_item_type*>(msg_item);
+          LOGPRINTF("%p send pack con %p item %p buf %p = srcs[indices %p] nitems %d\n", this, &this->m_contexts[msg_idx], item, buf, item->indices, item->size);
+          buf = this->pack_item(this->m_contexts[msg_idx], *item, buf);
+        }
+        if (async == detail::Async::no) {
+          this->m_contexts[msg_idx].finish_component(this->m_groups[len-1], this->m_components[msg_idx]);
+        } else {
+          this->m_contexts[msg_idx].finish_component_recordEvent(this->m_groups[len-1], this->m_components[msg_idx], this->m_events[msg_idx]);
+        }
+      }
+    }
+    else if (async == detail::Async::no) {
+      for (IdxT i = 0; i < len; ++i) {
+        const message_type* msg = msgs[i];
+        LOGPRINTF("%p send pack msg %p buf %p\n", this, msg, msg->buf);
+        char* buf = static_cast<char*>(msg->buf);
+        assert(buf != nullptr);
+        for (const MessageItemBase* msg_item : msg->message_items) {
+          const message_item_type* item = static_cast<const message_item_type*>(msg_item);
+          LOGPRINTF("%p send pack con %p item %p buf %p = srcs[indices %p] nitems %d\n", this, &con, item, buf, item->indices, item->size);
+          this->m_fuser.enqueue(con, (DataT*)buf, *item);
+          buf += item->nbytes;
+          assert(static_cast<IdxT>(item->size*sizeof(DataT)*this->m_variables.size()) == item->nbytes);
+        }
+      }
+      this->m_fuser.exec(con);
+    } else {
+      for (IdxT i = 0; i < len; ++i) {
+        const message_type* msg = msgs[i];
+        LOGPRINTF("%p send pack msg %p buf %p\n", this, msg, msg->buf);
+        const IdxT msg_idx = msg->idx;
+        char* buf = static_cast<char*>(msg->buf);
+        assert(buf != nullptr);
+        this->m_contexts[msg_idx].start_component(this->m_groups[len-1], this->m_components[msg_idx]);
+        for (const MessageItemBase* msg_item : msg->message_items) {
+          const message_item_type* item = static_cast<const message_item_type*>(msg_item);
+          LOGPRINTF("%p send pack con %p item %p buf %p = srcs[indices %p] nitems %d\n", this, &this->m_contexts[msg_idx], item, buf, item->indices, item->size);
+          this->m_fuser.enqueue(this->m_contexts[msg_idx], (DataT*)buf, *item);
+          buf += item->nbytes;
+          assert(static_cast<IdxT>(item->size*sizeof(DataT)*this->m_variables.size()) == item->nbytes);
+        }
+        this->m_fuser.exec(this->m_contexts[msg_idx]);
+        this->m_contexts[msg_idx].finish_component_recordEvent(this->m_groups[len-1], this->m_components[msg_idx], this->m_events[msg_idx]);
+      }
+    }
+    con.finish_group(this->m_groups[len-1]);
+  }
+
+  IdxT wait_pack_complete(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async async)
+  {
+    LOGPRINTF("%p send wait_pack_complete con %p msgs %p len %d\n", this, &con, msgs, len);
+    if (len <= 0) return 0;
+    if (async == detail::Async::no) {
+      con_comm.waitOn(con);
+    } else {
+      for (IdxT i = 0; i < len; ++i) {
+        const message_type* msg = msgs[i];
+        if (!this->m_contexts[msg->idx].queryEvent(this->m_events[msg->idx])) {
+          return i;
+        }
+      }
+    }
+    return len;
+  }
+
+  static void start_Isends(context_type& con, communicator_type& con_comm)
+  {
+    LOGPRINTF("send start_Isends con %p\n", &con);
+    COMB::ignore_unused(con, con_comm);
+  }
+
+  void Isend(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/, request_type* requests)
+  {
+    LOGPRINTF("%p send Isend con %p msgs %p len %d\n", this, &con, msgs, len);
+    if (len <= 0) return;
+    start_Isends(con, con_comm);
+    for (IdxT i = 0; i < len; ++i) {
+      const message_type* msg = msgs[i];
+      LOGPRINTF("%p send Isend msg %p buf %p nbytes %d to %i tag %i\n",
+                this, msg, msg->buf, msg->nbytes(), msg->partner_rank, msg->msg_tag);
+      assert(msg->buf != nullptr);
+      requests[i] = m_persistent_requests[msg->idx];
+    }
+    detail::MPI::Startall(len, requests);
+    finish_Isends(con, con_comm);
+  }
+
+  static void finish_Isends(context_type& con, communicator_type& con_comm)
+  {
+    LOGPRINTF("send finish_Isends con %p\n", &con);
+    COMB::ignore_unused(con, con_comm);
+  }
+
+  void deallocate(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/)
+  {
+    COMB::ignore_unused(con, con_comm);
+    LOGPRINTF("%p send deallocate con %p msgs %p len %d\n", this, &con, msgs, len);
+    if (len <= 0) return;
+    for (IdxT i = 0; i < len; ++i) {
+      // buffers are freed with the persistent requests
+      assert(msgs[i]->buf != nullptr);
+    }
+
+    if (comb_allow_pack_loop_fusion()) {
+      this->m_fuser.deallocate(con);
+    }
+  }
+};
+
+template < typename exec_policy >
+struct MessageGroup<MessageBase::Kind::recv, mpi_persistent_pol, exec_policy>
+  : detail::MessageGroupInterface<MessageBase::Kind::recv, mpi_persistent_pol, exec_policy>
+{
+  using base = detail::MessageGroupInterface<MessageBase::Kind::recv, mpi_persistent_pol, exec_policy>;
+
+  using policy_comm       = typename base::policy_comm;
+  using communicator_type = typename base::communicator_type;
+  using message_type      = typename base::message_type;
+  using request_type      = typename base::request_type;
+  using status_type       = typename base::status_type;
+
+  using message_item_type = typename base::message_item_type;
+  using context_type      = typename base::context_type;
+  using event_type        = typename base::event_type;
+  using group_type        = typename base::group_type;
+  using component_type    = typename base::component_type;
+
+  // persistent requests indexed by message idx
+  std::vector<request_type> m_persistent_requests;
+
+  // use the base class constructor
+  using base::base;
+
+
+  void finalize()
+  {
+    // call base finalize
+    base::finalize();
+  }
+
+  void setup_persistent(context_type& con, communicator_type& con_comm)
+  {
+    COMB::ignore_unused(con);
+    LOGPRINTF("%p recv setup_persistent con %p nmsgs %d\n", this, &con, (int)this->messages.size());
+    m_persistent_requests.resize(this->messages.size(), con_comm.recv_request_null());
+    for (message_type& msg : this->messages) {
+      assert(msg.buf == nullptr);
+
+      IdxT nbytes = msg.nbytes();
+
+      msg.buf = this->m_aloc.allocate(nbytes);
+      LOGPRINTF("%p recv setup_persistent msg %p buf %p nbytes %d to %d tag %d\n",
+                this, &msg, msg.buf, nbytes, msg.partner_rank, msg.msg_tag);
+      detail::MPI::Recv_init_bytes(msg.buf, nbytes,
+                                   msg.partner_rank, msg.msg_tag, con_comm.comm, &m_persistent_requests[msg.idx]);
+    }
+  }
+
+  void teardown_persistent(communicator_type& con_comm)
+  {
+    COMB::ignore_unused(con_comm);
+    LOGPRINTF("%p recv teardown_persistent nmsgs %d\n", this, (int)m_persistent_requests.size());
+    for (IdxT i = 0; i < static_cast<IdxT>(m_persistent_requests.size()); ++i) {
+      message_type& msg = this->messages[i];
+      detail::MPI::Request_free(&m_persistent_requests[i]);
+      this->m_aloc.deallocate(msg.buf);
+      msg.buf = nullptr;
+    }
+    m_persistent_requests.clear();
+  }
+
+  void allocate(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/)
+  {
+    COMB::ignore_unused(con, con_comm);
+    LOGPRINTF("%p recv allocate con %p msgs %p len %d\n", this, &con, msgs, len);
+    if (len <= 0) return;
+    for (IdxT i = 0; i < len; ++i) {
+      // buffers live as long as the persistent requests
+      assert(msgs[i]->buf != nullptr);
+    }
+
+    if (comb_allow_pack_loop_fusion()) {
+      this->m_fuser.allocate(con, this->m_variables, this->m_items.size());
+    }
+  }
+
+  void Irecv(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/, request_type* requests)
+  {
+    COMB::ignore_unused(con, con_comm);
+    LOGPRINTF("%p recv Irecv con %p msgs %p len %d\n", this, &con, msgs, len);
+    if (len <= 0) return;
+    for (IdxT i = 0; i < len; ++i) {
+      const message_type* msg = msgs[i];
+      LOGPRINTF("%p recv Irecv msg %p buf %p nbytes %d to %d tag %d\n",
+                                this, msg, msg->buf, msg->nbytes(), msg->partner_rank, msg->msg_tag);
+      assert(msg->buf != nullptr);
+      requests[i] = m_persistent_requests[msg->idx];
+    }
+    detail::MPI::Startall(len, requests);
+  }
+
+  void unpack(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/)
+  {
+    COMB::ignore_unused(con_comm);
+    LOGPRINTF("%p recv unpack con %p msgs %p len %d\n", this, &con, msgs, len);
+    if (len <= 0) return;
+    con.start_group(this->m_groups[len-1]);
+    if (!comb_allow_pack_loop_fusion()) {
+      for (IdxT i = 0; i < len; ++i) {
+        const message_type* msg = msgs[i];
+        LOGPRINTF("%p recv unpack msg %p buf %p\n", this, msg, msg->buf);
+        const IdxT msg_idx = msg->idx;
+        char const* buf = static_cast<char const*>(msg->buf);
+        assert(buf != nullptr);
+        this->m_contexts[msg_idx].start_component(this->m_groups[len-1], this->m_components[msg_idx]);
+        for (const MessageItemBase* msg_item : msg->message_items) {
+          const message_item_type* item = static_cast<const message_item_type*>(msg_item);
+          LOGPRINTF("%p recv unpack con %p item %p dsts[indices %p] = buf %p[i] nitems %d\n", this, &this->m_contexts[msg_idx], item, item->indices, buf, item->size);
+          buf = this->unpack_item(this->m_contexts[msg_idx], *item, buf);
+        }
+        this->m_contexts[msg_idx].finish_component(this->m_groups[len-1], this->m_components[msg_idx]);
+      }
+    }
+    else {
+      for (IdxT i = 0; i < len; ++i) {
+        const message_type* msg = msgs[i];
+        LOGPRINTF("%p recv unpack msg %p buf %p\n", this, msg, msg->buf);
+        char const* buf = static_cast<char const*>(msg->buf);
+        assert(buf != nullptr);
+        for (const MessageItemBase* msg_item : msg->message_items) {
+          const message_item_type* item = static_cast<const message_item_type*>(msg_item);
+          LOGPRINTF("%p recv unpack con %p item %p dsts[indices %p] = buf %p[i] nitems %d\n", this, &con, item, item->indices, buf, item->size);
+          const IdxT nitems = item->size;
+          const IdxT nbytes = item->nbytes;
+
+          this->m_fuser.enqueue(con, (DataT const*)buf, *item);
+          buf += nbytes;
+          assert(static_cast<IdxT>(nitems*sizeof(DataT)*this->m_variables.size()) == nbytes);
+        }
+      }
+      this->m_fuser.exec(con);
+    }
+    con.finish_group(this->m_groups[len-1]);
+  }
+
+  void deallocate(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/)
+  {
+    COMB::ignore_unused(con, con_comm);
+    LOGPRINTF("%p recv deallocate con %p msgs %p len %d\n", this, &con, msgs, len);
+    if (len <= 0) return;
+    for (IdxT i = 0; i < len; ++i) {
+      // buffers are freed with the persistent requests
+      assert(msgs[i]->buf != nullptr);
+    }
+
+    if (comb_allow_pack_loop_fusion()) {
+      this->m_fuser.deallocate(con);
+    }
+  }
+};
+
+} // namespace detail
+
+#endif
+
+#endif // _COMM_POL_MPI_PERSISTENT_HPP
@@ -0,0 +1,797 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2018-2021, Lawrence Livermore National Security, LLC.
+//
+// Produced at the Lawrence Livermore National Laboratory
+//
+// LLNL-CODE-758885
+//
+// All rights reserved.
+//
+// This file is part of Comb.
+//
+// For details, see https://github.com/LLNL/Comb
+// Please also see the LICENSE file for MIT license.
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef _COMM_POL_MPI_RMA_HPP
+#define _COMM_POL_MPI_RMA_HPP
+
+#include "config.hpp"
+
+#ifdef COMB_ENABLE_MPI
+
+#include "comm_pol_mpi.hpp"
+
+// mpi one sided, receivers attach their message buffers to a dynamic window
+// and senders put into them, each cycle is one post start complete wait
+// epoch over the neighbor groups
+struct mpi_rma_pol {
+  // static const bool async = false;
+  static const bool mock = false;
+  // compile mpi_type packing/unpacking tests for this comm policy
+  static const bool use_mpi_type = false;
+  // messages over the pipeline threshold may be split into chunk messages
+  static const bool chunk_messages = false;
+  // per cycle message buffers may come from one slab allocated per comm
+  static const bool slab_buffers = false;
+  static const char* get_name() { return "mpi_rma"; }
+  // requests are 1 while the epoch is open and 2 once each message has
+  // been reported complete
+  using send_request_type = int;
+  using recv_request_type = int;
+  using send_status_type = int;
+  using recv_status_type = int;
+};
+
+template < >
+struct CommContext<mpi_rma_pol> : MPIContext
+{
+  using base = MPIContext;
+
+  using pol = mpi_rma_pol;
+
+  using send_request_type = typename pol::send_request_type;
+  using recv_request_type = typename pol::recv_request_type;
+  using send_status_type = typename pol::send_status_type;
+  using recv_status_type = typename pol::recv_status_type;
+
+  MPI_Comm comm = MPI_COMM_NULL;
+  MPI_Win win = MPI_WIN_NULL;
+
+  // ranks that put into this rank and ranks this rank puts into
+  MPI_Group m_recv_group = MPI_GROUP_NULL;
+  MPI_Group m_send_group = MPI_GROUP_NULL;
+  IdxT m_num_recvs = 0;
+  IdxT m_num_sends = 0;
+
+  IdxT m_num_recvs_posted = 0;
+  IdxT m_num_sends_posted = 0;
+  bool m_exposed = false;
+
+  CommContext()
+    : base()
+  { }
+
+  CommContext(base const& b)
+    : base(b)
+  { }
+
+  CommContext(CommContext const& a_, MPI_Comm comm_)
+    : base(a_)
+    , comm(comm_)
+  { }
+
+  void ensure_waitable()
+  {
+
+  }
+
+  template < typename context >
+  void waitOn(context& con)
+  {
+    con.ensure_waitable();
+    base::waitOn(con);
+  }
+
+  send_request_type send_request_null() { return 0; }
+  recv_request_type recv_request_null() { return 0; }
+  send_status_type send_status_null() { return 0; }
+  recv_status_type recv_status_null() { return 0; }
+
+  void connect_ranks(std::vector<int> const& send_ranks,
+                     std::vector<int> const& recv_ranks)
+  {
+    win = detail::MPI::Win_create_dynamic(comm);
+    m_num_sends = send_ranks.size();
+    m_num_recvs = recv_ranks.size();
+    if (m_num_sends > 0) {
+      m_send_group = detail::MPI::Comm_group_incl(comm, m_num_sends, send_ranks.data());
+    }
+    if (m_num_recvs > 0) {
+      m_recv_group = detail::MPI::Comm_group_incl(comm, m_num_recvs, recv_ranks.data());
+    }
+  }
+
+  void disconnect_ranks(std::vector<int> const& send_ranks,
+                        std::vector<int> const& recv_ranks)
+  {
+    COMB::ignore_unused(send_ranks, recv_ranks);
+    if (m_send_group != MPI_GROUP_NULL) {
+      detail::MPI::Group_free(&m_send_group);
+    }
+    if (m_recv_group != MPI_GROUP_NULL) {
+      detail::MPI::Group_free(&m_recv_group);
+    }
+    m_num_sends = 0;
+    m_num_recvs = 0;
+    detail::MPI::Win_free(&win);
+  }
+
+
+  void setup_mempool(COMB::Allocator& many_aloc,
+                     COMB::Allocator& few_aloc)
+  {
+    COMB::ignore_unused(many_aloc, few_aloc);
+  }
+
+  void teardown_mempool()
+  {
+
+  }
+
+  // expose the recv buffers once every recv has been posted
+  void post_recv()
+  {
+    ++m_num_recvs_posted;
+    if (m_num_recvs_posted == m_num_recvs) {
+      m_num_recvs_posted = 0;
+      detail::MPI::Win_post(m_recv_group, win);
+      m_exposed = true;
+    }
+  }
+
+  // put into a recv buffer of rank, the access epoch starts with the first
+  // send and completes with the last
+  void put(const void* buf, IdxT nbytes, int rank, MPI_Aint target_disp)
+  {
+    if (m_num_sends_posted == 0) {
+      detail::MPI::Win_start(m_send_group, win);
+    }
+    detail::MPI::Put_bytes(buf, nbytes, rank, target_disp, win);
+    ++m_num_sends_posted;
+    if (m_num_sends_posted == m_num_sends) {
+      m_num_sends_posted = 0;
+      detail::MPI::Win_complete(win);
+    }
+  }
+
+  void wait_recvs()
+  {
+    if (m_exposed) {
+      detail::MPI::Win_wait(win);
+      m_exposed = false;
+    }
+  }
+
+  bool test_recvs()
+  {
+    if (m_exposed) {
+      if (!detail::MPI::Win_test(win)) return false;
+      m_exposed = false;
+    }
+    return true;
+  }
+
+  // sends are complete once the access epoch is closed by the last send
+  void wait_sends()
+  {
+    assert(m_num_sends_posted == 0);
+  }
+
+  bool test_sends()
+  {
+    assert(m_num_sends_posted == 0);
+    return true;
+  }
+};
+
+
+namespace detail {
+
+template < >
+struct Message<MessageBase::Kind::send, mpi_rma_pol>
+  : MessageInterface<MessageBase::Kind::send, mpi_rma_pol>
+{
+  using base = MessageInterface<MessageBase::Kind::send, mpi_rma_pol>;
+
+  using policy_comm = typename base::policy_comm;
+  using communicator_type = typename base::communicator_type;
+  using request_type      = typename base::request_type;
+  using status_type       = typename base::status_type;
+
+  // use the base class constructor
+  using base::base;
+
+
+  // every message completes with the access epoch
+  static int wait_send_any(communicator_type& con_comm,
+                           int count, request_type* requests,
+                           status_type* statuses)
+  {
+    for (int i = 0; i < count; ++i) {
+      if (requests[i] != 2) {
+        assert(requests[i] == 1);
+        con_comm.wait_sends();
+        requests[i] = 2;
+        statuses[i] = 1;
+        return i;
+      }
+    }
+    return -1;
+  }
+
+  static int test_send_any(communicator_type& con_comm,
+                           int count, request_type* requests,
+                           status_type* statuses)
+  {
+    for (int i = 0; i < count; ++i) {
+      if (requests[i] != 2) {
+        assert(requests[i] == 1);
+        if (!con_comm.test_sends()) return -1;
+        requests[i] = 2;
+        statuses[i] = 1;
+        return i;
+      }
+    }
+    return -1;
+  }
+
+  static int wait_send_some(communicator_type& con_comm,
+                            int count, request_type* requests,
+                            int* indices, status_type* statuses)
+  {
+    con_comm.wait_sends();
+    int done = 0;
+    for (int i = 0; i < count; ++i) {
+      if (requests[i] != 2) {
+        assert(requests[i] == 1);
+        requests[i] = 2;
+        statuses[i] = 1;
+        indices[done++] = i;
+      }
+    }
+    return done;
+  }
+
+  static int test_send_some(communicator_type& con_comm,
+                            int count, request_type* requests,
+                            int* indices, status_type* statuses)
+  {
+    if (!con_comm.test_sends()) return 0;
+    int done = 0;
+    for (int i = 0; i < count; ++i) {
+      if (requests[i] != 2) {
+        assert(requests[i] == 1);
+        requests[i] = 2;
+        statuses[i] = 1;
+        indices[done++] = i;
+      }
+    }
+    return done;
+  }
+
+  static void wait_send_all(communicator_type& con_comm,
+                            int count, request_type* requests,
+                            status_type* statuses)
+  {
+    con_comm.wait_sends();
+    for (int i = 0; i < count; ++i) {
+      if (requests[i] != 2) {
+        assert(requests[i] == 1);
+        requests[i] = 2;
+        statuses[i] = 1;
+      }
+    }
+  }
+
+  static bool test_send_all(communicator_type& con_comm,
+                            int count, request_type* requests,
+                            status_type* statuses)
+  {
+    if (!con_comm.test_sends()) return false;
+    for (int i = 0; i < count; ++i) {
+      if (requests[i] != 2) {
+        assert(requests[i] == 1);
+        requests[i] = 2;
+        statuses[i] = 1;
+      }
+    }
+    return true;
+  }
+};
+
+
+template < >
+struct Message<MessageBase::Kind::recv, mpi_rma_pol>
+  : MessageInterface<MessageBase::Kind::recv, mpi_rma_pol>
+{
+  using base = MessageInterface<MessageBase::Kind::recv, mpi_rma_pol>;
+
+  using policy_comm = typename base::policy_comm;
+  using communicator_type = typename base::communicator_type;
+  using request_type      = typename base::request_type;
+  using status_type       = typename base::status_type;
+
+  // use the base class constructor
+  using base::base;
+
+
+  // every message completes with the exposure epoch
+  static int wait_recv_any(communicator_type& con_comm,
+                           int count, request_type* requests,
+                           status_type* statuses)
+  {
+    for (int i = 0; i < count; ++i) {
+      if (requests[i] != 2) {
+        assert(requests[i] == 1);
+        con_comm.wait_recvs();
+        requests[i] = 2;
+        statuses[i] = 1;
+        return i;
+      }
+    }
+    return -1;
+  }
+
+  static int test_recv_any(communicator_type& con_comm,
+                           int count, request_type* requests,
+                           status_type* statuses)
+  {
+    for (int i = 0; i < count; ++i) {
+      if (requests[i] != 2) {
+        assert(requests[i] == 1);
+        if (!con_comm.test_recvs()) return -1;
+        requests[i] = 2;
+        statuses[i] = 1;
+        return i;
+      }
+    }
+    return -1;
+  }
+
+  static int wait_recv_some(communicator_type& con_comm,
+                            int count, request_type* requests,
+                            int* indices, status_type* statuses)
+  {
+    con_comm.wait_recvs();
+    int done = 0;
+    for (int i = 0; i < count; ++i) {
+      if (requests[i] != 2) {
+        assert(requests[i] == 1);
+        requests[i] = 2;
+        statuses[i] = 1;
+        indices[done++] = i;
+      }
+    }
+    return done;
+  }
+
+  static int test_recv_some(communicator_type& con_comm,
+                            int count, request_type* requests,
+                            int* indices, status_type* statuses)
+  {
+    if (!con_comm.test_recvs()) return 0;
+    int done = 0;
+    for (int i = 0; i < count; ++i) {
+      if (requests[i] != 2) {
+        assert(requests[i] == 1);
+        requests[i] = 2;
+        statuses[i] = 1;
+        indices[done++] = i;
+      }
+    }
+    return done;
+  }
+
+  static void wait_recv_all(communicator_type& con_comm,
+                            int count, request_type* requests,
+                            status_type* statuses)
+  {
+    con_comm.wait_recvs();
+    for (int i = 0; i < count; ++i) {
+      if (requests[i] != 2) {
+        assert(requests[i] == 1);
+        requests[i] = 2;
+        statuses[i] = 1;
+      }
+    }
+  }
+
+  static bool test_recv_all(communicator_type& con_comm,
+                            int count, request_type* requests,
+                            status_type* statuses)
+  {
+    if (!con_comm.test_recvs()) return false;
+    for (int i = 0; i < count; ++i) {
+      if (requests[i] != 2) {
+        assert(requests[i] == 1);
+        requests[i] = 2;
+        statuses[i] = 1;
+      }
+    }
+    return true;
+  }
+};
+
+
+template < typename exec_policy >
+struct MessageGroup<MessageBase::Kind::send, mpi_rma_pol, exec_policy>
+  : detail::MessageGroupInterface<MessageBase::Kind::send, mpi_rma_pol, exec_policy>
+{
+  using base = detail::MessageGroupInterface<MessageBase::Kind::send, mpi_rma_pol, exec_policy>;
+
+  using policy_comm       = typename base::policy_comm;
+  using communicator_type = typename base::communicator_type;
+  using message_type      = typename base::message_type;
+  using request_type      = typename base::request_type;
+  using status_type       = typename base::status_type;
+
+  using message_item_type = typename base::message_item_type;
+  using context_type      = typename base::context_type;
+  using event_type        = typename base::event_type;
+  using group_type        = typename base::group_type;
+  using component_type    = typename base::component_type;
+
+  // window displacements of the partner recv buffers indexed by message idx
+  std::vector<MPI_Aint> m_target_disps;
+  std::vector<MPI_Request> m_target_disp_requests;
+
+  // use the base class constructor
+  using base::base;
+
+
+  void finalize()
+  {
+    // call base finalize
+    base::finalize();
+  }
+
+  void setup_persistent(context_type& con, communicator_type& con_comm)
+  {
+    COMB::ignore_unused(con);
+    LOGPRINTF("%p send setup_persistent con %p nmsgs %d\n", this, &con, (int)this->messages.size());
+    m_target_disps.resize(this->messages.size(), 0);
+    m_target_disp_requests.resize(this->messages.size(), MPI_REQUEST_NULL);
+    for (message_type& msg : this->messages) {
+      assert(msg.buf == nullptr);
+
+      IdxT nbytes = msg.nbytes();
+
+      msg.buf = this->m_aloc.allocate(nbytes);
+      LOGPRINTF("%p send setup_persistent msg %p buf %p nbytes %d to %i tag %i\n",
+                this, &msg, msg.buf, nbytes, msg.partner_rank, msg.msg_tag);
+      // the partner sends the address of its recv buffer
+      detail::MPI::Irecv(&m_target_disps[msg.idx], 1, MPI_AINT,
+                         msg.partner_rank, msg.msg_tag, con_comm.comm, &m_target_disp_requests[msg.idx]);
+    }
+  }
+
+  void teardown_persistent(communicator_type& con_comm)
+  {
+    COMB::ignore_unused(con_comm);
+    LOGPRINTF("%p send teardown_persistent nmsgs %d\n", this, (int)m_target_disps.size());
+    for (IdxT i = 0; i < static_cast<IdxT>(m_target_disps.size()); ++i) {
+      message_type& msg = this->messages[i];
+      detail::MPI::Wait(&m_target_disp_requests[i], MPI_STATUS_IGNORE);
+      this->m_aloc.deallocate(msg.buf);
+      msg.buf = nullptr;
+    }
+    m_target_disps.clear();
+    m_target_disp_requests.clear();
+  }
+
+
+  void allocate(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/)
+  {
+    COMB::ignore_unused(con, con_comm);
+    LOGPRINTF("%p send allocate msgs %p len %d\n", this, msgs, len);
+    if (len <= 0) return;
+    for (IdxT i = 0; i < len; ++i) {
+      // buffers live as long as the window attachment
+      assert(msgs[i]->buf != nullptr);
+    }
+
+    if (comb_allow_pack_loop_fusion()) {
+      this->m_fuser.allocate(con, this->m_variables, this->m_items.size());
+    }
+  }
+
+  void pack(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async async)
+  {
+    COMB::ignore_unused(con_comm);
+    LOGPRINTF("%p send pack con %p msgs %p len %d\n", this, &con, msgs, len);
+    if (len <= 0) return;
+    con.start_group(this->m_groups[len-1]);
+    if (!comb_allow_pack_loop_fusion()) {
+      for (IdxT i = 0; i < len; ++i) {
+        const message_type* msg = msgs[i];
+        LOGPRINTF("%p send pack msg %p buf %p\n", this, msg, msg->buf);
+        const IdxT msg_idx = msg->idx;
+        char* buf = static_cast<char*>(msg->buf);
+        assert(buf != nullptr);
+        this->m_contexts[msg_idx].start_component(this->m_groups[len-1], this->m_components[msg_idx]);
+        for (const MessageItemBase* msg_item : msg->message_items) {
+          const message_item_type* item = static_cast<const message_item_type*>(msg_item);
+          LOGPRINTF("%p send pack con %p item %p buf %p = srcs[indices %p] nitems %d\n", this, &this->m_contexts[msg_idx], item, buf, item->indices, item->size);
+          buf = this->pack_item(this->m_contexts[msg_idx], *item, buf);
+        }
+        if (async == detail::Async::no) {
+          this->m_contexts[msg_idx].finish_component(this->m_groups[len-1], this->m_components[msg_idx]);
+        } else {
+          this->m_contexts[msg_idx].finish_component_recordEvent(this->m_groups[len-1], this->m_components[msg_idx], this->m_events[msg_idx]);
+        }
+      }
+    }
+    else if (async == detail::Async::no) {
+      for (IdxT i = 0; i < len; ++i) {
+        const message_type* msg = msgs[i];
+        LOGPRINTF("%p send pack msg %p buf %p\n", this, msg, msg->buf);
+        char* buf = static_cast<char*>(msg->buf);
+        assert(buf != nullptr);
+        for (const MessageItemBase* msg_item : msg->message_items) {
+          const message_item_type* item = static_cast<const message_item_type*>(msg_item);
+          LOGPRINTF("%p send pack con %p item %p buf %p = srcs[indices %p] nitems %d\n", this, &con, item, buf, item->indices, item->size);
+          this->m_fuser.enqueue(con, (DataT*)buf, *item);
+          buf += item->nbytes;
+          assert(static_cast<IdxT>(item->size*sizeof(DataT)*this->m_variables.size()) == item->nbytes);
+        }
+      }
+      this->m_fuser.exec(con);
+    } else {
+      for (IdxT i = 0; i < len; ++i) {
+        const message_type* msg = msgs[i];
+        LOGPRINTF("%p send pack msg %p buf %p\n", this, msg, msg->buf);
+        const IdxT msg_idx = msg->idx;
+        char* buf = static_cast<char*>(msg->buf);
+        assert(buf != nullptr);
+        this->m_contexts[msg_idx].start_component(this->m_groups[len-1], this->m_components[msg_idx]);
+        for (const MessageItemBase* msg_item : msg->message_items) {
+          const message_item_type* item = static_cast<const message_item_type*>(msg_item);
+          LOGPRINTF("%p send pack con %p item %p buf %p = srcs[indices %p] nitems %d\n", this, &this->m_contexts[msg_idx], item, buf, item->indices, item->size);
+          this->m_fuser.enqueue(this->m_contexts[msg_idx], (DataT*)buf, *item);
+          buf += item->nbytes;
+          assert(static_cast<IdxT>(item->size*sizeof(DataT)*this->m_variables.size()) == item->nbytes);
+        }
+        this->m_fuser.exec(this->m_contexts[msg_idx]);
+        this->m_contexts[msg_idx].finish_component_recordEvent(this->m_groups[len-1], this->m_components[msg_idx], this->m_events[msg_idx]);
+      }
+    }
+    con.finish_group(this->m_groups[len-1]);
+  }
+
+  IdxT wait_pack_complete(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async async)
+  {
+    LOGPRINTF("%p send wait_pack_complete con %p msgs %p len %d\n", this, &con, msgs, len);
+    if (len <= 0) return 0;
+    if (async == detail::Async::no) {
+      con_comm.waitOn(con);
+    } else {
+      for (IdxT i = 0; i < len; ++i) {
+        const message_type* msg = msgs[i];
+        if (!this->m_contexts[msg->idx].queryEvent(this->m_events[msg->idx])) {
+          return i;
+        }
+      }
+    }
+    return len;
+  }
+
+  static void start_Isends(context_type& con, communicator_type& con_comm)
+  {
+    LOGPRINTF("send start_Isends con %p\n", &con);
+    COMB::ignore_unused(con, con_comm);
+  }
+
+  void Isend(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/, request_type* requests)
+  {
+    LOGPRINTF("%p send Isend con %p msgs %p len %d\n", this, &con, msgs, len);
+    if (len <= 0) return;
+    start_Isends(con, con_comm);
+    for (IdxT i = 0; i < len; ++i) {
+      const message_type* msg = msgs[i];
+      LOGPRINTF("%p send Isend msg %p buf %p nbytes %d to %i tag %i\n",
+                this, msg, msg->buf, msg->nbytes(), msg->partner_rank, msg->msg_tag);
+      assert(msg->buf != nullptr);
+      detail::MPI::Wait(&m_target_disp_requests[msg->idx], MPI_STATUS_IGNORE);
+      con_comm.put(msg->buf, msg->nbytes(), msg->partner_rank, m_target_disps[msg->idx]);
+      requests[i] = 1;
+    }
+    finish_Isends(con, con_comm);
+  }
+
+  static void finish_Isends(context_type& con, communicator_type& con_comm)
+  {
+    LOGPRINTF("send finish_Isends con %p\n", &con);
+    COMB::ignore_unused(con, con_comm);
+  }
+
+  void deallocate(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/)
+  {
+    COMB::ignore_unused(con, con_comm);
+    LOGPRINTF("%p send deallocate con %p msgs %p len %d\n", this, &con, msgs, len);
+    if (len <= 0) return;
+    for (IdxT i = 0; i < len; ++i) {
+      // buffers are freed in teardown_persistent
+      assert(msgs[i]->buf != nullptr);
+    }
+
+    if (comb_allow_pack_loop_fusion()) {
+      this->m_fuser.deallocate(con);
+    }
+  }
+};
+
+template < typename exec_policy >
+struct MessageGroup<MessageBase::Kind::recv, mpi_rma_pol, exec_policy>
+  : detail::MessageGroupInterface<MessageBase::Kind::recv, mpi_rma_pol, exec_policy>
+{
+  using base = detail::MessageGroupInterface<MessageBase::Kind::recv, mpi_rma_pol, exec_policy>;
+
+  using policy_comm       = typename base::policy_comm;
+  using communicator_type = typename base::communicator_type;
+  using message_type      = typename base::message_type;
+  using request_type      = typename base::request_type;
+  using status_type       = typename base::status_type;
+
+  using message_item_type = typename base::message_item_type;
+  using context_type      = typename base::context_type;
+  using event_type        = typename base::event_type;
+  using group_type        = typename base::group_type;
+  using component_type    = typename base::component_type;
+
+  // addresses of the recv buffers in the window indexed by message idx
+  std::vector<MPI_Aint> m_disps;
+  std::vector<MPI_Request> m_disp_requests;
+
+  // use the base class constructor
+  using base::base;
+
+
+  void finalize()
+  {
+    // call base finalize
+    base::finalize();
+  }
+
+  void setup_persistent(context_type& con, communicator_type& con_comm)
+  {
+    COMB::ignore_unused(con);
+    LOGPRINTF("%p recv setup_persistent con %p nmsgs %d\n", this, &con, (int)this->messages.size());
+    m_disps.resize(this->messages.size(), 0);
+    m_disp_requests.resize(this->messages.size(), MPI_REQUEST_NULL);
+    for (message_type& msg : this->messages) {
+      assert(msg.buf == nullptr);
+
+      IdxT nbytes = msg.nbytes();
+
+      msg.buf = this->m_aloc.allocate(nbytes);
+      LOGPRINTF("%p recv setup_persistent msg %p buf %p nbytes %d to %d tag %d\n",
+                this, &msg, msg.buf, nbytes, msg.partner_rank, msg.msg_tag);
+      detail::MPI::Win_attach(con_comm.win, msg.buf, nbytes);
+      // tell the partner where to put its message
+      m_disps[msg.idx] = detail::MPI::Get_address(msg.buf);
+      detail::MPI::Isend(&m_disps[msg.idx], 1, MPI_AINT,
+                         msg.partner_rank, msg.msg_tag, con_comm.comm, &m_disp_requests[msg.idx]);
+    }
+  }
+
+  void teardown_persistent(communicator_type& con_comm)
+  {
+    COMB::ignore_unused(con_comm);
+    LOGPRINTF("%p recv teardown_persistent nmsgs %d\n", this, (int)m_disps.size());
+    for (IdxT i = 0; i < static_cast<IdxT>(m_disps.size()); ++i) {
+      message_type& msg = this->messages[i];
+      detail::MPI::Wait(&m_disp_requests[i], MPI_STATUS_IGNORE);
+      detail::MPI::Win_detach(con_comm.win, msg.buf);
+      this->m_aloc.deallocate(msg.buf);
+      msg.buf = nullptr;
+    }
+    m_disps.clear();
+    m_disp_requests.clear();
+  }
+
+  void allocate(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/)
+  {
+    COMB::ignore_unused(con, con_comm);
+    LOGPRINTF("%p recv allocate con %p msgs %p len %d\n", this, &con, msgs, len);
+    if (len <= 0) return;
+    for (IdxT i = 0; i < len; ++i) {
+      // buffers live as long as the window attachment
+      assert(msgs[i]->buf != nullptr);
+    }
+
+    if (comb_allow_pack_loop_fusion()) {
+      this->m_fuser.allocate(con, this->m_variables, this->m_items.size());
+    }
+  }
+
+  void Irecv(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/, request_type* requests)
+  {
+    COMB::ignore_unused(con, con_comm);
+    LOGPRINTF("%p recv Irecv con %p msgs %p len %d\n", this, &con, msgs, len);
+    if (len <= 0) return;
+    for (IdxT i = 0; i < len; ++i) {
+      const message_type* msg = msgs[i];
+      LOGPRINTF("%p recv Irecv msg %p buf %p nbytes %d to %d tag %d\n",
+                                this, msg, msg->buf, msg->nbytes(), msg->partner_rank, msg->msg_tag);
+      assert(msg->buf != nullptr);
+      requests[i] = 1;
+      con_comm.post_recv();
+    }
+  }
+
+  void unpack(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/)
+  {
+    COMB::ignore_unused(con_comm);
+    LOGPRINTF("%p recv unpack con %p msgs %p len %d\n", this, &con, msgs, len);
+    if (len <= 0) return;
+    con.start_group(this->m_groups[len-1]);
+    if (!comb_allow_pack_loop_fusion()) {
+      for (IdxT i = 0; i < len; ++i) {
+        const message_type* msg = msgs[i];
+        LOGPRINTF("%p recv unpack msg %p buf %p\n", this, msg, msg->buf);
+        const IdxT msg_idx = msg->idx;
+        char const* buf = static_cast<char const*>(msg->buf);
+        assert(buf != nullptr);
+        this->m_contexts[msg_idx].start_component(this->m_groups[len-1], this->m_components[msg_idx]);
+        for (const MessageItemBase* msg_item : msg->message_items) {
+          const message_item_type* item = static_cast<const message_item_type*>(msg_item);
+          LOGPRINTF("%p recv unpack con %p item %p dsts[indices %p] = buf %p[i] nitems %d\n", this, &this->m_contexts[msg_idx], item, item->indices, buf, item->size);
+          buf = this->unpack_item(this->m_contexts[msg_idx], *item, buf);
+        }
+        this->m_contexts[msg_idx].finish_component(this->m_groups[len-1], this->m_components[msg_idx]);
+      }
+    }
+    else {
+      for (IdxT i = 0; i < len; ++i) {
+        const message_type* msg = msgs[i];
+        LOGPRINTF("%p recv unpack msg %p buf %p\n", this, msg, msg->buf);
+        char const* buf = static_cast<char const*>(msg->buf);
+        assert(buf != nullptr);
+        for (const MessageItemBase* msg_item : msg->message_items) {
+          const message_item_type* item = static_cast<const message_item_type*>(msg_item);
+          LOGPRINTF("%p recv unpack con %p item %p dsts[indices %p] = buf %p[i] nitems %d\n", this, &con, item, item->indices, buf, item->size);
+          const IdxT nitems = item->size;
+          const IdxT nbytes = item->nbytes;
+
+          this->m_fuser.enqueue(con, (DataT const*)buf, *item);
+          buf += nbytes;
+          assert(static_cast<IdxT>(nitems*sizeof(DataT)*this->m_variables.size()) == nbytes);
+        }
+      }
+      this->m_fuser.exec(con);
+    }
+    con.finish_group(this->m_groups[len-1]);
+  }
+
+  void deallocate(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/)
+  {
+    COMB::ignore_unused(con, con_comm);
+    LOGPRINTF("%p recv deallocate con %p msgs %p len %d\n", this, &con, msgs, len);
+    if (len <= 0) return;
+    for (IdxT i = 0; i < len; ++i) {
+      // buffers are freed in teardown_persistent
+      assert(msgs[i]->buf != nullptr);
+    }
+
+    if (comb_allow_pack_loop_fusion()) {
+      this->m_fuser.deallocate(con);
+    }
+  }
+};
+
+} // namespace detail
+
+#endif
+
+#endif // _COMM_POL_MPI_RMA_HPP
@@ -0,0 +1,864 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2018-2021, Lawrence Livermore National Security, LLC.
+//
+// Produced at the Lawrence Livermore National Laboratory
+//
+// LLNL-CODE-758885
+//
+// All rights reserved.
+//
+// This file is part of Comb.
+//
+// For details, see https://github.com/LLNL/Comb
+// Please also see the LICENSE file for MIT license.
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef _COMM_POL_MPI_SHM_HPP
+#define _COMM_POL_MPI_SHM_HPP
+
+#include "config.hpp"
+
+#ifdef COMB_ENABLE_MPI
+
+#include <algorithm>
+
+#include "comm_pol_mpi.hpp"
+
+// mpi with mesh variables in node shared memory windows, receivers on the
+// same node as their partner copy straight from the partner's variables
+// into their own without packing, messages to other nodes are packed and
+// sent as with mpi
+struct mpi_shm_pol {
+  // static const bool async = false;
+  static const bool mock = false;
+  // compile mpi_type packing/unpacking tests for this comm policy
+  static const bool use_mpi_type = false;
+  // messages over the pipeline threshold may be split into chunk messages
+  static const bool chunk_messages = false;
+  // per cycle message buffers may come from one slab allocated per comm
+  static const bool slab_buffers = true;
+  static const char* get_name() { return "mpi_shm"; }
+  // on node send requests complete when the receiver is done copying and
+  // on node recv requests complete when the sender's data is ready
+  using send_request_type = MPI_Request;
+  using recv_request_type = MPI_Request;
+  using send_status_type = MPI_Status;
+  using recv_status_type = MPI_Status;
+};
+
+template < >
+struct CommContext<mpi_shm_pol> : CommContext<mpi_pol>
+{
+  using base = CommContext<mpi_pol>;
+
+  using pol = mpi_shm_pol;
+
+  using send_request_type = typename pol::send_request_type;
+  using recv_request_type = typename pol::recv_request_type;
+  using send_status_type = typename pol::send_status_type;
+  using recv_status_type = typename pol::recv_status_type;
+
+  // allocator of the mesh variables
+  COMB::MPISharedAllocator* shared_aloc = nullptr;
+
+  // receivers tell senders they are done copying on this communicator
+  MPI_Comm done_comm = MPI_COMM_NULL;
+
+  // rank in the node communicator of shared_aloc of each rank in comm,
+  // MPI_UNDEFINED for ranks on other nodes
+  std::vector<int> m_node_ranks;
+
+  CommContext()
+    : base()
+  { }
+
+  CommContext(MPIContext const& b, COMB::MPISharedAllocator& shared_aloc_)
+    : base(b)
+    , shared_aloc(&shared_aloc_)
+  { }
+
+  CommContext(CommContext const& a_, MPI_Comm comm_)
+    : base(a_, comm_)
+    , shared_aloc(a_.shared_aloc)
+  { }
+
+  void connect_ranks(std::vector<int> const& send_ranks,
+                     std::vector<int> const& recv_ranks)
+  {
+    COMB::ignore_unused(send_ranks, recv_ranks);
+    done_comm = detail::MPI::Comm_dup(comm);
+    int size = detail::MPI::Comm_size(comm);
+    std::vector<int> ranks(size);
+    for (int r = 0; r < size; ++r) {
+      ranks[r] = r;
+    }
+    m_node_ranks.resize(size, MPI_UNDEFINED);
+    detail::MPI::Comm_translate_ranks(comm, size, ranks.data(),
+                                      shared_aloc->node_comm(), m_node_ranks.data());
+  }
+
+  void disconnect_ranks(std::vector<int> const& send_ranks,
+                        std::vector<int> const& recv_ranks)
+  {
+    COMB::ignore_unused(send_ranks, recv_ranks);
+    m_node_ranks.clear();
+    detail::MPI::Comm_free(&done_comm);
+  }
+
+  int node_rank(int rank) const
+  {
+    return m_node_ranks[rank];
+  }
+
+  bool on_node(int rank) const
+  {
+    return node_rank(rank) != MPI_UNDEFINED;
+  }
+
+  // called by senders before telling receivers the variables are ready and
+  // by receivers after hearing it, and the same around the done messages
+  void sync_variables(std::vector<DataT*> const& variables)
+  {
+    for (DataT* var : variables) {
+      shared_aloc->sync(var);
+    }
+  }
+};
+
+
+namespace detail {
+
+namespace shm {
+
+// a run of contiguous zones in a message and where they are in the mesh
+struct message_run {
+  IdxT offset; // zone in the message of the first zone in the run
+  IdxT start;  // mesh index of the first zone in the run
+  IdxT len;    // zones in the run
+};
+
+// a run of contiguous zones copied from the sender's mesh to the receiver's
+struct copy_run {
+  IdxT src;
+  IdxT dst;
+  IdxT len;
+};
+
+// call body with each run of contiguous mesh indices in item
+template < typename message_item_type, typename body_type >
+inline void for_each_run(message_item_type const& item, body_type&& body)
+{
+  if (item.indices) {
+    for (IdxT i = 0; i < item.size; ++i) {
+      body(i, static_cast<IdxT>(item.indices[i]), 1);
+    }
+  } else if (item.spans) {
+    for (IdxT s = 0; s < item.num_spans; ++s) {
+      body(item.spans[s].offset, item.spans[s].start, item.spans[s].len);
+    }
+  } else {
+    box_rows const& box = item.box;
+    for (IdxT r = 0; r < box.nrows; ++r) {
+      body(r * box.ilen, box.row(r), box.ilen);
+    }
+  }
+}
+
+// the runs of all the items in a message in message order
+template < typename message_type, typename message_item_type >
+inline std::vector<message_run> get_message_runs(message_type const& msg)
+{
+  std::vector<message_run> runs;
+  IdxT offset = 0;
+  for (const MessageItemBase* msg_item : msg.message_items) {
+    const message_item_type& item = *static_cast<const message_item_type*>(msg_item);
+    for_each_run(item, [&](IdxT b, IdxT m, IdxT n) {
+      if (!runs.empty() &&
+          runs.back().offset + runs.back().len == offset + b &&
+          runs.back().start + runs.back().len == m) {
+        runs.back().len += n;
+      } else {
+        runs.push_back(message_run{offset + b, m, n});
+      }
+    });
+    offset += item.size;
+  }
+  return runs;
+}
+
+// pair up the runs of the sender and receiver of a message
+inline std::vector<copy_run> get_copy_runs(message_run const* src_runs, IdxT num_src_runs,
+                                           std::vector<message_run> const& dst_runs)
+{
+  std::vector<copy_run> runs;
+  IdxT s = 0;
+  IdxT d = 0;
+  IdxT offset = 0;
+  while (s < num_src_runs && d < static_cast<IdxT>(dst_runs.size())) {
+    message_run const& src = src_runs[s];
+    message_run const& dst = dst_runs[d];
+    IdxT src_end = src.offset + src.len;
+    IdxT dst_end = dst.offset + dst.len;
+    IdxT end = std::min(src_end, dst_end);
+    runs.push_back(copy_run{src.start + (offset - src.offset),
+                            dst.start + (offset - dst.offset),
+                            end - offset});
+    offset = end;
+    if (src_end == end) ++s;
+    if (dst_end == end) ++d;
+  }
+  assert(s == num_src_runs && d == static_cast<IdxT>(dst_runs.size()));
+  return runs;
+}
+
+// copy runs of a variable of the sender into the receiver's variable
+template < typename T >
+struct copy_runs {
+  T const* src;
+  T* dst;
+  copy_run const* runs;
+  copy_runs(T const* src_, T* dst_, copy_run const* runs_) : src(src_), dst(dst_), runs(runs_) {}
+  COMB_HOST COMB_DEVICE void operator()(IdxT r) const
+  {
+    copy_run run = runs[r];
+    copy_row(dst + run.dst, src + run.src, run.len);
+  }
+};
+
+} // namespace shm
+
+
+// on node requests are waited on and tested like any other mpi request
+template < >
+struct Message<MessageBase::Kind::send, mpi_shm_pol>
+  : MessageInterface<MessageBase::Kind::send, mpi_shm_pol>
+{
+  using base = MessageInterface<MessageBase::Kind::send, mpi_shm_pol>;
+
+  using policy_comm = typename base::policy_comm;
+  using communicator_type = typename base::communicator_type;
+  using request_type      = typename base::request_type;
+  using status_type       = typename base::status_type;
+
+  using mpi_message_type = Message<MessageBase::Kind::send, mpi_pol>;
+
+  // use the base class constructor
+  using base::base;
+
+
+  static int wait_send_any(communicator_type& con_comm,
+                           int count, request_type* requests,
+                           status_type* statuses)
+  {
+    return mpi_message_type::wait_send_any(con_comm, count, requests, statuses);
+  }
+
+  static int test_send_any(communicator_type& con_comm,
+                           int count, request_type* requests,
+                           status_type* statuses)
+  {
+    return mpi_message_type::test_send_any(con_comm, count, requests, statuses);
+  }
+
+  static int wait_send_some(communicator_type& con_comm,
+                            int count, request_type* requests,
+                            int* indices, status_type* statuses)
+  {
+    return mpi_message_type::wait_send_some(con_comm, count, requests, indices, statuses);
+  }
+
+  static int test_send_some(communicator_type& con_comm,
+                            int count, request_type* requests,
+                            int* indices, status_type* statuses)
+  {
+    return mpi_message_type::test_send_some(con_comm, count, requests, indices, statuses);
+  }
+
+  static void wait_send_all(communicator_type& con_comm,
+                            int count, request_type* requests,
+                            status_type* statuses)
+  {
+    mpi_message_type::wait_send_all(con_comm, count, requests, statuses);
+  }
+
+  static bool test_send_all(communicator_type& con_comm,
+                            int count, request_type* requests,
+                            status_type* statuses)
+  {
+    return mpi_message_type::test_send_all(con_comm, count, requests, statuses);
+  }
+};
+
+
+template < >
+struct Message<MessageBase::Kind::recv, mpi_shm_pol>
+  : MessageInterface<MessageBase::Kind::recv, mpi_shm_pol>
+{
+  using base = MessageInterface<MessageBase::Kind::recv, mpi_shm_pol>;
+
+  using policy_comm = typename base::policy_comm;
+  using communicator_type = typename base::communicator_type;
+  using request_type      = typename base::request_type;
+  using status_type       = typename base::status_type;
+
+  using mpi_message_type = Message<MessageBase::Kind::recv, mpi_pol>;
+
+  // use the base class constructor
+  using base::base;
+
+
+  static int wait_recv_any(communicator_type& con_comm,
+                           int count, request_type* requests,
+                           status_type* statuses)
+  {
+    return mpi_message_type::wait_recv_any(con_comm, count, requests, statuses);
+  }
+
+  static int test_recv_any(communicator_type& con_comm,
+                           int count, request_type* requests,
+                           status_type* statuses)
+  {
+    return mpi_message_type::test_recv_any(con_comm, count, requests, statuses);
+  }
+
+  static int wait_recv_some(communicator_type& con_comm,
+                            int count, request_type* requests,
+                            int* indices, status_type* statuses)
+  {
+    return mpi_message_type::wait_recv_some(con_comm, count, requests, indices, statuses);
+  }
+
+  static int test_recv_some(communicator_type& con_comm,
+                            int count, request_type* requests,
+                            int* indices, status_type* statuses)
+  {
+    return mpi_message_type::test_recv_some(con_comm, count, requests, indices, statuses);
+  }
+
+  static void wait_recv_all(communicator_type& con_comm,
+                            int count, request_type* requests,
+                            status_type* statuses)
+  {
+    mpi_message_type::wait_recv_all(con_comm, count, requests, statuses);
+  }
+
+  static bool test_recv_all(communicator_type& con_comm,
+                            int count, request_type* requests,
+                            status_type* statuses)
+  {
+    return mpi_message_type::test_recv_all(con_comm, count, requests, statuses);
+  }
+};
+
+
+template < typename exec_policy >
+struct MessageGroup<MessageBase::Kind::send, mpi_shm_pol, exec_policy>
+  : detail::MessageGroupInterface<MessageBase::Kind::send, mpi_shm_pol, exec_policy>
+{
+  using base = detail::MessageGroupInterface<MessageBase::Kind::send, mpi_shm_pol, exec_policy>;
+
+  using policy_comm       = typename base::policy_comm;
+  using communicator_type = typename base::communicator_type;
+  using message_type      = typename base::message_type;
+  using request_type      = typename base::request_type;
+  using status_type       = typename base::status_type;
+
+  using message_item_type = typename base::message_item_type;
+  using context_type      = typename base::context_type;
+  using event_type        = typename base::event_type;
+  using group_type        = typename base::group_type;
+  using component_type    = typename base::component_type;
+
+  // messages to ranks on this node, indexed by message idx
+  std::vector<bool> m_on_node;
+  // runs of each on node message sent to the receiver once
+  std::vector<std::vector<shm::message_run>> m_runs;
+  std::vector<request_type> m_runs_requests;
+  // zero byte messages telling on node receivers the variables are ready
+  std::vector<request_type> m_ready_requests;
+
+  // use the base class constructor
+  using base::base;
+
+
+  void finalize()
+  {
+    // call base finalize
+    base::finalize();
+  }
+
+  // true if any of msgs is to or from a rank on this node
+  bool any_on_node(message_type* const* msgs, IdxT len) const
+  {
+    for (IdxT i = 0; i < len; ++i) {
+      if (m_on_node[msgs[i]->idx]) return true;
+    }
+    return false;
+  }
+
+  void setup_persistent(context_type& con, communicator_type& con_comm)
+  {
+    COMB::ignore_unused(con);
+    LOGPRINTF("%p send setup_persistent con %p nmsgs %d\n", this, &con, (int)this->messages.size());
+    IdxT num_msgs = this->messages.size();
+    m_on_node.resize(num_msgs, false);
+    m_runs.resize(num_msgs);
+    m_runs_requests.resize(num_msgs, con_comm.send_request_null());
+    m_ready_requests.resize(num_msgs, con_comm.send_request_null());
+    for (message_type& msg : this->messages) {
+      if (!con_comm.on_node(msg.partner_rank)) continue;
+      m_on_node[msg.idx] = true;
+
+      // the receiver pairs these runs with its own to copy without packing
+      m_runs[msg.idx] = shm::get_message_runs<message_type, message_item_type>(msg);
+      LOGPRINTF("%p send setup_persistent msg %p nruns %d to %i tag %i\n",
+                this, &msg, (int)m_runs[msg.idx].size(), msg.partner_rank, msg.msg_tag);
+      detail::MPI::Isend_bytes(m_runs[msg.idx].data(), m_runs[msg.idx].size()*sizeof(shm::message_run),
+                               msg.partner_rank, msg.msg_tag, con_comm.comm, &m_runs_requests[msg.idx]);
+    }
+  }
+
+  void teardown_persistent(communicator_type& con_comm)
+  {
+    COMB::ignore_unused(con_comm);
+    LOGPRINTF("%p send teardown_persistent nmsgs %d\n", this, (int)m_on_node.size());
+    for (IdxT i = 0; i < static_cast<IdxT>(m_on_node.size()); ++i) {
+      if (!m_on_node[i]) continue;
+      detail::MPI::Wait(&m_runs_requests[i], MPI_STATUS_IGNORE);
+      detail::MPI::Wait(&m_ready_requests[i], MPI_STATUS_IGNORE);
+    }
+    m_on_node.clear();
+    m_runs.clear();
+    m_runs_requests.clear();
+    m_ready_requests.clear();
+  }
+
+
+  void allocate(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/)
+  {
+    COMB::ignore_unused(con, con_comm);
+    LOGPRINTF("%p send allocate msgs %p len %d\n", this, msgs, len);
+    if (len <= 0) return;
+    for (IdxT i = 0; i < len; ++i) {
+      message_type* msg = msgs[i];
+      // on node receivers read the variables directly
+      if (m_on_node[msg->idx]) continue;
+      assert(msg->buf == nullptr);
+      msg->buf = this->allocate_buffer(*msg, msg->nbytes());
+    }
+
+    if (comb_allow_pack_loop_fusion()) {
+      this->m_fuser.allocate(con, this->m_variables, this->m_items.size());
+    }
+  }
+
+  void pack(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async async)
+  {
+    COMB::ignore_unused(con_comm);
+    LOGPRINTF("%p send pack con %p msgs %p len %d\n", this, &con, msgs, len);
+    if (len <= 0) return;
+    con.start_group(this->m_groups[len-1]);
+    if (!comb_allow_pack_loop_fusion()) {
+      for (IdxT i = 0; i < len; ++i) {
+        const message_type* msg = msgs[i];
+        LOGPRINTF("%p send pack msg %p buf %p\n", this, msg, msg->buf);
+        const IdxT msg_idx = msg->idx;
+        char* buf = static_cast<char*>(msg->buf);
+        this->m_contexts[msg_idx].start_component(this->m_groups[len-1], this->m_components[msg_idx]);
+        if (!m_on_node[msg_idx]) {
+          assert(buf != nullptr);
+          for (const MessageItemBase* msg_item : msg->message_items) {
+            const message_item_type* item = static_cast<const message_item_type*>(msg_item);
+            LOGPRINTF("%p send pack con %p item %p buf %p = srcs[indices %p] nitems %d\n", this, &this->m_contexts[msg_idx], item, buf, item->indices, item->size);
+            buf = this->pack_item(this->m_contexts[msg_idx], *item, buf);
+          }
+        }
+        if (async == detail::Async::no) {
+          this->m_contexts[msg_idx].finish_component(this->m_groups[len-1], this->m_components[msg_idx]);
+        } else {
+          this->m_contexts[msg_idx].finish_component_recordEvent(this->m_groups[len-1], this->m_components[msg_idx], this->m_events[msg_idx]);
+        }
+      }
+    }
+    else if (async == detail::Async::no) {
+      bool enqueued = false;
+      for (IdxT i = 0; i < len; ++i) {
+        const message_type* msg = msgs[i];
+        LOGPRINTF("%p send pack msg %p buf %p\n", this, msg, msg->buf);
+        if (m_on_node[msg->idx]) continue;
+        enqueued = true;
+        char* buf = static_cast<char*>(msg->buf);
+        assert(buf != nullptr);
+        for (const MessageItemBase* msg_item : msg->message_items) {
+          const message_item_type* item = static_cast<const message_item_type*>(msg_item);
+          LOGPRINTF("%p send pack con %p item %p buf %p = srcs[indices %p] nitems %d\n", this, &con, item, buf, item->indices, item->size);
+          this->m_fuser.enqueue(con, (DataT*)buf, *item);
+          buf += item->nbytes;
+          assert(static_cast<IdxT>(item->size*sizeof(DataT)*this->m_variables.size()) == item->nbytes);
+        }
+      }
+      if (enqueued) {
+        this->m_fuser.exec(con);
+      }
+    } else {
+      for (IdxT i = 0; i < len; ++i) {
+        const message_type* msg = msgs[i];
+        LOGPRINTF("%p send pack msg %p buf %p\n", this, msg, msg->buf);
+        const IdxT msg_idx = msg->idx;
+        char* buf = static_cast<char*>(msg->buf);
+        this->m_contexts[msg_idx].start_component(this->m_groups[len-1], this->m_components[msg_idx]);
+        if (!m_on_node[msg_idx]) {
+          assert(buf != nullptr);
+          for (const MessageItemBase* msg_item : msg->message_items) {
+            const message_item_type* item = static_cast<const message_item_type*>(msg_item);
+            LOGPRINTF("%p send pack con %p item %p buf %p = srcs[indices %p] nitems %d\n", this, &this->m_contexts[msg_idx], item, buf, item->indices, item->size);
+            this->m_fuser.enqueue(this->m_contexts[msg_idx], (DataT*)buf, *item);
+            buf += item->nbytes;
+            assert(static_cast<IdxT>(item->size*sizeof(DataT)*this->m_variables.size()) == item->nbytes);
+          }
+          this->m_fuser.exec(this->m_contexts[msg_idx]);
+        }
+        this->m_contexts[msg_idx].finish_component_recordEvent(this->m_groups[len-1], this->m_components[msg_idx], this->m_events[msg_idx]);
+      }
+    }
+    con.finish_group(this->m_groups[len-1]);
+  }
+
+  IdxT wait_pack_complete(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async async)
+  {
+    LOGPRINTF("%p send wait_pack_complete con %p msgs %p len %d\n", this, &con, msgs, len);
+    if (len <= 0) return 0;
+    if (async == detail::Async::no) {
+      con_comm.waitOn(con);
+    } else {
+      for (IdxT i = 0; i < len; ++i) {
+        const message_type* msg = msgs[i];
+        if (!this->m_contexts[msg->idx].queryEvent(this->m_events[msg->idx])) {
+          return i;
+        }
+      }
+    }
+    return len;
+  }
+
+  static void start_Isends(context_type& con, communicator_type& con_comm)
+  {
+    LOGPRINTF("send start_Isends con %p\n", &con);
+    COMB::ignore_unused(con, con_comm);
+  }
+
+  void Isend(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/, request_type* requests)
+  {
+    LOGPRINTF("%p send Isend con %p msgs %p len %d\n", this, &con, msgs, len);
+    if (len <= 0) return;
+    start_Isends(con, con_comm);
+    if (any_on_node(msgs, len)) {
+      con_comm.sync_variables(this->m_variables);
+    }
+    for (IdxT i = 0; i < len; ++i) {
+      const message_type* msg = msgs[i];
+      const IdxT msg_idx = msg->idx;
+      if (m_on_node[msg_idx]) {
+        LOGPRINTF("%p send Isend msg %p ready to %i tag %i\n",
+                  this, msg, msg->partner_rank, msg->msg_tag);
+        // the last ready message was received before the last done message
+        detail::MPI::Wait(&m_ready_requests[msg_idx], MPI_STATUS_IGNORE);
+        detail::MPI::Isend_bytes(nullptr, 0, msg->partner_rank, msg->msg_tag, con_comm.comm, &m_ready_requests[msg_idx]);
+        // the variables may not change until the receiver is done copying
+        detail::MPI::Irecv_bytes(nullptr, 0, msg->partner_rank, msg->msg_tag, con_comm.done_comm, &requests[i]);
+      } else {
+        LOGPRINTF("%p send Isend msg %p buf %p nbytes %d to %i tag %i\n",
+                  this, msg, msg->buf, msg->nbytes(), msg->partner_rank, msg->msg_tag);
+        assert(msg->buf != nullptr);
+        detail::MPI::Isend_bytes(msg->buf, msg->nbytes(), msg->partner_rank, msg->msg_tag, con_comm.comm, &requests[i]);
+      }
+    }
+    finish_Isends(con, con_comm);
+  }
+
+  static void finish_Isends(context_type& con, communicator_type& con_comm)
+  {
+    LOGPRINTF("send finish_Isends con %p\n", &con);
+    COMB::ignore_unused(con, con_comm);
+  }
+
+  void deallocate(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/)
+  {
+    COMB::ignore_unused(con, con_comm);
+    LOGPRINTF("%p send deallocate con %p msgs %p len %d\n", this, &con, msgs, len);
+    if (len <= 0) return;
+    // on node receivers are done reading the variables
+    if (any_on_node(msgs, len)) {
+      con_comm.sync_variables(this->m_variables);
+    }
+    for (IdxT i = 0; i < len; ++i) {
+      message_type* msg = msgs[i];
+      if (m_on_node[msg->idx]) continue;
+      assert(msg->buf != nullptr);
+      this->deallocate_buffer(msg->buf);
+      msg->buf = nullptr;
+    }
+
+    if (comb_allow_pack_loop_fusion()) {
+      this->m_fuser.deallocate(con);
+    }
+  }
+};
+
+template < typename exec_policy >
+struct MessageGroup<MessageBase::Kind::recv, mpi_shm_pol, exec_policy>
+  : detail::MessageGroupInterface<MessageBase::Kind::recv, mpi_shm_pol, exec_policy>
+{
+  using base = detail::MessageGroupInterface<MessageBase::Kind::recv, mpi_shm_pol, exec_policy>;
+
+  using policy_comm       = typename base::policy_comm;
+  using communicator_type = typename base::communicator_type;
+  using message_type      = typename base::message_type;
+  using request_type      = typename base::request_type;
+  using status_type       = typename base::status_type;
+
+  using message_item_type = typename base::message_item_type;
+  using context_type      = typename base::context_type;
+  using event_type        = typename base::event_type;
+  using group_type        = typename base::group_type;
+  using component_type    = typename base::component_type;
+
+  // messages from ranks on this node, indexed by message idx
+  std::vector<bool> m_on_node;
+  // copies from the sender's variables into ours for each on node message
+  std::vector<std::vector<shm::copy_run>> m_copy_runs;
+  std::vector<std::vector<void const*>> m_partner_variables;
+  // zero byte messages telling on node senders we are done copying
+  std::vector<request_type> m_done_requests;
+
+  // use the base class constructor
+  using base::base;
+
+
+  void finalize()
+  {
+    // call base finalize
+    base::finalize();
+  }
+
+  // true if any of msgs is to or from a rank on this node
+  bool any_on_node(message_type* const* msgs, IdxT len) const
+  {
+    for (IdxT i = 0; i < len; ++i) {
+      if (m_on_node[msgs[i]->idx]) return true;
+    }
+    return false;
+  }
+
+  void setup_persistent(context_type& con, communicator_type& con_comm)
+  {
+    COMB::ignore_unused(con);
+    LOGPRINTF("%p recv setup_persistent con %p nmsgs %d\n", this, &con, (int)this->messages.size());
+    IdxT num_msgs = this->messages.size();
+    IdxT num_vars = this->m_variables.size();
+    m_on_node.resize(num_msgs, false);
+    m_copy_runs.resize(num_msgs);
+    m_partner_variables.resize(num_msgs);
+    m_done_requests.resize(num_msgs, con_comm.recv_request_null());
+    for (message_type& msg : this->messages) {
+      if (!con_comm.on_node(msg.partner_rank)) continue;
+      m_on_node[msg.idx] = true;
+
+      std::vector<shm::message_run> runs = shm::get_message_runs<message_type, message_item_type>(msg);
+
+      // the sender has at most one run per zone
+      IdxT nzones = 0;
+      for (const MessageItemBase* msg_item : msg.message_items) {
+        nzones += msg_item->size;
+      }
+      std::vector<shm::message_run> partner_runs(nzones);
+      MPI_Request request = MPI_REQUEST_NULL;
+      MPI_Status status;
+      detail::MPI::Irecv_bytes(partner_runs.data(), nzones*sizeof(shm::message_run),
+                               msg.partner_rank, msg.msg_tag, con_comm.comm, &request);
+      detail::MPI::Wait(&request, &status);
+      IdxT num_partner_runs = detail::MPI::Get_count(&status, MPI_BYTE) / sizeof(shm::message_run);
+
+      m_copy_runs[msg.idx] = shm::get_copy_runs(partner_runs.data(), num_partner_runs, runs);
+      LOGPRINTF("%p recv setup_persistent msg %p ncopies %d from %d tag %d\n",
+                this, &msg, (int)m_copy_runs[msg.idx].size(), msg.partner_rank, msg.msg_tag);
+
+      int partner_node_rank = con_comm.node_rank(msg.partner_rank);
+      m_partner_variables[msg.idx].resize(num_vars, nullptr);
+      for (IdxT v = 0; v < num_vars; ++v) {
+        m_partner_variables[msg.idx][v] = con_comm.shared_aloc->query(this->m_variables[v], partner_node_rank);
+      }
+    }
+  }
+
+  void teardown_persistent(communicator_type& con_comm)
+  {
+    COMB::ignore_unused(con_comm);
+    LOGPRINTF("%p recv teardown_persistent nmsgs %d\n", this, (int)m_on_node.size());
+    for (IdxT i = 0; i < static_cast<IdxT>(m_on_node.size()); ++i) {
+      if (!m_on_node[i]) continue;
+      detail::MPI::Wait(&m_done_requests[i], MPI_STATUS_IGNORE);
+    }
+    m_on_node.clear();
+    m_copy_runs.clear();
+    m_partner_variables.clear();
+    m_done_requests.clear();
+  }
+
+  void allocate(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/)
+  {
+    COMB::ignore_unused(con, con_comm);
+    LOGPRINTF("%p recv allocate con %p msgs %p len %d\n", this, &con, msgs, len);
+    if (len <= 0) return;
+    for (IdxT i = 0; i < len; ++i) {
+      message_type* msg = msgs[i];
+      // on node messages are copied from the sender's variables
+      if (m_on_node[msg->idx]) continue;
+      assert(msg->buf == nullptr);
+      msg->buf = this->allocate_buffer(*msg, msg->nbytes());
+    }
+
+    if (comb_allow_pack_loop_fusion()) {
+      this->m_fuser.allocate(con, this->m_variables, this->m_items.size());
+    }
+  }
+
+  void Irecv(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/, request_type* requests)
+  {
+    COMB::ignore_unused(con, con_comm);
+    LOGPRINTF("%p recv Irecv con %p msgs %p len %d\n", this, &con, msgs, len);
+    if (len <= 0) return;
+    for (IdxT i = 0; i < len; ++i) {
+      const message_type* msg = msgs[i];
+      if (m_on_node[msg->idx]) {
+        LOGPRINTF("%p recv Irecv msg %p ready from %d tag %d\n",
+                                  this, msg, msg->partner_rank, msg->msg_tag);
+        detail::MPI::Irecv_bytes(nullptr, 0, msg->partner_rank, msg->msg_tag, con_comm.comm, &requests[i]);
+      } else {
+        LOGPRINTF("%p recv Irecv msg %p buf %p nbytes %d to %d tag %d\n",
+                                  this, msg, msg->buf, msg->nbytes(), msg->partner_rank, msg->msg_tag);
+        assert(msg->buf != nullptr);
+        detail::MPI::Irecv_bytes(msg->buf, msg->nbytes(), msg->partner_rank, msg->msg_tag, con_comm.comm, &requests[i]);
+      }
+    }
+  }
+
+  // copy an on node message from the sender's variables into ours
+  void copy_message(context_type& con, message_type const& msg)
+  {
+    const IdxT msg_idx = msg.idx;
+    std::vector<shm::copy_run> const& runs = m_copy_runs[msg_idx];
+    IdxT num_vars = this->m_variables.size();
+    for (IdxT v = 0; v < num_vars; ++v) {
+      void const* src = m_partner_variables[msg_idx][v];
+      void* dst = this->m_variables[v];
+      visit_data_type(this->m_variable_types[v], [&](auto type) {
+        using T = decltype(type);
+        con.for_all(runs.size(), shm::copy_runs<T>(static_cast<T const*>(src), static_cast<T*>(dst), runs.data()));
+      });
+    }
+  }
+
+  void unpack(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/)
+  {
+    LOGPRINTF("%p recv unpack con %p msgs %p len %d\n", this, &con, msgs, len);
+    if (len <= 0) return;
+    // on node senders' variables are ready
+    const bool on_node = any_on_node(msgs, len);
+    if (on_node) {
+      con_comm.sync_variables(this->m_variables);
+    }
+    con.start_group(this->m_groups[len-1]);
+    if (!comb_allow_pack_loop_fusion()) {
+      for (IdxT i = 0; i < len; ++i) {
+        const message_type* msg = msgs[i];
+        LOGPRINTF("%p recv unpack msg %p buf %p\n", this, msg, msg->buf);
+        const IdxT msg_idx = msg->idx;
+        char const* buf = static_cast<char const*>(msg->buf);
+        this->m_contexts[msg_idx].start_component(this->m_groups[len-1], this->m_components[msg_idx]);
+        if (m_on_node[msg_idx]) {
+          copy_message(this->m_contexts[msg_idx], *msg);
+        } else {
+          assert(buf != nullptr);
+          for (const MessageItemBase* msg_item : msg->message_items) {
+            const message_item_type* item = static_cast<const message_item_type*>(msg_item);
+            LOGPRINTF("%p recv unpack con %p item %p dsts[indices %p] = buf %p[i] nitems %d\n", this, &this->m_contexts[msg_idx], item, item->indices, buf, item->size);
+            buf = this->unpack_item(this->m_contexts[msg_idx], *item, buf);
+          }
+        }
+        this->m_contexts[msg_idx].finish_component(this->m_groups[len-1], this->m_components[msg_idx]);
+      }
+    }
+    else {
+      bool enqueued = false;
+      for (IdxT i = 0; i < len; ++i) {
+        const message_type* msg = msgs[i];
+        LOGPRINTF("%p recv unpack msg %p buf %p\n", this, msg, msg->buf);
+        if (m_on_node[msg->idx]) {
+          copy_message(con, *msg);
+          continue;
+        }
+        enqueued = true;
+        char const* buf = static_cast<char const*>(msg->buf);
+        assert(buf != nullptr);
+        for (const MessageItemBase* msg_item : msg->message_items) {
+          const message_item_type* item = static_cast<const message_item_type*>(msg_item);
+          LOGPRINTF("%p recv unpack con %p item %p dsts[indices %p] = buf %p[i] nitems %d\n", this, &con, item, item->indices, buf, item->size);
+          const IdxT nitems = item->size;
+          const IdxT nbytes = item->nbytes;
+
+          this->m_fuser.enqueue(con, (DataT const*)buf, *item);
+          buf += nbytes;
+          assert(static_cast<IdxT>(nitems*sizeof(DataT)*this->m_variables.size()) == nbytes);
+        }
+      }
+      if (enqueued) {
+        this->m_fuser.exec(con);
+      }
+    }
+    con.finish_group(this->m_groups[len-1]);
+
+    // let on node senders reuse their variables once the copies are done
+    if (!on_node) return;
+    for (IdxT i = 0; i < len; ++i) {
+      const message_type* msg = msgs[i];
+      const IdxT msg_idx = msg->idx;
+      if (!m_on_node[msg_idx]) continue;
+      this->m_contexts[msg_idx].synchronize();
+    }
+    con_comm.sync_variables(this->m_variables);
+    for (IdxT i = 0; i < len; ++i) {
+      const message_type* msg = msgs[i];
+      const IdxT msg_idx = msg->idx;
+      if (!m_on_node[msg_idx]) continue;
+      LOGPRINTF("%p recv unpack msg %p done to %d tag %d\n",
+                this, msg, msg->partner_rank, msg->msg_tag);
+      detail::MPI::Wait(&m_done_requests[msg_idx], MPI_STATUS_IGNORE);
+      detail::MPI::Isend_bytes(nullptr, 0, msg->partner_rank, msg->msg_tag, con_comm.done_comm, &m_done_requests[msg_idx]);
+    }
+  }
+
+  void deallocate(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/)
+  {
+    COMB::ignore_unused(con, con_comm);
+    LOGPRINTF("%p recv deallocate con %p msgs %p len %d\n", this, &con, msgs, len);
+    if (len <= 0) return;
+    for (IdxT i = 0; i < len; ++i) {
+      message_type* msg = msgs[i];
+      if (m_on_node[msg->idx]) continue;
+      assert(msg->buf != nullptr);
+      this->deallocate_buffer(msg->buf);
+      msg->buf = nullptr;
+    }
+
+    if (comb_allow_pack_loop_fusion()) {
+      this->m_fuser.deallocate(con);
+    }
+  }
+};
+
+} // namespace detail
+
+#endif
+
+#endif // _COMM_POL_MPI_SHM_HPP
@@ -0,0 +1,531 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2018-2021, Lawrence Livermore National Security, LLC.
+//
+// Produced at the Lawrence Livermore National Laboratory
+//
+// LLNL-CODE-758885
+//
+// All rights reserved.
+//
+// This file is part of Comb.
+//
+// For details, see https://github.com/LLNL/Comb
+// Please also see the LICENSE file for MIT license.
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef _COMM_POL_MPI_THREADS_HPP
+#define _COMM_POL_MPI_THREADS_HPP
+
+#include "config.hpp"
+
+#ifdef COMB_ENABLE_MPI
+
+#include <vector>
+
+#include "comm_pol_mpi.hpp"
+
+// mpi with each message owned by one of a team of threads, the owning
+// thread packs and Isends the message and tests and unpacks it on arrival
+// so messages progress concurrently, needs MPI_THREAD_MULTIPLE to use more
+// than one thread, optionally each thread uses its own communicator
+struct mpi_threads_pol {
+  // static const bool async = false;
+  static const bool mock = false;
+  // compile mpi_type packing/unpacking tests for this comm policy
+  static const bool use_mpi_type = false;
+  // messages over the pipeline threshold may be split into chunk messages
+  static const bool chunk_messages = true;
+  // per cycle message buffers may come from one slab allocated per comm
+  static const bool slab_buffers = true;
+  static const char* get_name() { return "mpi_threads"; }
+  using send_request_type = MPI_Request;
+  // recvs are tested by the owning threads in unpack, these only track
+  // which messages were posted, -1 posted, -2 ready to unpack
+  using recv_request_type = int;
+  using send_status_type = MPI_Status;
+  using recv_status_type = int;
+};
+
+template < >
+struct CommContext<mpi_threads_pol> : CommContext<mpi_pol>
+{
+  using base = CommContext<mpi_pol>;
+
+  using pol = mpi_threads_pol;
+
+  using send_request_type = typename pol::send_request_type;
+  using recv_request_type = typename pol::recv_request_type;
+  using send_status_type = typename pol::send_status_type;
+  using recv_status_type = typename pol::recv_status_type;
+
+  // threads in the team, the same on every rank
+  int num_threads = 1;
+  int rank = -1;
+  // communicator of each thread when per thread comms are allowed
+  std::vector<MPI_Comm> thread_comms;
+
+  CommContext()
+    : base()
+  { }
+
+  CommContext(MPIContext const& b, int num_threads_)
+    : base(b)
+    , num_threads(num_threads_)
+  { }
+
+  CommContext(CommContext const& a_, MPI_Comm comm_)
+    : base(a_, comm_)
+    , num_threads(a_.num_threads)
+  { }
+
+  send_request_type send_request_null() { return MPI_REQUEST_NULL; }
+  recv_request_type recv_request_null() { return 0; }
+  send_status_type send_status_null() { return send_status_type{}; }
+  recv_status_type recv_status_null() { return 0; }
+
+  void connect_ranks(std::vector<int> const& send_ranks,
+                     std::vector<int> const& recv_ranks)
+  {
+    COMB::ignore_unused(send_ranks, recv_ranks);
+    rank = detail::MPI::Comm_rank(comm);
+    if (comb_allow_per_thread_comms() && num_threads > 1) {
+      thread_comms.resize(num_threads, MPI_COMM_NULL);
+      for (MPI_Comm& thread_comm : thread_comms) {
+        thread_comm = detail::MPI::Comm_dup(comm);
+      }
+    }
+  }
+
+  void disconnect_ranks(std::vector<int> const& send_ranks,
+                        std::vector<int> const& recv_ranks)
+  {
+    COMB::ignore_unused(send_ranks, recv_ranks);
+    for (MPI_Comm& thread_comm : thread_comms) {
+      detail::MPI::Comm_free(&thread_comm);
+    }
+    thread_comms.clear();
+  }
+
+  // thread that owns messages to and from partner_rank, both ranks of a
+  // pair pick the same thread so they use the same communicator
+  int owner(int partner_rank) const
+  {
+    return (rank + partner_rank) % num_threads;
+  }
+
+  MPI_Comm thread_comm(int thread) const
+  {
+    return thread_comms.empty() ? comm : thread_comms[thread];
+  }
+};
+
+
+namespace detail {
+
+namespace threads {
+
+// run body(thread) on num_threads threads, thread 0 is the calling
+// thread so a team of one may make mpi calls under MPI_THREAD_FUNNELED
+template < typename body_type >
+inline void run(int num_threads, body_type&& body)
+{
+#ifdef COMB_ENABLE_OPENMP
+  if (num_threads > 1) {
+#pragma omp parallel num_threads(num_threads)
+    body(omp_get_thread_num());
+    return;
+  }
+#endif
+  body(0);
+}
+
+} // namespace threads
+
+template < >
+struct Message<MessageBase::Kind::send, mpi_threads_pol>
+  : MessageInterface<MessageBase::Kind::send, mpi_threads_pol>
+{
+  using base = MessageInterface<MessageBase::Kind::send, mpi_threads_pol>;
+
+  using policy_comm = typename base::policy_comm;
+  using communicator_type = typename base::communicator_type;
+  using request_type      = typename base::request_type;
+  using status_type       = typename base::status_type;
+
+  using mpi_message_type = Message<MessageBase::Kind::send, mpi_pol>;
+
+  // use the base class constructor
+  using base::base;
+
+
+  static int wait_send_any(communicator_type& con_comm,
+                           int count, request_type* requests,
+                           status_type* statuses)
+  {
+    return mpi_message_type::wait_send_any(con_comm, count, requests, statuses);
+  }
+
+  static int test_send_any(communicator_type& con_comm,
+                           int count, request_type* requests,
+                           status_type* statuses)
+  {
+    return mpi_message_type::test_send_any(con_comm, count, requests, statuses);
+  }
+
+  static int wait_send_some(communicator_type& con_comm,
+                            int count, request_type* requests,
+                            int* indices, status_type* statuses)
+  {
+    return mpi_message_type::wait_send_some(con_comm, count, requests, indices, statuses);
+  }
+
+  static int test_send_some(communicator_type& con_comm,
+                            int count, request_type* requests,
+                            int* indices, status_type* statuses)
+  {
+    return mpi_message_type::test_send_some(con_comm, count, requests, indices, statuses);
+  }
+
+  static void wait_send_all(communicator_type& con_comm,
+                            int count, request_type* requests,
+                            status_type* statuses)
+  {
+    mpi_message_type::wait_send_all(con_comm, count, requests, statuses);
+  }
+
+  static bool test_send_all(communicator_type& con_comm,
+                            int count, request_type* requests,
+                            status_type* statuses)
+  {
+    return mpi_message_type::test_send_all(con_comm, count, requests, statuses);
+  }
+};
+
+
+// recvs complete in unpack, so every posted recv is ready to unpack
+template < >
+struct Message<MessageBase::Kind::recv, mpi_threads_pol>
+  : MessageInterface<MessageBase::Kind::recv, mpi_threads_pol>
+{
+  using base = MessageInterface<MessageBase::Kind::recv, mpi_threads_pol>;
+
+  using policy_comm = typename base::policy_comm;
+  using communicator_type = typename base::communicator_type;
+  using request_type      = typename base::request_type;
+  using status_type       = typename base::status_type;
+
+  // use the base class constructor
+  using base::base;
+
+
+  static int wait_recv_any(communicator_type&,
+                           int count, request_type* requests,
+                           status_type* statuses)
+  {
+    for (int i = 0; i < count; ++i) {
+      if (requests[i] != -2) {
+        assert(requests[i] == -1);
+        requests[i] = -2;
+        statuses[i] = 1;
+        return i;
+      }
+    }
+    return -1;
+  }
+
+  static int test_recv_any(communicator_type& con_comm,
+                           int count, request_type* requests,
+                           status_type* statuses)
+  {
+    return wait_recv_any(con_comm, count, requests, statuses);
+  }
+
+  static int wait_recv_some(communicator_type&,
+                            int count, request_type* requests,
+                            int* indices, status_type* statuses)
+  {
+    int done = 0;
+    for (int i = 0; i < count; ++i) {
+      if (requests[i] != -2) {
+        assert(requests[i] == -1);
+        requests[i] = -2;
+        statuses[i] = 1;
+        indices[done++] = i;
+      }
+    }
+    return done;
+  }
+
+  static int test_recv_some(communicator_type& con_comm,
+                            int count, request_type* requests,
+                            int* indices, status_type* statuses)
+  {
+    return wait_recv_some(con_comm, count, requests, indices, statuses);
+  }
+
+  static void wait_recv_all(communicator_type&,
+                            int count, request_type* requests,
+                            status_type* statuses)
+  {
+    for (int i = 0; i < count; ++i) {
+      if (requests[i] != -2) {
+        assert(requests[i] == -1);
+        requests[i] = -2;
+        statuses[i] = 1;
+      }
+    }
+  }
+
+  static bool test_recv_all(communicator_type& con_comm,
+                            int count, request_type* requests,
+                            status_type* statuses)
+  {
+    wait_recv_all(con_comm, count, requests, statuses);
+    return true;
+  }
+};
+
+
+template < typename exec_policy >
+struct MessageGroup<MessageBase::Kind::send, mpi_threads_pol, exec_policy>
+  : detail::MessageGroupInterface<MessageBase::Kind::send, mpi_threads_pol, exec_policy>
+{
+  using base = detail::MessageGroupInterface<MessageBase::Kind::send, mpi_threads_pol, exec_policy>;
+
+  using policy_comm       = typename base::policy_comm;
+  using communicator_type = typename base::communicator_type;
+  using message_type      = typename base::message_type;
+  using request_type      = typename base::request_type;
+  using status_type       = typename base::status_type;
+
+  using message_item_type = typename base::message_item_type;
+  using context_type      = typename base::context_type;
+  using event_type        = typename base::event_type;
+  using group_type        = typename base::group_type;
+  using component_type    = typename base::component_type;
+
+  // use the base class constructor
+  using base::base;
+
+
+  void finalize()
+  {
+    // call base finalize
+    base::finalize();
+  }
+
+
+  void allocate(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/)
+  {
+    COMB::ignore_unused(con, con_comm);
+    LOGPRINTF("%p send allocate msgs %p len %d\n", this, msgs, len);
+    if (len <= 0) return;
+    for (IdxT i = 0; i < len; ++i) {
+      message_type* msg = msgs[i];
+      assert(msg->buf == nullptr);
+
+      IdxT nbytes = msg->nbytes();
+
+      msg->buf = this->allocate_buffer(*msg, nbytes);
+      LOGPRINTF("%p send allocate msg %p buf %p nbytes %d\n", this, msg, msg->buf, nbytes);
+    }
+  }
+
+  // messages are packed by their owning threads in Isend
+  void pack(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/)
+  {
+    COMB::ignore_unused(con, con_comm);
+    LOGPRINTF("%p send pack con %p msgs %p len %d\n", this, &con, msgs, len);
+  }
+
+  IdxT wait_pack_complete(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/)
+  {
+    COMB::ignore_unused(con, con_comm);
+    LOGPRINTF("%p send wait_pack_complete con %p msgs %p len %d\n", this, &con, msgs, len);
+    if (len <= 0) return 0;
+    return len;
+  }
+
+  static void start_Isends(context_type& con, communicator_type& con_comm)
+  {
+    LOGPRINTF("send start_Isends con %p\n", &con);
+    COMB::ignore_unused(con, con_comm);
+  }
+
+  void Isend(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/, request_type* requests)
+  {
+    LOGPRINTF("%p send Isend con %p msgs %p len %d\n", this, &con, msgs, len);
+    if (len <= 0) return;
+    start_Isends(con, con_comm);
+    con.start_group(this->m_groups[len-1]);
+    threads::run(con_comm.num_threads, [&](int thread) {
+      for (IdxT i = 0; i < len; ++i) {
+        const message_type* msg = msgs[i];
+        if (con_comm.owner(msg->partner_rank) != thread) continue;
+        LOGPRINTF("%p send Isend thread %d msg %p buf %p nbytes %d to %i tag %i\n",
+                  this, thread, msg, msg->buf, msg->nbytes(), msg->partner_rank, msg->msg_tag);
+        const IdxT msg_idx = msg->idx;
+        char* buf = static_cast<char*>(msg->buf);
+        assert(buf != nullptr);
+        this->m_contexts[msg_idx].start_component(this->m_groups[len-1], this->m_components[msg_idx]);
+        for (const MessageItemBase* msg_item : msg->message_items) {
+          const message_item_type* item = static_cast<const message_item_type*>(msg_item);
+          buf = this->pack_item(this->m_contexts[msg_idx], *item, buf);
+        }
+        this->m_contexts[msg_idx].finish_component(this->m_groups[len-1], this->m_components[msg_idx]);
+        this->m_contexts[msg_idx].synchronize();
+
+        detail::MPI::Isend_bytes(msg->buf, msg->nbytes(),
+                                 msg->partner_rank, msg->msg_tag, con_comm.thread_comm(thread), &requests[i]);
+      }
+    });
+    con.finish_group(this->m_groups[len-1]);
+    finish_Isends(con, con_comm);
+  }
+
+  static void finish_Isends(context_type& con, communicator_type& con_comm)
+  {
+    LOGPRINTF("send finish_Isends con %p\n", &con);
+    COMB::ignore_unused(con, con_comm);
+  }
+
+  void deallocate(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/)
+  {
+    COMB::ignore_unused(con, con_comm);
+    LOGPRINTF("%p send deallocate con %p msgs %p len %d\n", this, &con, msgs, len);
+    if (len <= 0) return;
+    for (IdxT i = 0; i < len; ++i) {
+      message_type* msg = msgs[i];
+      LOGPRINTF("%p send deallocate msg %p buf %p\n", this, msg, msg->buf);
+      assert(msg->buf != nullptr);
+
+      this->deallocate_buffer(msg->buf);
+
+      msg->buf = nullptr;
+    }
+  }
+};
+
+template < typename exec_policy >
+struct MessageGroup<MessageBase::Kind::recv, mpi_threads_pol, exec_policy>
+  : detail::MessageGroupInterface<MessageBase::Kind::recv, mpi_threads_pol, exec_policy>
+{
+  using base = detail::MessageGroupInterface<MessageBase::Kind::recv, mpi_threads_pol, exec_policy>;
+
+  using policy_comm       = typename base::policy_comm;
+  using communicator_type = typename base::communicator_type;
+  using message_type      = typename base::message_type;
+  using request_type      = typename base::request_type;
+  using status_type       = typename base::status_type;
+
+  using message_item_type = typename base::message_item_type;
+  using context_type      = typename base::context_type;
+  using event_type        = typename base::event_type;
+  using group_type        = typename base::group_type;
+  using component_type    = typename base::component_type;
+
+  // mpi requests indexed by message idx, tested by the owning threads
+  std::vector<MPI_Request> m_mpi_requests;
+
+  // use the base class constructor
+  using base::base;
+
+
+  void finalize()
+  {
+    // call base finalize
+    base::finalize();
+    m_mpi_requests.resize(this->messages.size(), MPI_REQUEST_NULL);
+  }
+
+  void allocate(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/)
+  {
+    COMB::ignore_unused(con, con_comm);
+    LOGPRINTF("%p recv allocate con %p msgs %p len %d\n", this, &con, msgs, len);
+    if (len <= 0) return;
+    for (IdxT i = 0; i < len; ++i) {
+      message_type* msg = msgs[i];
+      assert(msg->buf == nullptr);
+
+      IdxT nbytes = msg->nbytes();
+
+      msg->buf = this->allocate_buffer(*msg, nbytes);
+      LOGPRINTF("%p recv allocate msg %p buf %p nbytes %d\n", this, msg, msg->buf, nbytes);
+    }
+  }
+
+  void Irecv(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/, request_type* requests)
+  {
+    COMB::ignore_unused(con);
+    LOGPRINTF("%p recv Irecv con %p msgs %p len %d\n", this, &con, msgs, len);
+    if (len <= 0) return;
+    for (IdxT i = 0; i < len; ++i) {
+      const message_type* msg = msgs[i];
+      LOGPRINTF("%p recv Irecv msg %p buf %p nbytes %d to %d tag %d\n",
+                                this, msg, msg->buf, msg->nbytes(), msg->partner_rank, msg->msg_tag);
+      assert(msg->buf != nullptr);
+      detail::MPI::Irecv_bytes(msg->buf, msg->nbytes(),
+                               msg->partner_rank, msg->msg_tag,
+                               con_comm.thread_comm(con_comm.owner(msg->partner_rank)),
+                               &m_mpi_requests[msg->idx]);
+      requests[i] = -1;
+    }
+  }
+
+  // each thread tests its own messages and unpacks them as they arrive
+  void unpack(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/)
+  {
+    LOGPRINTF("%p recv unpack con %p msgs %p len %d\n", this, &con, msgs, len);
+    if (len <= 0) return;
+    con.start_group(this->m_groups[len-1]);
+    threads::run(con_comm.num_threads, [&](int thread) {
+      IdxT num_pending = 0;
+      for (IdxT i = 0; i < len; ++i) {
+        if (con_comm.owner(msgs[i]->partner_rank) == thread) ++num_pending;
+      }
+      while (num_pending > 0) {
+        for (IdxT i = 0; i < len; ++i) {
+          const message_type* msg = msgs[i];
+          const IdxT msg_idx = msg->idx;
+          if (con_comm.owner(msg->partner_rank) != thread) continue;
+          if (m_mpi_requests[msg_idx] == MPI_REQUEST_NULL) continue;
+          MPI_Status status;
+          if (!detail::MPI::Test(&m_mpi_requests[msg_idx], &status)) continue;
+          LOGPRINTF("%p recv unpack thread %d msg %p buf %p\n", this, thread, msg, msg->buf);
+          char const* buf = static_cast<char const*>(msg->buf);
+          assert(buf != nullptr);
+          this->m_contexts[msg_idx].start_component(this->m_groups[len-1], this->m_components[msg_idx]);
+          for (const MessageItemBase* msg_item : msg->message_items) {
+            const message_item_type* item = static_cast<const message_item_type*>(msg_item);
+            buf = this->unpack_item(this->m_contexts[msg_idx], *item, buf);
+          }
+          this->m_contexts[msg_idx].finish_component(this->m_groups[len-1], this->m_components[msg_idx]);
+          --num_pending;
+        }
+      }
+    });
+    con.finish_group(this->m_groups[len-1]);
+  }
+
+  void deallocate(context_type& con, communicator_type& con_comm, message_type** msgs, IdxT len, detail::Async /*async*/)
+  {
+    COMB::ignore_unused(con, con_comm);
+    LOGPRINTF("%p recv deallocate con %p msgs %p len %d\n", this, &con, msgs, len);
+    if (len <= 0) return;
+    for (IdxT i = 0; i < len; ++i) {
+      message_type* msg = msgs[i];
+      LOGPRINTF("%p recv deallocate msg %p buf %p\n", this, msg, msg->buf);
+      assert(msg->buf != nullptr);
+
+      this->deallocate_buffer(msg->buf);
+
+      msg->buf = nullptr;
+    }
+  }
+};
+
+} // namespace detail
+
+#endif
+
+#endif // _COMM_POL_MPI_THREADS_HPP
@@ -30,6 +30,10 @@ struct umr_pol {
   static const bool mock = false;
   // compile mpi_type packing/unpacking tests for this comm policy
   static const bool use_mpi_type = false;
+  // messages over the pipeline threshold may be split into chunk messages
+  static const bool chunk_messages = false;
+  // per cycle message buffers may come from one slab allocated per comm
+  static const bool slab_buffers = true;
   static const char* get_name() { return "umr"; }
   using send_request_type = UMR_Request;
   using recv_request_type = UMR_Request;
@@ -265,9 +269,9 @@ struct MessageGroup<MessageBase::Kind::send, umr_pol, exec_policy>
       message_type* msg = msgs[i];
       assert(msg->buf == nullptr);
 
-      IdxT nbytes = msg->nbytes() * this->m_variables.size();
+      IdxT nbytes = msg->nbytes();
 
-      msg->buf = this->m_aloc.allocate(nbytes);
+      msg->buf = this->allocate_buffer(*msg, nbytes);
     }
   }
 
@@ -283,15 +287,7 @@ struct MessageGroup<MessageBase::Kind::send, umr_pol, exec_policy>
       this->m_contexts[msg->idx].start_component(this->m_groups[len-1], this->m_components[msg->idx]);
       for (const MessageItemBase* msg_item : msg->message_items) {
         const message_item_type* item = static_cast<const message_item_type*>(msg_item);
-        const IdxT len = item->size;
-        const IdxT nbytes = item->nbytes;
-        LidxT const* indices = item->indices;
-        for (DataT const* src : this->m_variables) {
-          // LOGPRINTF("%p pack %p = %p[%p] len %d\n", this, buf, src, indices, len);
-          this->m_contexts[msg->idx].for_all(len, make_copy_idxr_idxr(src, detail::indexer_list_i{indices},
-                                             static_cast<DataT*>(static_cast<void*>(buf)), detail::indexer_i{}));
-          buf += nbytes;
-        }
+        buf = this->pack_item(this->m_contexts[msg->idx], *item, buf);
       }
       if (async == detail::Async::no) {
         this->m_contexts[msg->idx].finish_component(this->m_groups[len-1], this->m_components[msg->idx]);
@@ -335,7 +331,7 @@ struct MessageGroup<MessageBase::Kind::send, umr_pol, exec_policy>
       assert(buf != nullptr);
       const int partner_rank = msg->partner_rank;
       const int tag = msg->msg_tag;
-      const IdxT nbytes = msg->nbytes() * this->m_variables.size();
+      const IdxT nbytes = msg->nbytes();
       // LOGPRINTF("%p Isend %p nbytes %d to %i tag %i\n", this, buf, nbytes, partner_rank, tag);
       detail::UMR::Isend(buf, nbytes, UMR_BYTE,
                          partner_rank, tag, con_comm.comm, &requests[i]);
@@ -357,7 +353,7 @@ struct MessageGroup<MessageBase::Kind::send, umr_pol, exec_policy>
       message_type* msg = msgs[i];
       assert(msg->buf != nullptr);
 
-      this->m_aloc.deallocate(msg->buf);
+      this->deallocate_buffer(msg->buf);
 
       msg->buf = nullptr;
     }
@@ -401,9 +397,9 @@ struct MessageGroup<MessageBase::Kind::recv, umr_pol, exec_policy>
       message_type* msg = msgs[i];
       assert(msg->buf == nullptr);
 
-      IdxT nbytes = msg->nbytes() * this->m_variables.size();
+      IdxT nbytes = msg->nbytes();
 
-      msg->buf = this->m_aloc.allocate(nbytes);
+      msg->buf = this->allocate_buffer(*msg, nbytes);
     }
   }
 
@@ -417,7 +413,7 @@ struct MessageGroup<MessageBase::Kind::recv, umr_pol, exec_policy>
       assert(buf != nullptr);
       const int partner_rank = msg->partner_rank;
       const int tag = msg->msg_tag;
-      const IdxT nbytes = msg->nbytes() * this->m_variables.size();
+      const IdxT nbytes = msg->nbytes();
       // LOGPRINTF("%p Irecv %p nbytes %d to %i tag %i\n", this, buf, nbytes, partner_rank, tag);
       detail::UMR::Irecv(buf, nbytes, UMR_BYTE,
                          partner_rank, tag, con_comm.comm, &requests[i]);
@@ -431,20 +427,12 @@ struct MessageGroup<MessageBase::Kind::recv, umr_pol, exec_policy>
     con.start_group(this->m_groups[len-1]);
     for (IdxT i = 0; i < len; ++i) {
       const message_type* msg = msgs[i];
-      char* buf = static_cast<char*>(msg->buf);
+      char const* buf = static_cast<char const*>(msg->buf);
       assert(buf != nullptr);
       this->m_contexts[msg->idx].start_component(this->m_groups[len-1], this->m_components[msg->idx]);
       for (const MessageItemBase* msg_item : msg->message_items) {
         const message_item_type* item = static_cast<const message_item_type*>(msg_item);
-        const IdxT len = item->size;
-        const IdxT nbytes = item->nbytes;
-        LidxT const* indices = item->indices;
-        for (DataT* dst : this->m_variables) {
-          // LOGPRINTF("%p unpack %p[%p] = %p len %d\n", this, dst, indices, buf, len);
-          this->m_contexts[msg->idx].for_all(len, make_copy_idxr_idxr(static_cast<DataT*>(static_cast<void*>(buf)), detail::indexer_i{},
-                                             dst, detail::indexer_list_i{indices}));
-          buf += nbytes;
-        }
+        buf = this->unpack_item(this->m_contexts[msg->idx], *item, buf);
       }
       this->m_contexts[msg->idx].finish_component(this->m_groups[len-1], this->m_components[msg->idx]);
     }
@@ -459,7 +447,7 @@ struct MessageGroup<MessageBase::Kind::recv, umr_pol, exec_policy>
       message_type* msg = msgs[i];
       assert(msg->buf != nullptr);
 
-      this->m_aloc.deallocate(msg->buf);
+      this->deallocate_buffer(msg->buf);
 
       msg->buf = nullptr;
     }
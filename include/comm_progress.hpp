@@ -0,0 +1,289 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2018-2021, Lawrence Livermore National Security, LLC.
+//
+// Produced at the Lawrence Livermore National Laboratory
+//
+// LLNL-CODE-758885
+//
+// All rights reserved.
+//
+// This file is part of Comb.
+//
+// For details, see https://github.com/LLNL/Comb
+// Please also see the LICENSE file for MIT license.
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef _COMM_PROGRESS_HPP
+#define _COMM_PROGRESS_HPP
+
+#include "config.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#ifdef COMB_ENABLE_OPENMP
+#include <omp.h>
+#endif
+
+#include "comm_utils_mpi.hpp"
+#include "profiling.hpp"
+
+namespace detail {
+
+namespace progress {
+
+// requests that can be queried without completing them
+template < typename request_type >
+struct queryable : std::false_type
+{ };
+
+#ifdef COMB_ENABLE_MPI
+template < >
+struct queryable<MPI_Request> : std::true_type
+{ };
+#endif
+
+// count of requests that have completed, never completes or frees a request
+// so the waits still see every request
+template < typename request_type >
+inline IdxT num_complete(request_type const*, IdxT)
+{
+  return 0;
+}
+
+#ifdef COMB_ENABLE_MPI
+inline IdxT num_complete(MPI_Request const* requests, IdxT count)
+{
+  IdxT num = 0;
+  for (IdxT i = 0; i < count; ++i) {
+    if (requests[i] == MPI_REQUEST_NULL ||
+        detail::MPI::Request_get_status(requests[i], MPI_STATUS_IGNORE)) {
+      num += 1;
+    }
+  }
+  return num;
+}
+#endif
+
+} // namespace progress
+
+} // namespace detail
+
+// Helper thread that makes communication progress while the main thread
+// computes. It sleeps until armed with work, then calls the work until it
+// reports there is nothing left to do or the main thread disarms it.
+// The main thread makes no mpi calls while the helper is armed.
+struct ProgressThread
+{
+  ProgressThread()
+    : m_timer(1024)
+  {
+    m_thread = std::thread([this]() { run(); });
+    pin();
+  }
+
+  ProgressThread(ProgressThread const&) = delete;
+  ProgressThread& operator=(ProgressThread const&) = delete;
+
+  ~ProgressThread()
+  {
+    disarm();
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_state = state::quit;
+    }
+    m_cv.notify_all();
+    m_thread.join();
+  }
+
+  // cpu the helper is pinned to or -1 if every cpu runs an openmp thread
+  int cpu() const
+  {
+    return m_cpu;
+  }
+
+  // start calling work, work returns true when it is done
+  void arm(std::function<bool()>&& work)
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      assert(m_state == state::idle);
+      m_work = std::move(work);
+      m_stop.store(false, std::memory_order_relaxed);
+      m_state = state::armed;
+    }
+    m_cv.notify_all();
+  }
+
+  // stop calling work and wait for the helper to go idle
+  void disarm()
+  {
+    m_stop.store(true, std::memory_order_release);
+    finish();
+  }
+
+  // wait for work to be done without interrupting it
+  void finish()
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait(lock, [&]() { return m_state != state::armed; });
+  }
+
+  // true if the helper has no work, without waiting
+  bool idle()
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_state != state::armed;
+  }
+
+  // time the helper spent working, only read when idle
+  Timer& timer()
+  {
+    return m_timer;
+  }
+
+  // queryable requests the main thread found complete when it started waiting
+  long num_recvs = 0;
+  long num_recvs_complete = 0;
+  long num_sends = 0;
+  long num_sends_complete = 0;
+
+  void clear()
+  {
+    m_timer.clear();
+    num_recvs = 0;
+    num_recvs_complete = 0;
+    num_sends = 0;
+    num_sends_complete = 0;
+  }
+
+private:
+  enum struct state
+  { idle
+  , armed
+  , quit };
+
+  std::thread m_thread;
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::function<bool()> m_work;
+  std::atomic<bool> m_stop{false};
+  state m_state = state::idle;
+  int m_cpu = -1;
+  Timer m_timer;
+
+  // most pauses between polls of the work, about a microsecond on x86
+  static const unsigned max_backoff = 64;
+
+  static void pause()
+  {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#else
+    std::this_thread::yield();
+#endif
+  }
+
+  void run()
+  {
+#ifdef COMB_ENABLE_OPENMP
+    // work like unpacking runs sequentially on the helper, a team would
+    // oversubscribe the cpus of the main thread's team computing meanwhile
+    omp_set_num_threads(1);
+#endif
+    CPUContext tm_con;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+      m_cv.wait(lock, [&]() { return m_state != state::idle; });
+      if (m_state == state::quit) break;
+      lock.unlock();
+
+      // back off exponentially between polls that found nothing to do,
+      // once backed off all the way give the cpu to other threads
+      m_timer.start(tm_con, "progress");
+      unsigned backoff = 1;
+      while (!m_stop.load(std::memory_order_acquire) && !m_work()) {
+        for (unsigned i = 0; i < backoff; ++i) {
+          pause();
+        }
+        if (backoff < max_backoff) {
+          backoff *= 2;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+      m_timer.stop(tm_con);
+
+      lock.lock();
+      m_work = nullptr;
+      m_state = state::idle;
+      m_cv.notify_all();
+    }
+  }
+
+  // pin to the last cpu this process may run on that no openmp thread is
+  // bound to or running on, so polling does not take a core from the
+  // compute loops it overlaps, stay unpinned if the team covers every cpu
+  void pin()
+  {
+#if defined(__linux__)
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    if (sched_getaffinity(0, sizeof(mask), &mask) == 0) {
+      cpu_set_t used;
+      CPU_ZERO(&used);
+#ifdef COMB_ENABLE_OPENMP
+#pragma omp parallel
+      {
+        // a bound thread may use every cpu in its mask, an unbound one is
+        // counted on the cpu it runs on now
+        cpu_set_t thread_mask;
+        CPU_ZERO(&thread_mask);
+        bool bound = pthread_getaffinity_np(pthread_self(), sizeof(thread_mask), &thread_mask) == 0
+                  && !CPU_EQUAL(&thread_mask, &mask);
+        int thread_cpu = sched_getcpu();
+#pragma omp critical
+        {
+          if (bound) {
+            CPU_OR(&used, &used, &thread_mask);
+          } else if (thread_cpu >= 0) {
+            CPU_SET(thread_cpu, &used);
+          }
+        }
+      }
+#else
+      int main_cpu = sched_getcpu();
+      if (main_cpu >= 0) {
+        CPU_SET(main_cpu, &used);
+      }
+#endif
+      for (int c = CPU_SETSIZE-1; c >= 0; --c) {
+        if (CPU_ISSET(c, &mask) && !CPU_ISSET(c, &used)) {
+          cpu_set_t pinned;
+          CPU_ZERO(&pinned);
+          CPU_SET(c, &pinned);
+          if (pthread_setaffinity_np(m_thread.native_handle(), sizeof(pinned), &pinned) == 0) {
+            m_cpu = c;
+          }
+          break;
+        }
+      }
+    }
+#endif
+  }
+};
+
+#endif // _COMM_PROGRESS_HPP
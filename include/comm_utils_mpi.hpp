@@ -22,6 +22,7 @@
 
 #include <cassert>
 #include <cstdio>
+#include <limits>
 
 #include <mpi.h>
 
@@ -90,6 +91,33 @@ inline int Comm_size(MPI_Comm comm)
   return size;
 }
 
+inline MPI_Comm Comm_split_type_shared(MPI_Comm comm_old)
+{
+  MPI_Comm comm;
+  // LOGPRINTF("MPI_Comm_split_type rank(w%i)\n", Comm_rank(MPI_COMM_WORLD));
+  int ret = MPI_Comm_split_type(comm_old, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &comm);
+  assert(ret == MPI_SUCCESS);
+  return comm;
+}
+
+// ranks in comm_to of the given ranks in comm_from, MPI_UNDEFINED for
+// ranks that are not in comm_to
+inline void Comm_translate_ranks(MPI_Comm comm_from, int n, const int* ranks_from,
+                                 MPI_Comm comm_to, int* ranks_to)
+{
+  MPI_Group group_from, group_to;
+  int ret = MPI_Comm_group(comm_from, &group_from);
+  assert(ret == MPI_SUCCESS);
+  ret = MPI_Comm_group(comm_to, &group_to);
+  assert(ret == MPI_SUCCESS);
+  ret = MPI_Group_translate_ranks(group_from, n, ranks_from, group_to, ranks_to);
+  assert(ret == MPI_SUCCESS);
+  ret = MPI_Group_free(&group_to);
+  assert(ret == MPI_SUCCESS);
+  ret = MPI_Group_free(&group_from);
+  assert(ret == MPI_SUCCESS);
+}
+
 inline void Comm_free(MPI_Comm* comm)
 {
   // LOGPRINTF("MPI_Comm_free rank(w%i)\n", Comm_rank(MPI_COMM_WORLD));
@@ -141,6 +169,32 @@ inline MPI_Datatype Type_create_subarray(int ndims, const int *sizes, const int
   return mpi_type;
 }
 
+inline MPI_Datatype Type_contiguous(int count, MPI_Datatype old_type)
+{
+  MPI_Datatype mpi_type;
+  int ret = MPI_Type_contiguous(count, old_type, &mpi_type);
+  // LOGPRINTF("MPI_Type_contiguous rank(w%i) count(%i)\n", Comm_rank(MPI_COMM_WORLD), count);
+  assert(ret == MPI_SUCCESS);
+  return mpi_type;
+}
+
+inline MPI_Datatype Type_create_struct(int count, const int *blocklengths, const MPI_Aint *displacements, const MPI_Datatype *types)
+{
+  MPI_Datatype mpi_type;
+  int ret = MPI_Type_create_struct(count, blocklengths, displacements, types, &mpi_type);
+  // LOGPRINTF("MPI_Type_create_struct rank(w%i) count(%i)\n", Comm_rank(MPI_COMM_WORLD), count);
+  assert(ret == MPI_SUCCESS);
+  return mpi_type;
+}
+
+inline MPI_Aint Get_address(const void* location)
+{
+  MPI_Aint address;
+  int ret = MPI_Get_address(location, &address);
+  assert(ret == MPI_SUCCESS);
+  return address;
+}
+
 inline void Type_commit(MPI_Datatype* mpi_type)
 {
   int ret = MPI_Type_commit(mpi_type);
@@ -155,6 +209,17 @@ inline void Type_free(MPI_Datatype* mpi_type)
   assert(ret == MPI_SUCCESS);
 }
 
+inline MPI_Comm Dist_graph_create_adjacent(MPI_Comm comm_old, int indegree, const int* sources, int outdegree, const int* destinations)
+{
+  MPI_Comm graph_comm;
+  int ret = MPI_Dist_graph_create_adjacent(comm_old, indegree, sources, MPI_UNWEIGHTED,
+                                           outdegree, destinations, MPI_UNWEIGHTED,
+                                           MPI_INFO_NULL, 0, &graph_comm);
+  // LOGPRINTF("MPI_Dist_graph_create_adjacent rank(w%i) indegree(%i) outdegree(%i)\n", Comm_rank(MPI_COMM_WORLD), indegree, outdegree);
+  assert(ret == MPI_SUCCESS);
+  return graph_comm;
+}
+
 inline void Barrier(MPI_Comm comm)
 {
   // LOGPRINTF("MPI_Barrier rank(w%i)\n", Comm_rank(MPI_COMM_WORLD));
@@ -176,6 +241,13 @@ inline void Reduce(const void* inbuf, void* outbuf, int count, MPI_Datatype mpi_
   assert(ret == MPI_SUCCESS);
 }
 
+inline void Allreduce(const void* inbuf, void* outbuf, int count, MPI_Datatype mpi_type, MPI_Op op, MPI_Comm comm)
+{
+  // LOGPRINTF("MPI_Allreduce rank(w%i)\n", Comm_rank(MPI_COMM_WORLD));
+  int ret = MPI_Allreduce(inbuf, outbuf, count, mpi_type, op, comm);
+  assert(ret == MPI_SUCCESS);
+}
+
 inline int Pack_size(int incount, MPI_Datatype mpi_type, MPI_Comm comm)
 {
   int size;
@@ -215,6 +287,322 @@ inline void Isend(const void *buf, int count, MPI_Datatype mpi_type, int dest, i
   assert(ret == MPI_SUCCESS);
 }
 
+inline void Ineighbor_alltoallv(const void* sendbuf, const int* sendcounts, const int* sdispls, MPI_Datatype sendtype,
+                                void* recvbuf, const int* recvcounts, const int* rdispls, MPI_Datatype recvtype,
+                                MPI_Comm comm, MPI_Request* request)
+{
+  // LOGPRINTF("MPI_Ineighbor_alltoallv rank(w%i) %p %p\n", Comm_rank(MPI_COMM_WORLD), sendbuf, recvbuf);
+  int ret = MPI_Ineighbor_alltoallv(sendbuf, sendcounts, sdispls, sendtype,
+                                    recvbuf, recvcounts, rdispls, recvtype,
+                                    comm, request);
+  assert(ret == MPI_SUCCESS);
+}
+
+inline void Ineighbor_alltoallw(const void* sendbuf, const int* sendcounts, const MPI_Aint* sdispls, const MPI_Datatype* sendtypes,
+                                void* recvbuf, const int* recvcounts, const MPI_Aint* rdispls, const MPI_Datatype* recvtypes,
+                                MPI_Comm comm, MPI_Request* request)
+{
+  // LOGPRINTF("MPI_Ineighbor_alltoallw rank(w%i) %p %p\n", Comm_rank(MPI_COMM_WORLD), sendbuf, recvbuf);
+  int ret = MPI_Ineighbor_alltoallw(sendbuf, sendcounts, sdispls, sendtypes,
+                                    recvbuf, recvcounts, rdispls, recvtypes,
+                                    comm, request);
+  assert(ret == MPI_SUCCESS);
+}
+
+// byte counts that do not fit in an int use the large count interface
+// in mpi 4 and otherwise a derived type made of int sized blocks
+constexpr MPI_Count large_count_block_nbytes = MPI_Count{1} << 30;
+
+inline bool is_large_count(MPI_Count nbytes)
+{
+  return nbytes > static_cast<MPI_Count>(std::numeric_limits<int>::max());
+}
+
+inline MPI_Datatype Type_bytes(MPI_Count nbytes)
+{
+  int nblocks = static_cast<int>(nbytes / large_count_block_nbytes);
+  int remainder = static_cast<int>(nbytes % large_count_block_nbytes);
+  MPI_Datatype block_type = Type_contiguous(static_cast<int>(large_count_block_nbytes), MPI_BYTE);
+  MPI_Datatype mpi_type = Type_contiguous(nblocks, block_type);
+  Type_free(&block_type);
+  if (remainder > 0) {
+    MPI_Datatype blocks_type = mpi_type;
+    int blocklengths[2] {1, remainder};
+    MPI_Aint displacements[2] {0, static_cast<MPI_Aint>(nblocks) * static_cast<MPI_Aint>(large_count_block_nbytes)};
+    MPI_Datatype types[2] {blocks_type, MPI_BYTE};
+    mpi_type = Type_create_struct(2, blocklengths, displacements, types);
+    Type_free(&blocks_type);
+  }
+  Type_commit(&mpi_type);
+  return mpi_type;
+}
+
+inline void Irecv_bytes(void *buf, MPI_Count nbytes, int src, int tag, MPI_Comm comm, MPI_Request *request)
+{
+  if (!is_large_count(nbytes)) {
+    Irecv(buf, static_cast<int>(nbytes), MPI_BYTE, src, tag, comm, request);
+  } else {
+#if MPI_VERSION >= 4
+    int ret = MPI_Irecv_c(buf, nbytes, MPI_BYTE, src, tag, comm, request);
+    assert(ret == MPI_SUCCESS);
+#else
+    // freeing the type does not affect the pending receive
+    MPI_Datatype mpi_type = Type_bytes(nbytes);
+    Irecv(buf, 1, mpi_type, src, tag, comm, request);
+    Type_free(&mpi_type);
+#endif
+  }
+}
+
+inline void Isend_bytes(const void *buf, MPI_Count nbytes, int dest, int tag, MPI_Comm comm, MPI_Request *request)
+{
+  if (!is_large_count(nbytes)) {
+    Isend(buf, static_cast<int>(nbytes), MPI_BYTE, dest, tag, comm, request);
+  } else {
+#if MPI_VERSION >= 4
+    int ret = MPI_Isend_c(buf, nbytes, MPI_BYTE, dest, tag, comm, request);
+    assert(ret == MPI_SUCCESS);
+#else
+    // freeing the type does not affect the pending send
+    MPI_Datatype mpi_type = Type_bytes(nbytes);
+    Isend(buf, 1, mpi_type, dest, tag, comm, request);
+    Type_free(&mpi_type);
+#endif
+  }
+}
+
+inline void Recv_init(void *buf, int count, MPI_Datatype mpi_type, int src, int tag, MPI_Comm comm, MPI_Request *request)
+{
+  // LOGPRINTF("MPI_Recv_init rank(w%i) %p[%i] src(%i) tag(%i)\n", Comm_rank(MPI_COMM_WORLD), buf, count, src, tag);
+  int ret = MPI_Recv_init(buf, count, mpi_type, src, tag, comm, request);
+  assert(ret == MPI_SUCCESS);
+}
+
+inline void Send_init(const void *buf, int count, MPI_Datatype mpi_type, int dest, int tag, MPI_Comm comm, MPI_Request *request)
+{
+  // LOGPRINTF("MPI_Send_init rank(w%i) %p[%i] dst(%i) tag(%i)\n", Comm_rank(MPI_COMM_WORLD), buf, count, dest, tag);
+  int ret = MPI_Send_init(buf, count, mpi_type, dest, tag, comm, request);
+  assert(ret == MPI_SUCCESS);
+}
+
+inline void Recv_init_bytes(void *buf, MPI_Count nbytes, int src, int tag, MPI_Comm comm, MPI_Request *request)
+{
+  if (!is_large_count(nbytes)) {
+    Recv_init(buf, static_cast<int>(nbytes), MPI_BYTE, src, tag, comm, request);
+  } else {
+#if MPI_VERSION >= 4
+    int ret = MPI_Recv_init_c(buf, nbytes, MPI_BYTE, src, tag, comm, request);
+    assert(ret == MPI_SUCCESS);
+#else
+    // the request keeps its own reference to the type
+    MPI_Datatype mpi_type = Type_bytes(nbytes);
+    Recv_init(buf, 1, mpi_type, src, tag, comm, request);
+    Type_free(&mpi_type);
+#endif
+  }
+}
+
+inline void Send_init_bytes(const void *buf, MPI_Count nbytes, int dest, int tag, MPI_Comm comm, MPI_Request *request)
+{
+  if (!is_large_count(nbytes)) {
+    Send_init(buf, static_cast<int>(nbytes), MPI_BYTE, dest, tag, comm, request);
+  } else {
+#if MPI_VERSION >= 4
+    int ret = MPI_Send_init_c(buf, nbytes, MPI_BYTE, dest, tag, comm, request);
+    assert(ret == MPI_SUCCESS);
+#else
+    // the request keeps its own reference to the type
+    MPI_Datatype mpi_type = Type_bytes(nbytes);
+    Send_init(buf, 1, mpi_type, dest, tag, comm, request);
+    Type_free(&mpi_type);
+#endif
+  }
+}
+
+inline void Startall(int count, MPI_Request *requests)
+{
+  // LOGPRINTF("MPI_Startall rank(w%i) count(%i)\n", Comm_rank(MPI_COMM_WORLD), count);
+  int ret = MPI_Startall(count, requests);
+  assert(ret == MPI_SUCCESS);
+}
+
+inline void Request_free(MPI_Request *request)
+{
+  int ret = MPI_Request_free(request);
+  assert(ret == MPI_SUCCESS);
+}
+
+inline MPI_Group Comm_group_incl(MPI_Comm comm, int n, const int* ranks)
+{
+  MPI_Group comm_group;
+  int ret = MPI_Comm_group(comm, &comm_group);
+  assert(ret == MPI_SUCCESS);
+  MPI_Group group;
+  ret = MPI_Group_incl(comm_group, n, ranks, &group);
+  assert(ret == MPI_SUCCESS);
+  ret = MPI_Group_free(&comm_group);
+  assert(ret == MPI_SUCCESS);
+  return group;
+}
+
+inline void Group_free(MPI_Group* group)
+{
+  int ret = MPI_Group_free(group);
+  assert(ret == MPI_SUCCESS);
+}
+
+inline MPI_Win Win_create_dynamic(MPI_Comm comm)
+{
+  MPI_Win win;
+  // LOGPRINTF("MPI_Win_create_dynamic rank(w%i)\n", Comm_rank(MPI_COMM_WORLD));
+  int ret = MPI_Win_create_dynamic(MPI_INFO_NULL, comm, &win);
+  assert(ret == MPI_SUCCESS);
+  return win;
+}
+
+inline MPI_Win Win_allocate_shared(MPI_Aint nbytes, MPI_Comm comm, void** baseptr)
+{
+  MPI_Win win;
+  // LOGPRINTF("MPI_Win_allocate_shared rank(w%i) nbytes(%lli)\n", Comm_rank(MPI_COMM_WORLD), (long long)nbytes);
+  int ret = MPI_Win_allocate_shared(nbytes, 1, MPI_INFO_NULL, comm, baseptr, &win);
+  assert(ret == MPI_SUCCESS);
+  return win;
+}
+
+inline void* Win_shared_query(MPI_Win win, int rank)
+{
+  MPI_Aint nbytes;
+  int disp_unit;
+  void* baseptr = nullptr;
+  int ret = MPI_Win_shared_query(win, rank, &nbytes, &disp_unit, &baseptr);
+  assert(ret == MPI_SUCCESS);
+  return baseptr;
+}
+
+inline void Win_attach(MPI_Win win, void* base, MPI_Aint nbytes)
+{
+  int ret = MPI_Win_attach(win, base, nbytes);
+  assert(ret == MPI_SUCCESS);
+}
+
+inline void Win_detach(MPI_Win win, const void* base)
+{
+  int ret = MPI_Win_detach(win, base);
+  assert(ret == MPI_SUCCESS);
+}
+
+inline void Win_free(MPI_Win* win)
+{
+  int ret = MPI_Win_free(win);
+  assert(ret == MPI_SUCCESS);
+}
+
+inline void Win_lock_all(int assert_, MPI_Win win)
+{
+  int ret = MPI_Win_lock_all(assert_, win);
+  assert(ret == MPI_SUCCESS);
+}
+
+inline void Win_unlock_all(MPI_Win win)
+{
+  int ret = MPI_Win_unlock_all(win);
+  assert(ret == MPI_SUCCESS);
+}
+
+inline void Win_sync(MPI_Win win)
+{
+  int ret = MPI_Win_sync(win);
+  assert(ret == MPI_SUCCESS);
+}
+
+inline void Win_post(MPI_Group group, MPI_Win win)
+{
+  // LOGPRINTF("MPI_Win_post rank(w%i)\n", Comm_rank(MPI_COMM_WORLD));
+  int ret = MPI_Win_post(group, 0, win);
+  assert(ret == MPI_SUCCESS);
+}
+
+inline void Win_start(MPI_Group group, MPI_Win win)
+{
+  // LOGPRINTF("MPI_Win_start rank(w%i)\n", Comm_rank(MPI_COMM_WORLD));
+  int ret = MPI_Win_start(group, 0, win);
+  assert(ret == MPI_SUCCESS);
+}
+
+inline void Win_complete(MPI_Win win)
+{
+  int ret = MPI_Win_complete(win);
+  assert(ret == MPI_SUCCESS);
+}
+
+inline void Win_wait(MPI_Win win)
+{
+  int ret = MPI_Win_wait(win);
+  assert(ret == MPI_SUCCESS);
+}
+
+inline bool Win_test(MPI_Win win)
+{
+  int flag = 0;
+  int ret = MPI_Win_test(win, &flag);
+  assert(ret == MPI_SUCCESS);
+  return flag;
+}
+
+inline void Put_bytes(const void* buf, MPI_Count nbytes, int target, MPI_Aint target_disp, MPI_Win win)
+{
+  // LOGPRINTF("MPI_Put rank(w%i) %p nbytes(%lli) target(%i)\n", Comm_rank(MPI_COMM_WORLD), buf, (long long)nbytes, target);
+  if (!is_large_count(nbytes)) {
+    int ret = MPI_Put(buf, static_cast<int>(nbytes), MPI_BYTE,
+                      target, target_disp, static_cast<int>(nbytes), MPI_BYTE, win);
+    assert(ret == MPI_SUCCESS);
+  } else {
+#if MPI_VERSION >= 4
+    int ret = MPI_Put_c(buf, nbytes, MPI_BYTE,
+                        target, target_disp, nbytes, MPI_BYTE, win);
+    assert(ret == MPI_SUCCESS);
+#else
+    // freeing the type does not affect the pending put
+    MPI_Datatype mpi_type = Type_bytes(nbytes);
+    int ret = MPI_Put(buf, 1, mpi_type, target, target_disp, 1, mpi_type, win);
+    assert(ret == MPI_SUCCESS);
+    Type_free(&mpi_type);
+#endif
+  }
+}
+
+#ifdef COMB_ENABLE_MPI_PARTITIONED
+
+inline void Precv_init(void *buf, int partitions, MPI_Count count, MPI_Datatype mpi_type, int src, int tag, MPI_Comm comm, MPI_Request *request)
+{
+  // LOGPRINTF("MPI_Precv_init rank(w%i) %p[%i][%lli] src(%i) tag(%i)\n", Comm_rank(MPI_COMM_WORLD), buf, partitions, (long long)count, src, tag);
+  int ret = MPI_Precv_init(buf, partitions, count, mpi_type, src, tag, comm, MPI_INFO_NULL, request);
+  assert(ret == MPI_SUCCESS);
+}
+
+inline void Psend_init(const void *buf, int partitions, MPI_Count count, MPI_Datatype mpi_type, int dest, int tag, MPI_Comm comm, MPI_Request *request)
+{
+  // LOGPRINTF("MPI_Psend_init rank(w%i) %p[%i][%lli] dst(%i) tag(%i)\n", Comm_rank(MPI_COMM_WORLD), buf, partitions, (long long)count, dest, tag);
+  int ret = MPI_Psend_init(buf, partitions, count, mpi_type, dest, tag, comm, MPI_INFO_NULL, request);
+  assert(ret == MPI_SUCCESS);
+}
+
+inline void Pready(int partition, MPI_Request request)
+{
+  int ret = MPI_Pready(partition, request);
+  assert(ret == MPI_SUCCESS);
+}
+
+inline bool Parrived(MPI_Request request, int partition)
+{
+  int flag = 0;
+  int ret = MPI_Parrived(request, partition, &flag);
+  assert(ret == MPI_SUCCESS);
+  return flag;
+}
+
+#endif
+
 inline void Wait(MPI_Request *request, MPI_Status *status)
 {
   // LOGPRINTF("MPI_Wait rank(w%i)\n", Comm_rank(MPI_COMM_WORLD));
@@ -222,6 +610,14 @@ inline void Wait(MPI_Request *request, MPI_Status *status)
   assert(ret == MPI_SUCCESS);
 }
 
+inline int Get_count(MPI_Status const* status, MPI_Datatype mpi_type)
+{
+  int count = 0;
+  int ret = MPI_Get_count(status, mpi_type, &count);
+  assert(ret == MPI_SUCCESS);
+  return count;
+}
+
 inline bool Test(MPI_Request *request, MPI_Status *status)
 {
   int completed = 0;
@@ -231,6 +627,16 @@ inline bool Test(MPI_Request *request, MPI_Status *status)
   return completed;
 }
 
+// checks for completion without completing or freeing the request
+inline bool Request_get_status(MPI_Request request, MPI_Status *status)
+{
+  int completed = 0;
+  // LOGPRINTF("MPI_Request_get_status rank(w%i)\n", Comm_rank(MPI_COMM_WORLD));
+  int ret = MPI_Request_get_status(request, &completed, status);
+  assert(ret == MPI_SUCCESS);
+  return completed;
+}
+
 inline int Waitany(int count, MPI_Request *requests, MPI_Status *status)
 {
   int idx = -1;
@@ -0,0 +1,193 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2018-2021, Lawrence Livermore National Security, LLC.
+//
+// Produced at the Lawrence Livermore National Laboratory
+//
+// LLNL-CODE-758885
+//
+// All rights reserved.
+//
+// This file is part of Comb.
+//
+// For details, see https://github.com/LLNL/Comb
+// Please also see the LICENSE file for MIT license.
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef _DO_AUTOTUNE_HPP
+#define _DO_AUTOTUNE_HPP
+
+#include "config.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "comb.hpp"
+#include "CommFactory.hpp"
+
+namespace COMB {
+
+// Pick the post and wait methods and the cutoff with the shortest comm
+// time for a test by successive halving. Every candidate runs the same
+// number of trial cycles, the slower half is dropped using the slowest
+// rank's time so all ranks agree, and the survivors run twice as many
+// cycles until one is left. The chosen settings are stored in comminfo.
+template < typename pol_comm, typename pol_mesh, typename pol_many, typename pol_few >
+void do_autotune(CommContext<pol_comm>& con_comm,
+                 CommInfo& comminfo, MeshInfo& info,
+                 IdxT num_vars,
+                 ExecContext<pol_mesh>& con_mesh, COMB::Allocator& aloc_mesh,
+                 ExecContext<pol_many>& con_many, COMB::Allocator& aloc_many,
+                 ExecContext<pol_few>& con_few,   COMB::Allocator& aloc_few)
+{
+  using comm_type = Comm<pol_many, pol_few, pol_comm>;
+  using method = CommInfo::method;
+
+  Range r0("autotune", Range::green);
+
+  struct candidate
+  {
+    method post_recv;
+    method post_send;
+    method wait_recv;
+    method wait_send;
+    IdxT cutoff_idx;
+    double time;
+  };
+
+  // the cutoff only matters when large and small messages use different
+  // execution policies
+  std::vector<IdxT> cutoffs{comminfo.cutoff};
+  if (!std::is_same<pol_many, pol_few>::value) {
+    cutoffs = {0, comminfo.cutoff, 4*comminfo.cutoff};
+    std::sort(cutoffs.begin(), cutoffs.end());
+    cutoffs.erase(std::unique(cutoffs.begin(), cutoffs.end()), cutoffs.end());
+  }
+
+  // packing and unpacking order every method differently, recvs and
+  // sends are only posted or completed in different sized groups
+  const method all_methods[] = { method::waitany, method::testany,
+                                 method::waitsome, method::testsome,
+                                 method::waitall, method::testall };
+  const method wait_methods[] = { method::waitany, method::waitsome, method::waitall };
+
+  std::vector<candidate> candidates;
+  for (IdxT c = 0; c < (IdxT)cutoffs.size(); ++c) {
+    for (method post_recv : wait_methods) {
+      for (method post_send : all_methods) {
+        for (method wait_recv : all_methods) {
+          for (method wait_send : wait_methods) {
+            candidates.push_back(candidate{post_recv, post_send, wait_recv, wait_send, c, 0.0});
+          }
+        }
+      }
+    }
+  }
+
+  std::vector<MeshData> vars;
+  vars.reserve(num_vars);
+
+  for (IdxT i = 0; i < num_vars; ++i) {
+
+    vars.push_back(MeshData(info, aloc_mesh, comb_variable_type(i)));
+
+    vars[i].allocate();
+
+    con_mesh.for_all_3d(info.len[2],
+                        info.len[1],
+                        info.len[0],
+                        detail::set_n1_3d(vars[i].any_data(), info.stride[1], info.stride[2]));
+  }
+
+  con_mesh.synchronize();
+
+  // one comm per cutoff, the methods are switched between candidates
+  IdxT given_cutoff = comminfo.cutoff;
+  std::vector<std::unique_ptr<comm_type>> comms;
+  for (IdxT cutoff : cutoffs) {
+    comminfo.cutoff = cutoff;
+    comms.emplace_back(new comm_type(con_comm, comminfo, aloc_mesh, aloc_many, aloc_few));
+
+    CommFactory factory(comminfo);
+    for (IdxT i = 0; i < num_vars; ++i) {
+      factory.add_var(vars[i]);
+    }
+    factory.populate(*comms.back(), con_many, con_few);
+
+    // an untimed cycle so the first candidate does not pay for first touch
+    comms.back()->postRecv(con_many, con_few);
+    comms.back()->postSend(con_many, con_few);
+    comms.back()->waitRecv(con_many, con_few);
+    comms.back()->waitSend(con_many, con_few);
+  }
+  comminfo.cutoff = given_cutoff;
+
+  IdxT cycles = comminfo.autotune_cycles;
+  for (IdxT round = 0; candidates.size() > 1; ++round) {
+
+    std::vector<double> times(candidates.size(), 0.0);
+
+    for (IdxT c = 0; c < (IdxT)candidates.size(); ++c) {
+      candidate const& cand = candidates[c];
+      comm_type& comm = *comms[cand.cutoff_idx];
+      comm.post_recv_method = cand.post_recv;
+      comm.post_send_method = cand.post_send;
+      comm.wait_recv_method = cand.wait_recv;
+      comm.wait_send_method = cand.wait_send;
+
+      comm.barrier();
+
+      auto start = std::chrono::high_resolution_clock::now();
+      for (IdxT cycle = 0; cycle < cycles; ++cycle) {
+        comm.postRecv(con_many, con_few);
+        comm.postSend(con_many, con_few);
+        comm.waitRecv(con_many, con_few);
+        comm.waitSend(con_many, con_few);
+      }
+      auto stop = std::chrono::high_resolution_clock::now();
+
+      times[c] = std::chrono::duration<double>(stop - start).count() / cycles;
+    }
+
+    comminfo.max(times.data(), times.size());
+
+    for (IdxT c = 0; c < (IdxT)candidates.size(); ++c) {
+      candidates[c].time = times[c];
+    }
+    std::stable_sort(candidates.begin(), candidates.end(),
+        [](candidate const& lhs, candidate const& rhs) { return lhs.time < rhs.time; });
+
+    fgprintf(FileGroup::summary, "autotune round %li cycles %li candidates %li\n",
+        (long)round, (long)cycles, (long)candidates.size());
+    for (candidate const& cand : candidates) {
+      fgprintf(FileGroup::summary, "autotune: post_recv %-9s post_send %-9s wait_recv %-9s wait_send %-9s cutoff %-6li avg %.9f s\n",
+          CommInfo::method_str(cand.post_recv), CommInfo::method_str(cand.post_send),
+          CommInfo::method_str(cand.wait_recv), CommInfo::method_str(cand.wait_send),
+          (long)cutoffs[cand.cutoff_idx], cand.time);
+    }
+
+    candidates.resize((candidates.size() + 1) / 2);
+    cycles *= 2;
+  }
+
+  candidate const& best = candidates.front();
+  comminfo.post_recv_method = best.post_recv;
+  comminfo.post_send_method = best.post_send;
+  comminfo.wait_recv_method = best.wait_recv;
+  comminfo.wait_send_method = best.wait_send;
+  comminfo.cutoff = cutoffs[best.cutoff_idx];
+
+  fgprintf(FileGroup::all, "Autotune chose post_recv %s post_send %s wait_recv %s wait_send %s cutoff %li\n",
+      CommInfo::method_str(comminfo.post_recv_method), CommInfo::method_str(comminfo.post_send_method),
+      CommInfo::method_str(comminfo.wait_recv_method), CommInfo::method_str(comminfo.wait_send_method),
+      (long)comminfo.cutoff);
+
+  comms.clear();
+  vars.clear();
+}
+
+} // namespace COMB
+
+#endif // _DO_AUTOTUNE_HPP
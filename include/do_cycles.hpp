@@ -16,10 +16,12 @@
 #ifndef _DO_CYCLES_HPP
 #define _DO_CYCLES_HPP
 
+#include <memory>
 #include <type_traits>
 
 #include "comb.hpp"
 #include "CommFactory.hpp"
+#include "do_autotune.hpp"
 
 namespace COMB {
 
@@ -37,6 +39,69 @@ bool should_do_cycles(CommContext<pol_comm>& con_comm_in,
       && aloc_mesh_in.accessible(con_few_in.get())  && aloc_few_in.accessible(con_few_in.get()) ;
 }
 
+// run the overlap stencil on each var over the zones in [lo, hi)
+template < typename pol_mesh >
+void run_stencil(ExecContext<pol_mesh>& con_mesh, MeshInfo const& info, IdxT npoints,
+                 std::vector<MeshData>& vars, std::vector<MeshData>& results,
+                 IdxT ilo, IdxT jlo, IdxT klo, IdxT ihi, IdxT jhi, IdxT khi)
+{
+  if (ilo >= ihi || jlo >= jhi || klo >= khi) return;
+
+  IdxT istride = (info.ghost_widths[0] > 0) ? info.stride[0] : 0;
+  IdxT jstride = (info.ghost_widths[1] > 0) ? info.stride[1] : 0;
+  IdxT kstride = (info.ghost_widths[2] > 0) ? info.stride[2] : 0;
+
+  for (IdxT v = 0; v < (IdxT)vars.size(); ++v) {
+    ::detail::visit_data_type(vars[v].type, [&](auto type) {
+      using T = decltype(type);
+      con_mesh.for_all_3d(khi - klo,
+                          jhi - jlo,
+                          ihi - ilo,
+                          detail::stencil<T>(info.len[0], info.stride[2],
+                                             (T const*)vars[v].data(), (T*)results[v].data(),
+                                             ilo, jlo, klo, istride, jstride, kstride, npoints));
+    });
+  }
+}
+
+// owned zones farther than the ghost width from the ghost zones, their
+// stencil does not read data that is being communicated
+inline void stencil_interior(MeshInfo const& info, IdxT lo[3], IdxT hi[3])
+{
+  for (IdxT dim = 0; dim < 3; ++dim) {
+    lo[dim] = std::min(info.min[dim] + info.ghost_widths[dim], info.max[dim]);
+    hi[dim] = std::max(info.max[dim] - info.ghost_widths[dim], lo[dim]);
+  }
+}
+
+// run the overlap stencil on the interior zones
+template < typename pol_mesh >
+void run_stencil_interior(ExecContext<pol_mesh>& con_mesh, MeshInfo const& info, IdxT npoints,
+                          std::vector<MeshData>& vars, std::vector<MeshData>& results)
+{
+  IdxT lo[3], hi[3];
+  stencil_interior(info, lo, hi);
+  run_stencil(con_mesh, info, npoints, vars, results, lo[0], lo[1], lo[2], hi[0], hi[1], hi[2]);
+}
+
+// run the overlap stencil on the shell of owned zones around the interior,
+// as slabs in k then j then i
+template < typename pol_mesh >
+void run_stencil_boundary(ExecContext<pol_mesh>& con_mesh, MeshInfo const& info, IdxT npoints,
+                          std::vector<MeshData>& vars, std::vector<MeshData>& results)
+{
+  IdxT const* min = info.min;
+  IdxT const* max = info.max;
+  IdxT lo[3], hi[3];
+  stencil_interior(info, lo, hi);
+  run_stencil(con_mesh, info, npoints, vars, results, min[0], min[1], min[2], max[0], max[1], lo[2]);
+  run_stencil(con_mesh, info, npoints, vars, results, min[0], min[1], hi[2],  max[0], max[1], max[2]);
+  run_stencil(con_mesh, info, npoints, vars, results, min[0], min[1], lo[2],  max[0], lo[1],  hi[2]);
+  run_stencil(con_mesh, info, npoints, vars, results, min[0], hi[1],  lo[2],  max[0], max[1], hi[2]);
+  run_stencil(con_mesh, info, npoints, vars, results, min[0], lo[1],  lo[2],  lo[0],  hi[1],  hi[2]);
+  run_stencil(con_mesh, info, npoints, vars, results, hi[0],  lo[1],  lo[2],  max[0], hi[1],  hi[2]);
+}
+
 template < typename pol_comm, typename exec_mesh, typename exec_many, typename exec_few >
 void do_cycles(CommContext<pol_comm>& con_comm_in,
                CommInfo& comm_info, MeshInfo& info,
@@ -76,6 +141,10 @@ void do_cycles(CommContext<pol_comm>& con_comm_in,
                                                         pol_many::get_name(), aloc_many.name(), pol_few::get_name(), aloc_few.name());
   fgprintf(FileGroup::all, "Starting test %s\n", test_name);
 
+  if (comb_print_mempool_stats()) {
+    clear_allocator_statistics(aloc_mesh, aloc_many, aloc_few);
+  }
+
   {
     Range r0(test_name, Range::orange);
 
@@ -101,6 +170,16 @@ void do_cycles(CommContext<pol_comm>& con_comm_in,
 #endif
                                    );
 
+    // pick the methods and cutoff for this test
+    if (comminfo.autotune_cycles > 0) {
+      tm_total.start(tm_con, "autotune");
+
+      do_autotune(con_comm, comminfo, info, num_vars,
+                  con_mesh, aloc_mesh, con_many, aloc_many, con_few, aloc_few);
+
+      tm_total.stop(tm_con);
+    }
+
     // sometimes set cutoff to 0 (always use pol_many) to simplify algorithms
     if (std::is_same<pol_many, pol_few>::value) {
       // check comm send (packing) method
@@ -121,6 +200,20 @@ void do_cycles(CommContext<pol_comm>& con_comm_in,
     // make communicator object
     comm_type comm(con_comm, comminfo, aloc_mesh, aloc_many, aloc_few);
 
+    // optional helper thread that makes progress between post and wait
+    std::unique_ptr<ProgressThread> progress;
+    if (comminfo.progress_thread != CommInfo::progress::off) {
+      progress.reset(new ProgressThread());
+      comm.set_progress_thread(progress.get());
+      if (progress->cpu() >= 0) {
+        fgprintf(FileGroup::proc, "Progress thread %s pinned to cpu %i\n",
+            CommInfo::progress_str(comminfo.progress_thread), progress->cpu());
+      } else {
+        fgprintf(FileGroup::proc, "Progress thread %s not pinned, every cpu runs an openmp thread\n",
+            CommInfo::progress_str(comminfo.progress_thread));
+      }
+    }
+
     comm.barrier();
 
     tm_total.start(tm_con, "start-up");
@@ -128,6 +221,11 @@ void do_cycles(CommContext<pol_comm>& con_comm_in,
     std::vector<MeshData> vars;
     vars.reserve(num_vars);
 
+    // results of the overlap stencil
+    IdxT overlap = comminfo.overlap_stencil;
+    std::vector<MeshData> results;
+    results.reserve((overlap > 0) ? num_vars : 0);
+
     {
       Range r2("setup factory", Range::yellow);
 
@@ -137,18 +235,19 @@ void do_cycles(CommContext<pol_comm>& con_comm_in,
 
       for (IdxT i = 0; i < num_vars; ++i) {
 
-        vars.push_back(MeshData(info, aloc_mesh));
+        vars.push_back(MeshData(info, aloc_mesh, comb_variable_type(i)));
 
         vars[i].allocate();
 
-        DataT* data = vars[i].data();
-        IdxT totallen = info.totallen;
+        con_mesh.for_all_3d(info.len[2],
+                            info.len[1],
+                            info.len[0],
+                            detail::set_n1_3d(vars[i].any_data(), info.stride[1], info.stride[2]));
 
-        con_mesh.for_all(totallen,
-                         [=] COMB_HOST COMB_DEVICE (IdxT i) {
-          // LOGPRINTF("init-var %p[%i] = %f\n", data, i, -1.0);
-          data[i] = -1.0;
-        });
+        if (overlap > 0) {
+          results.push_back(MeshData(info, aloc_mesh, vars[i].type));
+          results[i].allocate();
+        }
 
         factory.add_var(vars[i]);
 
@@ -204,7 +303,7 @@ void do_cycles(CommContext<pol_comm>& con_comm_in,
 
       for (IdxT i = 0; i < num_vars; ++i) {
 
-        DataT* data = vars[i].data();
+        ::detail::any_data_ptr data = vars[i].any_data();
         IdxT var_i = i + 1;
 
         con_mesh.for_all_3d(klen,
@@ -257,7 +356,7 @@ void do_cycles(CommContext<pol_comm>& con_comm_in,
           }
           if (!mock_communication) {
             if (found != expected) {
-              FGPRINTF(FileGroup::proc, "test pre-comm %p %i zone %i(%i %i %i) g%i(%i %i %i) = %f expected %f next %f\n", data, branchid, zone, i, j, k, zone_global, iglobal, jglobal, kglobal, found, expected, next);
+              FGPRINTF(FileGroup::proc, "test pre-comm %p %i zone %li(%li %li %li) g%li(%li %li %li) = %f expected %f next %f\n", data.ptr, branchid, (long)zone, (long)i, (long)j, (long)k, (long)zone_global, (long)iglobal, (long)jglobal, (long)kglobal, found, expected, next);
             }
             // LOGPRINTF("test pre-comm %p[%i]{%f} = %f\n", data, zone, found, next);
             assert(found == expected);
@@ -319,7 +418,7 @@ void do_cycles(CommContext<pol_comm>& con_comm_in,
       //       branchid = 0;
       //       if (!mock_communication) {
       //         if (found != expected) {
-      //           FGPRINTF(FileGroup::proc, "test mid-comm %p %i zone %i(%i %i %i) g%i(%i %i %i) = %f expected %f next %f\n", data, branchid, zone, i, j, k, zone_global, iglobal, jglobal, kglobal, found, expected, next);
+      //           FGPRINTF(FileGroup::proc, "test mid-comm %p %i zone %li(%li %li %li) g%li(%li %li %li) = %f expected %f next %f\n", data, branchid, (long)zone, (long)i, (long)j, (long)k, (long)zone_global, (long)iglobal, (long)jglobal, (long)kglobal, found, expected, next);
       //         }
       //         LOGPRINTF("test mid-comm %p[%i]{%f} = %f\n", data, zone, found, next);
       //         assert(found == expected);
@@ -350,7 +449,7 @@ void do_cycles(CommContext<pol_comm>& con_comm_in,
 
       for (IdxT i = 0; i < num_vars; ++i) {
 
-        DataT* data = vars[i].data();
+        ::detail::any_data_ptr data = vars[i].any_data();
         IdxT var_i = i + 1;
 
         con_mesh.for_all_3d(klen,
@@ -403,7 +502,7 @@ void do_cycles(CommContext<pol_comm>& con_comm_in,
           }
           if (!mock_communication) {
             if (found != expected) {
-              FGPRINTF(FileGroup::proc, "test post-comm %p %i zone %i(%i %i %i) g%i(%i %i %i) = %f expected %f next %f\n", data, branchid, zone, i, j, k, zone_global, iglobal, jglobal, kglobal, found, expected, next);
+              FGPRINTF(FileGroup::proc, "test post-comm %p %i zone %li(%li %li %li) g%li(%li %li %li) = %f expected %f next %f\n", data.ptr, branchid, (long)zone, (long)i, (long)j, (long)k, (long)zone_global, (long)iglobal, (long)jglobal, (long)kglobal, found, expected, next);
             }
             // LOGPRINTF("test post-comm %p[%i]{%p} = %f\n", data, zone, found, next);
             assert(found == expected);
@@ -425,134 +524,219 @@ void do_cycles(CommContext<pol_comm>& con_comm_in,
     tm_total.stop(tm_con);
 
     tm.clear();
+    if (progress) progress->clear();
+
+    // with the overlap stencil run the cycles again with the interior
+    // computed before posting, the comm time the overlap hides is the
+    // difference between the comm times of the two passes
+    Timer tm_seq((overlap > 0) ? 2*12*ncycles : 0);
+    // with a buffer slab run the cycles again allocating the buffers each
+    // cycle, the time the slab saves is the difference between the passes
+    const bool slab = comm.buffer_slab();
+    Timer tm_per_cycle(slab ? 2*12*ncycles : 0);
+    IdxT npasses = 3;
+
+    for (IdxT pass = 0; pass < npasses; ++pass) {
+
+      bool sequential = (pass == 1);
+      bool per_cycle = (pass == 2);
+      if (sequential && overlap <= 0) continue;
+      if (per_cycle && !slab) continue;
+      Timer& tm_pass = sequential ? tm_seq : per_cycle ? tm_per_cycle : tm;
+
+      if (per_cycle) {
+        comm.release_buffer_slab();
+      }
 
-    r1.restart("bench comm", Range::magenta);
+      r1.restart(sequential ? "bench comm sequential" :
+                 per_cycle  ? "bench comm per cycle buffers" : "bench comm", Range::magenta);
 
-    tm_total.start(tm_con, "bench-comm");
+      tm_total.start(tm_con, sequential ? "bench-comm-sequential" :
+                             per_cycle  ? "bench-comm-per-cycle-buffers" : "bench-comm");
 
-    for(IdxT cycle = 0; cycle < ncycles; cycle++) {
+      for(IdxT cycle = 0; cycle < ncycles; cycle++) {
 
-      Range r2("cycle", Range::yellow);
+        Range r2("cycle", Range::yellow);
 
-      IdxT imin = info.min[0];
-      IdxT jmin = info.min[1];
-      IdxT kmin = info.min[2];
-      IdxT imax = info.max[0];
-      IdxT jmax = info.max[1];
-      IdxT kmax = info.max[2];
-      IdxT ilen = info.len[0];
-      IdxT jlen = info.len[1];
-      IdxT klen = info.len[2];
-      IdxT ijlen = info.stride[2];
+        IdxT imin = info.min[0];
+        IdxT jmin = info.min[1];
+        IdxT kmin = info.min[2];
+        IdxT imax = info.max[0];
+        IdxT jmax = info.max[1];
+        IdxT kmax = info.max[2];
+        IdxT ilen = info.len[0];
+        IdxT jlen = info.len[1];
+        IdxT klen = info.len[2];
+        IdxT ijlen = info.stride[2];
 
 
-      Range r3("pre-comm", Range::red);
-      tm.start(tm_con, "pre-comm");
+        Range r3("pre-comm", Range::red);
+        tm_pass.start(tm_con, "pre-comm");
 
-      for (IdxT i = 0; i < num_vars; ++i) {
+        for (IdxT i = 0; i < num_vars; ++i) {
 
-        DataT* data = vars[i].data();
+          DataT* data = vars[i].data();
 
-        // set internal zones to 1
-        con_mesh.for_all_3d(kmax - kmin,
-                            jmax - jmin,
-                            imax - imin,
-                            detail::set_1(ilen, ijlen, data, imin, jmin, kmin));
-      }
+          // set internal zones to 1
+          ::detail::visit_data_type(vars[i].type, [&](auto type) {
+            using T = decltype(type);
+            con_mesh.for_all_3d(kmax - kmin,
+                                jmax - jmin,
+                                imax - imin,
+                                detail::set_1<T>(ilen, ijlen, (T*)data, imin, jmin, kmin));
+          });
+        }
 
-      con_mesh.synchronize();
+        con_mesh.synchronize();
 
-      tm.stop(tm_con);
-      r3.restart("post-recv", Range::pink);
-      tm.start(tm_con, "post-recv");
+        tm_pass.stop(tm_con);
 
-      comm.postRecv(con_many, con_few);
+        if (sequential) {
+          r3.restart("interior", Range::red);
+          tm_pass.start(tm_con, "interior");
 
-      tm.stop(tm_con);
-      r3.restart("post-send", Range::pink);
-      tm.start(tm_con, "post-send");
+          run_stencil_interior(con_mesh, info, overlap, vars, results);
 
-      comm.postSend(con_many, con_few);
+          con_mesh.synchronize();
 
-      tm.stop(tm_con);
-      r3.stop();
+          tm_pass.stop(tm_con);
+        }
 
-      /*
-      for (IdxT i = 0; i < num_vars; ++i) {
+        r3.restart("post-recv", Range::pink);
+        tm_pass.start(tm_con, "post-recv");
 
-        DataT* data = vars[i].data();
+        comm.postRecv(con_many, con_few);
 
-        con_mesh.for_all_3d(klen,
-                            jlen,
-                            ilen,
-                            [=] COMB_HOST COMB_DEVICE (IdxT k, IdxT j, IdxT i) {
-          IdxT zone = i + j * ilen + k * ijlen;
-          DataT expected, found, next;
-          if (k >= kmin && k < kmax &&
-              j >= jmin && j < jmax &&
-              i >= imin && i < imax) {
-            expected = 1.0; found = data[zone]; next = 1.0;
-          } else {
-            expected = -1.0; found = data[zone]; next = -1.0;
-          }
-          // if (found != expected) {
-          //   FGPRINTF(FileGroup::proc, "zone %i(%i %i %i) = %f expected %f\n", zone, i, j, k, found, expected);
-          // }
-          // LOGPRINTF("%p[%i] = %f\n", data, zone, 1.0);
-          data[zone] = next;
-        });
-      }
-      */
+        tm_pass.stop(tm_con);
+        r3.restart("post-send", Range::pink);
+        tm_pass.start(tm_con, "post-send");
 
-      r3.start("wait-recv", Range::pink);
-      tm.start(tm_con, "wait-recv");
+        comm.postSend(con_many, con_few);
 
-      comm.waitRecv(con_many, con_few);
+        tm_pass.stop(tm_con);
+        tm_pass.add("pack-streamed", comm.pack_times().streamed);
+        tm_pass.add("pack-cached", comm.pack_times().cached);
+        r3.stop();
 
-      tm.stop(tm_con);
-      r3.restart("wait-send", Range::pink);
-      tm.start(tm_con, "wait-send");
+        if (overlap > 0 && !sequential) {
+          r3.start("interior", Range::red);
+          tm_pass.start(tm_con, "interior");
 
-      comm.waitSend(con_many, con_few);
+          run_stencil_interior(con_mesh, info, overlap, vars, results);
 
-      tm.stop(tm_con);
-      r3.restart("post-comm", Range::red);
-      tm.start(tm_con, "post-comm");
+          con_mesh.synchronize();
 
-      for (IdxT i = 0; i < num_vars; ++i) {
+          tm_pass.stop(tm_con);
+          r3.stop();
+        }
 
-        DataT* data = vars[i].data();
+        /*
+        for (IdxT i = 0; i < num_vars; ++i) {
 
-        // set all zones to 1
-        con_mesh.for_all_3d(klen,
-                            jlen,
-                            ilen,
-                            detail::set_1(ilen, ijlen, data, 0, 0, 0));
-      }
+          DataT* data = vars[i].data();
 
-      con_mesh.synchronize();
+          con_mesh.for_all_3d(klen,
+                              jlen,
+                              ilen,
+                              [=] COMB_HOST COMB_DEVICE (IdxT k, IdxT j, IdxT i) {
+            IdxT zone = i + j * ilen + k * ijlen;
+            DataT expected, found, next;
+            if (k >= kmin && k < kmax &&
+                j >= jmin && j < jmax &&
+                i >= imin && i < imax) {
+              expected = 1.0; found = data[zone]; next = 1.0;
+            } else {
+              expected = -1.0; found = data[zone]; next = -1.0;
+            }
+            // if (found != expected) {
+            //   FGPRINTF(FileGroup::proc, "zone %i(%i %i %i) = %f expected %f\n", zone, i, j, k, found, expected);
+            // }
+            // LOGPRINTF("%p[%i] = %f\n", data, zone, 1.0);
+            data[zone] = next;
+          });
+        }
+        */
 
-      tm.stop(tm_con);
-      r3.stop();
+        r3.start("wait-recv", Range::pink);
+        tm_pass.start(tm_con, "wait-recv");
 
-      r2.stop();
+        comm.waitRecv(con_many, con_few);
 
-    }
+        tm_pass.stop(tm_con);
+        tm_pass.add("unpack-streamed", comm.unpack_times().streamed);
+        tm_pass.add("unpack-cached", comm.unpack_times().cached);
 
-    comm.barrier();
+        if (overlap > 0) {
+          r3.restart("boundary", Range::red);
+          tm_pass.start(tm_con, "boundary");
+
+          run_stencil_boundary(con_mesh, info, overlap, vars, results);
+
+          con_mesh.synchronize();
+
+          tm_pass.stop(tm_con);
+        }
+
+        r3.restart("wait-send", Range::pink);
+        tm_pass.start(tm_con, "wait-send");
+
+        comm.waitSend(con_many, con_few);
+
+        tm_pass.stop(tm_con);
+        r3.restart("post-comm", Range::red);
+        tm_pass.start(tm_con, "post-comm");
+
+        for (IdxT i = 0; i < num_vars; ++i) {
+
+          DataT* data = vars[i].data();
+
+          // set all zones to 1
+          ::detail::visit_data_type(vars[i].type, [&](auto type) {
+            using T = decltype(type);
+            con_mesh.for_all_3d(klen,
+                                jlen,
+                                ilen,
+                                detail::set_1<T>(ilen, ijlen, (T*)data, 0, 0, 0));
+          });
+        }
+
+        con_mesh.synchronize();
+
+        tm_pass.stop(tm_con);
+        r3.stop();
+
+        r2.stop();
+
+      }
 
-    tm_total.stop(tm_con);
+
+      comm.barrier();
+
+      tm_total.stop(tm_con);
+    }
 
     r1.stop();
 
     print_timer(comminfo, tm);
+    if (progress) print_progress(comminfo, *progress);
+    if (overlap > 0) {
+      print_timer(comminfo, tm_seq, "sequential-");
+      print_overlap(comminfo, tm, tm_seq);
+    }
+    if (slab) {
+      print_timer(comminfo, tm_per_cycle, "per-cycle-buffers-");
+      print_buffer_slab(comminfo, tm, tm_per_cycle);
+    }
     print_timer(comminfo, tm_total);
   }
 
   tm.clear();
   tm_total.clear();
 
-  // print_proc_memory_stats(comminfo);
+  if (comb_print_mempool_stats()) {
+    print_proc_memory_stats();
+    print_allocator_statistics(aloc_mesh, aloc_many, aloc_few);
+  }
 }
 
 } // namespace COMB
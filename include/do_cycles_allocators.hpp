@@ -161,6 +161,13 @@ void do_cycles_allocator(CommContext<comm_pol>& con_comm,
 }
 
 
+// host buffers follow a mesh on huge, locked, or numa placed pages into
+// the same memory space
+inline AllocatorInfo& host_space_aloc(Allocators& alloc, AllocatorInfo& pages_aloc, AllocatorInfo& aloc)
+{
+  return (&aloc == &alloc.host) ? pages_aloc : aloc;
+}
+
 template < typename comm_pol >
 void do_cycles_allocators(CommContext<comm_pol>& con_comm,
                           CommInfo& comminfo, MeshInfo& info,
@@ -178,6 +185,51 @@ void do_cycles_allocators(CommContext<comm_pol>& con_comm,
                       cuda_many_aloc, cuda_few_aloc,
                       num_vars, ncycles, tm, tm_total);
 
+  do_cycles_allocator(con_comm,
+                      comminfo, info,
+                      exec,
+                      alloc.host_hugepage,
+                      host_space_aloc(alloc, alloc.host_hugepage, cpu_many_aloc),
+                      host_space_aloc(alloc, alloc.host_hugepage, cpu_few_aloc),
+                      cuda_many_aloc, cuda_few_aloc,
+                      num_vars, ncycles, tm, tm_total);
+
+  do_cycles_allocator(con_comm,
+                      comminfo, info,
+                      exec,
+                      alloc.host_locked,
+                      host_space_aloc(alloc, alloc.host_locked, cpu_many_aloc),
+                      host_space_aloc(alloc, alloc.host_locked, cpu_few_aloc),
+                      cuda_many_aloc, cuda_few_aloc,
+                      num_vars, ncycles, tm, tm_total);
+
+  do_cycles_allocator(con_comm,
+                      comminfo, info,
+                      exec,
+                      alloc.host_numa_local,
+                      host_space_aloc(alloc, alloc.host_numa_local, cpu_many_aloc),
+                      host_space_aloc(alloc, alloc.host_numa_local, cpu_few_aloc),
+                      cuda_many_aloc, cuda_few_aloc,
+                      num_vars, ncycles, tm, tm_total);
+
+  do_cycles_allocator(con_comm,
+                      comminfo, info,
+                      exec,
+                      alloc.host_numa_interleave,
+                      host_space_aloc(alloc, alloc.host_numa_interleave, cpu_many_aloc),
+                      host_space_aloc(alloc, alloc.host_numa_interleave, cpu_few_aloc),
+                      cuda_many_aloc, cuda_few_aloc,
+                      num_vars, ncycles, tm, tm_total);
+
+  do_cycles_allocator(con_comm,
+                      comminfo, info,
+                      exec,
+                      alloc.host_numa_bind,
+                      host_space_aloc(alloc, alloc.host_numa_bind, cpu_many_aloc),
+                      host_space_aloc(alloc, alloc.host_numa_bind, cpu_few_aloc),
+                      cuda_many_aloc, cuda_few_aloc,
+                      num_vars, ncycles, tm, tm_total);
+
 #ifdef COMB_ENABLE_CUDA
 
   do_cycles_allocator(con_comm,
@@ -26,6 +26,7 @@
 #include "memory.hpp"
 #include "ExecContext.hpp"
 #include "exec_utils.hpp"
+#include "exec_simd.hpp"
 
 
 inline bool& comb_allow_per_message_pack_fusing()
@@ -40,6 +41,68 @@ inline bool& comb_allow_pack_loop_fusion()
   return allow;
 }
 
+inline bool& comb_allow_structured_packing()
+{
+  static bool allow = false;
+  return allow;
+}
+
+inline bool& comb_allow_span_packing()
+{
+  static bool allow = false;
+  return allow;
+}
+
+inline bool& comb_allow_multi_variable_pack_fusing()
+{
+  static bool allow = false;
+  return allow;
+}
+
+inline bool& comb_allow_specialized_pack_kernels()
+{
+  static bool allow = true;
+  return allow;
+}
+
+inline bool& comb_allow_per_thread_comms()
+{
+  static bool allow = false;
+  return allow;
+}
+
+inline bool& comb_allow_persistent_buffers()
+{
+  static bool allow = false;
+  return allow;
+}
+
+namespace detail {
+
+// order of data in message buffers, variable major stores all zones of
+// one variable together, zone major stores all variables of one zone together
+enum struct message_layout {
+  variable_major
+ ,zone_major
+};
+
+inline const char* message_layout_str(message_layout layout)
+{
+  switch (layout) {
+    case message_layout::variable_major: return "variable_major";
+    case message_layout::zone_major:     return "zone_major";
+  }
+  return "unknown";
+}
+
+} // namespace detail
+
+inline detail::message_layout& comb_message_layout()
+{
+  static detail::message_layout layout = detail::message_layout::variable_major;
+  return layout;
+}
+
 namespace detail {
 
 template < typename body_type >
@@ -102,29 +165,42 @@ struct adapter_3d {
 
 struct fused_packer
 {
-  DataT const** srcs;
-  DataT**       bufs;
-  LidxT const** idxs;
-  IdxT const*   lens;
+  DataT const**       srcs;
+  DataT**             bufs;
+  LidxT const**       idxs;
+  index_span const**  spanss;
+  box_rows const*     boxes;
+  IdxT const*         lens;
+  IdxT const*         loop_lens;
 
-  DataT const* src = nullptr;
-  DataT*       bufk = nullptr;
-  DataT*       buf = nullptr;
-  LidxT const* idx = nullptr;
-  IdxT         len = 0;
+  DataT const*      src = nullptr;
+  DataT*            bufk = nullptr;
+  DataT*            buf = nullptr;
+  LidxT const*      idx = nullptr;
+  index_span const* spans = nullptr;
+  box_rows          box;
+  IdxT              nitems = 0;
+  IdxT              len = 0;
 
-  fused_packer(DataT const** srcs_, DataT** bufs_, LidxT const** idxs_, IdxT const* lens_)
+  fused_packer(DataT const** srcs_, DataT** bufs_, LidxT const** idxs_, index_span const** spanss_, box_rows const* boxes_, IdxT const* lens_, IdxT const* loop_lens_)
     : srcs(srcs_)
     , bufs(bufs_)
     , idxs(idxs_)
+    , spanss(spanss_)
+    , boxes(boxes_)
     , lens(lens_)
+    , loop_lens(loop_lens_)
   { }
 
+  // loops without idx iterate over spans if present, otherwise over the rows of box
   COMB_HOST COMB_DEVICE
   void set_outer(IdxT k)
   {
-    len = lens[k];
+    nitems = lens[k];
     idx = idxs[k];
+    spans = spanss[k];
+    box = boxes[k];
+    len = loop_lens[k];
     bufk = bufs[k];
   }
 
@@ -132,7 +208,7 @@ struct fused_packer
   void set_inner(IdxT j)
   {
     src = srcs[j];
-    buf = bufk + j*len;
+    buf = bufk + j*nitems;
   }
 
   // must be run for all i in [0, len)
@@ -142,35 +218,55 @@ struct fused_packer
     // if (i == 0) {
     //   LOGPRINTF("fused_packer buf %p, src %p, idx %p, len %i\n", buf, src, idx, len); FFLUSH(stdout);
     // }
-    buf[i] = src[idx[i]];
+    if (idx) {
+      buf[i] = src[idx[i]];
+    } else if (spans) {
+      index_span span = spans[i];
+      copy_row(buf + span.offset, src + span.start, span.len);
+    } else {
+      copy_row(buf + i*box.ilen, src + box.row(i), box.ilen);
+    }
   }
 };
 
 struct fused_unpacker
 {
-  DataT**       dsts;
-  DataT const** bufs;
-  LidxT const** idxs;
-  IdxT  const*  lens;
+  DataT**             dsts;
+  DataT const**       bufs;
+  LidxT const**       idxs;
+  index_span const**  spanss;
+  box_rows const*     boxes;
+  IdxT  const*        lens;
+  IdxT  const*        loop_lens;
 
-  DataT*       dst = nullptr;
-  DataT const* bufk = nullptr;
-  DataT const* buf = nullptr;
-  LidxT const* idx = nullptr;
-  IdxT         len = 0;
+  DataT*            dst = nullptr;
+  DataT const*      bufk = nullptr;
+  DataT const*      buf = nullptr;
+  LidxT const*      idx = nullptr;
+  index_span const* spans = nullptr;
+  box_rows          box;
+  IdxT              nitems = 0;
+  IdxT              len = 0;
 
-  fused_unpacker(DataT** dsts_, DataT const** bufs_, LidxT const** idxs_, IdxT const* lens_)
+  fused_unpacker(DataT** dsts_, DataT const** bufs_, LidxT const** idxs_, index_span const** spanss_, box_rows const* boxes_, IdxT const* lens_, IdxT const* loop_lens_)
     : dsts(dsts_)
     , bufs(bufs_)
     , idxs(idxs_)
+    , spanss(spanss_)
+    , boxes(boxes_)
     , lens(lens_)
+    , loop_lens(loop_lens_)
   { }
 
+  // loops without idx iterate over spans if present, otherwise over the rows of box
   COMB_HOST COMB_DEVICE
   void set_outer(IdxT k)
   {
-    len = lens[k];
+    nitems = lens[k];
     idx = idxs[k];
+    spans = spanss[k];
+    box = boxes[k];
+    len = loop_lens[k];
     bufk = bufs[k];
   }
 
@@ -178,7 +274,7 @@ struct fused_unpacker
   void set_inner(IdxT j)
   {
     dst = dsts[j];
-    buf = bufk + j*len;
+    buf = bufk + j*nitems;
   }
 
   // must be run for all i in [0, len)
@@ -188,10 +284,596 @@ struct fused_unpacker
     // if (i == 0) {
     //   LOGPRINTF("fused_packer buf %p, dst %p, idx %p, len %i\n", buf, dst, idx, len); FFLUSH(stdout);
     // }
-    dst[idx[i]] = buf[i];
+    if (idx) {
+      dst[idx[i]] = buf[i];
+    } else if (spans) {
+      index_span span = spans[i];
+      copy_row(dst + span.start, buf + span.offset, span.len);
+    } else {
+      copy_row(dst + box.row(i), buf + i*box.ilen, box.ilen);
+    }
+  }
+};
+
+// number of variables handled in one pass by the multi variable fused
+// loops, keeps the number of concurrent write streams within what the
+// cache and hardware prefetchers can track
+constexpr IdxT fused_multi_vars_per_block = 8;
+
+// packs a block of variables in one pass over each item, so each index
+// is read once per block instead of once per variable
+struct fused_multi_packer
+{
+  DataT const**       srcs;
+  IdxT                num_vars;
+  DataT**             bufs;
+  LidxT const**       idxs;
+  index_span const**  spanss;
+  box_rows const*     boxes;
+  IdxT const*         lens;
+  IdxT const*         loop_lens;
+
+  DataT const* const* src_block = nullptr;
+  IdxT                num_block_vars = 0;
+  DataT*              bufk = nullptr;
+  DataT*              buf = nullptr;
+  LidxT const*        idx = nullptr;
+  index_span const*   spans = nullptr;
+  box_rows            box;
+  IdxT                nitems = 0;
+  IdxT                len = 0;
+
+  fused_multi_packer(DataT const** srcs_, IdxT num_vars_, DataT** bufs_, LidxT const** idxs_, index_span const** spanss_, box_rows const* boxes_, IdxT const* lens_, IdxT const* loop_lens_)
+    : srcs(srcs_)
+    , num_vars(num_vars_)
+    , bufs(bufs_)
+    , idxs(idxs_)
+    , spanss(spanss_)
+    , boxes(boxes_)
+    , lens(lens_)
+    , loop_lens(loop_lens_)
+  { }
+
+  static IdxT num_blocks(IdxT num_vars)
+  {
+    return (num_vars + fused_multi_vars_per_block - 1) / fused_multi_vars_per_block;
+  }
+
+  COMB_HOST COMB_DEVICE
+  void set_outer(IdxT k)
+  {
+    nitems = lens[k];
+    idx = idxs[k];
+    spans = spanss[k];
+    box = boxes[k];
+    len = loop_lens[k];
+    bufk = bufs[k];
+  }
+
+  COMB_HOST COMB_DEVICE
+  void set_inner(IdxT b)
+  {
+    IdxT v_begin = b*fused_multi_vars_per_block;
+    src_block = srcs + v_begin;
+    num_block_vars = (num_vars - v_begin < fused_multi_vars_per_block) ? num_vars - v_begin
+                                                                       : fused_multi_vars_per_block;
+    buf = bufk + v_begin*nitems;
+  }
+
+  // must be run for all i in [0, len)
+  COMB_HOST COMB_DEVICE
+  void operator()(IdxT i)
+  {
+    if (idx) {
+      IdxT mesh_i = idx[i];
+      for (IdxT v = 0; v < num_block_vars; ++v) {
+        buf[v*nitems + i] = src_block[v][mesh_i];
+      }
+    } else if (spans) {
+      index_span span = spans[i];
+      for (IdxT v = 0; v < num_block_vars; ++v) {
+        copy_row(buf + v*nitems + span.offset, src_block[v] + span.start, span.len);
+      }
+    } else {
+      IdxT mesh_i = box.row(i);
+      for (IdxT v = 0; v < num_block_vars; ++v) {
+        copy_row(buf + v*nitems + i*box.ilen, src_block[v] + mesh_i, box.ilen);
+      }
+    }
+  }
+};
+
+// unpacks a block of variables in one pass over each item, so each index
+// is read once per block instead of once per variable
+struct fused_multi_unpacker
+{
+  DataT**             dsts;
+  IdxT                num_vars;
+  DataT const**       bufs;
+  LidxT const**       idxs;
+  index_span const**  spanss;
+  box_rows const*     boxes;
+  IdxT const*         lens;
+  IdxT const*         loop_lens;
+
+  DataT* const*       dst_block = nullptr;
+  IdxT                num_block_vars = 0;
+  DataT const*        bufk = nullptr;
+  DataT const*        buf = nullptr;
+  LidxT const*        idx = nullptr;
+  index_span const*   spans = nullptr;
+  box_rows            box;
+  IdxT                nitems = 0;
+  IdxT                len = 0;
+
+  fused_multi_unpacker(DataT** dsts_, IdxT num_vars_, DataT const** bufs_, LidxT const** idxs_, index_span const** spanss_, box_rows const* boxes_, IdxT const* lens_, IdxT const* loop_lens_)
+    : dsts(dsts_)
+    , num_vars(num_vars_)
+    , bufs(bufs_)
+    , idxs(idxs_)
+    , spanss(spanss_)
+    , boxes(boxes_)
+    , lens(lens_)
+    , loop_lens(loop_lens_)
+  { }
+
+  static IdxT num_blocks(IdxT num_vars)
+  {
+    return (num_vars + fused_multi_vars_per_block - 1) / fused_multi_vars_per_block;
+  }
+
+  COMB_HOST COMB_DEVICE
+  void set_outer(IdxT k)
+  {
+    nitems = lens[k];
+    idx = idxs[k];
+    spans = spanss[k];
+    box = boxes[k];
+    len = loop_lens[k];
+    bufk = bufs[k];
+  }
+
+  COMB_HOST COMB_DEVICE
+  void set_inner(IdxT b)
+  {
+    IdxT v_begin = b*fused_multi_vars_per_block;
+    dst_block = dsts + v_begin;
+    num_block_vars = (num_vars - v_begin < fused_multi_vars_per_block) ? num_vars - v_begin
+                                                                       : fused_multi_vars_per_block;
+    buf = bufk + v_begin*nitems;
+  }
+
+  // must be run for all i in [0, len)
+  COMB_HOST COMB_DEVICE
+  void operator()(IdxT i)
+  {
+    if (idx) {
+      IdxT mesh_i = idx[i];
+      for (IdxT v = 0; v < num_block_vars; ++v) {
+        dst_block[v][mesh_i] = buf[v*nitems + i];
+      }
+    } else if (spans) {
+      index_span span = spans[i];
+      for (IdxT v = 0; v < num_block_vars; ++v) {
+        copy_row(dst_block[v] + span.start, buf + v*nitems + span.offset, span.len);
+      }
+    } else {
+      IdxT mesh_i = box.row(i);
+      for (IdxT v = 0; v < num_block_vars; ++v) {
+        copy_row(dst_block[v] + mesh_i, buf + v*nitems + i*box.ilen, box.ilen);
+      }
+    }
+  }
+};
+
+// packs all variables of each zone together, so the inner loop over
+// variables has a single iteration
+struct fused_zone_packer
+{
+  DataT**             bufs;
+  LidxT const**       idxs;
+  index_span const**  spanss;
+  box_rows const*     boxes;
+  IdxT const*         loop_lens;
+
+  pack_zones<DataT> kernel;
+  LidxT const*      idx = nullptr;
+  index_span const* spans = nullptr;
+  box_rows          box;
+  IdxT              len = 0;
+
+  fused_zone_packer(DataT const** srcs_, IdxT num_vars_, DataT** bufs_, LidxT const** idxs_, index_span const** spanss_, box_rows const* boxes_, IdxT const* loop_lens_)
+    : bufs(bufs_)
+    , idxs(idxs_)
+    , spanss(spanss_)
+    , boxes(boxes_)
+    , loop_lens(loop_lens_)
+    , kernel{srcs_, num_vars_, nullptr}
+  { }
+
+  COMB_HOST COMB_DEVICE
+  void set_outer(IdxT k)
+  {
+    idx = idxs[k];
+    spans = spanss[k];
+    box = boxes[k];
+    len = loop_lens[k];
+    kernel.buf = bufs[k];
+  }
+
+  COMB_HOST COMB_DEVICE
+  void set_inner(IdxT /*j*/)
+  {
+  }
+
+  // must be run for all i in [0, len)
+  COMB_HOST COMB_DEVICE
+  void operator()(IdxT i)
+  {
+    if (idx) {
+      kernel.copy(i, idx[i]);
+    } else if (spans) {
+      index_span span = spans[i];
+      kernel.copy_run(span.offset, span.start, span.len);
+    } else {
+      kernel.copy_run(i*box.ilen, box.row(i), box.ilen);
+    }
+  }
+};
+
+// unpacks all variables of each zone together, so the inner loop over
+// variables has a single iteration
+struct fused_zone_unpacker
+{
+  DataT const**       bufs;
+  LidxT const**       idxs;
+  index_span const**  spanss;
+  box_rows const*     boxes;
+  IdxT const*         loop_lens;
+
+  unpack_zones<DataT> kernel;
+  LidxT const*        idx = nullptr;
+  index_span const*   spans = nullptr;
+  box_rows            box;
+  IdxT                len = 0;
+
+  fused_zone_unpacker(DataT** dsts_, IdxT num_vars_, DataT const** bufs_, LidxT const** idxs_, index_span const** spanss_, box_rows const* boxes_, IdxT const* loop_lens_)
+    : bufs(bufs_)
+    , idxs(idxs_)
+    , spanss(spanss_)
+    , boxes(boxes_)
+    , loop_lens(loop_lens_)
+    , kernel{dsts_, num_vars_, nullptr}
+  { }
+
+  COMB_HOST COMB_DEVICE
+  void set_outer(IdxT k)
+  {
+    idx = idxs[k];
+    spans = spanss[k];
+    box = boxes[k];
+    len = loop_lens[k];
+    kernel.buf = bufs[k];
+  }
+
+  COMB_HOST COMB_DEVICE
+  void set_inner(IdxT /*j*/)
+  {
+  }
+
+  // must be run for all i in [0, len)
+  COMB_HOST COMB_DEVICE
+  void operator()(IdxT i)
+  {
+    if (idx) {
+      kernel.copy(i, idx[i]);
+    } else if (spans) {
+      index_span span = spans[i];
+      kernel.copy_run(span.offset, span.start, span.len);
+    } else {
+      kernel.copy_run(i*box.ilen, box.row(i), box.ilen);
+    }
+  }
+};
+
+// copy a row whose length is known at compile time
+template < IdxT width, typename T >
+COMB_HOST COMB_DEVICE
+inline void copy_row_fixed(T* COMB_RESTRICT dst, T const* COMB_RESTRICT src)
+{
+  for (IdxT i = 0; i < width; ++i) {
+    dst[i] = src[i];
+  }
+}
+
+// packs all num_vars variables in one pass over each item,
+// rows of length width are copied with fully unrolled loops
+template < IdxT num_vars, IdxT width >
+struct fused_fixed_packer
+{
+  DataT*const*        bufs;
+  LidxT const**       idxs;
+  index_span const**  spanss;
+  box_rows const*     boxes;
+  IdxT const*         lens;
+  IdxT const*         loop_lens;
+
+  DataT const*        srcs[num_vars];
+  DataT*              buf = nullptr;
+  LidxT const*        idx = nullptr;
+  index_span const*   spans = nullptr;
+  box_rows            box;
+  IdxT                nitems = 0;
+  IdxT                len = 0;
+
+  fused_fixed_packer(DataT const* const* srcs_, DataT*const* bufs_, LidxT const** idxs_, index_span const** spanss_, box_rows const* boxes_, IdxT const* lens_, IdxT const* loop_lens_)
+    : bufs(bufs_)
+    , idxs(idxs_)
+    , spanss(spanss_)
+    , boxes(boxes_)
+    , lens(lens_)
+    , loop_lens(loop_lens_)
+  {
+    for (IdxT v = 0; v < num_vars; ++v) {
+      srcs[v] = srcs_[v];
+    }
+  }
+
+  COMB_HOST COMB_DEVICE
+  void set_outer(IdxT k)
+  {
+    nitems = lens[k];
+    idx = idxs[k];
+    spans = spanss[k];
+    box = boxes[k];
+    len = loop_lens[k];
+    buf = bufs[k];
+  }
+
+  COMB_HOST COMB_DEVICE
+  void set_inner(IdxT /*j*/)
+  {
+  }
+
+  // must be run for all i in [0, len)
+  COMB_HOST COMB_DEVICE
+  void operator()(IdxT i)
+  {
+    if (idx) {
+      IdxT mesh_i = idx[i];
+      for (IdxT v = 0; v < num_vars; ++v) {
+        buf[v*nitems + i] = srcs[v][mesh_i];
+      }
+    } else if (spans) {
+      index_span span = spans[i];
+      if (span.len == width) {
+        for (IdxT v = 0; v < num_vars; ++v) {
+          copy_row_fixed<width>(buf + v*nitems + span.offset, srcs[v] + span.start);
+        }
+      } else {
+        for (IdxT v = 0; v < num_vars; ++v) {
+          copy_row(buf + v*nitems + span.offset, srcs[v] + span.start, span.len);
+        }
+      }
+    } else {
+      IdxT mesh_i = box.row(i);
+      if (box.ilen == width) {
+        for (IdxT v = 0; v < num_vars; ++v) {
+          copy_row_fixed<width>(buf + v*nitems + i*width, srcs[v] + mesh_i);
+        }
+      } else {
+        for (IdxT v = 0; v < num_vars; ++v) {
+          copy_row(buf + v*nitems + i*box.ilen, srcs[v] + mesh_i, box.ilen);
+        }
+      }
+    }
+  }
+};
+
+template < IdxT num_vars, IdxT width >
+struct fused_fixed_unpacker
+{
+  DataT const*const*  bufs;
+  LidxT const**       idxs;
+  index_span const**  spanss;
+  box_rows const*     boxes;
+  IdxT const*         lens;
+  IdxT const*         loop_lens;
+
+  DataT*              dsts[num_vars];
+  DataT const*        buf = nullptr;
+  LidxT const*        idx = nullptr;
+  index_span const*   spans = nullptr;
+  box_rows            box;
+  IdxT                nitems = 0;
+  IdxT                len = 0;
+
+  fused_fixed_unpacker(DataT* const* dsts_, DataT const*const* bufs_, LidxT const** idxs_, index_span const** spanss_, box_rows const* boxes_, IdxT const* lens_, IdxT const* loop_lens_)
+    : bufs(bufs_)
+    , idxs(idxs_)
+    , spanss(spanss_)
+    , boxes(boxes_)
+    , lens(lens_)
+    , loop_lens(loop_lens_)
+  {
+    for (IdxT v = 0; v < num_vars; ++v) {
+      dsts[v] = dsts_[v];
+    }
+  }
+
+  COMB_HOST COMB_DEVICE
+  void set_outer(IdxT k)
+  {
+    nitems = lens[k];
+    idx = idxs[k];
+    spans = spanss[k];
+    box = boxes[k];
+    len = loop_lens[k];
+    buf = bufs[k];
+  }
+
+  COMB_HOST COMB_DEVICE
+  void set_inner(IdxT /*j*/)
+  {
+  }
+
+  // must be run for all i in [0, len)
+  COMB_HOST COMB_DEVICE
+  void operator()(IdxT i)
+  {
+    if (idx) {
+      IdxT mesh_i = idx[i];
+      for (IdxT v = 0; v < num_vars; ++v) {
+        dsts[v][mesh_i] = buf[v*nitems + i];
+      }
+    } else if (spans) {
+      index_span span = spans[i];
+      if (span.len == width) {
+        for (IdxT v = 0; v < num_vars; ++v) {
+          copy_row_fixed<width>(dsts[v] + span.start, buf + v*nitems + span.offset);
+        }
+      } else {
+        for (IdxT v = 0; v < num_vars; ++v) {
+          copy_row(dsts[v] + span.start, buf + v*nitems + span.offset, span.len);
+        }
+      }
+    } else {
+      IdxT mesh_i = box.row(i);
+      if (box.ilen == width) {
+        for (IdxT v = 0; v < num_vars; ++v) {
+          copy_row_fixed<width>(dsts[v] + mesh_i, buf + v*nitems + i*width);
+        }
+      } else {
+        for (IdxT v = 0; v < num_vars; ++v) {
+          copy_row(dsts[v] + mesh_i, buf + v*nitems + i*box.ilen, box.ilen);
+        }
+      }
+    }
+  }
+};
+
+// run all iterations of a fused loop body on the host
+template < typename body_type >
+inline void fused_run_host(body_type& body)
+{
+  for (IdxT i = 0; i < body.len; ++i) {
+    body(i);
+  }
+}
+
+inline void fused_run_host(fused_packer& body)
+{
+  if (body.idx) {
+    simd::gather(body.buf, body.src, body.idx, body.len);
+  } else {
+    for (IdxT i = 0; i < body.len; ++i) {
+      body(i);
+    }
+  }
+}
+
+inline void fused_run_host(fused_unpacker& body)
+{
+  if (body.idx) {
+    simd::scatter(body.dst, body.idx, body.buf, body.len);
+  } else {
+    for (IdxT i = 0; i < body.len; ++i) {
+      body(i);
+    }
   }
+}
+
+
+// fused pack and unpack loops over all items for a fixed number of variables
+// and row width, these are explicitly instantiated for the cpu contexts
+// in fused_kernels.cpp.in
+template < typename context_type, IdxT num_vars, IdxT width >
+struct fused_fixed_kernels
+{
+  static void pack(context_type& con, IdxT num_loops, IdxT len_hint,
+                   DataT const* const* srcs, DataT* const* bufs,
+                   LidxT const** idxs, index_span const** spanss, box_rows const* boxes,
+                   IdxT const* lens, IdxT const* loop_lens);
+
+  static void unpack(context_type& con, IdxT num_loops, IdxT len_hint,
+                     DataT* const* dsts, DataT const* const* bufs,
+                     LidxT const** idxs, index_span const** spanss, box_rows const* boxes,
+                     IdxT const* lens, IdxT const* loop_lens);
 };
 
+template < typename context_type >
+using fused_fixed_pack_fn = void(*)(context_type&, IdxT, IdxT,
+                                    DataT const* const*, DataT* const*,
+                                    LidxT const**, index_span const**, box_rows const*,
+                                    IdxT const*, IdxT const*);
+
+template < typename context_type >
+using fused_fixed_unpack_fn = void(*)(context_type&, IdxT, IdxT,
+                                      DataT* const*, DataT const* const*,
+                                      LidxT const**, index_span const**, box_rows const*,
+                                      IdxT const*, IdxT const*);
+
+// specialized kernels exist for 1, 3, 5, and 8 variables and row widths 1-4
+template < typename context_type, IdxT num_vars >
+inline fused_fixed_pack_fn<context_type> find_fused_fixed_pack_width(IdxT width)
+{
+  switch (width) {
+    case 1: return &fused_fixed_kernels<context_type, num_vars, 1>::pack;
+    case 2: return &fused_fixed_kernels<context_type, num_vars, 2>::pack;
+    case 3: return &fused_fixed_kernels<context_type, num_vars, 3>::pack;
+    case 4: return &fused_fixed_kernels<context_type, num_vars, 4>::pack;
+  }
+  return nullptr;
+}
+
+template < typename context_type, IdxT num_vars >
+inline fused_fixed_unpack_fn<context_type> find_fused_fixed_unpack_width(IdxT width)
+{
+  switch (width) {
+    case 1: return &fused_fixed_kernels<context_type, num_vars, 1>::unpack;
+    case 2: return &fused_fixed_kernels<context_type, num_vars, 2>::unpack;
+    case 3: return &fused_fixed_kernels<context_type, num_vars, 3>::unpack;
+    case 4: return &fused_fixed_kernels<context_type, num_vars, 4>::unpack;
+  }
+  return nullptr;
+}
+
+template < typename context_type >
+inline fused_fixed_pack_fn<context_type> find_fused_fixed_pack(IdxT num_vars, IdxT width, std::true_type)
+{
+  switch (num_vars) {
+    case 1: return find_fused_fixed_pack_width<context_type, 1>(width);
+    case 3: return find_fused_fixed_pack_width<context_type, 3>(width);
+    case 5: return find_fused_fixed_pack_width<context_type, 5>(width);
+    case 8: return find_fused_fixed_pack_width<context_type, 8>(width);
+  }
+  return nullptr;
+}
+
+template < typename context_type >
+inline fused_fixed_pack_fn<context_type> find_fused_fixed_pack(IdxT, IdxT, std::false_type)
+{
+  return nullptr;
+}
+
+template < typename context_type >
+inline fused_fixed_unpack_fn<context_type> find_fused_fixed_unpack(IdxT num_vars, IdxT width, std::true_type)
+{
+  switch (num_vars) {
+    case 1: return find_fused_fixed_unpack_width<context_type, 1>(width);
+    case 3: return find_fused_fixed_unpack_width<context_type, 3>(width);
+    case 5: return find_fused_fixed_unpack_width<context_type, 5>(width);
+    case 8: return find_fused_fixed_unpack_width<context_type, 8>(width);
+  }
+  return nullptr;
+}
+
+template < typename context_type >
+inline fused_fixed_unpack_fn<context_type> find_fused_fixed_unpack(IdxT, IdxT, std::false_type)
+{
+  return nullptr;
+}
+
 
 template < typename context_type >
 struct FuserStorage
@@ -206,13 +888,24 @@ struct FuserStorage
   DataT** m_vars = nullptr;
   IdxT m_num_vars = 0;
 
-  LidxT const** m_idxs = nullptr;
-  IdxT*         m_lens = nullptr;
+  LidxT const**       m_idxs = nullptr;
+  index_span const**  m_spans = nullptr;
+  box_rows*           m_boxes = nullptr;
+  IdxT*               m_lens = nullptr;
+  IdxT*               m_loop_lens = nullptr;
 
 
   DataT      ** get_dsts() { return                m_vars; }
   DataT const** get_srcs() { return (DataT const**)m_vars; }
 
+  // the multi variable loops are only used on the cpu, where the single
+  // pass over each item saves cache traffic
+  static bool use_multi_variable()
+  {
+    return comb_allow_multi_variable_pack_fusing() &&
+           std::is_base_of<CPUContext, context_type>::value;
+  }
+
   void allocate(context_type& con, std::vector<DataT*> const& variables, IdxT num_loops)
   {
     if (m_vars == nullptr) {
@@ -232,8 +925,11 @@ struct FuserStorage
       }
 
       // allocate per item vars
-      m_idxs = (LidxT const**)con.util_aloc.allocate(num_loops*sizeof(LidxT const*));
-      m_lens = (IdxT*)        con.util_aloc.allocate(num_loops*sizeof(IdxT));
+      m_idxs      = (LidxT const**)     con.util_aloc.allocate(num_loops*sizeof(LidxT const*));
+      m_spans     = (index_span const**)con.util_aloc.allocate(num_loops*sizeof(index_span const*));
+      m_boxes     = (box_rows*)         con.util_aloc.allocate(num_loops*sizeof(box_rows));
+      m_lens      = (IdxT*)             con.util_aloc.allocate(num_loops*sizeof(IdxT));
+      m_loop_lens = (IdxT*)             con.util_aloc.allocate(num_loops*sizeof(IdxT));
 
       // item vars initialized in pack
     }
@@ -254,7 +950,10 @@ struct FuserStorage
 
       // deallocate per item vars
       con.util_aloc.deallocate(m_idxs); m_idxs = nullptr;
+      con.util_aloc.deallocate(m_spans); m_spans = nullptr;
+      con.util_aloc.deallocate(m_boxes); m_boxes = nullptr;
       con.util_aloc.deallocate(m_lens); m_lens = nullptr;
+      con.util_aloc.deallocate(m_loop_lens); m_loop_lens = nullptr;
     }
   }
 };
@@ -266,6 +965,19 @@ struct FuserPacker : FuserStorage<context_type>
 
   DataT** m_bufs = nullptr;
 
+  // specialized kernel for this message group, nullptr uses the generic loops
+  fused_fixed_pack_fn<context_type> m_fixed_kernel = nullptr;
+
+  void select_kernel(IdxT num_vars, IdxT width)
+  {
+    m_fixed_kernel = nullptr;
+    if (comb_allow_specialized_pack_kernels() &&
+        comb_message_layout() == message_layout::variable_major) {
+      m_fixed_kernel = find_fused_fixed_pack<context_type>(num_vars, width,
+                           std::is_base_of<CPUContext, context_type>{});
+    }
+  }
+
   void allocate(context_type& con, std::vector<DataT*> const& variables, IdxT num_items)
   {
     if (this->m_vars == nullptr) {
@@ -276,12 +988,16 @@ struct FuserPacker : FuserStorage<context_type>
   }
 
   // enqueue packing loops for all variables
-  void enqueue(context_type& /*con*/, DataT* buf, LidxT const* indices, const IdxT nitems)
+  template < typename item_type >
+  void enqueue(context_type& /*con*/, DataT* buf, item_type const& item)
   {
-    this->m_bufs[this->m_num_fused_loops_enqueued] = buf;
-    this->m_idxs[this->m_num_fused_loops_enqueued] = indices;
-    this->m_lens[this->m_num_fused_loops_enqueued] = nitems;
-    this->m_num_fused_iterations += nitems;
+    this->m_bufs[this->m_num_fused_loops_enqueued]      = buf;
+    this->m_idxs[this->m_num_fused_loops_enqueued]      = item.indices;
+    this->m_spans[this->m_num_fused_loops_enqueued]     = item.spans;
+    this->m_boxes[this->m_num_fused_loops_enqueued]     = item.box;
+    this->m_lens[this->m_num_fused_loops_enqueued]      = item.size;
+    this->m_loop_lens[this->m_num_fused_loops_enqueued] = item.loop_len();
+    this->m_num_fused_iterations += item.loop_len();
     this->m_num_fused_loops_enqueued += 1;
   }
 
@@ -289,10 +1005,40 @@ struct FuserPacker : FuserStorage<context_type>
   {
     IdxT num_fused_loops = this->m_num_fused_loops_enqueued - this->m_num_fused_loops_executed;
     IdxT avg_iterations = (this->m_num_fused_iterations + num_fused_loops - 1) / num_fused_loops;
-    con.fused(num_fused_loops, this->m_num_vars, avg_iterations,
-        fused_packer(this->get_srcs(), this->m_bufs+this->m_num_fused_loops_executed,
-                                       this->m_idxs+this->m_num_fused_loops_executed,
-                                       this->m_lens+this->m_num_fused_loops_executed));
+    if (comb_message_layout() == message_layout::zone_major) {
+      con.fused(num_fused_loops, 1, avg_iterations,
+          fused_zone_packer(this->get_srcs(), this->m_num_vars,
+                            this->m_bufs+this->m_num_fused_loops_executed,
+                            this->m_idxs+this->m_num_fused_loops_executed,
+                            this->m_spans+this->m_num_fused_loops_executed,
+                            this->m_boxes+this->m_num_fused_loops_executed,
+                            this->m_loop_lens+this->m_num_fused_loops_executed));
+    } else if (m_fixed_kernel != nullptr) {
+      m_fixed_kernel(con, num_fused_loops, avg_iterations,
+                     this->get_srcs(), this->m_bufs+this->m_num_fused_loops_executed,
+                     this->m_idxs+this->m_num_fused_loops_executed,
+                     this->m_spans+this->m_num_fused_loops_executed,
+                     this->m_boxes+this->m_num_fused_loops_executed,
+                     this->m_lens+this->m_num_fused_loops_executed,
+                     this->m_loop_lens+this->m_num_fused_loops_executed);
+    } else if (base::use_multi_variable()) {
+      con.fused(num_fused_loops, fused_multi_packer::num_blocks(this->m_num_vars), avg_iterations,
+          fused_multi_packer(this->get_srcs(), this->m_num_vars,
+                             this->m_bufs+this->m_num_fused_loops_executed,
+                             this->m_idxs+this->m_num_fused_loops_executed,
+                             this->m_spans+this->m_num_fused_loops_executed,
+                             this->m_boxes+this->m_num_fused_loops_executed,
+                             this->m_lens+this->m_num_fused_loops_executed,
+                             this->m_loop_lens+this->m_num_fused_loops_executed));
+    } else {
+      con.fused(num_fused_loops, this->m_num_vars, avg_iterations,
+          fused_packer(this->get_srcs(), this->m_bufs+this->m_num_fused_loops_executed,
+                                         this->m_idxs+this->m_num_fused_loops_executed,
+                                         this->m_spans+this->m_num_fused_loops_executed,
+                                         this->m_boxes+this->m_num_fused_loops_executed,
+                                         this->m_lens+this->m_num_fused_loops_executed,
+                                         this->m_loop_lens+this->m_num_fused_loops_executed));
+    }
     this->m_num_fused_iterations = 0;
     this->m_num_fused_loops_executed = this->m_num_fused_loops_enqueued;
   }
@@ -314,6 +1060,19 @@ struct FuserUnpacker : FuserStorage<context_type>
 
   DataT const** m_bufs = nullptr;
 
+  // specialized kernel for this message group, nullptr uses the generic loops
+  fused_fixed_unpack_fn<context_type> m_fixed_kernel = nullptr;
+
+  void select_kernel(IdxT num_vars, IdxT width)
+  {
+    m_fixed_kernel = nullptr;
+    if (comb_allow_specialized_pack_kernels() &&
+        comb_message_layout() == message_layout::variable_major) {
+      m_fixed_kernel = find_fused_fixed_unpack<context_type>(num_vars, width,
+                           std::is_base_of<CPUContext, context_type>{});
+    }
+  }
+
   void allocate(context_type& con, std::vector<DataT*> const& variables, IdxT num_items)
   {
     if (this->m_vars == nullptr) {
@@ -324,12 +1083,16 @@ struct FuserUnpacker : FuserStorage<context_type>
   }
 
   // enqueue unpacking loops for all variables
-  void enqueue(context_type& /*con*/, DataT const* buf, LidxT const* indices, const IdxT nitems)
+  template < typename item_type >
+  void enqueue(context_type& /*con*/, DataT const* buf, item_type const& item)
   {
-    this->m_bufs[this->m_num_fused_loops_enqueued] = buf;
-    this->m_idxs[this->m_num_fused_loops_enqueued] = indices;
-    this->m_lens[this->m_num_fused_loops_enqueued] = nitems;
-    this->m_num_fused_iterations += nitems;
+    this->m_bufs[this->m_num_fused_loops_enqueued]      = buf;
+    this->m_idxs[this->m_num_fused_loops_enqueued]      = item.indices;
+    this->m_spans[this->m_num_fused_loops_enqueued]     = item.spans;
+    this->m_boxes[this->m_num_fused_loops_enqueued]     = item.box;
+    this->m_lens[this->m_num_fused_loops_enqueued]      = item.size;
+    this->m_loop_lens[this->m_num_fused_loops_enqueued] = item.loop_len();
+    this->m_num_fused_iterations += item.loop_len();
     this->m_num_fused_loops_enqueued += 1;
   }
 
@@ -337,10 +1100,40 @@ struct FuserUnpacker : FuserStorage<context_type>
   {
     IdxT num_fused_loops = this->m_num_fused_loops_enqueued - this->m_num_fused_loops_executed;
     IdxT avg_iterations = (this->m_num_fused_iterations + num_fused_loops - 1) / num_fused_loops;
-    con.fused(num_fused_loops, this->m_num_vars, avg_iterations,
-        fused_unpacker(this->get_dsts(), this->m_bufs+this->m_num_fused_loops_executed,
-                                         this->m_idxs+this->m_num_fused_loops_executed,
-                                         this->m_lens+this->m_num_fused_loops_executed));
+    if (comb_message_layout() == message_layout::zone_major) {
+      con.fused(num_fused_loops, 1, avg_iterations,
+          fused_zone_unpacker(this->get_dsts(), this->m_num_vars,
+                              this->m_bufs+this->m_num_fused_loops_executed,
+                              this->m_idxs+this->m_num_fused_loops_executed,
+                              this->m_spans+this->m_num_fused_loops_executed,
+                              this->m_boxes+this->m_num_fused_loops_executed,
+                              this->m_loop_lens+this->m_num_fused_loops_executed));
+    } else if (m_fixed_kernel != nullptr) {
+      m_fixed_kernel(con, num_fused_loops, avg_iterations,
+                     this->get_dsts(), this->m_bufs+this->m_num_fused_loops_executed,
+                     this->m_idxs+this->m_num_fused_loops_executed,
+                     this->m_spans+this->m_num_fused_loops_executed,
+                     this->m_boxes+this->m_num_fused_loops_executed,
+                     this->m_lens+this->m_num_fused_loops_executed,
+                     this->m_loop_lens+this->m_num_fused_loops_executed);
+    } else if (base::use_multi_variable()) {
+      con.fused(num_fused_loops, fused_multi_unpacker::num_blocks(this->m_num_vars), avg_iterations,
+          fused_multi_unpacker(this->get_dsts(), this->m_num_vars,
+                               this->m_bufs+this->m_num_fused_loops_executed,
+                               this->m_idxs+this->m_num_fused_loops_executed,
+                               this->m_spans+this->m_num_fused_loops_executed,
+                               this->m_boxes+this->m_num_fused_loops_executed,
+                               this->m_lens+this->m_num_fused_loops_executed,
+                               this->m_loop_lens+this->m_num_fused_loops_executed));
+    } else {
+      con.fused(num_fused_loops, this->m_num_vars, avg_iterations,
+          fused_unpacker(this->get_dsts(), this->m_bufs+this->m_num_fused_loops_executed,
+                                           this->m_idxs+this->m_num_fused_loops_executed,
+                                           this->m_spans+this->m_num_fused_loops_executed,
+                                           this->m_boxes+this->m_num_fused_loops_executed,
+                                           this->m_lens+this->m_num_fused_loops_executed,
+                                           this->m_loop_lens+this->m_num_fused_loops_executed));
+    }
     this->m_num_fused_iterations = 0;
     this->m_num_fused_loops_executed = this->m_num_fused_loops_enqueued;
   }
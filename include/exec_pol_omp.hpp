@@ -27,6 +27,7 @@
 
 #include "exec_utils.hpp"
 #include "memory.hpp"
+#include "exec_fused.hpp"
 
 struct omp_component
 {
@@ -156,7 +157,7 @@ struct ExecContext<omp_pol> : CPUContext
   template < typename body_type >
   void for_all(IdxT len, body_type&& body)
   {
-  #pragma omp parallel for
+  #pragma omp parallel for schedule(static)
     for(IdxT i = 0; i < len; ++i) {
       body(i);
     }
@@ -168,7 +169,7 @@ struct ExecContext<omp_pol> : CPUContext
   {
   #ifdef COMB_USE_OMP_COLLAPSE
 
-  #pragma omp parallel for collapse(2)
+  #pragma omp parallel for collapse(2) schedule(static)
     for(IdxT i0 = 0; i0 < len0; ++i0) {
       for(IdxT i1 = 0; i1 < len1; ++i1) {
         body(i0, i1);
@@ -213,7 +214,7 @@ struct ExecContext<omp_pol> : CPUContext
 
   #else
 
-  #pragma omp parallel for
+  #pragma omp parallel for schedule(static)
     for(IdxT i0 = 0; i0 < len0; ++i0) {
       for(IdxT i1 = 0; i1 < len1; ++i1) {
         body(i0, i1);
@@ -229,7 +230,7 @@ struct ExecContext<omp_pol> : CPUContext
   {
 #ifdef COMB_USE_OMP_COLLAPSE
 
-  #pragma omp parallel for collapse(3)
+  #pragma omp parallel for collapse(3) schedule(static)
     for(IdxT i0 = 0; i0 < len0; ++i0) {
       for(IdxT i1 = 0; i1 < len1; ++i1) {
         for(IdxT i2 = 0; i2 < len2; ++i2) {
@@ -285,7 +286,7 @@ struct ExecContext<omp_pol> : CPUContext
 
 #else
 
-#pragma omp parallel for
+#pragma omp parallel for schedule(static)
     for(IdxT i0 = 0; i0 < len0; ++i0) {
       for(IdxT i1 = 0; i1 < len1; ++i1) {
         for(IdxT i2 = 0; i2 < len2; ++i2) {
@@ -305,43 +306,37 @@ struct ExecContext<omp_pol> : CPUContext
 
   #ifdef COMB_USE_OMP_COLLAPSE
 
-    #pragma omp parallel for collapse(2)
+    #pragma omp parallel for collapse(2) schedule(static)
     for (IdxT i_outer = 0; i_outer < len_outer; ++i_outer) {
       for (IdxT i_inner = 0; i_inner < len_inner; ++i_inner) {
         auto body = body_in;
         body.set_outer(i_outer);
         body.set_inner(i_inner);
-        for (IdxT i = 0; i < body.len; ++i) {
-          body(i);
-        }
+        detail::fused_run_host(body);
       }
     }
 
   #elif defined(COMB_USE_OMP_WEAK_COLLAPSE)
 
-    #pragma omp parallel for collapse(2)
+    #pragma omp parallel for collapse(2) schedule(static)
     for (IdxT i_outer = 0; i_outer < len_outer; ++i_outer) {
       for (IdxT i_inner = 0; i_inner < len_inner; ++i_inner) {
         auto body = body_in;
         body.set_outer(i_outer);
         body.set_inner(i_inner);
-        for (IdxT i = 0; i < body.len; ++i) {
-          body(i);
-        }
+        detail::fused_run_host(body);
       }
     }
 
   #else
 
-    #pragma omp parallel for
+    #pragma omp parallel for schedule(static)
     for (IdxT i_outer = 0; i_outer < len_outer; ++i_outer) {
       auto body = body_in;
       body.set_outer(i_outer);
       for (IdxT i_inner = 0; i_inner < len_inner; ++i_inner) {
         body.set_inner(i_inner);
-        for (IdxT i = 0; i < body.len; ++i) {
-          body(i);
-        }
+        detail::fused_run_host(body);
       }
     }
 
@@ -381,6 +381,7 @@ struct FuserStorage<ExecContext<raja_pol<base_policy>>>
 
   // vars for fused loops, stored in backend accessible memory
   std::vector<DataT*> m_variables;
+  DataT** m_vars = nullptr;
 
   void allocate(context_type& con, std::vector<DataT*> const& variables, IdxT num_loops)
   {
@@ -393,6 +394,10 @@ struct FuserStorage<ExecContext<raja_pol<base_policy>>>
 
       // allocate per variable vars
       m_variables = variables;
+      m_vars = (DataT**)con.util_aloc.allocate(m_variables.size()*sizeof(DataT*));
+      for (size_t i = 0; i < m_variables.size(); ++i) {
+        m_vars[i] = m_variables[i];
+      }
 
       m_workGroup_it = m_workGroups_list.begin();
       LOGPRINTF("%p FuserStorage<raja>::allocate num_vars %zu\n", this, m_variables.size());
@@ -436,6 +441,7 @@ struct FuserStorage<ExecContext<raja_pol<base_policy>>>
       LOGPRINTF("%p FuserStorage<raja>::deallocate clear\n", this);
       // deallocate per variable vars
       this->m_variables.clear();
+      con.util_aloc.deallocate(this->m_vars); this->m_vars = nullptr;
 
       // do not clear WorkObjects here, not yet synchronized
     }
@@ -456,18 +462,50 @@ struct FuserPacker<ExecContext<raja_pol<base_policy>>> : FuserStorage<ExecContex
     }
   }
 
+  // raja builds its own fused loops, there are no specialized kernels
+  void select_kernel(IdxT /*num_vars*/, IdxT /*width*/)
+  {
+  }
+
   // enqueue packing loops for all variables
-  void enqueue(context_type& con, DataT* buf, LidxT const* indices, const IdxT nitems)
+  template < typename item_type >
+  void enqueue(context_type& con, DataT* buf, item_type const& item)
   {
+    LidxT const* indices = item.indices;
+    const IdxT nitems = item.size;
     LOGPRINTF("%p FuserPacker<raja>::enqueue con %p buf %p indices %p nitems %i\n", this, &con, buf, indices, nitems);
     base::enqueue(con);
 
-    RAJA::TypedRangeSegment<IdxT> seg(0, nitems);
-    for (DataT const* src : this->m_variables) {
-      LOGPRINTF("%p FuserPacker<raja>::enqueue enqueue con %p WorkObjects %p buf %p[i] = src %p[indices %p] nitems %i\n", this, &con, &*this->m_workGroup_it, buf, src, indices, nitems);
-      this->m_workGroup_it->m_pool.enqueue(seg, make_copy_idxr_idxr(src, detail::indexer_list_i{indices},
-                                                                    buf, detail::indexer_i{}));
-      buf += nitems;
+    if (comb_message_layout() == message_layout::zone_major) {
+      RAJA::TypedRangeSegment<IdxT> seg(0, item.loop_len());
+      pack_zones<DataT> kernel{this->m_vars, static_cast<IdxT>(this->m_variables.size()), buf};
+      if (indices) {
+        this->m_workGroup_it->m_pool.enqueue(seg, zone_list_loop<pack_zones<DataT>>{kernel, indices});
+      } else if (item.spans) {
+        this->m_workGroup_it->m_pool.enqueue(seg, zone_span_loop<pack_zones<DataT>>{kernel, item.spans});
+      } else {
+        this->m_workGroup_it->m_pool.enqueue(seg, zone_box_loop<pack_zones<DataT>>{kernel, item.box});
+      }
+    } else if (item.spans) {
+      RAJA::TypedRangeSegment<IdxT> seg(0, item.num_spans);
+      for (DataT const* src : this->m_variables) {
+        this->m_workGroup_it->m_pool.enqueue(seg, make_pack_spans(src, buf, item.spans));
+        buf += nitems;
+      }
+    } else if (item.structured()) {
+      RAJA::TypedRangeSegment<IdxT> seg(0, item.box.nrows);
+      for (DataT const* src : this->m_variables) {
+        this->m_workGroup_it->m_pool.enqueue(seg, make_pack_box_rows(src, buf, item.box));
+        buf += nitems;
+      }
+    } else {
+      RAJA::TypedRangeSegment<IdxT> seg(0, nitems);
+      for (DataT const* src : this->m_variables) {
+        LOGPRINTF("%p FuserPacker<raja>::enqueue enqueue con %p WorkObjects %p buf %p[i] = src %p[indices %p] nitems %i\n", this, &con, &*this->m_workGroup_it, buf, src, indices, nitems);
+        this->m_workGroup_it->m_pool.enqueue(seg, make_copy_idxr_idxr(src, detail::indexer_list_i{indices},
+                                                                      buf, detail::indexer_i{}));
+        buf += nitems;
+      }
     }
     this->m_num_fused_loops_enqueued += 1;
   }
@@ -501,18 +539,50 @@ struct FuserUnpacker<ExecContext<raja_pol<base_policy>>> : FuserStorage<ExecCont
     }
   }
 
+  // raja builds its own fused loops, there are no specialized kernels
+  void select_kernel(IdxT /*num_vars*/, IdxT /*width*/)
+  {
+  }
+
   // enqueue unpacking loops for all variables
-  void enqueue(context_type& con, DataT const* buf, LidxT const* indices, const IdxT nitems)
+  template < typename item_type >
+  void enqueue(context_type& con, DataT const* buf, item_type const& item)
   {
+    LidxT const* indices = item.indices;
+    const IdxT nitems = item.size;
     LOGPRINTF("%p FuserUnpacker<raja>::enqueue con %p buf %p indices %p nitems %i\n", this, &con, buf, indices, nitems);
     base::enqueue(con);
 
-    RAJA::TypedRangeSegment<IdxT> seg(0, nitems);
-    for (DataT* dst : this->m_variables) {
-      LOGPRINTF("%p FuserUnpacker<raja>::enqueue enqueue %p dst %p[indices %p] = buf %p[i] nitems %i\n", this, &*this->m_workGroup_it, dst, indices, buf, nitems);
-      this->m_workGroup_it->m_pool.enqueue(seg, make_copy_idxr_idxr(buf, detail::indexer_i{},
-                                                                    dst, detail::indexer_list_i{indices}));
-      buf += nitems;
+    if (comb_message_layout() == message_layout::zone_major) {
+      RAJA::TypedRangeSegment<IdxT> seg(0, item.loop_len());
+      unpack_zones<DataT> kernel{this->m_vars, static_cast<IdxT>(this->m_variables.size()), buf};
+      if (indices) {
+        this->m_workGroup_it->m_pool.enqueue(seg, zone_list_loop<unpack_zones<DataT>>{kernel, indices});
+      } else if (item.spans) {
+        this->m_workGroup_it->m_pool.enqueue(seg, zone_span_loop<unpack_zones<DataT>>{kernel, item.spans});
+      } else {
+        this->m_workGroup_it->m_pool.enqueue(seg, zone_box_loop<unpack_zones<DataT>>{kernel, item.box});
+      }
+    } else if (item.spans) {
+      RAJA::TypedRangeSegment<IdxT> seg(0, item.num_spans);
+      for (DataT* dst : this->m_variables) {
+        this->m_workGroup_it->m_pool.enqueue(seg, make_unpack_spans(buf, dst, item.spans));
+        buf += nitems;
+      }
+    } else if (item.structured()) {
+      RAJA::TypedRangeSegment<IdxT> seg(0, item.box.nrows);
+      for (DataT* dst : this->m_variables) {
+        this->m_workGroup_it->m_pool.enqueue(seg, make_unpack_box_rows(buf, dst, item.box));
+        buf += nitems;
+      }
+    } else {
+      RAJA::TypedRangeSegment<IdxT> seg(0, nitems);
+      for (DataT* dst : this->m_variables) {
+        LOGPRINTF("%p FuserUnpacker<raja>::enqueue enqueue %p dst %p[indices %p] = buf %p[i] nitems %i\n", this, &*this->m_workGroup_it, dst, indices, buf, nitems);
+        this->m_workGroup_it->m_pool.enqueue(seg, make_copy_idxr_idxr(buf, detail::indexer_i{},
+                                                                      dst, detail::indexer_list_i{indices}));
+        buf += nitems;
+      }
     }
     this->m_num_fused_loops_enqueued += 1;
   }
@@ -20,6 +20,7 @@
 
 #include "exec_utils.hpp"
 #include "memory.hpp"
+#include "exec_fused.hpp"
 
 struct seq_component
 {
@@ -188,9 +189,7 @@ struct ExecContext<seq_pol> : CPUContext
       body.set_outer(i_outer);
       for (IdxT i_inner = 0; i_inner < len_inner; ++i_inner) {
         body.set_inner(i_inner);
-        for (IdxT i = 0; i < body.len; ++i) {
-          body(i);
-        }
+        detail::fused_run_host(body);
       }
     }
     // base::synchronize();
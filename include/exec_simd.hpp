@@ -0,0 +1,427 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2018-2021, Lawrence Livermore National Security, LLC.
+//
+// Produced at the Lawrence Livermore National Laboratory
+//
+// LLNL-CODE-758885
+//
+// All rights reserved.
+//
+// This file is part of Comb.
+//
+// For details, see https://github.com/LLNL/Comb
+// Please also see the LICENSE file for MIT license.
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef _SIMD_HPP
+#define _SIMD_HPP
+
+#include "config.hpp"
+
+#include <cstdint>
+#include <type_traits>
+
+#include "exec_utils.hpp"
+
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__GNUC__) || defined(__clang__)) && \
+    !defined(__CUDACC__)
+#define COMB_HAVE_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace detail {
+
+namespace simd {
+
+enum struct isa {
+  scalar
+ ,avx2
+ ,avx512
+};
+
+inline const char* isa_str(isa i)
+{
+  switch (i) {
+    case isa::scalar: return "scalar";
+    case isa::avx2:   return "avx2";
+    case isa::avx512: return "avx512";
+  }
+  return "unknown";
+}
+
+// most capable instruction set supported by this cpu
+inline isa detect()
+{
+#ifdef COMB_HAVE_X86_SIMD
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) return isa::avx512;
+  if (__builtin_cpu_supports("avx2"))    return isa::avx2;
+#endif
+  return isa::scalar;
+}
+
+// the vector kernels assume double data with 32-bit indices
+constexpr bool supported_types = std::is_same<DataT, double>::value &&
+                                 std::is_same<LidxT, int>::value;
+
+// number of elements ahead to prefetch the gathered data
+constexpr IdxT prefetch_distance = 32;
+
+// number of elements per chunk when splitting a loop across threads
+constexpr IdxT chunk_size = 2048;
+
+// templated on the index type for use in the 32-bit index vector kernels
+template < typename I >
+inline void gather_scalar(DataT* COMB_RESTRICT dst, DataT const* COMB_RESTRICT src,
+                          I const* COMB_RESTRICT idx, IdxT len)
+{
+  for (IdxT i = 0; i < len; ++i) {
+    dst[i] = src[idx[i]];
+  }
+}
+
+template < typename I >
+inline void scatter_scalar(DataT* COMB_RESTRICT dst, I const* COMB_RESTRICT idx,
+                           DataT const* COMB_RESTRICT src, IdxT len)
+{
+  for (IdxT i = 0; i < len; ++i) {
+    dst[idx[i]] = src[i];
+  }
+}
+
+#ifdef COMB_HAVE_X86_SIMD
+
+// gathers with every lane enabled and a zeroed source, gcc warns that the
+// undefined source of the unmasked forms may be used uninitialized
+__attribute__((target("avx2")))
+inline __m256d gather4_pd(double const* src, __m128i vidx)
+{
+  return _mm256_mask_i32gather_pd(_mm256_setzero_pd(), src, vidx,
+                                  _mm256_castsi256_pd(_mm256_set1_epi64x(-1)), sizeof(double));
+}
+
+__attribute__((target("avx512f")))
+inline __m512d gather8_pd(double const* src, __m256i vidx)
+{
+  return _mm512_mask_i32gather_pd(_mm512_setzero_pd(), (__mmask8)0xff, vidx, src, sizeof(double));
+}
+
+__attribute__((target("avx2")))
+inline void gather_avx2(double* COMB_RESTRICT dst, double const* COMB_RESTRICT src,
+                        int const* COMB_RESTRICT idx, IdxT len)
+{
+  IdxT i = 0;
+  for (; i + 4 <= len; i += 4) {
+    if (i + prefetch_distance < len) {
+      _mm_prefetch((char const*)(src + idx[i + prefetch_distance]), _MM_HINT_T0);
+    }
+    __m128i vidx = _mm_loadu_si128((__m128i const*)(idx + i));
+    __m256d v = gather4_pd(src, vidx);
+    _mm256_storeu_pd(dst + i, v);
+  }
+  for (; i < len; ++i) {
+    dst[i] = src[idx[i]];
+  }
+}
+
+// avx2 has no scatter, the indices are sorted so store in order
+// and prefetch the upcoming destination lines
+__attribute__((target("avx2")))
+inline void scatter_avx2(double* COMB_RESTRICT dst, int const* COMB_RESTRICT idx,
+                         double const* COMB_RESTRICT src, IdxT len)
+{
+  IdxT i = 0;
+  for (; i + 4 <= len; i += 4) {
+    if (i + prefetch_distance < len) {
+      _mm_prefetch((char const*)(dst + idx[i + prefetch_distance]), _MM_HINT_T0);
+    }
+    dst[idx[i+0]] = src[i+0];
+    dst[idx[i+1]] = src[i+1];
+    dst[idx[i+2]] = src[i+2];
+    dst[idx[i+3]] = src[i+3];
+  }
+  for (; i < len; ++i) {
+    dst[idx[i]] = src[i];
+  }
+}
+
+__attribute__((target("avx512f")))
+inline void gather_avx512(double* COMB_RESTRICT dst, double const* COMB_RESTRICT src,
+                          int const* COMB_RESTRICT idx, IdxT len)
+{
+  IdxT i = 0;
+  for (; i + 8 <= len; i += 8) {
+    if (i + prefetch_distance < len) {
+      _mm_prefetch((char const*)(src + idx[i + prefetch_distance]), _MM_HINT_T0);
+    }
+    __m256i vidx = _mm256_loadu_si256((__m256i const*)(idx + i));
+    __m512d v = gather8_pd(src, vidx);
+    _mm512_storeu_pd(dst + i, v);
+  }
+  for (; i < len; ++i) {
+    dst[i] = src[idx[i]];
+  }
+}
+
+// indices within an item are unique so the scatter has no conflicts
+__attribute__((target("avx512f")))
+inline void scatter_avx512(double* COMB_RESTRICT dst, int const* COMB_RESTRICT idx,
+                           double const* COMB_RESTRICT src, IdxT len)
+{
+  IdxT i = 0;
+  for (; i + 8 <= len; i += 8) {
+    if (i + prefetch_distance < len) {
+      _mm_prefetch((char const*)(dst + idx[i + prefetch_distance]), _MM_HINT_T0);
+    }
+    __m256i vidx = _mm256_loadu_si256((__m256i const*)(idx + i));
+    __m512d v = _mm512_loadu_pd(src + i);
+    _mm512_i32scatter_pd(dst, vidx, v, sizeof(double));
+  }
+  for (; i < len; ++i) {
+    dst[idx[i]] = src[i];
+  }
+}
+
+// streaming variants bypass the cache for the buffer side of the copy,
+// the buffer is written or read once and then handed to the network
+
+// number of leading elements before ptr is aligned to align bytes
+inline IdxT unaligned_prefix(void const* ptr, IdxT len, std::uintptr_t align)
+{
+  std::uintptr_t mis = reinterpret_cast<std::uintptr_t>(ptr) % align;
+  if (mis % sizeof(double) != 0) return len;
+  IdxT n = ((align - mis) % align) / sizeof(double);
+  return (n < len) ? n : len;
+}
+
+__attribute__((target("avx2")))
+inline void gather_stream_avx2(double* COMB_RESTRICT dst, double const* COMB_RESTRICT src,
+                               int const* COMB_RESTRICT idx, IdxT len)
+{
+  IdxT i = unaligned_prefix(dst, len, 32);
+  gather_scalar(dst, src, idx, i);
+  for (; i + 4 <= len; i += 4) {
+    if (i + prefetch_distance < len) {
+      _mm_prefetch((char const*)(src + idx[i + prefetch_distance]), _MM_HINT_T0);
+    }
+    __m128i vidx = _mm_loadu_si128((__m128i const*)(idx + i));
+    __m256d v = gather4_pd(src, vidx);
+    _mm256_stream_pd(dst + i, v);
+  }
+  for (; i < len; ++i) {
+    dst[i] = src[idx[i]];
+  }
+  _mm_sfence();
+}
+
+__attribute__((target("avx2")))
+inline void scatter_stream_avx2(double* COMB_RESTRICT dst, int const* COMB_RESTRICT idx,
+                                double const* COMB_RESTRICT src, IdxT len)
+{
+  IdxT i = unaligned_prefix(src, len, 32);
+  scatter_scalar(dst, idx, src, i);
+  for (; i + 4 <= len; i += 4) {
+    if (i + prefetch_distance < len) {
+      _mm_prefetch((char const*)(dst + idx[i + prefetch_distance]), _MM_HINT_T0);
+    }
+    alignas(32) double v[4];
+    _mm256_store_pd(v, _mm256_castsi256_pd(_mm256_stream_load_si256((__m256i const*)(src + i))));
+    dst[idx[i+0]] = v[0];
+    dst[idx[i+1]] = v[1];
+    dst[idx[i+2]] = v[2];
+    dst[idx[i+3]] = v[3];
+  }
+  for (; i < len; ++i) {
+    dst[idx[i]] = src[i];
+  }
+}
+
+__attribute__((target("avx512f")))
+inline void gather_stream_avx512(double* COMB_RESTRICT dst, double const* COMB_RESTRICT src,
+                                 int const* COMB_RESTRICT idx, IdxT len)
+{
+  IdxT i = unaligned_prefix(dst, len, 64);
+  gather_scalar(dst, src, idx, i);
+  for (; i + 8 <= len; i += 8) {
+    if (i + prefetch_distance < len) {
+      _mm_prefetch((char const*)(src + idx[i + prefetch_distance]), _MM_HINT_T0);
+    }
+    __m256i vidx = _mm256_loadu_si256((__m256i const*)(idx + i));
+    __m512d v = gather8_pd(src, vidx);
+    _mm512_stream_pd(dst + i, v);
+  }
+  for (; i < len; ++i) {
+    dst[i] = src[idx[i]];
+  }
+  _mm_sfence();
+}
+
+__attribute__((target("avx512f")))
+inline void scatter_stream_avx512(double* COMB_RESTRICT dst, int const* COMB_RESTRICT idx,
+                                  double const* COMB_RESTRICT src, IdxT len)
+{
+  IdxT i = unaligned_prefix(src, len, 64);
+  scatter_scalar(dst, idx, src, i);
+  for (; i + 8 <= len; i += 8) {
+    if (i + prefetch_distance < len) {
+      _mm_prefetch((char const*)(dst + idx[i + prefetch_distance]), _MM_HINT_T0);
+    }
+    __m256i vidx = _mm256_loadu_si256((__m256i const*)(idx + i));
+    __m512d v = _mm512_castsi512_pd(_mm512_stream_load_si512((void*)(src + i)));
+    _mm512_i32scatter_pd(dst, vidx, v, sizeof(double));
+  }
+  for (; i < len; ++i) {
+    dst[idx[i]] = src[i];
+  }
+}
+
+#endif
+
+} // namespace simd
+
+} // namespace detail
+
+// instruction set used by host pack and unpack kernels,
+// defaults to the best one supported by this cpu
+inline detail::simd::isa& comb_simd_isa()
+{
+  static detail::simd::isa i = detail::simd::supported_types ? detail::simd::detect()
+                                                             : detail::simd::isa::scalar;
+  return i;
+}
+
+// messages with at least this many bytes are packed with streaming
+// stores and unpacked with streaming loads on cpu, 0 disables streaming
+inline IdxT& comb_nontemporal_threshold()
+{
+  static IdxT threshold = 0;
+  return threshold;
+}
+
+inline bool comb_use_nontemporal(IdxT nbytes)
+{
+  return comb_nontemporal_threshold() > 0 && nbytes >= comb_nontemporal_threshold();
+}
+
+namespace detail {
+
+namespace simd {
+
+inline void gather(DataT* COMB_RESTRICT dst, DataT const* COMB_RESTRICT src,
+                   LidxT const* COMB_RESTRICT idx, IdxT len)
+{
+#ifdef COMB_HAVE_X86_SIMD
+  if (supported_types) {
+    switch (comb_simd_isa()) {
+      case isa::avx512:
+        gather_avx512((double*)dst, (double const*)src, (int const*)idx, len); return;
+      case isa::avx2:
+        gather_avx2((double*)dst, (double const*)src, (int const*)idx, len); return;
+      case isa::scalar:
+        break;
+    }
+  }
+#endif
+  gather_scalar(dst, src, idx, len);
+}
+
+inline void scatter(DataT* COMB_RESTRICT dst, LidxT const* COMB_RESTRICT idx,
+                    DataT const* COMB_RESTRICT src, IdxT len)
+{
+#ifdef COMB_HAVE_X86_SIMD
+  if (supported_types) {
+    switch (comb_simd_isa()) {
+      case isa::avx512:
+        scatter_avx512((double*)dst, (int const*)idx, (double const*)src, len); return;
+      case isa::avx2:
+        scatter_avx2((double*)dst, (int const*)idx, (double const*)src, len); return;
+      case isa::scalar:
+        break;
+    }
+  }
+#endif
+  scatter_scalar(dst, idx, src, len);
+}
+
+inline void gather_stream(DataT* COMB_RESTRICT dst, DataT const* COMB_RESTRICT src,
+                          LidxT const* COMB_RESTRICT idx, IdxT len)
+{
+#ifdef COMB_HAVE_X86_SIMD
+  if (supported_types) {
+    switch (comb_simd_isa()) {
+      case isa::avx512:
+        gather_stream_avx512((double*)dst, (double const*)src, (int const*)idx, len); return;
+      case isa::avx2:
+        gather_stream_avx2((double*)dst, (double const*)src, (int const*)idx, len); return;
+      case isa::scalar:
+        break;
+    }
+  }
+#endif
+  gather_scalar(dst, src, idx, len);
+}
+
+inline void scatter_stream(DataT* COMB_RESTRICT dst, LidxT const* COMB_RESTRICT idx,
+                           DataT const* COMB_RESTRICT src, IdxT len)
+{
+#ifdef COMB_HAVE_X86_SIMD
+  if (supported_types) {
+    switch (comb_simd_isa()) {
+      case isa::avx512:
+        scatter_stream_avx512((double*)dst, (int const*)idx, (double const*)src, len); return;
+      case isa::avx2:
+        scatter_stream_avx2((double*)dst, (int const*)idx, (double const*)src, len); return;
+      case isa::scalar:
+        break;
+    }
+  }
+#endif
+  scatter_scalar(dst, idx, src, len);
+}
+
+} // namespace simd
+
+// gather src[idx[i]] into buf[i] in chunks so threaded contexts can split it
+struct gather_chunks {
+  DataT const* src;
+  LidxT const* idx;
+  DataT* buf;
+  IdxT len;
+  bool stream;
+  static IdxT num_chunks(IdxT len) { return (len + simd::chunk_size - 1) / simd::chunk_size; }
+  void operator()(IdxT c) const
+  {
+    IdxT begin = c * simd::chunk_size;
+    IdxT n = (len - begin < simd::chunk_size) ? len - begin : simd::chunk_size;
+    if (stream) {
+      simd::gather_stream(buf + begin, src, idx + begin, n);
+    } else {
+      simd::gather(buf + begin, src, idx + begin, n);
+    }
+  }
+};
+
+// scatter buf[i] into dst[idx[i]] in chunks so threaded contexts can split it
+struct scatter_chunks {
+  DataT const* buf;
+  LidxT const* idx;
+  DataT* dst;
+  IdxT len;
+  bool stream;
+  static IdxT num_chunks(IdxT len) { return (len + simd::chunk_size - 1) / simd::chunk_size; }
+  void operator()(IdxT c) const
+  {
+    IdxT begin = c * simd::chunk_size;
+    IdxT n = (len - begin < simd::chunk_size) ? len - begin : simd::chunk_size;
+    if (stream) {
+      simd::scatter_stream(dst, idx + begin, buf + begin, n);
+    } else {
+      simd::scatter(dst, idx + begin, buf + begin, n);
+    }
+  }
+};
+
+} // namespace detail
+
+#endif // _SIMD_HPP
@@ -22,9 +22,28 @@
 
 #include <cassert>
 #include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <vector>
+
+#if COMB_INDEX_BITS == 64
+using IdxT = std::int64_t;
+#elif COMB_INDEX_BITS == 32
+using IdxT = std::int32_t;
+#else
+#error COMB_INDEX_BITS must be 32 or 64
+#endif
+
+#if COMB_LOCAL_INDEX_BITS == 64
+using LidxT = std::int64_t;
+#elif COMB_LOCAL_INDEX_BITS == 32
+using LidxT = std::int32_t;
+#elif COMB_LOCAL_INDEX_BITS == 16
+using LidxT = std::int16_t;
+#else
+#error COMB_LOCAL_INDEX_BITS must be 16, 32 or 64
+#endif
 
-using IdxT = int;
-using LidxT = int;
 using DataT = double;
 
 
@@ -152,7 +171,287 @@ set_idxr_idxr<I_src, T_dst, I_dst> make_set_idxr_idxr(I_src const& idxr_src, T_d
   return set_idxr_idxr<I_src, T_dst, I_dst>(idxr_src, ptr_dst, idxr_dst);
 }
 
+// describes an axis aligned box of zones in a mesh as a list of i-rows
+// that are contiguous in the mesh, rows are ordered k then j
+struct box_rows {
+  IdxT offset;  // mesh index of the first zone in the box
+  IdxT ilen;    // zones per row
+  IdxT jlen;    // rows per plane
+  IdxT nrows;   // total number of rows in the box
+  IdxT jstride; // mesh stride between rows
+  IdxT kstride; // mesh stride between planes
+  COMB_HOST COMB_DEVICE IdxT row(IdxT r) const
+  {
+    IdxT k = r / jlen;
+    IdxT j = r - k * jlen;
+    return offset + j * jstride + k * kstride;
+  }
+};
+
+template < typename T >
+COMB_HOST COMB_DEVICE inline void copy_row(T* COMB_RESTRICT dst, T const* COMB_RESTRICT src, IdxT len)
+{
+#if defined(__CUDA_ARCH__)
+  for (IdxT i = 0; i < len; ++i) {
+    dst[i] = src[i];
+  }
+#else
+  memcpy(dst, src, len*sizeof(T));
+#endif
+}
+
+// copy the rows of a box in a mesh into a contiguous buffer
+template < typename T >
+struct pack_box_rows {
+  T const* src;
+  T* buf;
+  box_rows box;
+  pack_box_rows(T const* src_, T* buf_, box_rows const& box_) : src(src_), buf(buf_), box(box_) {}
+  COMB_HOST COMB_DEVICE void operator()(IdxT r) const
+  {
+    copy_row(buf + r * box.ilen, src + box.row(r), box.ilen);
+  }
+};
+
+template < typename T >
+pack_box_rows<T> make_pack_box_rows(T const* src, T* buf, box_rows const& box) {
+  return pack_box_rows<T>(src, buf, box);
+}
+
+// copy a contiguous buffer into the rows of a box in a mesh
+template < typename T >
+struct unpack_box_rows {
+  T const* buf;
+  T* dst;
+  box_rows box;
+  unpack_box_rows(T const* buf_, T* dst_, box_rows const& box_) : buf(buf_), dst(dst_), box(box_) {}
+  COMB_HOST COMB_DEVICE void operator()(IdxT r) const
+  {
+    copy_row(dst + box.row(r), buf + r * box.ilen, box.ilen);
+  }
+};
+
+template < typename T >
+unpack_box_rows<T> make_unpack_box_rows(T const* buf, T* dst, box_rows const& box) {
+  return unpack_box_rows<T>(buf, dst, box);
+}
+
+// a run of contiguous mesh indices and where it is stored in a buffer
+struct index_span {
+  IdxT offset; // buffer index of the first zone in the span
+  IdxT start;  // mesh index of the first zone in the span
+  IdxT len;    // zones in the span
+};
+
+// copy spans of a mesh into a contiguous buffer
+template < typename T >
+struct pack_spans {
+  T const* src;
+  T* buf;
+  index_span const* spans;
+  pack_spans(T const* src_, T* buf_, index_span const* spans_) : src(src_), buf(buf_), spans(spans_) {}
+  COMB_HOST COMB_DEVICE void operator()(IdxT s) const
+  {
+    index_span span = spans[s];
+    copy_row(buf + span.offset, src + span.start, span.len);
+  }
+};
+
+template < typename T >
+pack_spans<T> make_pack_spans(T const* src, T* buf, index_span const* spans) {
+  return pack_spans<T>(src, buf, spans);
+}
+
+// copy a contiguous buffer into spans of a mesh
+template < typename T >
+struct unpack_spans {
+  T const* buf;
+  T* dst;
+  index_span const* spans;
+  unpack_spans(T const* buf_, T* dst_, index_span const* spans_) : buf(buf_), dst(dst_), spans(spans_) {}
+  COMB_HOST COMB_DEVICE void operator()(IdxT s) const
+  {
+    index_span span = spans[s];
+    copy_row(dst + span.start, buf + span.offset, span.len);
+  }
+};
+
+template < typename T >
+unpack_spans<T> make_unpack_spans(T const* buf, T* dst, index_span const* spans) {
+  return unpack_spans<T>(buf, dst, spans);
+}
+
+// copy all variables of each zone to adjacent positions in a buffer
+template < typename T >
+struct pack_zones {
+  T const* const* srcs;
+  IdxT num_vars;
+  T* buf;
+  COMB_HOST COMB_DEVICE void copy(IdxT pos, IdxT mesh_i) const
+  {
+    T* zone_buf = buf + pos * num_vars;
+    for (IdxT v = 0; v < num_vars; ++v) {
+      zone_buf[v] = srcs[v][mesh_i];
+    }
+  }
+  COMB_HOST COMB_DEVICE void copy_run(IdxT pos, IdxT mesh_i, IdxT len) const
+  {
+    for (IdxT i = 0; i < len; ++i) {
+      copy(pos + i, mesh_i + i);
+    }
+  }
+};
+
+// copy adjacent values in a buffer to all variables of each zone
+template < typename T >
+struct unpack_zones {
+  T* const* dsts;
+  IdxT num_vars;
+  T const* buf;
+  COMB_HOST COMB_DEVICE void copy(IdxT pos, IdxT mesh_i) const
+  {
+    T const* zone_buf = buf + pos * num_vars;
+    for (IdxT v = 0; v < num_vars; ++v) {
+      dsts[v][mesh_i] = zone_buf[v];
+    }
+  }
+  COMB_HOST COMB_DEVICE void copy_run(IdxT pos, IdxT mesh_i, IdxT len) const
+  {
+    for (IdxT i = 0; i < len; ++i) {
+      copy(pos + i, mesh_i + i);
+    }
+  }
+};
+
+// loops applying a zone kernel to a list of indices, spans, or box rows
+template < typename kernel_type >
+struct zone_list_loop {
+  kernel_type kernel;
+  LidxT const* idx;
+  COMB_HOST COMB_DEVICE void operator()(IdxT i) const
+  {
+    kernel.copy(i, idx[i]);
+  }
+};
+
+template < typename kernel_type >
+struct zone_span_loop {
+  kernel_type kernel;
+  index_span const* spans;
+  COMB_HOST COMB_DEVICE void operator()(IdxT s) const
+  {
+    index_span span = spans[s];
+    kernel.copy_run(span.offset, span.start, span.len);
+  }
+};
+
+template < typename kernel_type >
+struct zone_box_loop {
+  kernel_type kernel;
+  box_rows box;
+  COMB_HOST COMB_DEVICE void operator()(IdxT r) const
+  {
+    kernel.copy_run(r * box.ilen, box.row(r), box.ilen);
+  }
+};
+
+
+// element types of mesh variables, the variables in an exchange may
+// have different types and are packed into the same messages
+enum struct data_type {
+  float64
+ ,float32
+ ,int32
+};
+
+inline IdxT data_type_size(data_type type)
+{
+  switch (type) {
+    case data_type::float64: return sizeof(double);
+    case data_type::float32: return sizeof(float);
+    case data_type::int32:   return sizeof(std::int32_t);
+  }
+  return 0;
+}
+
+inline const char* data_type_str(data_type type)
+{
+  switch (type) {
+    case data_type::float64: return "double";
+    case data_type::float32: return "float";
+    case data_type::int32:   return "int";
+  }
+  return "unknown";
+}
+
+// call body with a value of the c++ type of type
+template < typename body_type >
+inline void visit_data_type(data_type type, body_type&& body)
+{
+  switch (type) {
+    case data_type::float64: body(double{});       break;
+    case data_type::float32: body(float{});        break;
+    case data_type::int32:   body(std::int32_t{}); break;
+  }
+}
+
+// element of a variable of any type that converts to and from DataT,
+// for code where speed does not matter like the correctness checks
+struct any_data_ref {
+  void* ptr;
+  data_type type;
+  IdxT i;
+  COMB_HOST COMB_DEVICE operator DataT() const
+  {
+    switch (type) {
+      case data_type::float32: return static_cast<float*>(ptr)[i];
+      case data_type::int32:   return static_cast<std::int32_t*>(ptr)[i];
+      default:                 return static_cast<double*>(ptr)[i];
+    }
+  }
+  COMB_HOST COMB_DEVICE any_data_ref const& operator=(DataT val) const
+  {
+    switch (type) {
+      case data_type::float32: static_cast<float*>(ptr)[i] = static_cast<float>(val); break;
+      case data_type::int32:   static_cast<std::int32_t*>(ptr)[i] = static_cast<std::int32_t>(val); break;
+      default:                 static_cast<double*>(ptr)[i] = val; break;
+    }
+    return *this;
+  }
+};
+
+struct any_data_ptr {
+  void* ptr;
+  data_type type;
+  COMB_HOST COMB_DEVICE any_data_ref operator[](IdxT i) const
+  {
+    return any_data_ref{ptr, type, i};
+  }
+};
+
 } // namespace detail
 
-#endif // _UTILS_HPP
+// element types of the variables, variable v has type v % size
+inline std::vector<detail::data_type>& comb_variable_types()
+{
+  static std::vector<detail::data_type> types{detail::data_type::float64};
+  return types;
+}
 
+inline detail::data_type comb_variable_type(IdxT var)
+{
+  std::vector<detail::data_type> const& types = comb_variable_types();
+  return types[var % static_cast<IdxT>(types.size())];
+}
+
+// the fused and zone major packing kernels and mpi datatypes
+// only handle variables of type DataT
+inline bool comb_variables_are_DataT()
+{
+  for (detail::data_type type : comb_variable_types()) {
+    if (type != detail::data_type::float64) return false;
+  }
+  return true;
+}
+
+#endif // _UTILS_HPP
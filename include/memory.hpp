@@ -18,23 +18,184 @@
 
 #include "config.hpp"
 
+#include <cassert>
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <limits>
+#include <map>
 #include <utility>
 #include <stdexcept>
 
-#include "basic_mempool.hpp"
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#endif
+
+#include "sizeclass_mempool.hpp"
 
 #include "ExecContext.hpp"
 #include "exec_utils_cuda.hpp"
+#include "comm_utils_mpi.hpp"
 
 namespace COMB {
 
 namespace detail {
 
 template < typename alloc >
-using mempool = COMBRAJA::basic_mempool::MemPool<alloc>;
+using mempool = COMB::sizeclass_mempool::MemPool<alloc>;
+
+  // host memory mapped in 2 MiB aligned pieces backed by huge pages, from
+  // hugetlbfs when the system has reserved huge pages, otherwise
+  // transparent huge pages, optionally locked in memory
+  template < bool locked >
+  struct host_page_allocator {
+    static const size_t hugepage_size = 2ull * 1024ull * 1024ull;
+
+    void* malloc(size_t nbytes) {
+      size_t len = (nbytes + hugepage_size - 1) / hugepage_size * hugepage_size;
+      void* ptr = MAP_FAILED;
+#if defined(MAP_HUGETLB) && defined(MAP_HUGE_2MB)
+      ptr = mmap(nullptr, len, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_HUGE_2MB, -1, 0);
+#endif
+      if (ptr == MAP_FAILED) {
+        // map an extra huge page and trim to a huge page boundary
+        size_t map_len = len + hugepage_size;
+        void* map_ptr = mmap(nullptr, map_len, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (map_ptr == MAP_FAILED) {
+          return nullptr;
+        }
+        char* map_begin = static_cast<char*>(map_ptr);
+        char* begin = reinterpret_cast<char*>(
+            (reinterpret_cast<uintptr_t>(map_begin) + hugepage_size - 1) / hugepage_size * hugepage_size);
+        char* end = begin + len;
+        if (begin != map_begin) {
+          munmap(map_begin, begin - map_begin);
+        }
+        if (end != map_begin + map_len) {
+          munmap(end, map_begin + map_len - end);
+        }
+        ptr = begin;
+#if defined(MADV_HUGEPAGE)
+        madvise(ptr, len, MADV_HUGEPAGE);
+#endif
+      }
+      if (locked && mlock(ptr, len) != 0) {
+        static bool warned = false;
+        if (!warned) {
+          fgprintf(FileGroup::err_any, "mlock of %zu bytes failed, host_locked memory is not locked, check ulimit -l\n", len);
+          warned = true;
+        }
+      }
+      m_lens.emplace(ptr, len);
+      return ptr;
+    }
+    void free(void* ptr) {
+      auto iter = m_lens.find(ptr);
+      assert(iter != m_lens.end());
+      munmap(iter->first, iter->second);
+      m_lens.erase(iter);
+    }
+  private:
+    std::map<void*, size_t> m_lens;
+  };
+
+  using host_hugepage_allocator = host_page_allocator<false>;
+  using host_locked_allocator = host_page_allocator<true>;
+
+  namespace numa {
+
+  enum struct policy
+  { local
+  , interleave
+  , bind };
+
+  // node the bind policy places memory on
+  inline int& bind_node()
+  {
+    static int node = 0;
+    return node;
+  }
+
+  // set the policy of the pages in [ptr, ptr+len) with mbind, pages are
+  // placed by the policy when first touched, false on failure
+  inline bool apply(void* ptr, size_t len, policy pol)
+  {
+#if defined(__linux__) && defined(SYS_mbind) && defined(SYS_get_mempolicy)
+    const unsigned long bits = 8*sizeof(unsigned long);
+    const unsigned long maxnode = 1024;
+    unsigned long mask[maxnode / bits] = {};
+    int mode = MPOL_DEFAULT;
+    unsigned long* nodemask = nullptr;
+    switch (pol) {
+      case policy::local:
+#if defined(MPOL_LOCAL)
+        mode = MPOL_LOCAL;
+#else
+        // preferred with no nodes is local
+        mode = MPOL_PREFERRED;
+#endif
+        break;
+      case policy::interleave:
+        mode = MPOL_INTERLEAVE;
+        if (syscall(SYS_get_mempolicy, nullptr, mask, maxnode, nullptr, MPOL_F_MEMS_ALLOWED) != 0) {
+          return false;
+        }
+        nodemask = mask;
+        break;
+      case policy::bind:
+        mode = MPOL_BIND;
+        if (bind_node() < 0 || (unsigned long)bind_node() >= maxnode - 1) {
+          return false;
+        }
+        mask[bind_node() / bits] |= 1ul << (bind_node() % bits);
+        nodemask = mask;
+        break;
+    }
+    return syscall(SYS_mbind, ptr, len, mode, nodemask, nodemask ? maxnode : 0ul, 0u) == 0;
+#else
+    COMB::ignore_unused(ptr, len, pol);
+    return false;
+#endif
+  }
+
+  } // namespace numa
+
+  // host memory mapped in pages with a numa policy
+  template < numa::policy pol >
+  struct host_numa_allocator {
+    void* malloc(size_t nbytes) {
+      size_t page_size = sysconf(_SC_PAGESIZE);
+      size_t len = (nbytes + page_size - 1) / page_size * page_size;
+      void* ptr = mmap(nullptr, len, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (ptr == MAP_FAILED) {
+        return nullptr;
+      }
+      if (!numa::apply(ptr, len, pol)) {
+        static bool warned = false;
+        if (!warned) {
+          fgprintf(FileGroup::err_any, "mbind failed, host numa memory uses the default numa policy\n");
+          warned = true;
+        }
+      }
+      m_lens.emplace(ptr, len);
+      return ptr;
+    }
+    void free(void* ptr) {
+      auto iter = m_lens.find(ptr);
+      assert(iter != m_lens.end());
+      munmap(iter->first, iter->second);
+      m_lens.erase(iter);
+    }
+  private:
+    std::map<void*, size_t> m_lens;
+  };
 
 #ifdef COMB_ENABLE_CUDA
   struct cuda_host_pinned_allocator {
@@ -150,8 +311,48 @@ struct Allocator
     // LOGPRINTF("deallocating %p\n", ptr);
     assert(ptr == nullptr);
   }
+  // allocator for per rank data used alongside this allocator's memory,
+  // like mesh indices, allocators with collective allocations return one
+  // without
+  virtual Allocator& local_allocator() { return *this; }
+  // statistics of the memory pool behind this allocator, allocators
+  // without a pool have none
+  virtual void clear_statistics() { }
+  virtual void print_statistics() { }
 };
 
+// print the memory pool statistics of each test's allocators to the proc
+// files after the test
+inline bool& comb_print_mempool_stats()
+{
+  static bool print = false;
+  return print;
+}
+
+// clear the statistics of a test's allocators, each allocator once
+inline void clear_allocator_statistics(Allocator& aloc_mesh, Allocator& aloc_many, Allocator& aloc_few)
+{
+  aloc_mesh.clear_statistics();
+  if (&aloc_many != &aloc_mesh) {
+    aloc_many.clear_statistics();
+  }
+  if (&aloc_few != &aloc_mesh && &aloc_few != &aloc_many) {
+    aloc_few.clear_statistics();
+  }
+}
+
+// print the statistics of a test's allocators, each allocator once
+inline void print_allocator_statistics(Allocator& aloc_mesh, Allocator& aloc_many, Allocator& aloc_few)
+{
+  aloc_mesh.print_statistics();
+  if (&aloc_many != &aloc_mesh) {
+    aloc_many.print_statistics();
+  }
+  if (&aloc_few != &aloc_mesh && &aloc_few != &aloc_many) {
+    aloc_few.print_statistics();
+  }
+}
+
 struct HostAllocator : Allocator
 {
   const char* name() override { return "Host"; }
@@ -168,6 +369,97 @@ struct HostAllocator : Allocator
   }
 };
 
+struct HostHugepageAllocator : Allocator
+{
+  const char* name() override { return "HostHugepage"; }
+  void* allocate(size_t nbytes) override
+  {
+    void* ptr = detail::mempool<detail::host_hugepage_allocator>::getInstance().malloc<char>(nbytes);
+    // LOGPRINTF("allocated %p nbytes %zu\n", ptr, nbytes);
+    return ptr;
+  }
+  void deallocate(void* ptr) override
+  {
+    // LOGPRINTF("deallocating %p\n", ptr);
+    detail::mempool<detail::host_hugepage_allocator>::getInstance().free(ptr);
+  }
+  void clear_statistics() override
+  {
+    detail::mempool<detail::host_hugepage_allocator>::getInstance().clear_statistics();
+  }
+  void print_statistics() override
+  {
+    sizeclass_mempool::print_statistics(name(), detail::mempool<detail::host_hugepage_allocator>::getInstance());
+  }
+};
+
+struct HostLockedAllocator : Allocator
+{
+  const char* name() override { return "HostLocked"; }
+  void* allocate(size_t nbytes) override
+  {
+    void* ptr = detail::mempool<detail::host_locked_allocator>::getInstance().malloc<char>(nbytes);
+    // LOGPRINTF("allocated %p nbytes %zu\n", ptr, nbytes);
+    return ptr;
+  }
+  void deallocate(void* ptr) override
+  {
+    // LOGPRINTF("deallocating %p\n", ptr);
+    detail::mempool<detail::host_locked_allocator>::getInstance().free(ptr);
+  }
+  void clear_statistics() override
+  {
+    detail::mempool<detail::host_locked_allocator>::getInstance().clear_statistics();
+  }
+  void print_statistics() override
+  {
+    sizeclass_mempool::print_statistics(name(), detail::mempool<detail::host_locked_allocator>::getInstance());
+  }
+};
+
+template < detail::numa::policy pol >
+struct HostNumaAllocator : Allocator
+{
+  const char* name() override
+  {
+    switch (pol) {
+      case detail::numa::policy::local:
+        return "HostNumaLocal";
+      case detail::numa::policy::interleave:
+        return "HostNumaInterleave";
+      case detail::numa::policy::bind:
+        snprintf(m_name, sizeof(m_name), "HostNumaBind%i", detail::numa::bind_node());
+        return m_name;
+    }
+    return "HostNuma";
+  }
+  void* allocate(size_t nbytes) override
+  {
+    void* ptr = detail::mempool<detail::host_numa_allocator<pol>>::getInstance().template malloc<char>(nbytes);
+    // LOGPRINTF("allocated %p nbytes %zu\n", ptr, nbytes);
+    return ptr;
+  }
+  void deallocate(void* ptr) override
+  {
+    // LOGPRINTF("deallocating %p\n", ptr);
+    detail::mempool<detail::host_numa_allocator<pol>>::getInstance().free(ptr);
+  }
+  void clear_statistics() override
+  {
+    detail::mempool<detail::host_numa_allocator<pol>>::getInstance().clear_statistics();
+  }
+  void print_statistics() override
+  {
+    sizeclass_mempool::print_statistics(name(), detail::mempool<detail::host_numa_allocator<pol>>::getInstance());
+  }
+private:
+  char m_name[32] = "";
+};
+
+using HostNumaLocalAllocator      = HostNumaAllocator<detail::numa::policy::local>;
+using HostNumaInterleaveAllocator = HostNumaAllocator<detail::numa::policy::interleave>;
+using HostNumaBindAllocator       = HostNumaAllocator<detail::numa::policy::bind>;
+
 struct HostPinnedAllocator : Allocator
 {
 #ifdef COMB_ENABLE_CUDA
@@ -181,6 +473,14 @@ struct HostPinnedAllocator : Allocator
   {
     detail::mempool<detail::cuda_host_pinned_allocator>::getInstance().free(ptr);
   }
+  void clear_statistics() override
+  {
+    detail::mempool<detail::cuda_host_pinned_allocator>::getInstance().clear_statistics();
+  }
+  void print_statistics() override
+  {
+    sizeclass_mempool::print_statistics(name(), detail::mempool<detail::cuda_host_pinned_allocator>::getInstance());
+  }
 #endif
 };
 
@@ -197,6 +497,14 @@ struct DeviceAllocator : Allocator
   {
     detail::mempool<detail::cuda_device_allocator>::getInstance().free(ptr);
   }
+  void clear_statistics() override
+  {
+    detail::mempool<detail::cuda_device_allocator>::getInstance().clear_statistics();
+  }
+  void print_statistics() override
+  {
+    sizeclass_mempool::print_statistics(name(), detail::mempool<detail::cuda_device_allocator>::getInstance());
+  }
 #endif
 };
 
@@ -213,6 +521,14 @@ struct ManagedAllocator : Allocator
   {
     detail::mempool<detail::cuda_managed_allocator>::getInstance().free(ptr);
   }
+  void clear_statistics() override
+  {
+    detail::mempool<detail::cuda_managed_allocator>::getInstance().clear_statistics();
+  }
+  void print_statistics() override
+  {
+    sizeclass_mempool::print_statistics(name(), detail::mempool<detail::cuda_managed_allocator>::getInstance());
+  }
 #endif
 };
 
@@ -229,6 +545,14 @@ struct ManagedHostPreferredAllocator : Allocator
   {
     detail::mempool<detail::cuda_managed_host_preferred_allocator>::getInstance().free(ptr);
   }
+  void clear_statistics() override
+  {
+    detail::mempool<detail::cuda_managed_host_preferred_allocator>::getInstance().clear_statistics();
+  }
+  void print_statistics() override
+  {
+    sizeclass_mempool::print_statistics(name(), detail::mempool<detail::cuda_managed_host_preferred_allocator>::getInstance());
+  }
 #endif
 };
 
@@ -245,6 +569,14 @@ struct ManagedHostPreferredDeviceAccessedAllocator : Allocator
   {
     detail::mempool<detail::cuda_managed_host_preferred_device_accessed_allocator>::getInstance().free(ptr);
   }
+  void clear_statistics() override
+  {
+    detail::mempool<detail::cuda_managed_host_preferred_device_accessed_allocator>::getInstance().clear_statistics();
+  }
+  void print_statistics() override
+  {
+    sizeclass_mempool::print_statistics(name(), detail::mempool<detail::cuda_managed_host_preferred_device_accessed_allocator>::getInstance());
+  }
 #endif
 };
 
@@ -261,6 +593,14 @@ struct ManagedDevicePreferredAllocator : Allocator
   {
     detail::mempool<detail::cuda_managed_device_preferred_allocator>::getInstance().free(ptr);
   }
+  void clear_statistics() override
+  {
+    detail::mempool<detail::cuda_managed_device_preferred_allocator>::getInstance().clear_statistics();
+  }
+  void print_statistics() override
+  {
+    sizeclass_mempool::print_statistics(name(), detail::mempool<detail::cuda_managed_device_preferred_allocator>::getInstance());
+  }
 #endif
 };
 
@@ -277,10 +617,89 @@ struct ManagedDevicePreferredHostAccessedAllocator : Allocator
   {
     detail::mempool<detail::cuda_managed_device_preferred_host_accessed_allocator>::getInstance().free(ptr);
   }
+  void clear_statistics() override
+  {
+    detail::mempool<detail::cuda_managed_device_preferred_host_accessed_allocator>::getInstance().clear_statistics();
+  }
+  void print_statistics() override
+  {
+    sizeclass_mempool::print_statistics(name(), detail::mempool<detail::cuda_managed_device_preferred_host_accessed_allocator>::getInstance());
+  }
 #endif
 };
 
 
+#ifdef COMB_ENABLE_MPI
+
+// host memory in mpi shared memory windows, every allocation is collective
+// over the ranks of a node so those ranks can read each others allocations
+struct MPISharedAllocator : Allocator
+{
+  MPISharedAllocator(MPI_Comm comm)
+    : m_node_comm(::detail::MPI::Comm_split_type_shared(comm))
+  { }
+
+  MPISharedAllocator(MPISharedAllocator const&) = delete;
+  MPISharedAllocator& operator=(MPISharedAllocator const&) = delete;
+
+  const char* name() override { return "MPIShared"; }
+  void* allocate(size_t nbytes) override
+  {
+    void* ptr = nullptr;
+    MPI_Win win = ::detail::MPI::Win_allocate_shared(nbytes, m_node_comm, &ptr);
+    // a passive target epoch for the lifetime of the window so sync may be
+    // called on it, ranks coordinate with messages instead of locks
+    ::detail::MPI::Win_lock_all(MPI_MODE_NOCHECK, win);
+    m_wins.emplace(ptr, win);
+    // LOGPRINTF("allocated %p nbytes %zu\n", ptr, nbytes);
+    return ptr;
+  }
+  void deallocate(void* ptr) override
+  {
+    // LOGPRINTF("deallocating %p\n", ptr);
+    auto iter = m_wins.find(ptr);
+    assert(iter != m_wins.end());
+    ::detail::MPI::Win_unlock_all(iter->second);
+    ::detail::MPI::Win_free(&iter->second);
+    m_wins.erase(iter);
+  }
+  Allocator& local_allocator() override { return m_local_allocator; }
+
+  // the communicator of the ranks that share allocations with this rank
+  MPI_Comm node_comm() const { return m_node_comm; }
+
+  // the allocation of node_rank made by the same collective call as ptr
+  void* query(void* ptr, int node_rank)
+  {
+    auto iter = m_wins.find(ptr);
+    assert(iter != m_wins.end());
+    return ::detail::MPI::Win_shared_query(iter->second, node_rank);
+  }
+
+  // synchronize the public and private copies of the window of ptr, orders
+  // this rank's loads and stores in it with those of the other ranks
+  void sync(void* ptr)
+  {
+    auto iter = m_wins.find(ptr);
+    assert(iter != m_wins.end());
+    ::detail::MPI::Win_sync(iter->second);
+  }
+
+  ~MPISharedAllocator()
+  {
+    assert(m_wins.empty());
+    ::detail::MPI::Comm_free(&m_node_comm);
+  }
+
+private:
+  MPI_Comm m_node_comm;
+  std::map<void*, MPI_Win> m_wins;
+  HostAllocator m_local_allocator;
+};
+
+#endif
+
+
 template < typename T >
 struct std_allocator
 {
@@ -412,6 +831,73 @@ private:
   HostAllocator m_allocator;
 };
 
+struct HostHugepageAllocatorInfo : AllocatorInfo
+{
+  HostHugepageAllocatorInfo(AllocatorAccessibilityFlags& a) : AllocatorInfo(a) { }
+  Allocator& allocator() override { return m_allocator; }
+  bool available() override { return m_available; }
+  bool accessible(CPUContext const&) override { return true; }
+#ifdef COMB_ENABLE_MPI
+  bool accessible(MPIContext const&) override { return true; }
+#endif
+#ifdef COMB_ENABLE_CUDA
+  bool accessible(CudaContext const&) override { return m_accessFlags.cuda_host_accessible_from_device; }
+#endif
+#ifdef COMB_ENABLE_RAJA
+  bool accessible(RAJAContext<RAJA::resources::Host> const&) override { return true; }
+#ifdef COMB_ENABLE_CUDA
+  bool accessible(RAJAContext<RAJA::resources::Cuda> const&) override { return m_accessFlags.cuda_host_accessible_from_device; }
+#endif
+#endif
+private:
+  HostHugepageAllocator m_allocator;
+};
+
+struct HostLockedAllocatorInfo : AllocatorInfo
+{
+  HostLockedAllocatorInfo(AllocatorAccessibilityFlags& a) : AllocatorInfo(a) { }
+  Allocator& allocator() override { return m_allocator; }
+  bool available() override { return m_available; }
+  bool accessible(CPUContext const&) override { return true; }
+#ifdef COMB_ENABLE_MPI
+  bool accessible(MPIContext const&) override { return true; }
+#endif
+#ifdef COMB_ENABLE_CUDA
+  bool accessible(CudaContext const&) override { return m_accessFlags.cuda_host_accessible_from_device; }
+#endif
+#ifdef COMB_ENABLE_RAJA
+  bool accessible(RAJAContext<RAJA::resources::Host> const&) override { return true; }
+#ifdef COMB_ENABLE_CUDA
+  bool accessible(RAJAContext<RAJA::resources::Cuda> const&) override { return m_accessFlags.cuda_host_accessible_from_device; }
+#endif
+#endif
+private:
+  HostLockedAllocator m_allocator;
+};
+
+template < detail::numa::policy pol >
+struct HostNumaAllocatorInfo : AllocatorInfo
+{
+  HostNumaAllocatorInfo(AllocatorAccessibilityFlags& a) : AllocatorInfo(a) { }
+  Allocator& allocator() override { return m_allocator; }
+  bool available() override { return m_available; }
+  bool accessible(CPUContext const&) override { return true; }
+#ifdef COMB_ENABLE_MPI
+  bool accessible(MPIContext const&) override { return true; }
+#endif
+#ifdef COMB_ENABLE_CUDA
+  bool accessible(CudaContext const&) override { return m_accessFlags.cuda_host_accessible_from_device; }
+#endif
+#ifdef COMB_ENABLE_RAJA
+  bool accessible(RAJAContext<RAJA::resources::Host> const&) override { return true; }
+#ifdef COMB_ENABLE_CUDA
+  bool accessible(RAJAContext<RAJA::resources::Cuda> const&) override { return m_accessFlags.cuda_host_accessible_from_device; }
+#endif
+#endif
+private:
+  HostNumaAllocator<pol> m_allocator;
+};
+
 #ifdef COMB_ENABLE_CUDA
 
 struct HostPinnedAllocatorInfo : AllocatorInfo
@@ -542,12 +1028,42 @@ private:
 
 #endif
 
+#ifdef COMB_ENABLE_MPI
+
+struct MPISharedAllocatorInfo : AllocatorInfo
+{
+  MPISharedAllocatorInfo(AllocatorAccessibilityFlags& a, MPI_Comm comm) : AllocatorInfo(a), m_allocator(comm) { }
+  Allocator& allocator() override { return m_allocator; }
+  MPISharedAllocator& shared_allocator() { return m_allocator; }
+  bool available() override { return m_available; }
+  bool accessible(CPUContext const&) override { return true; }
+  bool accessible(MPIContext const&) override { return true; }
+#ifdef COMB_ENABLE_CUDA
+  bool accessible(CudaContext const&) override { return false; }
+#endif
+#ifdef COMB_ENABLE_RAJA
+  bool accessible(RAJAContext<RAJA::resources::Host> const&) override { return true; }
+#ifdef COMB_ENABLE_CUDA
+  bool accessible(RAJAContext<RAJA::resources::Cuda> const&) override { return false; }
+#endif
+#endif
+private:
+  MPISharedAllocator m_allocator;
+};
+
+#endif
+
 struct Allocators
 {
   AllocatorAccessibilityFlags access;
 
   InvalidAllocatorInfo                            invalid{access};
   HostAllocatorInfo                               host{access};
+  HostHugepageAllocatorInfo                       host_hugepage{access};
+  HostLockedAllocatorInfo                         host_locked{access};
+  HostNumaAllocatorInfo<detail::numa::policy::local>      host_numa_local{access};
+  HostNumaAllocatorInfo<detail::numa::policy::interleave> host_numa_interleave{access};
+  HostNumaAllocatorInfo<detail::numa::policy::bind>       host_numa_bind{access};
 #ifdef COMB_ENABLE_CUDA
   HostPinnedAllocatorInfo                         cuda_hostpinned{access};
   DeviceAllocatorInfo                             cuda_device{access};
@@ -43,7 +43,8 @@ extern FILE* comb_summary_file;
 extern void comb_setup_files();
 extern void comb_teardown_files();
 
-extern void fgprintf(FileGroup fg, const char* fmt, ...);
+// format checked like printf to catch mismatches with the index type sizes
+extern void fgprintf(FileGroup fg, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
 extern void print_proc_memory_stats();
 
 #ifdef __CUDA_ARCH__
@@ -151,6 +151,24 @@ struct Timer {
     start(con, nullptr);
   }
 
+  // add a segment of a length measured elsewhere, call while stopped
+  void add(const char* str, double seconds) {
+    if (idx+1 >= times.size()) {
+      resize(2*idx+4);
+      assert(idx+1 < times.size());
+    }
+    auto tp = std::chrono::high_resolution_clock::now();
+    times[idx].tp_cpu = tp;
+    times[idx].type = cpu;
+    names[idx] = str;
+    ++idx;
+    times[idx].tp_cpu = tp + std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>(
+                                 std::chrono::duration<double>(seconds));
+    times[idx].type = cpu;
+    names[idx] = nullptr;
+    ++idx;
+  }
+
   std::vector<std::pair<std::string, double>> get_times()
   {
     std::vector<std::pair<std::string, double>> items;
@@ -0,0 +1,784 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2018-2021, Lawrence Livermore National Security, LLC.
+//
+// Produced at the Lawrence Livermore National Laboratory
+//
+// LLNL-CODE-758885
+//
+// All rights reserved.
+//
+// This file is part of Comb.
+//
+// For details, see https://github.com/LLNL/Comb
+// Please also see the LICENSE file for MIT license.
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef _SIZECLASS_MEMPOOL_HPP
+#define _SIZECLASS_MEMPOOL_HPP
+
+#include "config.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <list>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "align.hpp"
+#include "mutex.hpp"
+#include "print.hpp"
+
+namespace COMB {
+
+namespace sizeclass_mempool {
+
+namespace detail {
+
+// Block sizes are multiples of granularity with four size classes per
+// power of two, so a block is at most 25% larger than the request.
+// Classes 0-3 hold 1-4 granules, class 4 + 4*(k-2) + (m-1) holds
+// 2^k + m*2^(k-2) granules for m in 1-4.
+struct size_classes
+{
+  // alignment of every block, matches cudaMalloc
+  static const size_t granularity = 256;
+
+  static const size_t num_classes = 4 + 4*(8*sizeof(size_t) - 10);
+
+  // smallest class with size >= nbytes
+  static size_t index(size_t nbytes)
+  {
+    size_t units = std::max((nbytes + granularity - 1) / granularity, size_t(1));
+    if (units <= 4) {
+      return units - 1;
+    }
+    size_t k = log2(units - 1);
+    size_t step = size_t(1) << (k - 2);
+    size_t m = (units - (size_t(1) << k) + step - 1) >> (k - 2);
+    return 4 + 4*(k - 2) + (m - 1);
+  }
+
+  // largest class with size <= nbytes, nbytes >= granularity
+  static size_t floor_index(size_t nbytes)
+  {
+    size_t idx = index(nbytes);
+    return (size(idx) > nbytes) ? idx - 1 : idx;
+  }
+
+  static size_t size(size_t idx)
+  {
+    if (idx < 4) {
+      return (idx + 1) * granularity;
+    }
+    size_t k = (idx - 4) / 4 + 2;
+    size_t m = (idx - 4) % 4 + 1;
+    return ((size_t(1) << k) + m * (size_t(1) << (k - 2))) * granularity;
+  }
+
+  static size_t log2(size_t n)
+  {
+#if defined(__GNUC__)
+    return 8*sizeof(unsigned long long) - 1 - __builtin_clzll(n);
+#else
+    size_t k = 0;
+    while (n >>= 1) ++k;
+    return k;
+#endif
+  }
+};
+
+// mutex that counts how often it was taken and how long callers waited
+class counted_mutex
+{
+public:
+  void lock()
+  {
+#if defined(COMB_ENABLE_OPENMP)
+    if (!m_mutex.try_lock()) {
+      auto start = std::chrono::steady_clock::now();
+      m_mutex.lock();
+      auto stop = std::chrono::steady_clock::now();
+      contended += 1;
+      wait_time += std::chrono::duration<double>(stop - start).count();
+    }
+#endif
+    acquires += 1;
+  }
+
+  void unlock()
+  {
+#if defined(COMB_ENABLE_OPENMP)
+    m_mutex.unlock();
+#endif
+  }
+
+  // only touched while locked
+  size_t acquires = 0;
+  size_t contended = 0;
+  double wait_time = 0.0;
+
+private:
+#if defined(COMB_ENABLE_OPENMP)
+  COMBRAJA::omp::mutex m_mutex;
+#endif
+};
+
+// number of malloc latency histogram bins, bin b counts calls that took
+// [2^b, 2^(b+1)) ns
+static const size_t num_latency_bins = 32;
+
+inline size_t latency_bin(double seconds)
+{
+  size_t ns = static_cast<size_t>(seconds * 1e9);
+  return std::min(size_classes::log2(std::max(ns, size_t(1))), num_latency_bins - 1);
+}
+
+// pools get ids that are never reused so a thread never finds its cache
+// of a destroyed pool in a new pool at the same address
+inline size_t next_pool_id()
+{
+  static std::atomic<size_t> s_next_id{0};
+  return ++s_next_id;
+}
+
+// the calling thread's caches in each pool it used, by pool id
+inline std::vector<std::pair<size_t, void*>>& thread_caches()
+{
+  thread_local std::vector<std::pair<size_t, void*>> t_caches;
+  return t_caches;
+}
+
+} /* end namespace detail */
+
+// timing every malloc for the latency histograms costs more than a cache
+// hit, so it is only done when enabled, set before using any pool
+inline bool& instrument()
+{
+  static bool enabled = false;
+  return enabled;
+}
+
+
+/*! \class MemPool
+ ******************************************************************************
+ *
+ * \brief  MemPool with segregated free lists, a drop in replacement for
+ * COMBRAJA::basic_mempool::MemPool
+ *
+ * Arenas are carved into blocks of fixed size classes. Freed blocks go onto
+ * the free list of their class and are reused as is, so malloc is a pop
+ * from a free list or a bump of the current arena. Blocks are never split
+ * or merged, when an arena runs out the rest of it is carved into the
+ * largest blocks that fit.
+ *
+ * Each thread keeps a small cache of free blocks per class in front of the
+ * shared free lists. Steady state malloc and free only touch the calling
+ * thread's cache and the table of allocated blocks, the lock is taken to
+ * refill an empty cache or drain a full one half a cache at a time, and
+ * to return blocks a thread has not needed for a while.
+ *
+ * Book-keeping lives on the host so the allocator may return memory the
+ * host can not access, like cudaMalloc.
+ *
+ * free_chunks must not be called while other threads use the pool.
+ *
+ * get_statistics reports the arenas and the bytes reserved from the
+ * allocator, the bytes held by callers and thread caches, and the free
+ * bytes left in the shared free lists and the current arena.
+ *
+ ******************************************************************************
+ */
+template <typename allocator_t>
+class MemPool
+{
+public:
+  using allocator_type = allocator_t;
+  using size_classes = detail::size_classes;
+
+  static inline MemPool<allocator_t>& getInstance()
+  {
+    static MemPool<allocator_t> pool{};
+    return pool;
+  }
+
+  static const size_t default_default_arena_size = 32ull * 1024ull * 1024ull;
+
+  // bytes of each size class a thread may cache
+  static const size_t default_cache_size = 4ull * 1024ull * 1024ull;
+
+  // most blocks of one size class a thread may cache
+  static const size_t max_cached_blocks = 64;
+
+  // cache operations between returns of unneeded blocks
+  static const size_t cache_period = 1024;
+
+  // most arenas, lookup of a block's arena must not race with new arenas
+  static const size_t max_arenas = 4096;
+
+  struct statistics {
+    size_t arenas = 0;
+    // arenas allocated since the statistics were cleared
+    size_t arenas_allocated = 0;
+    size_t bytes_reserved = 0;
+    // bytes of the blocks held by callers and by thread caches
+    size_t bytes_in_use = 0;
+    size_t bytes_cached = 0;
+    // most bytes held by callers and thread caches at once
+    size_t bytes_high_water = 0;
+    // bytes in the shared free lists and the rest of the current arena,
+    // blocks are never merged so the largest free chunk is one block or
+    // the rest of the current arena
+    size_t bytes_free = 0;
+    size_t largest_free = 0;
+    size_t allocations = 0;
+    size_t cache_hits = 0;
+    size_t cache_misses = 0;
+    size_t lock_acquires = 0;
+    size_t lock_contended = 0;
+    double lock_wait_time = 0.0;
+    // only counted when instrument() is enabled
+    size_t malloc_latency[detail::num_latency_bins] = {};
+  };
+
+  MemPool()
+      : m_id(detail::next_pool_id()),
+        m_free_blocks(size_classes::num_classes),
+        m_bump_begin(nullptr), m_bump_end(nullptr),
+        m_bytes_reserved(0), m_bytes_held(0), m_bytes_high_water(0),
+        m_arenas_allocated(0), m_uncached_allocations(0),
+        m_default_arena_size(default_default_arena_size),
+        m_cache_size(default_cache_size), m_alloc()
+  {
+    LOGPRINTF("%p sizeclass MemPool::MemPool m_default_arena_size %zu\n", this, m_default_arena_size);
+  }
+
+  ~MemPool()
+  {
+    // as with basic_mempool::MemPool no allocator calls here, static
+    // objects may outlive the runtime the allocator uses
+    size_t num_arenas = m_num_arenas.load(std::memory_order_relaxed);
+    for (size_t a = 0; a < num_arenas; ++a) {
+      delete m_arenas[a].load(std::memory_order_relaxed);
+    }
+  }
+
+  void free_chunks()
+  {
+    LOGPRINTF("%p sizeclass MemPool::free_chunks\n", this);
+    COMBRAJA::lock_guard<detail::counted_mutex> lock(m_mutex);
+
+    size_t num_arenas = m_num_arenas.load(std::memory_order_relaxed);
+    for (size_t a = 0; a < num_arenas; ++a) {
+      arena* ar = m_arenas[a].load(std::memory_order_relaxed);
+      m_alloc.free(ar->allocation);
+      delete ar;
+      m_arenas[a].store(nullptr, std::memory_order_relaxed);
+    }
+    m_num_arenas.store(0, std::memory_order_release);
+
+    for (std::vector<void*>& free_blocks : m_free_blocks) {
+      free_blocks.clear();
+    }
+    for (thread_cache& cache : m_caches) {
+      for (magazine& mag : cache.magazines) {
+        mag.blocks.clear();
+        mag.low_water = 0;
+      }
+      cache.bytes_cached.store(0, std::memory_order_relaxed);
+    }
+    m_bump_begin = nullptr;
+    m_bump_end = nullptr;
+    m_bytes_reserved = 0;
+    m_bytes_held = 0;
+  }
+
+  size_t arena_size()
+  {
+    COMBRAJA::lock_guard<detail::counted_mutex> lock(m_mutex);
+
+    return m_default_arena_size;
+  }
+
+  size_t arena_size(size_t new_size)
+  {
+    COMBRAJA::lock_guard<detail::counted_mutex> lock(m_mutex);
+
+    size_t prev_size = m_default_arena_size;
+    m_default_arena_size = new_size;
+    return prev_size;
+  }
+
+  // bytes of each size class a thread may cache, 0 disables the caches,
+  // only change when no other thread uses the pool
+  size_t cache_size()
+  {
+    return m_cache_size;
+  }
+
+  size_t cache_size(size_t new_size)
+  {
+    flush_caches();
+    size_t prev_size = m_cache_size;
+    m_cache_size = new_size;
+    return prev_size;
+  }
+
+  // return every thread's cached blocks to the shared free lists,
+  // only call when no other thread uses the pool
+  void flush_caches()
+  {
+    COMBRAJA::lock_guard<detail::counted_mutex> lock(m_mutex);
+
+    for (thread_cache& cache : m_caches) {
+      for (size_t idx = 0; idx < size_classes::num_classes; ++idx) {
+        give_blocks(cache, idx, cache.magazines[idx].blocks.size());
+      }
+    }
+  }
+
+  statistics get_statistics()
+  {
+    COMBRAJA::lock_guard<detail::counted_mutex> lock(m_mutex);
+
+    statistics stats;
+    for (thread_cache& cache : m_caches) {
+      stats.cache_hits   += cache.hits.load(std::memory_order_relaxed);
+      stats.cache_misses += cache.misses.load(std::memory_order_relaxed);
+      stats.bytes_cached += cache.bytes_cached.load(std::memory_order_relaxed);
+      for (size_t b = 0; b < detail::num_latency_bins; ++b) {
+        stats.malloc_latency[b] += cache.malloc_latency[b].load(std::memory_order_relaxed);
+      }
+    }
+    stats.arenas           = m_num_arenas.load(std::memory_order_relaxed);
+    stats.arenas_allocated = m_arenas_allocated;
+    stats.bytes_reserved   = m_bytes_reserved;
+    // blocks move between caches and callers without the lock
+    stats.bytes_cached     = std::min(stats.bytes_cached, m_bytes_held);
+    stats.bytes_in_use     = m_bytes_held - stats.bytes_cached;
+    stats.bytes_high_water = m_bytes_high_water;
+    stats.bytes_free       = m_bump_end - m_bump_begin;
+    stats.largest_free     = m_bump_end - m_bump_begin;
+    for (size_t idx = 0; idx < size_classes::num_classes; ++idx) {
+      size_t num_free = m_free_blocks[idx].size();
+      if (num_free > 0) {
+        stats.bytes_free  += num_free * size_classes::size(idx);
+        stats.largest_free = std::max(stats.largest_free, size_classes::size(idx));
+      }
+    }
+    stats.allocations    = stats.cache_hits + stats.cache_misses + m_uncached_allocations;
+    stats.lock_acquires  = m_mutex.acquires;
+    stats.lock_contended = m_mutex.contended;
+    stats.lock_wait_time = m_mutex.wait_time;
+    return stats;
+  }
+
+  void clear_statistics()
+  {
+    COMBRAJA::lock_guard<detail::counted_mutex> lock(m_mutex);
+
+    for (thread_cache& cache : m_caches) {
+      cache.hits.store(0, std::memory_order_relaxed);
+      cache.misses.store(0, std::memory_order_relaxed);
+      for (std::atomic<size_t>& count : cache.malloc_latency) {
+        count.store(0, std::memory_order_relaxed);
+      }
+    }
+    m_bytes_high_water = m_bytes_held;
+    m_arenas_allocated = 0;
+    m_uncached_allocations = 0;
+    // acquires counts this lock once it is released
+    m_mutex.acquires = 0;
+    m_mutex.contended = 0;
+    m_mutex.wait_time = 0.0;
+  }
+
+  template <typename T>
+  T* malloc(size_t nTs, size_t alignment = std::max(alignof(T), alignof(std::max_align_t)))
+  {
+    LOGPRINTF("%p sizeclass MemPool::malloc sizeof(T) %zu nTs %zu align %zu\n", this, sizeof(T), nTs, alignment);
+
+    const size_t size = nTs * sizeof(T);
+    void* ptr = nullptr;
+
+    const bool timed = instrument();
+    std::chrono::steady_clock::time_point start;
+    if (timed) {
+      start = std::chrono::steady_clock::now();
+    }
+
+    if (size > 0u) {
+      // blocks are only aligned to the granularity, leave room to align
+      size_t nbytes = size;
+      if (alignment > size_classes::granularity) {
+        nbytes += alignment - size_classes::granularity;
+      }
+      const size_t idx = size_classes::index(nbytes);
+
+      void* block = nullptr;
+      const size_t capacity = cache_capacity(idx);
+      if (capacity > 0) {
+        thread_cache& cache = get_cache();
+        magazine& mag = cache.magazines[idx];
+        if (mag.blocks.empty()) {
+          increment(cache.misses);
+          COMBRAJA::lock_guard<detail::counted_mutex> lock(m_mutex);
+          take_blocks(cache, idx, (capacity + 1) / 2);
+        } else {
+          increment(cache.hits);
+        }
+        if (!mag.blocks.empty()) {
+          block = mag.blocks.back();
+          mag.blocks.pop_back();
+          mag.low_water = std::min(mag.low_water, mag.blocks.size());
+          add(cache.bytes_cached, -size_classes::size(idx));
+        }
+        tick(cache);
+      } else {
+        COMBRAJA::lock_guard<detail::counted_mutex> lock(m_mutex);
+        block = get_block(idx);
+        m_uncached_allocations += 1;
+      }
+
+      if (block != nullptr) {
+        ptr = block;
+        size_t space = size_classes::size(idx);
+        ::COMBRAJA::align(alignment, size, ptr, space);
+        set_entry(ptr, block, idx);
+      }
+    }
+
+    if (timed) {
+      auto stop = std::chrono::steady_clock::now();
+      increment(get_cache().malloc_latency[
+          detail::latency_bin(std::chrono::duration<double>(stop - start).count())]);
+    }
+
+    LOGPRINTF("%p sizeclass MemPool::malloc return %p\n", this, ptr);
+    return static_cast<T*>(ptr);
+  }
+
+  void free(const void* cptr)
+  {
+    void* ptr = const_cast<void*>(cptr);
+    LOGPRINTF("%p sizeclass MemPool::free ptr %p\n", this, ptr);
+
+    if (ptr != nullptr) {
+      void* block = nullptr;
+      size_t idx = 0;
+      if (take_entry(ptr, block, idx)) {
+        const size_t capacity = cache_capacity(idx);
+        if (capacity > 0) {
+          thread_cache& cache = get_cache();
+          magazine& mag = cache.magazines[idx];
+          mag.blocks.push_back(block);
+          add(cache.bytes_cached, size_classes::size(idx));
+          if (mag.blocks.size() > capacity) {
+            COMBRAJA::lock_guard<detail::counted_mutex> lock(m_mutex);
+            give_blocks(cache, idx, mag.blocks.size() - capacity / 2);
+          }
+          tick(cache);
+        } else {
+          COMBRAJA::lock_guard<detail::counted_mutex> lock(m_mutex);
+          m_free_blocks[idx].push_back(block);
+          m_bytes_held -= size_classes::size(idx);
+        }
+        ptr = nullptr;
+      }
+    }
+    if (ptr != nullptr) {
+      fprintf(stderr, "Unknown pointer %p", ptr);
+    }
+  }
+
+private:
+  // one entry per granule of an arena, 0 if no allocation starts there,
+  // otherwise size class + 1 and granules from the block start shifted by 8
+  using entry_type = uint32_t;
+
+  struct arena {
+    void* allocation;
+    char* begin;
+    char* end;
+    std::unique_ptr<entry_type[]> entries;
+  };
+
+  struct magazine {
+    std::vector<void*> blocks;
+    // fewest blocks held since the last return of unneeded blocks
+    size_t low_water = 0;
+  };
+
+  struct thread_cache {
+    std::vector<magazine> magazines = std::vector<magazine>(size_classes::num_classes);
+    size_t ops = 0;
+    // only written by the owning thread
+    std::atomic<size_t> hits{0};
+    std::atomic<size_t> misses{0};
+    std::atomic<size_t> bytes_cached{0};
+    std::atomic<size_t> malloc_latency[detail::num_latency_bins] = {};
+  };
+
+  const size_t m_id;
+
+  detail::counted_mutex m_mutex;
+
+  // published arenas are read without the lock
+  std::atomic<arena*> m_arenas[max_arenas] = {};
+  std::atomic<size_t> m_num_arenas{0};
+
+  std::vector<std::vector<void*>> m_free_blocks;
+  std::list<thread_cache> m_caches;
+  char* m_bump_begin;
+  char* m_bump_end;
+  size_t m_bytes_reserved;
+  // bytes of the blocks taken from the free lists and arenas by callers
+  // and thread caches
+  size_t m_bytes_held;
+  size_t m_bytes_high_water;
+  size_t m_arenas_allocated;
+  size_t m_uncached_allocations;
+  size_t m_default_arena_size;
+  size_t m_cache_size;
+  allocator_t m_alloc;
+
+  static void increment(std::atomic<size_t>& counter)
+  {
+    add(counter, 1);
+  }
+
+  // counters only written by one thread, subtracts wrap around
+  static void add(std::atomic<size_t>& counter, size_t n)
+  {
+    counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+  }
+
+  size_t cache_capacity(size_t idx) const
+  {
+    return std::min(size_t(max_cached_blocks), m_cache_size / size_classes::size(idx));
+  }
+
+  thread_cache& get_cache()
+  {
+    std::vector<std::pair<size_t, void*>>& caches = detail::thread_caches();
+    for (std::pair<size_t, void*>& cache : caches) {
+      if (cache.first == m_id) {
+        return *static_cast<thread_cache*>(cache.second);
+      }
+    }
+
+    // first use of this pool by this thread
+    thread_cache* cache = nullptr;
+    {
+      COMBRAJA::lock_guard<detail::counted_mutex> lock(m_mutex);
+      m_caches.emplace_back();
+      cache = &m_caches.back();
+    }
+    caches.emplace_back(m_id, cache);
+    return *cache;
+  }
+
+  // every cache_period operations return the blocks each class of the
+  // cache did not need since the last time
+  void tick(thread_cache& cache)
+  {
+    if (++cache.ops < cache_period) {
+      return;
+    }
+    cache.ops = 0;
+
+    bool any_unneeded = false;
+    for (magazine& mag : cache.magazines) {
+      any_unneeded = any_unneeded || mag.low_water > 0;
+    }
+    if (any_unneeded) {
+      COMBRAJA::lock_guard<detail::counted_mutex> lock(m_mutex);
+      for (size_t idx = 0; idx < size_classes::num_classes; ++idx) {
+        give_blocks(cache, idx, cache.magazines[idx].low_water);
+      }
+    }
+    for (magazine& mag : cache.magazines) {
+      mag.low_water = mag.blocks.size();
+    }
+  }
+
+  // move up to num blocks of the class from the shared free lists to the
+  // cache, call locked
+  void take_blocks(thread_cache& cache, size_t idx, size_t num)
+  {
+    magazine& mag = cache.magazines[idx];
+    size_t taken = 0;
+    for (; taken < num; ++taken) {
+      void* block = get_block(idx);
+      if (block == nullptr) break;
+      mag.blocks.push_back(block);
+    }
+    add(cache.bytes_cached, taken * size_classes::size(idx));
+  }
+
+  // move num blocks of the class from the cache to the shared free lists,
+  // call locked
+  void give_blocks(thread_cache& cache, size_t idx, size_t num)
+  {
+    magazine& mag = cache.magazines[idx];
+    std::vector<void*>& free_blocks = m_free_blocks[idx];
+    for (size_t i = 0; i < num; ++i) {
+      free_blocks.push_back(mag.blocks.back());
+      mag.blocks.pop_back();
+    }
+    mag.low_water = std::min(mag.low_water, mag.blocks.size());
+    add(cache.bytes_cached, -(num * size_classes::size(idx)));
+    m_bytes_held -= num * size_classes::size(idx);
+  }
+
+  arena* find_arena(void* ptr)
+  {
+    size_t num_arenas = m_num_arenas.load(std::memory_order_acquire);
+    for (size_t a = num_arenas; a > 0; --a) {
+      arena* ar = m_arenas[a-1].load(std::memory_order_relaxed);
+      if (ar->begin <= ptr && ptr < ar->end) {
+        return ar;
+      }
+    }
+    return nullptr;
+  }
+
+  void set_entry(void* ptr, void* block, size_t idx)
+  {
+    arena* ar = find_arena(block);
+    size_t granule = (static_cast<char*>(ptr) - ar->begin) / size_classes::granularity;
+    size_t offset = (static_cast<char*>(ptr) - static_cast<char*>(block)) / size_classes::granularity;
+    ar->entries[granule] = static_cast<entry_type>((idx + 1) | (offset << 8));
+  }
+
+  // look up and clear the entry of ptr, false if ptr was not allocated
+  bool take_entry(void* ptr, void*& block, size_t& idx)
+  {
+    arena* ar = find_arena(ptr);
+    if (ar == nullptr) {
+      return false;
+    }
+    size_t ptr_offset = static_cast<char*>(ptr) - ar->begin;
+    if (ptr_offset % size_classes::granularity != 0) {
+      return false;
+    }
+    entry_type& entry = ar->entries[ptr_offset / size_classes::granularity];
+    if (entry == 0) {
+      return false;
+    }
+    idx = (entry & 0xff) - 1;
+    block = static_cast<char*>(ptr) - (entry >> 8) * size_classes::granularity;
+    entry = 0;
+    return true;
+  }
+
+  // pop a free block of the class or carve one from the current arena,
+  // call locked
+  void* get_block(size_t idx)
+  {
+    const size_t nbytes = size_classes::size(idx);
+    void* block = nullptr;
+
+    std::vector<void*>& free_blocks = m_free_blocks[idx];
+    if (!free_blocks.empty()) {
+      block = free_blocks.back();
+      free_blocks.pop_back();
+    } else {
+      if (static_cast<size_t>(m_bump_end - m_bump_begin) < nbytes) {
+        if (!add_arena(nbytes)) {
+          return nullptr;
+        }
+      }
+      block = m_bump_begin;
+      m_bump_begin += nbytes;
+    }
+
+    m_bytes_held += nbytes;
+    m_bytes_high_water = std::max(m_bytes_high_water, m_bytes_held);
+    return block;
+  }
+
+  bool add_arena(size_t nbytes)
+  {
+    size_t num_arenas = m_num_arenas.load(std::memory_order_relaxed);
+    if (num_arenas == max_arenas) {
+      fprintf(stderr, "sizeclass MemPool out of arenas");
+      return false;
+    }
+
+    const size_t alloc_size =
+        std::max(nbytes + size_classes::granularity, m_default_arena_size);
+    void* arena_ptr = m_alloc.malloc(alloc_size);
+    if (arena_ptr == nullptr) {
+      return false;
+    }
+    LOGPRINTF("%p sizeclass MemPool::add_arena mem %p nbytes %zu\n", this, arena_ptr, alloc_size);
+
+    carve_remainder();
+
+    void* begin = arena_ptr;
+    size_t space = alloc_size;
+    ::COMBRAJA::align(size_classes::granularity, size_classes::granularity, begin, space);
+    const size_t num_granules = space / size_classes::granularity;
+
+    arena* ar = new arena{arena_ptr, static_cast<char*>(begin),
+                          static_cast<char*>(begin) + num_granules * size_classes::granularity,
+                          std::unique_ptr<entry_type[]>(new entry_type[num_granules]())};
+    m_arenas[num_arenas].store(ar, std::memory_order_relaxed);
+    m_num_arenas.store(num_arenas + 1, std::memory_order_release);
+
+    m_bump_begin = ar->begin;
+    m_bump_end = ar->end;
+    m_bytes_reserved += alloc_size;
+    m_arenas_allocated += 1;
+    return true;
+  }
+
+  // put the unused end of the current arena onto the free lists
+  void carve_remainder()
+  {
+    while (static_cast<size_t>(m_bump_end - m_bump_begin) >= size_classes::granularity) {
+      const size_t idx = size_classes::floor_index(m_bump_end - m_bump_begin);
+      m_free_blocks[idx].push_back(m_bump_begin);
+      m_bump_begin += size_classes::size(idx);
+    }
+  }
+};
+
+// print the statistics of a pool to the proc file
+template <typename allocator_t>
+void print_statistics(const char* name, MemPool<allocator_t>& pool)
+{
+  auto stats = pool.get_statistics();
+  fgprintf(FileGroup::proc, "mempool %s arenas %zu allocated %zu reserved %zu in use %zu cached %zu high water %zu free %zu largest free %zu (%.3f of free)\n",
+      name, stats.arenas, stats.arenas_allocated,
+      stats.bytes_reserved, stats.bytes_in_use, stats.bytes_cached, stats.bytes_high_water,
+      stats.bytes_free, stats.largest_free,
+      (stats.bytes_free > 0) ? (double)stats.largest_free / stats.bytes_free : 1.0);
+  fgprintf(FileGroup::proc, "mempool %s allocations %zu cache hits %zu misses %zu lock acquires %zu contended %zu wait %.9f s\n",
+      name, stats.allocations, stats.cache_hits, stats.cache_misses,
+      stats.lock_acquires, stats.lock_contended, stats.lock_wait_time);
+  if (instrument()) {
+    // only the bins that counted calls, labeled by their upper bound
+    char hist[1024] = "";
+    int len = 0;
+    for (size_t b = 0; b < detail::num_latency_bins; ++b) {
+      if (stats.malloc_latency[b] > 0 && len < (int)sizeof(hist)) {
+        len += snprintf(hist + len, sizeof(hist) - len, " <%zu:%zu",
+                        size_t(2) << b, stats.malloc_latency[b]);
+      }
+    }
+    fgprintf(FileGroup::proc, "mempool %s malloc latency ns%s\n", name, hist);
+  }
+}
+
+} /* end namespace sizeclass_mempool */
+
+} /* end namespace COMB */
+
+#endif /* _SIZECLASS_MEMPOOL_HPP */
@@ -21,6 +21,9 @@
 #include <cstring>
 #include <cmath>
 #include <vector>
+#include <string>
+#include <algorithm>
+#include <limits>
 #include <cctype>
 #include <unistd.h>
 #include <sched.h>
@@ -45,6 +48,26 @@ int main(int argc, char** argv)
 
 #ifdef COMB_ENABLE_MPI
   int required = MPI_THREAD_FUNNELED; // MPI_THREAD_SINGLE, MPI_THREAD_FUNNELED, MPI_THREAD_SERIALIZED, MPI_THREAD_MULTIPLE
+  // the mpi_threads comm makes mpi calls from many threads, ask for that
+  // before the other arguments are parsed after Init, only when it is named
+  // so "-comm enable all" keeps the thread level, and with it the locking
+  // inside mpi, of the other comms, mpi_threads then uses one thread
+  for (int i = 1; i+2 < argc; ++i) {
+    if ( strcmp(argv[i], "-comm") == 0
+      && strcmp(argv[i+1], "enable") == 0
+      && strcmp(argv[i+2], "mpi_threads") == 0 ) {
+      required = MPI_THREAD_MULTIPLE;
+    }
+  }
+  // the progress thread makes mpi calls while the main thread does not
+  for (int i = 1; i+2 < argc; ++i) {
+    if ( strcmp(argv[i], "-comm") == 0
+      && strcmp(argv[i+1], "progress_thread") == 0
+      && strcmp(argv[i+2], "off") != 0
+      && required < MPI_THREAD_SERIALIZED ) {
+      required = MPI_THREAD_SERIALIZED;
+    }
+  }
   int provided = detail::MPI::Init_thread(&argc, &argv, required);
 
   MPI_Comm adiak_comm = detail::MPI::Comm_dup(MPI_COMM_WORLD);
@@ -70,9 +93,15 @@ int main(int argc, char** argv)
   CommInfo comminfo;
 
 #ifdef COMB_ENABLE_MPI
-  if (required != provided) {
+  comminfo.thread_level = provided;
+  fgprintf(FileGroup::all, "MPI thread support required %s provided %s\n",
+      CommInfo::thread_level_str(required), CommInfo::thread_level_str(provided));
+  if (provided < MPI_THREAD_FUNNELED) {
     fgprintf(FileGroup::err_master, "Didn't receive MPI thread support required %i provided %i.\n", required, provided);
     comminfo.abort();
+  } else if (provided < required && required == MPI_THREAD_MULTIPLE) {
+    // a progress thread without the level it needs is disabled below
+    fgprintf(FileGroup::err_master, "Didn't receive MPI thread support required %i provided %i, mpi_threads will use one thread.\n", required, provided);
   }
 #endif
 
@@ -136,6 +165,7 @@ int main(int argc, char** argv)
 
   bool do_print_packing_sizes = false;
   bool do_print_message_sizes = false;
+  bool do_test_mempool = false;
 
   // Caliper profiling config, if enabled
   std::string caliper_config;
@@ -174,6 +204,72 @@ int main(int argc, char** argv)
             } else {
               fgprintf(FileGroup::err_master, "No argument to sub-option, ignoring %s %s.\n", argv[i-1], argv[i]);
             }
+          } else if (strcmp(argv[i], "pipeline_chunks") == 0) {
+            if (i+1 < argc && argv[i+1][0] != '-') {
+              long read_chunks = comminfo.pipeline_chunks;
+              int ret = sscanf(argv[++i], "%ld", &read_chunks);
+              if (ret == 1 && read_chunks >= 1) {
+                comminfo.pipeline_chunks = read_chunks;
+              } else {
+                fgprintf(FileGroup::err_master, "Invalid argument to sub-option, ignoring %s %s %s.\n", argv[i-2], argv[i-1], argv[i]);
+              }
+            } else {
+              fgprintf(FileGroup::err_master, "No argument to sub-option, ignoring %s %s.\n", argv[i-1], argv[i]);
+            }
+          } else if (strcmp(argv[i], "pipeline_threshold") == 0) {
+            if (i+1 < argc && argv[i+1][0] != '-') {
+              long read_threshold = comminfo.pipeline_threshold;
+              int ret = sscanf(argv[++i], "%ld", &read_threshold);
+              if (ret == 1 && read_threshold >= 0) {
+                comminfo.pipeline_threshold = read_threshold;
+              } else {
+                fgprintf(FileGroup::err_master, "Invalid argument to sub-option, ignoring %s %s %s.\n", argv[i-2], argv[i-1], argv[i]);
+              }
+            } else {
+              fgprintf(FileGroup::err_master, "No argument to sub-option, ignoring %s %s.\n", argv[i-1], argv[i]);
+            }
+          } else if (strcmp(argv[i], "autotune") == 0) {
+            if (i+1 < argc && argv[i+1][0] != '-') {
+              long read_cycles = comminfo.autotune_cycles;
+              int ret = sscanf(argv[++i], "%ld", &read_cycles);
+              if (ret == 1 && read_cycles >= 0) {
+                comminfo.autotune_cycles = read_cycles;
+              } else {
+                fgprintf(FileGroup::err_master, "Invalid argument to sub-option, ignoring %s %s %s.\n", argv[i-2], argv[i-1], argv[i]);
+              }
+            } else {
+              fgprintf(FileGroup::err_master, "No argument to sub-option, ignoring %s %s.\n", argv[i-1], argv[i]);
+            }
+          } else if (strcmp(argv[i], "overlap") == 0) {
+            if (i+1 < argc && argv[i+1][0] != '-') {
+              ++i;
+              if (strcmp(argv[i], "off") == 0) {
+                comminfo.overlap_stencil = 0;
+              } else if (strcmp(argv[i], "7pt") == 0) {
+                comminfo.overlap_stencil = 7;
+              } else if (strcmp(argv[i], "27pt") == 0) {
+                comminfo.overlap_stencil = 27;
+              } else {
+                fgprintf(FileGroup::err_master, "Invalid argument to sub-option, ignoring %s %s %s.\n", argv[i-2], argv[i-1], argv[i]);
+              }
+            } else {
+              fgprintf(FileGroup::err_master, "No argument to sub-option, ignoring %s %s.\n", argv[i-1], argv[i]);
+            }
+          } else if (strcmp(argv[i], "progress_thread") == 0) {
+            if (i+1 < argc && argv[i+1][0] != '-') {
+              ++i;
+              if (strcmp(argv[i], "off") == 0) {
+                comminfo.progress_thread = CommInfo::progress::off;
+              } else if (strcmp(argv[i], "poll") == 0) {
+                comminfo.progress_thread = CommInfo::progress::poll;
+              } else if (strcmp(argv[i], "unpack") == 0) {
+                comminfo.progress_thread = CommInfo::progress::unpack;
+              } else {
+                fgprintf(FileGroup::err_master, "Invalid argument to sub-option, ignoring %s %s %s.\n", argv[i-2], argv[i-1], argv[i]);
+              }
+            } else {
+              fgprintf(FileGroup::err_master, "No argument to sub-option, ignoring %s %s.\n", argv[i-1], argv[i]);
+            }
           } else if ( strcmp(argv[i], "post_recv") == 0
                    || strcmp(argv[i], "post_send") == 0
                    || strcmp(argv[i], "wait_recv") == 0
@@ -222,6 +318,14 @@ int main(int argc, char** argv)
                 comm_avail.mock = enabledisable;
 #ifdef COMB_ENABLE_MPI
                 comm_avail.mpi = enabledisable;
+                comm_avail.mpi_persistent = enabledisable;
+                comm_avail.mpi_neighbor = enabledisable;
+                comm_avail.mpi_rma = enabledisable;
+                comm_avail.mpi_shm = enabledisable;
+                comm_avail.mpi_threads = enabledisable;
+#endif
+#ifdef COMB_ENABLE_MPI_PARTITIONED
+                comm_avail.mpi_partitioned = enabledisable;
 #endif
 #ifdef COMB_ENABLE_GDSYNC
                 comm_avail.gdsync = enabledisable;
@@ -240,6 +344,30 @@ int main(int argc, char** argv)
               } else if (strcmp(argv[i], "mpi") == 0) {
 #ifdef COMB_ENABLE_MPI
                 comm_avail.mpi = enabledisable;
+#endif
+              } else if (strcmp(argv[i], "mpi_persistent") == 0) {
+#ifdef COMB_ENABLE_MPI
+                comm_avail.mpi_persistent = enabledisable;
+#endif
+              } else if (strcmp(argv[i], "mpi_neighbor") == 0) {
+#ifdef COMB_ENABLE_MPI
+                comm_avail.mpi_neighbor = enabledisable;
+#endif
+              } else if (strcmp(argv[i], "mpi_rma") == 0) {
+#ifdef COMB_ENABLE_MPI
+                comm_avail.mpi_rma = enabledisable;
+#endif
+              } else if (strcmp(argv[i], "mpi_shm") == 0) {
+#ifdef COMB_ENABLE_MPI
+                comm_avail.mpi_shm = enabledisable;
+#endif
+              } else if (strcmp(argv[i], "mpi_threads") == 0) {
+#ifdef COMB_ENABLE_MPI
+                comm_avail.mpi_threads = enabledisable;
+#endif
+              } else if (strcmp(argv[i], "mpi_partitioned") == 0) {
+#ifdef COMB_ENABLE_MPI_PARTITIONED
+                comm_avail.mpi_partitioned = enabledisable;
 #endif
               } else if (strcmp(argv[i], "gdsync") == 0) {
 #ifdef COMB_ENABLE_GDSYNC
@@ -263,6 +391,31 @@ int main(int argc, char** argv)
             } else {
               fgprintf(FileGroup::err_master, "No argument to sub-option, ignoring %s %s.\n", argv[i-1], argv[i]);
             }
+          } else if (strcmp(argv[i], "nontemporal_threshold") == 0) {
+            if (i+1 < argc && argv[i+1][0] != '-') {
+              long read_threshold = comb_nontemporal_threshold();
+              int ret = sscanf(argv[++i], "%ld", &read_threshold);
+              if (ret == 1 && read_threshold >= 0) {
+                comb_nontemporal_threshold() = read_threshold;
+              } else {
+                fgprintf(FileGroup::err_master, "Invalid argument to sub-option, ignoring %s %s %s.\n", argv[i-2], argv[i-1], argv[i]);
+              }
+            } else {
+              fgprintf(FileGroup::err_master, "No argument to sub-option, ignoring %s %s.\n", argv[i-1], argv[i]);
+            }
+          } else if (strcmp(argv[i], "layout") == 0) {
+            if (i+1 < argc && argv[i+1][0] != '-') {
+              ++i;
+              if (strcmp(argv[i], "variable_major") == 0) {
+                comb_message_layout() = detail::message_layout::variable_major;
+              } else if (strcmp(argv[i], "zone_major") == 0) {
+                comb_message_layout() = detail::message_layout::zone_major;
+              } else {
+                fgprintf(FileGroup::err_master, "Invalid argument to sub-option, ignoring %s %s %s.\n", argv[i-2], argv[i-1], argv[i]);
+              }
+            } else {
+              fgprintf(FileGroup::err_master, "No argument to sub-option, ignoring %s %s.\n", argv[i-1], argv[i]);
+            }
           } else if ( strcmp(argv[i], "allow") == 0
                    || strcmp(argv[i], "disallow") == 0 ) {
             bool allowdisallow = false;
@@ -277,6 +430,18 @@ int main(int argc, char** argv)
                 comb_allow_per_message_pack_fusing() = allowdisallow;
               } else if (strcmp(argv[i], "message_group_pack_fusing") == 0) {
                 comb_allow_pack_loop_fusion() = allowdisallow;
+              } else if (strcmp(argv[i], "structured_packing") == 0) {
+                comb_allow_structured_packing() = allowdisallow;
+              } else if (strcmp(argv[i], "span_packing") == 0) {
+                comb_allow_span_packing() = allowdisallow;
+              } else if (strcmp(argv[i], "multi_variable_pack_fusing") == 0) {
+                comb_allow_multi_variable_pack_fusing() = allowdisallow;
+              } else if (strcmp(argv[i], "specialized_pack_kernels") == 0) {
+                comb_allow_specialized_pack_kernels() = allowdisallow;
+              } else if (strcmp(argv[i], "per_thread_comms") == 0) {
+                comb_allow_per_thread_comms() = allowdisallow;
+              } else if (strcmp(argv[i], "persistent_buffers") == 0) {
+                comb_allow_persistent_buffers() = allowdisallow;
               } else {
                 fgprintf(FileGroup::err_master, "Invalid argument to sub-option, ignoring %s %s %s.\n", argv[i-2], argv[i-1], argv[i]);
               }
@@ -381,6 +546,35 @@ int main(int argc, char** argv)
             } else {
               fgprintf(FileGroup::err_master, "No argument to sub-option, ignoring %s %s.\n", argv[i-1], argv[i]);
             }
+          } else if (strcmp(argv[i], "simd") == 0) {
+            if (i+1 < argc && argv[i+1][0] != '-') {
+              ++i;
+              detail::simd::isa detected = detail::simd::supported_types ? detail::simd::detect()
+                                                                         : detail::simd::isa::scalar;
+              detail::simd::isa requested = detected;
+              bool valid = true;
+              if (strcmp(argv[i], "auto") == 0) {
+                requested = detected;
+              } else if (strcmp(argv[i], "scalar") == 0) {
+                requested = detail::simd::isa::scalar;
+              } else if (strcmp(argv[i], "avx2") == 0) {
+                requested = detail::simd::isa::avx2;
+              } else if (strcmp(argv[i], "avx512") == 0) {
+                requested = detail::simd::isa::avx512;
+              } else {
+                valid = false;
+                fgprintf(FileGroup::err_master, "Invalid argument to sub-option, ignoring %s %s %s.\n", argv[i-2], argv[i-1], argv[i]);
+              }
+              if (valid) {
+                if (static_cast<int>(requested) > static_cast<int>(detected)) {
+                  fgprintf(FileGroup::err_master, "%s not supported, using %s for %s %s.\n", argv[i], detail::simd::isa_str(detected), argv[i-2], argv[i-1]);
+                  requested = detected;
+                }
+                comb_simd_isa() = requested;
+              }
+            } else {
+              fgprintf(FileGroup::err_master, "No argument to sub-option, ignoring %s %s.\n", argv[i-1], argv[i]);
+            }
           } else {
             fgprintf(FileGroup::err_master, "Invalid argument to option, ignoring %s %s.\n", argv[i-1], argv[i]);
           }
@@ -402,6 +596,11 @@ int main(int argc, char** argv)
               ++i;
               if (strcmp(argv[i], "all") == 0) {
                 alloc.host.m_available = enabledisable;
+                alloc.host_hugepage.m_available = enabledisable;
+                alloc.host_locked.m_available = enabledisable;
+                alloc.host_numa_local.m_available = enabledisable;
+                alloc.host_numa_interleave.m_available = enabledisable;
+                alloc.host_numa_bind.m_available = enabledisable;
 #ifdef COMB_ENABLE_CUDA
                 alloc.cuda_hostpinned.m_available = enabledisable;
                 alloc.cuda_device.m_available = enabledisable;
@@ -413,6 +612,16 @@ int main(int argc, char** argv)
 #endif
               } else if (strcmp(argv[i], "host") == 0) {
                 alloc.host.m_available = enabledisable;
+              } else if (strcmp(argv[i], "host_hugepage") == 0) {
+                alloc.host_hugepage.m_available = enabledisable;
+              } else if (strcmp(argv[i], "host_locked") == 0) {
+                alloc.host_locked.m_available = enabledisable;
+              } else if (strcmp(argv[i], "host_numa_local") == 0) {
+                alloc.host_numa_local.m_available = enabledisable;
+              } else if (strcmp(argv[i], "host_numa_interleave") == 0) {
+                alloc.host_numa_interleave.m_available = enabledisable;
+              } else if (strcmp(argv[i], "host_numa_bind") == 0) {
+                alloc.host_numa_bind.m_available = enabledisable;
               } else if (strcmp(argv[i], "cuda_hostpinned") == 0) {
 #ifdef COMB_ENABLE_CUDA
                 alloc.cuda_hostpinned.m_available = enabledisable;
@@ -447,6 +656,18 @@ int main(int argc, char** argv)
             } else {
               fgprintf(FileGroup::err_master, "No argument to sub-option, ignoring %s %s.\n", argv[i-1], argv[i]);
             }
+          } else if (strcmp(argv[i], "numa_node") == 0) {
+            if (i+1 < argc && argv[i+1][0] != '-') {
+              long read_node = COMB::detail::numa::bind_node();
+              int ret = sscanf(argv[++i], "%ld", &read_node);
+              if (ret == 1 && read_node >= 0) {
+                COMB::detail::numa::bind_node() = read_node;
+              } else {
+                fgprintf(FileGroup::err_master, "Invalid argument to sub-option, ignoring %s %s %s.\n", argv[i-2], argv[i-1], argv[i]);
+              }
+            } else {
+              fgprintf(FileGroup::err_master, "No argument to sub-option, ignoring %s %s.\n", argv[i-1], argv[i]);
+            }
           } else {
             fgprintf(FileGroup::err_master, "Invalid argument to option, ignoring %s %s.\n", argv[i-1], argv[i]);
           }
@@ -465,6 +686,35 @@ int main(int argc, char** argv)
         } else {
           fgprintf(FileGroup::err_master, "No argument to option, ignoring %s.\n", argv[i]);
         }
+      } else if (strcmp(&argv[i][1], "var_types") == 0) {
+        if (i+1 < argc && argv[i+1][0] != '-') {
+          // underscore separated list of types used cyclically by the variables
+          std::vector<detail::data_type> read_types;
+          bool valid = true;
+          std::string types_str(argv[++i]);
+          size_t begin = 0;
+          while (valid && begin <= types_str.size()) {
+            size_t end = std::min(types_str.find('_', begin), types_str.size());
+            std::string type_str = types_str.substr(begin, end - begin);
+            if (type_str == "double") {
+              read_types.emplace_back(detail::data_type::float64);
+            } else if (type_str == "float") {
+              read_types.emplace_back(detail::data_type::float32);
+            } else if (type_str == "int") {
+              read_types.emplace_back(detail::data_type::int32);
+            } else {
+              valid = false;
+            }
+            begin = end + 1;
+          }
+          if (valid) {
+            comb_variable_types() = read_types;
+          } else {
+            fgprintf(FileGroup::err_master, "Invalid argument to option, ignoring %s %s.\n", argv[i-1], argv[i]);
+          }
+        } else {
+          fgprintf(FileGroup::err_master, "No argument to option, ignoring %s.\n", argv[i]);
+        }
       } else if (strcmp(&argv[i][1], "cycles") == 0) {
         if (i+1 < argc && argv[i+1][0] != '-') {
           long read_ncycles = ncycles;
@@ -567,6 +817,11 @@ int main(int argc, char** argv)
         do_print_packing_sizes = true;
       } else if (strcmp(&argv[i][1], "print_message_sizes") == 0) {
         do_print_message_sizes = true;
+      } else if (strcmp(&argv[i][1], "print_mempool_stats") == 0) {
+        COMB::comb_print_mempool_stats() = true;
+        COMB::sizeclass_mempool::instrument() = true;
+      } else if (strcmp(&argv[i][1], "test_mempool") == 0) {
+        do_test_mempool = true;
       } else if (strcmp(&argv[i][1], "caliper_config") == 0) {
         if (i+1 < argc && argv[i+1][0] != '-') {
           caliper_config = argv[++i];
@@ -616,6 +871,25 @@ int main(int argc, char** argv)
     comminfo.abort();
   }
 
+  // variables of other types are packed one item at a time in variable major
+  // order, the fused kernels and mpi datatypes only handle DataT
+  if (!comb_variables_are_DataT()) {
+    if (comb_allow_pack_loop_fusion()) {
+      fgprintf(FileGroup::err_master, "Variables of mixed types, disabling pack loop fusion.\n");
+      comb_allow_pack_loop_fusion() = false;
+    }
+    if (comb_message_layout() != detail::message_layout::variable_major) {
+      fgprintf(FileGroup::err_master, "Variables of mixed types, using variable_major message layout.\n");
+      comb_message_layout() = detail::message_layout::variable_major;
+    }
+#ifdef COMB_ENABLE_MPI
+    if (exec.mpi_type.m_available) {
+      fgprintf(FileGroup::err_master, "Variables of mixed types, disabling mpi_type.\n");
+      exec.mpi_type.m_available = false;
+    }
+#endif
+  }
+
 #ifdef COMB_ENABLE_CALIPER
   cali::ConfigManager mgr;
   mgr.add(caliper_config.c_str());
@@ -678,6 +952,27 @@ int main(int argc, char** argv)
 #endif // ifdef COMB_ENABLE_OPENMP
 
 
+#ifdef COMB_ENABLE_MPI
+  // the progress thread needs mpi calls from a thread other than main
+  if (comminfo.progress_thread != CommInfo::progress::off &&
+      comminfo.thread_level < MPI_THREAD_SERIALIZED) {
+    fgprintf(FileGroup::err_master, "Didn't receive MPI thread support required %i provided %i, disabling progress thread.\n", MPI_THREAD_SERIALIZED, comminfo.thread_level);
+    comminfo.progress_thread = CommInfo::progress::off;
+  }
+#endif
+
+  // global indices and local zones must fit in the configured index types
+  {
+    long long global_zones = 1;
+    for (IdxT dim = 0; dim < 3; ++dim) {
+      global_zones *= static_cast<long long>(sizes[dim]);
+    }
+    if (global_zones > static_cast<long long>(std::numeric_limits<IdxT>::max())) {
+      fgprintf(FileGroup::err_master, "Mesh too large for %i-bit index type, configure with COMB_INDEX_BITS=64.\n", COMB_INDEX_BITS);
+      comminfo.abort();
+    }
+  }
+
   GlobalMeshInfo global_info(sizes, comminfo.size, divisions, periodic, ghost_widths);
 
   // create cartesian communicator and get rank
@@ -685,10 +980,20 @@ int main(int argc, char** argv)
 
   MeshInfo info = MeshInfo::get_local(global_info, comminfo.cart.coords);
 
+  if (comminfo.any(static_cast<long long>(info.totallen) > static_cast<long long>(std::numeric_limits<LidxT>::max()))) {
+    fgprintf(FileGroup::err_master, "Local mesh too large for %i-bit local index type, configure with a larger COMB_LOCAL_INDEX_BITS.\n", COMB_LOCAL_INDEX_BITS);
+    comminfo.abort();
+  }
+
   // print info about problem setup
   {
     long print_coords[3]       = {comminfo.cart.coords[0],    comminfo.cart.coords[1],    comminfo.cart.coords[2]   };
     long print_cutoff          = comminfo.cutoff;
+    long print_pipeline_chunks    = comminfo.pipeline_chunks;
+    long print_pipeline_threshold = comminfo.pipeline_threshold;
+    long print_overlap_stencil    = comminfo.overlap_stencil;
+    long print_autotune_cycles    = comminfo.autotune_cycles;
+    long print_nontemporal_threshold = comb_nontemporal_threshold();
     long print_ncycles         = ncycles;
     long print_num_vars        = num_vars;
     long print_ghost_widths[3] = {info.ghost_widths[0],       info.ghost_widths[1],       info.ghost_widths[2]      };
@@ -698,12 +1003,35 @@ int main(int argc, char** argv)
 
     fgprintf(FileGroup::all, "Cart coords  %8li %8li %8li\n", print_coords[0],       print_coords[1],       print_coords[2]      );
     fgprintf(FileGroup::all, "Message policy cutoff %li\n",   print_cutoff                                                       );
+    fgprintf(FileGroup::all, "Message pipeline chunks %li over %li bytes\n", print_pipeline_chunks, print_pipeline_threshold      );
+    fgprintf(FileGroup::all, "Progress thread %s\n",        CommInfo::progress_str(comminfo.progress_thread)                   );
+    if (print_autotune_cycles > 0) {
+      fgprintf(FileGroup::all, "Autotune methods and cutoff starting with %li trial cycles\n", print_autotune_cycles);
+    }
+    if (print_overlap_stencil > 0) {
+      fgprintf(FileGroup::all, "Overlap %li point stencil\n", print_overlap_stencil);
+    } else {
+      fgprintf(FileGroup::all, "Overlap off\n");
+    }
     fgprintf(FileGroup::all, "Post Recv using %s method\n",   CommInfo::method_str(comminfo.post_recv_method)                    );
     fgprintf(FileGroup::all, "Post Send using %s method\n",   CommInfo::method_str(comminfo.post_send_method)                    );
     fgprintf(FileGroup::all, "Wait Recv using %s method\n",   CommInfo::method_str(comminfo.wait_recv_method)                    );
     fgprintf(FileGroup::all, "Wait Send using %s method\n",   CommInfo::method_str(comminfo.wait_send_method)                    );
+    fgprintf(FileGroup::all, "Packing using %s items\n",      comb_allow_structured_packing() ? "structured" :
+                                                             comb_allow_span_packing()       ? "span or indexed" : "indexed"    );
+    fgprintf(FileGroup::all, "Packing using %s kernels on cpu\n", detail::simd::isa_str(comb_simd_isa())                         );
+    fgprintf(FileGroup::all, "Nontemporal threshold %li\n",   print_nontemporal_threshold                                        );
+    fgprintf(FileGroup::all, "Message layout %s\n",          detail::message_layout_str(comb_message_layout())                  );
+    fgprintf(FileGroup::all, "Fused packing over %s\n",      comb_allow_multi_variable_pack_fusing() ? "blocks of variables on cpu" : "each variable");
+    fgprintf(FileGroup::all, "Fused packing kernels %s\n",  comb_allow_specialized_pack_kernels() ? "specialized when available" : "generic");
+    fgprintf(FileGroup::all, "Message buffers %s\n",        comb_allow_persistent_buffers() ? "persistent in one slab per message group" : "allocated each cycle");
     fgprintf(FileGroup::all, "Num cycles   %8li\n",           print_ncycles                                                      );
     fgprintf(FileGroup::all, "Num vars     %8li\n",           print_num_vars                                                     );
+    fgprintf(FileGroup::all, "Var types   ");
+    for (detail::data_type type : comb_variable_types()) {
+      fgprintf(FileGroup::all, " %s", detail::data_type_str(type));
+    }
+    fgprintf(FileGroup::all, "\n");
     fgprintf(FileGroup::all, "ghost_widths %8li %8li %8li\n", print_ghost_widths[0], print_ghost_widths[1], print_ghost_widths[2]);
     fgprintf(FileGroup::all, "sizes        %8li %8li %8li\n", print_sizes[0],        print_sizes[1],        print_sizes[2]       );
     fgprintf(FileGroup::all, "divisions    %8li %8li %8li\n", print_divisions[0],    print_divisions[1],    print_divisions[2]   );
@@ -743,12 +1071,33 @@ int main(int argc, char** argv)
     adiak_namevalue("periodic",      adiak_general, nullptr, "[%ld]", print_periodic,     3);
 
     adiak::value("policy_cutoff",    print_cutoff);
+    adiak::value("pipeline_chunks",  print_pipeline_chunks);
+    adiak::value("pipeline_threshold", print_pipeline_threshold);
+    adiak::value("progress_thread",  CommInfo::progress_str(comminfo.progress_thread));
+    adiak::value("overlap_stencil",  print_overlap_stencil);
+    adiak::value("autotune_cycles",  print_autotune_cycles);
     adiak::value("ncycles",          print_ncycles);
     adiak::value("num_vars",         print_num_vars);
+    std::string print_var_types;
+    for (detail::data_type type : comb_variable_types()) {
+      if (!print_var_types.empty()) print_var_types += "_";
+      print_var_types += detail::data_type_str(type);
+    }
+    adiak::value("var_types",        print_var_types);
     adiak::value("post_recv_method", CommInfo::method_str(comminfo.post_recv_method));
     adiak::value("post_send_method", CommInfo::method_str(comminfo.post_send_method));
     adiak::value("wait_recv_method", CommInfo::method_str(comminfo.wait_recv_method));
     adiak::value("wait_send_method", CommInfo::method_str(comminfo.wait_send_method));
+    adiak::value("structured_packing", comb_allow_structured_packing());
+    adiak::value("span_packing",     comb_allow_span_packing());
+    adiak::value("simd_isa",         detail::simd::isa_str(comb_simd_isa()));
+    adiak::value("nontemporal_threshold", print_nontemporal_threshold);
+    adiak::value("message_layout",   detail::message_layout_str(comb_message_layout()));
+    adiak::value("multi_variable_pack_fusing", comb_allow_multi_variable_pack_fusing());
+    adiak::value("specialized_pack_kernels", comb_allow_specialized_pack_kernels());
+    adiak::value("per_thread_comms", comb_allow_per_thread_comms());
+    adiak::value("persistent_buffers", comb_allow_persistent_buffers());
+    adiak::value("mpi_thread_level", CommInfo::thread_level_str(comminfo.thread_level));
 
     adiak_user();
     adiak_launchdate();
@@ -760,7 +1109,7 @@ int main(int argc, char** argv)
 
   COMB::print_message_info(comminfo, info, alloc.host.allocator(), num_vars, do_print_packing_sizes, do_print_message_sizes);
 
-  Timer tm(2*6*ncycles);
+  Timer tm(2*10*ncycles);
   Timer tm_total(1024);
 
   exec.create_executors(alloc);
@@ -770,6 +1119,10 @@ int main(int argc, char** argv)
 
   COMB::test_copy(comminfo, exec, alloc, tm, num_vars, info.totallen, ncycles);
 
+  if (do_test_mempool) {
+    COMB::test_mempool(comminfo, info, tm, num_vars, ncycles);
+  }
+
   if (do_basic_only) {
 
     COMB::test_cycles_basic(comminfo, info, exec, alloc, num_vars, ncycles, tm, tm_total);
@@ -784,6 +1137,36 @@ int main(int argc, char** argv)
       COMB::test_cycles_mpi(comminfo, info, exec, alloc, num_vars, ncycles, tm, tm_total);
 #endif
 
+#ifdef COMB_ENABLE_MPI
+    if (comm_avail.mpi_persistent)
+      COMB::test_cycles_mpi_persistent(comminfo, info, exec, alloc, num_vars, ncycles, tm, tm_total);
+#endif
+
+#ifdef COMB_ENABLE_MPI
+    if (comm_avail.mpi_neighbor)
+      COMB::test_cycles_mpi_neighbor(comminfo, info, exec, alloc, num_vars, ncycles, tm, tm_total);
+#endif
+
+#ifdef COMB_ENABLE_MPI
+    if (comm_avail.mpi_rma)
+      COMB::test_cycles_mpi_rma(comminfo, info, exec, alloc, num_vars, ncycles, tm, tm_total);
+#endif
+
+#ifdef COMB_ENABLE_MPI
+    if (comm_avail.mpi_shm)
+      COMB::test_cycles_mpi_shm(comminfo, info, exec, alloc, num_vars, ncycles, tm, tm_total);
+#endif
+
+#ifdef COMB_ENABLE_MPI
+    if (comm_avail.mpi_threads)
+      COMB::test_cycles_mpi_threads(comminfo, info, exec, alloc, num_vars, ncycles, tm, tm_total);
+#endif
+
+#ifdef COMB_ENABLE_MPI_PARTITIONED
+    if (comm_avail.mpi_partitioned)
+      COMB::test_cycles_mpi_partitioned(comminfo, info, exec, alloc, num_vars, ncycles, tm, tm_total);
+#endif
+
 #ifdef COMB_ENABLE_GDSYNC
     if (comm_avail.gdsync)
       COMB::test_cycles_gdsync(comminfo, info, exec, alloc, num_vars, ncycles, tm, tm_total);
@@ -96,6 +96,106 @@ void print_timer(CommInfo& comminfo, Timer& tm, const char* prefix) {
   delete[] nums;
 }
 
+void print_progress(CommInfo& comminfo, ProgressThread& progress) {
+
+  // time the helper spent working while the main thread did other things
+  print_timer(comminfo, progress.timer());
+
+  long counts[4] = {progress.num_recvs, progress.num_recvs_complete,
+                    progress.num_sends, progress.num_sends_complete};
+  long final_counts[4] = {counts[0], counts[1], counts[2], counts[3]};
+
+#ifdef COMB_ENABLE_MPI
+  MPI_Reduce(counts, final_counts, 4, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+#endif
+
+  if (comminfo.rank == 0) {
+    fgprintf(FileGroup::summary, "progress-recvs: %ld of %ld complete before wait\n", final_counts[1], final_counts[0]);
+    fgprintf(FileGroup::summary, "progress-sends: %ld of %ld complete before wait\n", final_counts[3], final_counts[2]);
+  }
+
+  fgprintf(FileGroup::proc, "progress-recvs: %ld of %ld complete before wait\n", counts[1], counts[0]);
+  fgprintf(FileGroup::proc, "progress-sends: %ld of %ld complete before wait\n", counts[3], counts[2]);
+}
+
+// total time spent posting and waiting on communication
+static double comm_time(Timer& tm)
+{
+  double time = 0.0;
+  for (auto& stat : tm.getStats()) {
+    if (stat.name.compare(0, 9, "post-recv") == 0 ||
+        stat.name.compare(0, 9, "post-send") == 0 ||
+        stat.name.compare(0, 9, "wait-recv") == 0 ||
+        stat.name.compare(0, 9, "wait-send") == 0) {
+      time += stat.sum;
+    }
+  }
+  return time;
+}
+
+void print_overlap(CommInfo& comminfo, Timer& tm_overlap, Timer& tm_sequential) {
+
+  // comm time with the interior computed between post and wait and before
+  // post, the difference is the comm time hidden behind the interior
+  double times[2] = {comm_time(tm_overlap), comm_time(tm_sequential)};
+  double final_times[2] = {times[0], times[1]};
+
+#ifdef COMB_ENABLE_MPI
+  MPI_Reduce(times, final_times, 2, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+#endif
+
+  auto print = [](FileGroup fg, double exposed, double total) {
+    double hidden = std::max(0.0, total - exposed);
+    double efficiency = (total > 0.0) ? hidden / total : 0.0;
+    fgprintf(fg, "overlap: hidden %.9f s of %.9f s comm efficiency %.3f\n",
+                 hidden, total, efficiency);
+  };
+
+  if (comminfo.rank == 0) {
+    print(FileGroup::summary, final_times[0], final_times[1]);
+  }
+
+  print(FileGroup::proc, times[0], times[1]);
+}
+
+// total time of the named phases
+static double phase_time(Timer& tm, const char* name0, const char* name1)
+{
+  double time = 0.0;
+  for (auto& stat : tm.getStats()) {
+    if (stat.name == name0 || stat.name == name1) {
+      time += stat.sum;
+    }
+  }
+  return time;
+}
+
+void print_buffer_slab(CommInfo& comminfo, Timer& tm_slab, Timer& tm_per_cycle) {
+
+  // buffers are allocated in the posts and freed in the waits, the time
+  // the slab saves is the difference from allocating them each cycle
+  double times[4] = {phase_time(tm_slab,      "post-recv", "post-send"),
+                     phase_time(tm_per_cycle, "post-recv", "post-send"),
+                     phase_time(tm_slab,      "wait-recv", "wait-send"),
+                     phase_time(tm_per_cycle, "wait-recv", "wait-send")};
+  double final_times[4] = {times[0], times[1], times[2], times[3]};
+
+#ifdef COMB_ENABLE_MPI
+  MPI_Reduce(times, final_times, 4, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+#endif
+
+  auto print = [](FileGroup fg, double const* t) {
+    fgprintf(fg, "buffer-slab: saved %.9f s of %.9f s post time %.9f s of %.9f s wait time\n",
+                 t[1] - t[0], t[1], t[3] - t[2], t[3]);
+  };
+
+  if (comminfo.rank == 0) {
+    print(FileGroup::summary, final_times);
+  }
+
+  print(FileGroup::proc, times);
+}
+
 void print_message_info(CommInfo& comminfo, MeshInfo& info,
                         COMB::Allocator& aloc_unused,
                         IdxT num_vars,
@@ -126,7 +226,7 @@ void print_message_info(CommInfo& comminfo, MeshInfo& info,
 
     for (IdxT i = 0; i < num_vars; ++i) {
 
-      vars.push_back(MeshData(info, aloc_unused));
+      vars.push_back(MeshData(info, aloc_unused, comb_variable_type(i)));
 
       factory.add_var(vars[i]);
     }
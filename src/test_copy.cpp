@@ -55,7 +55,7 @@ void do_copy(ContextHolder<exec_type>& con_in,
   char test_name[1024] = ""; snprintf(test_name, 1024, "memcpy %s dst %s src %s", pol::get_name(), dst_aloc.name(), src_aloc.name());
   fgprintf(FileGroup::all, "Starting test %s\n", test_name);
 
-  char sub_test_name[1024] = ""; snprintf(sub_test_name, 1024, "copy_sync-%d-%d-%zu", num_vars, len, sizeof(DataT));
+  char sub_test_name[1024] = ""; snprintf(sub_test_name, 1024, "copy_sync-%ld-%ld-%zu", (long)num_vars, (long)len, sizeof(DataT));
 
   Range r(test_name, Range::green);
 
@@ -208,6 +208,41 @@ void test_copy_allocators(CommInfo& comminfo,
                       cuda_src_aloc,
                       tm, num_vars, len, nrepeats);
 
+  test_copy_allocator(comminfo,
+                      exec,
+                      alloc.host_hugepage,
+                      cpu_src_aloc,
+                      cuda_src_aloc,
+                      tm, num_vars, len, nrepeats);
+
+  test_copy_allocator(comminfo,
+                      exec,
+                      alloc.host_locked,
+                      cpu_src_aloc,
+                      cuda_src_aloc,
+                      tm, num_vars, len, nrepeats);
+
+  test_copy_allocator(comminfo,
+                      exec,
+                      alloc.host_numa_local,
+                      cpu_src_aloc,
+                      cuda_src_aloc,
+                      tm, num_vars, len, nrepeats);
+
+  test_copy_allocator(comminfo,
+                      exec,
+                      alloc.host_numa_interleave,
+                      cpu_src_aloc,
+                      cuda_src_aloc,
+                      tm, num_vars, len, nrepeats);
+
+  test_copy_allocator(comminfo,
+                      exec,
+                      alloc.host_numa_bind,
+                      cpu_src_aloc,
+                      cuda_src_aloc,
+                      tm, num_vars, len, nrepeats);
+
 #ifdef COMB_ENABLE_CUDA
 
   test_copy_allocator(comminfo,
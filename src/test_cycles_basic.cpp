@@ -47,6 +47,10 @@ void do_cycles_basic(CommContext<pol_comm>& con_comm_in,
                                                         pol_many::get_name(), aloc_many.name(), pol_few::get_name(), aloc_few.name());
   fgprintf(FileGroup::all, "Starting test %s\n", test_name);
 
+  if (comb_print_mempool_stats()) {
+    clear_allocator_statistics(aloc_mesh, aloc_many, aloc_few);
+  }
+
   {
     Range r0(test_name, Range::orange);
 
@@ -239,7 +243,7 @@ void do_cycles_basic(CommContext<pol_comm>& con_comm_in,
           }
           if (!mock_communication) {
             if (found != expected) {
-              FGPRINTF(FileGroup::proc, "%p %i zone %i(%i %i %i) g%i(%i %i %i) = %f expected %f next %f\n", data, branchid, zone, i, j, k, zone_global, iglobal, jglobal, kglobal, found, expected, next);
+              FGPRINTF(FileGroup::proc, "%p %i zone %li(%li %li %li) g%li(%li %li %li) = %f expected %f next %f\n", data, branchid, (long)zone, (long)i, (long)j, (long)k, (long)zone_global, (long)iglobal, (long)jglobal, (long)kglobal, found, expected, next);
             }
             // LOGPRINTF("%p[%i] = %f\n", data, zone, 1.0);
             assert(found == expected);
@@ -311,7 +315,7 @@ void do_cycles_basic(CommContext<pol_comm>& con_comm_in,
       //       branchid = 0;
       //       if (!mock_communication) {
       //         if (found != expected) {
-      //           FGPRINTF(FileGroup::proc, "%p %i zone %i(%i %i %i) g%i(%i %i %i) = %f expected %f next %f\n", data, branchid, zone, i, j, k, zone_global, iglobal, jglobal, kglobal, found, expected, next);
+      //           FGPRINTF(FileGroup::proc, "%p %i zone %li(%li %li %li) g%li(%li %li %li) = %f expected %f next %f\n", data, branchid, (long)zone, (long)i, (long)j, (long)k, (long)zone_global, (long)iglobal, (long)jglobal, (long)kglobal, found, expected, next);
       //         }
       //         // LOGPRINTF("%p[%i] = %f\n", data, zone, 1.0);
       //         assert(found == expected);
@@ -405,7 +409,7 @@ void do_cycles_basic(CommContext<pol_comm>& con_comm_in,
           }
           if (!mock_communication) {
             if (found != expected) {
-              FGPRINTF(FileGroup::proc, "%p %i zone %i(%i %i %i) g%i(%i %i %i) = %f expected %f next %f\n", data, branchid, zone, i, j, k, zone_global, iglobal, jglobal, kglobal, found, expected, next);
+              FGPRINTF(FileGroup::proc, "%p %i zone %li(%li %li %li) g%li(%li %li %li) = %f expected %f next %f\n", data, branchid, (long)zone, (long)i, (long)j, (long)k, (long)zone_global, (long)iglobal, (long)jglobal, (long)kglobal, found, expected, next);
             }
             // LOGPRINTF("%p[%i] = %f\n", data, zone, 1.0);
             assert(found == expected);
@@ -468,7 +472,7 @@ void do_cycles_basic(CommContext<pol_comm>& con_comm_in,
         con_mesh.for_all_3d(kmax - kmin,
                             jmax - jmin,
                             imax - imin,
-                            detail::set_1(ilen, ijlen, data, imin, jmin, kmin));
+                            detail::set_1<DataT>(ilen, ijlen, data, imin, jmin, kmin));
       }
 
       con_mesh.synchronize();
@@ -634,7 +638,7 @@ void do_cycles_basic(CommContext<pol_comm>& con_comm_in,
         con_mesh.for_all_3d(klen,
                             jlen,
                             ilen,
-                            detail::set_1(ilen, ijlen, data, 0, 0, 0));
+                            detail::set_1<DataT>(ilen, ijlen, data, 0, 0, 0));
       }
 
       con_mesh.synchronize();
@@ -659,7 +663,10 @@ void do_cycles_basic(CommContext<pol_comm>& con_comm_in,
   tm.clear();
   tm_total.clear();
 
-  // print_proc_memory_stats(comminfo);
+  if (comb_print_mempool_stats()) {
+    print_proc_memory_stats();
+    print_allocator_statistics(aloc_mesh, aloc_many, aloc_few);
+  }
 }
 
 
@@ -0,0 +1,54 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2018-2021, Lawrence Livermore National Security, LLC.
+//
+// Produced at the Lawrence Livermore National Laboratory
+//
+// LLNL-CODE-758885
+//
+// All rights reserved.
+//
+// This file is part of Comb.
+//
+// For details, see https://github.com/LLNL/Comb
+// Please also see the LICENSE file for MIT license.
+//////////////////////////////////////////////////////////////////////////////
+
+#include "comb.hpp"
+
+#ifdef COMB_ENABLE_MPI
+
+#include "comm_pol_mpi_shm.hpp"
+#include "do_cycles_allocators.hpp"
+
+namespace COMB {
+
+void test_cycles_mpi_shm(CommInfo& comminfo, MeshInfo& info,
+                         COMB::Executors& exec,
+                         COMB::Allocators& alloc,
+                         IdxT num_vars, IdxT ncycles, Timer& tm, Timer& tm_total)
+{
+  // the mesh is in node shared memory so on node partners can read it
+  MPISharedAllocatorInfo mesh_aloc{alloc.access, comminfo.cart.comm};
+  mesh_aloc.m_available = alloc.host.m_available;
+
+  CommContext<mpi_shm_pol> con_comm{exec.base_mpi.get(), mesh_aloc.shared_allocator()};
+
+  {
+    // mpi shm host memory tests
+    AllocatorInfo& cpu_many_aloc = alloc.host;
+    AllocatorInfo& cpu_few_aloc  = alloc.host;
+
+    do_cycles_allocator(con_comm,
+                        comminfo, info,
+                        exec,
+                        mesh_aloc,
+                        cpu_many_aloc, cpu_few_aloc,
+                        alloc.invalid, alloc.invalid,
+                        num_vars, ncycles, tm, tm_total);
+  }
+
+}
+
+} // namespace COMB
+
+#endif
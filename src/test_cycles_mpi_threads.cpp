@@ -0,0 +1,105 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2018-2021, Lawrence Livermore National Security, LLC.
+//
+// Produced at the Lawrence Livermore National Laboratory
+//
+// LLNL-CODE-758885
+//
+// All rights reserved.
+//
+// This file is part of Comb.
+//
+// For details, see https://github.com/LLNL/Comb
+// Please also see the LICENSE file for MIT license.
+//////////////////////////////////////////////////////////////////////////////
+
+#include "comb.hpp"
+
+#ifdef COMB_ENABLE_MPI
+
+#include "comm_pol_mpi_threads.hpp"
+#include "do_cycles_allocators.hpp"
+
+namespace COMB {
+
+void test_cycles_mpi_threads(CommInfo& comminfo, MeshInfo& info,
+                             COMB::Executors& exec,
+                             COMB::Allocators& alloc,
+                             IdxT num_vars, IdxT ncycles, Timer& tm, Timer& tm_total)
+{
+  // only make mpi calls from many threads if mpi allows it, every rank
+  // uses the same number of threads so both ranks of a pair agree on the
+  // thread that owns their messages
+  int num_threads = 1;
+#ifdef COMB_ENABLE_OPENMP
+  if (comminfo.thread_level == MPI_THREAD_MULTIPLE) {
+    num_threads = omp_get_max_threads();
+  }
+#endif
+  num_threads = comminfo.min(num_threads);
+
+  fgprintf(FileGroup::all, "mpi_threads using %i threads with mpi thread support %s%s\n",
+      num_threads, CommInfo::thread_level_str(comminfo.thread_level),
+      (comb_allow_per_thread_comms() && num_threads > 1) ? " and per thread comms" : "");
+
+  CommContext<mpi_threads_pol> con_comm{exec.base_mpi.get(), num_threads};
+
+  {
+    // mpi threads host memory tests
+    AllocatorInfo& cpu_many_aloc = alloc.host;
+    AllocatorInfo& cpu_few_aloc  = alloc.host;
+
+    do_cycles_allocator(con_comm,
+                        comminfo, info,
+                        exec,
+                        alloc.host,
+                        cpu_many_aloc, cpu_few_aloc,
+                        alloc.invalid, alloc.invalid,
+                        num_vars, ncycles, tm, tm_total);
+
+    do_cycles_allocator(con_comm,
+                        comminfo, info,
+                        exec,
+                        alloc.host_hugepage,
+                        alloc.host_hugepage, alloc.host_hugepage,
+                        alloc.invalid, alloc.invalid,
+                        num_vars, ncycles, tm, tm_total);
+
+    do_cycles_allocator(con_comm,
+                        comminfo, info,
+                        exec,
+                        alloc.host_locked,
+                        alloc.host_locked, alloc.host_locked,
+                        alloc.invalid, alloc.invalid,
+                        num_vars, ncycles, tm, tm_total);
+
+    do_cycles_allocator(con_comm,
+                        comminfo, info,
+                        exec,
+                        alloc.host_numa_local,
+                        alloc.host_numa_local, alloc.host_numa_local,
+                        alloc.invalid, alloc.invalid,
+                        num_vars, ncycles, tm, tm_total);
+
+    do_cycles_allocator(con_comm,
+                        comminfo, info,
+                        exec,
+                        alloc.host_numa_interleave,
+                        alloc.host_numa_interleave, alloc.host_numa_interleave,
+                        alloc.invalid, alloc.invalid,
+                        num_vars, ncycles, tm, tm_total);
+
+    do_cycles_allocator(con_comm,
+                        comminfo, info,
+                        exec,
+                        alloc.host_numa_bind,
+                        alloc.host_numa_bind, alloc.host_numa_bind,
+                        alloc.invalid, alloc.invalid,
+                        num_vars, ncycles, tm, tm_total);
+  }
+
+}
+
+} // namespace COMB
+
+#endif
@@ -0,0 +1,148 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2018-2021, Lawrence Livermore National Security, LLC.
+//
+// Produced at the Lawrence Livermore National Laboratory
+//
+// LLNL-CODE-758885
+//
+// All rights reserved.
+//
+// This file is part of Comb.
+//
+// For details, see https://github.com/LLNL/Comb
+// Please also see the LICENSE file for MIT license.
+//////////////////////////////////////////////////////////////////////////////
+
+#include "comb.hpp"
+
+#include "basic_mempool.hpp"
+#include "sizeclass_mempool.hpp"
+
+namespace COMB {
+
+// buffer sizes of the messages this rank sends to or receives from each
+// neighbor holding all variables
+static std::vector<size_t> neighbor_message_sizes(MeshInfo& info, IdxT num_vars)
+{
+  std::vector<size_t> sizes;
+  for (IdxT k = -1; k <= 1; ++k) {
+    for (IdxT j = -1; j <= 1; ++j) {
+      for (IdxT i = -1; i <= 1; ++i) {
+        IdxT dirs[3] {i, j, k};
+        if (i == 0 && j == 0 && k == 0) continue;
+        size_t nbytes = num_vars * sizeof(DataT);
+        for (IdxT dim = 0; dim < 3; ++dim) {
+          nbytes *= (dirs[dim] == 0) ? info.size[dim] : info.ghost_widths[dim];
+        }
+        if (nbytes > 0) {
+          sizes.push_back(nbytes);
+        }
+      }
+    }
+  }
+  return sizes;
+}
+
+using basic_pool = COMBRAJA::basic_mempool::MemPool<COMBRAJA::basic_mempool::generic_allocator>;
+using sizeclass_pool = COMB::sizeclass_mempool::MemPool<COMBRAJA::basic_mempool::generic_allocator>;
+
+// the basic pool keeps no statistics
+static void clear_mempool_statistics(basic_pool&)
+{
+}
+
+static void print_mempool_statistics(const char*, basic_pool&)
+{
+}
+
+static void clear_mempool_statistics(sizeclass_pool& pool)
+{
+  pool.clear_statistics();
+}
+
+static void print_mempool_statistics(const char* pool_name, sizeclass_pool& pool)
+{
+  COMB::sizeclass_mempool::print_statistics(pool_name, pool);
+}
+
+template < typename pool_type >
+void do_mempool(CommInfo& comminfo, const char* pool_name, pool_type& pool,
+                std::vector<size_t> const& sizes,
+                Timer& tm, IdxT nrepeats)
+{
+  tm.clear();
+
+  char test_name[1024] = ""; snprintf(test_name, 1024, "mempool %s", pool_name);
+  fgprintf(FileGroup::all, "Starting test %s\n", test_name);
+
+  Range r(test_name, Range::green);
+
+  CPUContext tm_con;
+
+  const IdxT num_msgs = sizes.size();
+  std::vector<char*> recv_bufs(num_msgs, nullptr);
+  std::vector<char*> send_bufs(num_msgs, nullptr);
+
+  // the first repeat fills the pool and is not timed, with openmp threads
+  // own messages like mpi_threads and free messages other threads allocated
+  for (IdxT rep = 0; rep <= nrepeats; ++rep) {
+
+    if (rep == 1) {
+      clear_mempool_statistics(pool);
+    }
+
+    if (rep > 0) tm.start(tm_con, "malloc");
+#ifdef COMB_ENABLE_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (IdxT m = 0; m < num_msgs; ++m) {
+      recv_bufs[m] = pool.template malloc<char>(sizes[m]);
+      send_bufs[m] = pool.template malloc<char>(sizes[m]);
+    }
+    if (rep > 0) tm.stop(tm_con);
+
+    // messages complete in a different order every cycle
+    if (rep > 0) tm.start(tm_con, "free");
+#ifdef COMB_ENABLE_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (IdxT m = 0; m < num_msgs; ++m) {
+      pool.free(recv_bufs[(m + rep) % num_msgs]);
+      pool.free(send_bufs[(num_msgs - 1 - m + rep) % num_msgs]);
+    }
+    if (rep > 0) tm.stop(tm_con);
+  }
+
+  print_timer(comminfo, tm);
+  tm.clear();
+
+  print_mempool_statistics(pool_name, pool);
+
+  pool.free_chunks();
+}
+
+void test_mempool(CommInfo& comminfo, MeshInfo& info,
+                  Timer& tm, IdxT num_vars, IdxT nrepeats)
+{
+  Range r0("test_mempool", Range::green);
+
+  std::vector<size_t> sizes = neighbor_message_sizes(info, num_vars);
+
+  {
+    basic_pool pool;
+    do_mempool(comminfo, "basic", pool, sizes, tm, nrepeats);
+  }
+
+  {
+    sizeclass_pool pool;
+    pool.cache_size(0);
+    do_mempool(comminfo, "sizeclass uncached", pool, sizes, tm, nrepeats);
+  }
+
+  {
+    sizeclass_pool pool;
+    do_mempool(comminfo, "sizeclass", pool, sizes, tm, nrepeats);
+  }
+}
+
+} // namespace COMB
@@ -56,6 +56,14 @@ void warmup(COMB::Executors& exec,
   do_warmup(exec.omp.get(), alloc.host.allocator(), tm, num_vars, len);
 #endif
 
+  if (alloc.host_hugepage.available()) {
+    do_warmup(exec.seq.get(), alloc.host_hugepage.allocator(), tm, num_vars, len);
+  }
+
+  if (alloc.host_locked.available()) {
+    do_warmup(exec.seq.get(), alloc.host_locked.allocator(), tm, num_vars, len);
+  }
+
 #ifdef COMB_ENABLE_CUDA
   do_warmup(exec.seq.get(), alloc.cuda_hostpinned.allocator(), tm, num_vars, len);
 